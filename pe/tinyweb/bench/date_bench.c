@@ -0,0 +1,286 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ * Fuzz test and microbenchmark of the HTTP-date routines of
+ * src/http_date.c against strptime()/mktime() and gmtime()/strftime().
+ * The fuzz test runs first, a mismatch ends the program with an error.
+ *
+ *===================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "http_date.h"
+
+#define DEFAULT_ITERATIONS          1000000
+#define FUZZ_ROUNDS                 1000000
+#define MIN_LIBC_TIME      (-2208988800LL)  // 1900-01-01, strftime() pads %Y from here on
+#define MAX_TIME            253402300799LL  // 9999-12-31T23:59:59
+#define RFC850_FIRST                    0LL // 1970-01-01, two digit years cover 1970 to 2069
+#define RFC850_LAST         3155759999LL    // 2069-12-31T23:59:59
+#define DATE_SIZE                      64
+
+
+static unsigned long long rng_state = 88172645463325252ull;
+
+
+/**
+ * Draw a pseudo random number with xorshift64.
+ * @return          the number
+ */
+static unsigned long long
+next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+} /* end of next_random */
+
+/**
+ * Draw a time from a range.
+ * @input_param     the first time
+ * @input_param     the last time
+ * @return          the time
+ */
+static time_t
+random_time(long long first, long long last) {
+    return first + (long long) (next_random() % (unsigned long long) (last - first + 1));
+} /* end of random_time */
+
+/**
+ * Report a failed check and end the program.
+ * @input_param     the check
+ * @input_param     the input
+ * @input_param     the time
+ */
+static void
+fail(const char *check, const char *input, long long t) {
+    fprintf(stderr, "FAILED %s: '%s' (%lld)\n", check, input, t);
+    exit(EXIT_FAILURE);
+} /* end of fail */
+
+/**
+ * Compare the routines with the C library on random times and parse
+ * the obsolete formats, which the server never sends.
+ * @input_param     the number of rounds
+ */
+static void
+fuzz_round_trip(long rounds) {
+    char own[DATE_SIZE];
+    char libc[DATE_SIZE];
+    struct tm tm;
+    time_t t, parsed;
+    long i;
+
+    for (i = 0; i < rounds; i++) {
+        t = random_time(MIN_LIBC_TIME, MAX_TIME);
+        http_date_format(t, own);
+        gmtime_r(&t, &tm);
+        strftime(libc, sizeof (libc), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        if (strcmp(own, libc) != 0) {
+            fail("format", own, t);
+        } /* end if */
+        if (!http_date_parse(own, strlen(own), &parsed) || parsed != t) {
+            fail("IMF-fixdate", own, t);
+        } /* end if */
+
+        strftime(libc, sizeof (libc), "%a %b %e %H:%M:%S %Y", &tm);
+        if (!http_date_parse(libc, strlen(libc), &parsed) || parsed != t) {
+            fail("asctime", libc, t);
+        } /* end if */
+
+        t = random_time(RFC850_FIRST, RFC850_LAST);
+        gmtime_r(&t, &tm);
+        strftime(libc, sizeof (libc), "%A, %d-%b-%y %H:%M:%S GMT", &tm);
+        if (!http_date_parse(libc, strlen(libc), &parsed) || parsed != t) {
+            fail("RFC 850", libc, t);
+        } /* end if */
+    } /* end for */
+} /* end of fuzz_round_trip */
+
+/**
+ * Parse damaged dates: an accepted date has to format back to itself,
+ * except for a leap second, which moves to the next minute.
+ * @input_param     the number of rounds
+ * @return          the number of accepted mutants
+ */
+static long
+fuzz_mutations(long rounds) {
+    static const char alphabet[] = "0123456789 ,:-GMTSunMonTueNovFeb\t\r\n\x80";
+    char date[DATE_SIZE];
+    char again[DATE_SIZE];
+    size_t len;
+    time_t t, parsed;
+    long accepted = 0;
+    long i;
+    int n;
+
+    for (i = 0; i < rounds; i++) {
+        http_date_format(random_time(MIN_LIBC_TIME, MAX_TIME), date);
+        len = HTTP_DATE_LEN;
+        for (n = next_random() % 3 + 1; n > 0; n--) {
+            switch (next_random() % 4) {
+                case 0:
+                    len = next_random() % (len + 1);
+                    break;
+                case 1:
+                    if (len < DATE_SIZE - 1) {
+                        date[len++] = alphabet[next_random() % (sizeof (alphabet) - 1)];
+                    } /* end if */
+                    break;
+                default:
+                    if (len > 0) {
+                        date[next_random() % len] = alphabet[next_random() % (sizeof (alphabet) - 1)];
+                    } /* end if */
+                    break;
+            } /* end switch */
+        } /* end for */
+        date[len] = '\0';
+
+        t = 0;
+        if (http_date_parse(date, len, &t)) {
+            accepted++;
+            http_date_format(t, again);
+            if (strcmp(date, again) != 0 && strstr(date, ":60 ") == NULL) {
+                fail("mutant", date, t);
+            } /* end if */
+            if (!http_date_parse(again, strlen(again), &parsed) || parsed != t) {
+                fail("mutant round trip", again, t);
+            } /* end if */
+        } /* end if */
+    } /* end for */
+
+    return accepted;
+} /* end of fuzz_mutations */
+
+/**
+ * Check dates which have to be rejected.
+ */
+static void
+check_invalid(void) {
+    static const char *invalid[] = {
+        "Sun, 06 Nov 1994 08:49:37",            // no zone
+        "Sun, 06 Nov 1994 08:49:37 UTC",        // only GMT
+        "Mon, 06 Nov 1994 08:49:37 GMT",        // wrong day of the week
+        "Sun, 6 Nov 1994 08:49:37 GMT",         // one digit day
+        "sun, 06 nov 1994 08:49:37 GMT",        // names are case-sensitive
+        "Tue, 29 Feb 2100 00:00:00 GMT",        // no leap year
+        "Sun, 31 Apr 1994 08:49:37 GMT",
+        "Sun, 06 Nov 1994 24:00:00 GMT",
+        "Sun, 06 Nov 1994 08:60:00 GMT",
+        "Sun, 06 Nov 1994 08:49:61 GMT",
+        "Sun, 06 Nov 1994 08:49:37 GMT ",       // trailing garbage
+        "Sun, 06 Nov 94 08:49:37 GMT",
+        "Sunday, 06-Nov-1994 08:49:37 GMT",
+        "Sun Nov 6 08:49:37 1994",
+        "",
+        NULL
+    };
+    time_t t;
+    int i;
+
+    for (i = 0; invalid[i] != NULL; i++) {
+        if (http_date_parse(invalid[i], strlen(invalid[i]), &t)) {
+            fail("invalid date accepted", invalid[i], t);
+        } /* end if */
+    } /* end for */
+} /* end of check_invalid */
+
+/**
+ * Return the time elapsed since a start time.
+ * @input_param     the start time
+ * @return          the elapsed time in seconds
+ */
+static double
+elapsed(struct timespec *start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+} /* end of elapsed */
+
+/**
+ * Print one result line.
+ * @input_param     the name of the variant
+ * @input_param     the number of operations
+ * @input_param     the elapsed time in seconds
+ */
+static void
+print_result(char *name, long iterations, double seconds) {
+    printf("%-24s %10.1f ns/op %12.0f op/s\n", name, seconds * 1e9 / iterations, iterations / seconds);
+} /* end of print_result */
+
+int
+main(int argc, char *argv[]) {
+    long iterations = DEFAULT_ITERATIONS;
+    const char *sample = "Sun, 06 Nov 1994 08:49:37 GMT";
+    char buf[DATE_SIZE];
+    struct timespec start;
+    struct tm tm;
+    time_t t = 784111777;
+    long long sum = 0;
+    long accepted;
+    long i;
+
+    if (argc > 1) {
+        iterations = atol(argv[1]);
+        if (iterations <= 0) {
+            fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        } /* end if */
+    } /* end if */
+
+    // the former parser needs the time zone for mktime()
+    setenv("TZ", "GMT", 1);
+    tzset();
+
+    check_invalid();
+    fuzz_round_trip(FUZZ_ROUNDS);
+    accepted = fuzz_mutations(FUZZ_ROUNDS);
+    printf("fuzz: %d round trips, %d mutants, %ld accepted, all consistent\n",
+            FUZZ_ROUNDS, FUZZ_ROUNDS, accepted);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < iterations; i++) {
+        memset(&tm, 0, sizeof (tm));
+        strptime(sample, "%a, %d %b %Y %H:%M:%S", &tm);
+        sum += mktime(&tm);
+    } /* end for */
+    print_result("parse strptime/mktime", iterations, elapsed(&start));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < iterations; i++) {
+        http_date_parse(sample, HTTP_DATE_LEN, &t);
+        sum += t;
+    } /* end for */
+    print_result("parse http_date", iterations, elapsed(&start));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < iterations; i++) {
+        t = 784111777 + i;
+        gmtime_r(&t, &tm);
+        sum += strftime(buf, sizeof (buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    } /* end for */
+    print_result("format gmtime/strftime", iterations, elapsed(&start));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < iterations; i++) {
+        http_date_format(784111777 + i, buf);
+        sum += buf[24];
+    } /* end for */
+    print_result("format http_date", iterations, elapsed(&start));
+
+    // keep the loops from being optimised away
+    if (sum == 42) {
+        printf("%lld\n", sum);
+    } /* end if */
+
+    exit(EXIT_SUCCESS);
+} /* end of main */
@@ -0,0 +1,188 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ * Microbenchmark of the response header generation: the header
+ * builder against the former malloc/strcat based functions.
+ *
+ *===================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "tinyweb.h"
+#include "http.h"
+#include "content.h"
+#include "header_builder.h"
+#include "legacy_header.h"
+
+#define DEFAULT_ITERATIONS          500000
+#define DEFAULT_FILE       "../web/index.html"
+
+
+/**
+ * Return the time elapsed since a start time.
+ * @input_param     the start time
+ * @return          the elapsed time in seconds
+ */
+static double
+elapsed(struct timespec *start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+} /* end of elapsed */
+
+/**
+ * Print one result line.
+ * @input_param     the name of the variant
+ * @input_param     the header length
+ * @input_param     the number of built headers
+ * @input_param     the elapsed time in seconds
+ */
+static void
+print_result(char *name, size_t len, long iterations, double seconds) {
+    printf("%-24s %6zu bytes %10.1f ns/resp %12.0f resp/s\n", name, len,
+            seconds * 1e9 / iterations, iterations / seconds);
+} /* end of print_result */
+
+/**
+ * Build headers with the former functions.
+ * @input_param     the file path
+ * @input_param     the file status
+ * @input_param     the first byte of a range or -2
+ * @input_param     the number of iterations
+ * @output_param    the header
+ * @return          the elapsed time in seconds
+ */
+static double
+bench_legacy(char *filepath, struct stat fstat, int start, long iterations, char *header) {
+    legacy_http_header_t data;
+    struct timespec begin;
+    long i;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (i = 0; i < iterations; i++) {
+        memset(&data, 0, sizeof (data));
+        data.status = http_status_list[start >= 0 ? HTTP_STATUS_PARTIAL_CONTENT : HTTP_STATUS_OK];
+        data.connection = "Connection: keep-alive\r\n";
+        legacy_create_response_header(filepath, &data, fstat, start, start >= 0 ? 0 : -2);
+        legacy_create_response_header_string(data, header);
+        legacy_free_response_header(&data);
+    } /* end for */
+
+    return elapsed(&begin);
+} /* end of bench_legacy */
+
+/**
+ * Build headers with the header builder, as process_request() does
+ * for a file which is not cached.
+ * @input_param     the file path
+ * @input_param     the file status
+ * @input_param     the first byte of a range or -1
+ * @input_param     the number of iterations
+ * @output_param    the header
+ * @input_param     the size of the header buffer
+ * @return          the elapsed time in seconds
+ */
+static double
+bench_builder(char *filepath, struct stat fstat, off_t start, long iterations, char *header, size_t size) {
+    header_builder_t hb;
+    struct timespec begin;
+    long i;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (i = 0; i < iterations; i++) {
+        header_init(&hb, header, size);
+        header_add_status(&hb, start >= 0 ? HTTP_STATUS_PARTIAL_CONTENT : HTTP_STATUS_OK);
+        header_add_number(&hb, HTTP_HEADER_CONTENT_LENGTH, fstat.st_size - (start >= 0 ? start : 0));
+        header_add_field(&hb, HTTP_HEADER_CONTENT_TYPE, get_http_content_type_str(get_http_content_type(filepath)));
+        header_add_time(&hb, HTTP_HEADER_LAST_MODIFIED, fstat.st_mtime);
+        if (start >= 0) {
+            header_add_range(&hb, start, fstat.st_size - 1, fstat.st_size);
+        } /* end if */
+        header_add_field(&hb, HTTP_HEADER_CONNECTION, "keep-alive");
+        header_finish(&hb);
+    } /* end for */
+
+    return elapsed(&begin);
+} /* end of bench_builder */
+
+/**
+ * Build headers with the header builder and the prebuilt fields of a
+ * cached file.
+ * @input_param     the prebuilt fields
+ * @input_param     the number of iterations
+ * @output_param    the header
+ * @input_param     the size of the header buffer
+ * @return          the elapsed time in seconds
+ */
+static double
+bench_cached(header_builder_t *fields, long iterations, char *header, size_t size) {
+    header_builder_t hb;
+    struct timespec begin;
+    long i;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (i = 0; i < iterations; i++) {
+        header_init(&hb, header, size);
+        header_add_status(&hb, HTTP_STATUS_OK);
+        header_add_raw(&hb, fields->buf, fields->len);
+        header_add_field(&hb, HTTP_HEADER_CONNECTION, "keep-alive");
+        header_finish(&hb);
+    } /* end for */
+
+    return elapsed(&begin);
+} /* end of bench_cached */
+
+int
+main(int argc, char *argv[]) {
+    long iterations = DEFAULT_ITERATIONS;
+    char *filepath = DEFAULT_FILE;
+    char header[BUFFER_SIZE];
+    char prebuilt[256];
+    header_builder_t fields;
+    struct stat fstat;
+    double seconds;
+
+    if (argc > 1) {
+        iterations = atol(argv[1]);
+    } /* end if */
+    if (argc > 2) {
+        filepath = argv[2];
+    } /* end if */
+    if (iterations <= 0 || stat(filepath, &fstat) < 0) {
+        fprintf(stderr, "Usage: %s [iterations [file]]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    } /* end if */
+
+    setenv("TZ", "GMT", 1);
+    tzset();
+
+    header[0] = '\0';
+    seconds = bench_legacy(filepath, fstat, -2, iterations, header);
+    print_result("legacy 200", strlen(header), iterations, seconds);
+    header[0] = '\0';
+    seconds = bench_legacy(filepath, fstat, 100, iterations, header);
+    print_result("legacy 206", strlen(header), iterations, seconds);
+
+    seconds = bench_builder(filepath, fstat, -1, iterations, header, sizeof (header));
+    print_result("builder 200", strstr(header, "\r\n\r\n") + 4 - header, iterations, seconds);
+    seconds = bench_builder(filepath, fstat, 100, iterations, header, sizeof (header));
+    print_result("builder 206", strstr(header, "\r\n\r\n") + 4 - header, iterations, seconds);
+
+    header_init(&fields, prebuilt, sizeof (prebuilt));
+    header_add_number(&fields, HTTP_HEADER_CONTENT_LENGTH, fstat.st_size);
+    header_add_field(&fields, HTTP_HEADER_CONTENT_TYPE, get_http_content_type_str(get_http_content_type(filepath)));
+    header_add_time(&fields, HTTP_HEADER_LAST_MODIFIED, fstat.st_mtime);
+    seconds = bench_cached(&fields, iterations, header, sizeof (header));
+    print_result("builder 200, cached", strstr(header, "\r\n\r\n") + 4 - header, iterations, seconds);
+
+    exit(EXIT_SUCCESS);
+} /* end of main */
@@ -0,0 +1,140 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ * The response header functions tinyweb used before the header
+ * builder, kept as a reference for header_bench.
+ *
+ *===================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "http.h"
+#include "content.h"
+#include "legacy_header.h"
+
+
+/**
+ * create the response header fields, each one is allocated
+ * @input_param     the path to requested file
+ * @output_param    the response header data
+ * @input_param     the file status
+ * @input_param     the first byte of a range or -2
+ * @input_param     the last byte of a range or -2
+ * @return          unequal zero in case of error
+ */
+int
+legacy_create_response_header(char *filepath, legacy_http_header_t *response_header_data, struct stat fstat, int start, int end) {
+
+    // content-type
+    char *content_type_str;
+    http_content_type_t content_type;
+    content_type = get_http_content_type(filepath);
+    content_type_str = get_http_content_type_str(content_type);
+    int size = strlen(http_header_field_list[4]) + strlen(content_type_str) + strlen("\r\n") + 1;
+    response_header_data->content_type = malloc(size);
+    snprintf(response_header_data->content_type, size, "%s%s\r\n", http_header_field_list[4], content_type_str);
+
+
+    struct tm * timeinfo;
+    char timeString[80];
+    timeinfo = localtime(&fstat.st_mtime);
+    strftime(timeString, 80, "%a, %d %b %Y %H:%M:%S GMT", timeinfo);
+    size = strlen(http_header_field_list[2]) + strlen(timeString) + strlen("\r\n") + 1;
+    response_header_data->last_modified = malloc(size);
+    snprintf(response_header_data->last_modified, size, "%s%s\r\n", http_header_field_list[2], timeString);
+
+    // content-range
+    if ((start != -2) && (end != -2)) { /* for partial content */
+        size = strlen(http_header_field_list[8]) + sizeof (int)*3 + strlen("bytes -/\r\n") + 1;
+        response_header_data->content_range = malloc(size);
+        int endOfRange = fstat.st_size - 1;
+        snprintf(response_header_data->content_range, size, "%sbytes %d-%d/%d\r\n", http_header_field_list[8], start, endOfRange, (int) fstat.st_size);
+
+        int size = strlen(http_header_field_list[3]) + sizeof (int) +strlen("\r\n") + 1;
+        int range_length = fstat.st_size - start;
+        response_header_data->content_length = malloc(size);
+        snprintf(response_header_data->content_length, size, "%s%d\r\n", http_header_field_list[3], range_length);
+    } else {
+        // content-length, content type, und last modified
+        size = strlen(http_header_field_list[3]) + sizeof (long long) +strlen("\r\n") + 1;
+        response_header_data->content_length = malloc(size);
+        snprintf(response_header_data->content_length, size, "%s%lld\r\n", http_header_field_list[3], (long long) fstat.st_size);
+    }
+
+    // TODO: return retcode instead of 0
+    return 0;
+} /* end of legacy_create_response_header */
+
+/**
+ * create the response header string
+ * @input_param     the response header data
+ * @output_param    the response header string
+ * @return          unequal zero in case of error
+ */
+int
+legacy_create_response_header_string(legacy_http_header_t response_header_data, char* response_header_string) {
+    // status
+    snprintf(response_header_string, 50, "%s %hu %s\r\n", "HTTP/1.1", response_header_data.status.code, response_header_data.status.text);
+
+    // server
+    char server[30];
+    snprintf(server, 30, "%s%s\r\n", http_header_field_list[1], "Tinyweb 1.1");
+    strcat(response_header_string, server);
+
+    // date
+    char timeString [80];
+    char date [100];
+    time_t rawtime;
+    struct tm * timeinfo;
+    time(&rawtime);
+    timeinfo = localtime(&rawtime);
+    strftime(timeString, 80, "%a, %d %b %Y %H:%M:%S", timeinfo);
+    snprintf(date, sizeof (date), "%s%s\r\n", http_header_field_list[0], timeString);
+    strcat(response_header_string, date);
+
+    if (response_header_data.content_length != NULL) {
+        //content length
+        strcat(response_header_string, response_header_data.content_length);
+    }
+    if (response_header_data.content_type != NULL) {
+        //content type
+        strcat(response_header_string, response_header_data.content_type);
+    }
+    if (response_header_data.last_modified != NULL) {
+        //last modified
+        strcat(response_header_string, response_header_data.last_modified);
+    }
+    if (response_header_data.content_location != NULL) {
+        strcat(response_header_string, response_header_data.content_location);
+    }
+    if (response_header_data.content_range != NULL) {
+        strcat(response_header_string, response_header_data.content_range);
+    }
+    if (response_header_data.connection != NULL) {
+        strcat(response_header_string, response_header_data.connection);
+    }
+    // end header
+    strcat(response_header_string, "\r\n");
+    return 0;
+} /* end of legacy_create_response_header_string */
+
+/**
+ * free the fields allocated by legacy_create_response_header()
+ * @input_param     the response header data
+ */
+void
+legacy_free_response_header(legacy_http_header_t *response_header_data) {
+    free(response_header_data->content_type);
+    free(response_header_data->last_modified);
+    free(response_header_data->content_length);
+    free(response_header_data->content_range);
+} /* end of legacy_free_response_header */
@@ -0,0 +1,33 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _LEGACY_HEADER_H
+#define _LEGACY_HEADER_H
+
+#include <sys/stat.h>
+
+#include "http.h"
+
+typedef struct legacy_http_header {
+    http_status_entry_t status;
+    char    *date;
+    char    *server;
+    char    *last_modified;
+    char    *content_length;
+    char    *content_type;
+    char    *connection;
+    char    *accept_ranges;
+    char    *content_location;
+    char    *content_range;
+} legacy_http_header_t;
+
+extern int legacy_create_response_header(char *filepath, legacy_http_header_t *response_header_data, struct stat fstat, int start, int end);
+extern int legacy_create_response_header_string(legacy_http_header_t response_header_data, char* response_header_string);
+extern void legacy_free_response_header(legacy_http_header_t *response_header_data);
+#endif
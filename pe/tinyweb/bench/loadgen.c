@@ -0,0 +1,902 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ * HTTP load generator: keeps a number of connections busy with
+ * requests from a URL mix, optionally persistent and pipelined, and
+ * reports the request rate, the transfer rate and the latency
+ * distribution. Every thread drives its share of the connections with
+ * its own epoll instance.
+ *
+ * The latency of a request is the time from sending the request, or
+ * from starting the connect for a non-persistent connection, until the
+ * last byte of its response was received.
+ *
+ *===================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define DEFAULT_HOST           "localhost"
+#define DEFAULT_PORT                "8080"
+#define DEFAULT_CONNECTIONS             50
+#define DEFAULT_SECONDS                  5
+#define MAX_PIPELINE                    64
+#define MAX_URLS                        32
+#define MAX_SCHEDULE                   256   // weighted URL sequence of a mix
+#define REQUEST_SIZE                   512
+#define RESPONSE_BUFFER_SIZE         65536
+
+/*
+ * Latency histogram in microseconds: values below 2 * HIST_SUB are
+ * counted exactly, above every power of two is divided into HIST_SUB
+ * buckets, which keeps the relative error below 2 %.
+ */
+#define HIST_SUB_BITS                    6
+#define HIST_SUB        (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS         (40 * HIST_SUB)
+
+
+typedef struct url_entry {
+    char *path;
+    char *extra;                // additional header fields or NULL
+    int status;                 // expected status, 0 accepts 2xx and 3xx
+    int weight;
+} url_entry_t;
+
+typedef struct url_mix {
+    char *name;
+    url_entry_t urls[MAX_URLS];
+} url_mix_t;
+
+typedef struct request {
+    char text[REQUEST_SIZE];
+    size_t len;
+    int status;
+} request_t;
+
+typedef struct stats {
+    unsigned long long requests;
+    unsigned long long bytes;
+    unsigned long long errors;          // connect, reset and protocol errors
+    unsigned long long unexpected;      // responses with an unexpected status
+    unsigned long long connects;
+    unsigned long long status_class[6];
+    unsigned long long hist[HIST_BUCKETS];
+    unsigned long long max_us;
+} stats_t;
+
+typedef enum lg_state {
+    LG_CONNECTING = 0,
+    LG_ACTIVE
+} lg_state_t;
+
+typedef struct lg_conn {
+    int fd;
+    lg_state_t state;
+    unsigned int next;                  // position in the schedule
+    long long connect_start;
+    // requests sent but not answered yet, oldest first
+    long long sent_at[MAX_PIPELINE];
+    int sent_request[MAX_PIPELINE];
+    int inflight_first;
+    int inflight;
+    // pending output
+    char out[MAX_PIPELINE * REQUEST_SIZE];
+    size_t out_len;
+    size_t out_off;
+    // response being received
+    char in[RESPONSE_BUFFER_SIZE];
+    size_t in_len;
+    bool in_body;
+    long long body_left;                // -1 until the connection closes
+    int status;
+    bool server_closes;
+    size_t response_bytes;
+} lg_conn_t;
+
+typedef struct worker {
+    pthread_t thread;
+    int connections;
+    stats_t stats;
+} worker_t;
+
+
+/*
+ * The URL mixes refer to the files of the web directory. %s in the
+ * extra header fields is replaced by the start time of the run.
+ */
+static url_mix_t mixes[] = {
+    { "small", {
+        { "/index.html", NULL, 200, 1 },
+        { NULL, NULL, 0, 0 } } },
+    { "pdf", {
+        { "/example.pdf", NULL, 200, 1 },
+        { NULL, NULL, 0, 0 } } },
+    { "range", {
+        { "/zeros3.jpg", "Range: bytes=100-\r\n", 206, 1 },
+        { NULL, NULL, 0, 0 } } },
+    { "304", {
+        { "/index.html", "If-Modified-Since: %s\r\n", 304, 1 },
+        { NULL, NULL, 0, 0 } } },
+    { "mixed", {
+        { "/index.html", NULL, 200, 8 },
+        { "/css/default.css", NULL, 200, 4 },
+        { "/images/computerhead1.gif", NULL, 200, 4 },
+        { "/index.html", "If-Modified-Since: %s\r\n", 304, 4 },
+        { "/zeros3.jpg", "Range: bytes=100-\r\n", 206, 2 },
+        { "/example.pdf", NULL, 200, 1 },
+        { "/missing.html", NULL, 404, 1 },
+        { NULL, NULL, 0, 0 } } },
+    { NULL, { { NULL, NULL, 0, 0 } } }
+};
+
+
+static struct sockaddr_storage server_addr;
+static socklen_t server_addrlen;
+static char *host = DEFAULT_HOST;
+static bool keep_alive = true;
+static int pipeline = 1;
+static bool fast_open = false;              // send the first request with the SYN
+static request_t requests[MAX_URLS];
+static int schedule[MAX_SCHEDULE];
+static unsigned int schedule_len = 0;
+static volatile sig_atomic_t running = 1;
+
+
+/**
+ * Return the current time in nanoseconds.
+ * @return          the time
+ */
+static long long
+now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+} /* end of now_ns */
+
+/**
+ * Return the histogram bucket of a latency.
+ * @input_param     the latency in microseconds
+ * @return          the bucket
+ */
+static int
+hist_bucket(unsigned long long us) {
+    int shift;
+    int bucket;
+
+    if (us < 2 * HIST_SUB) {
+        return (int) us;
+    } /* end if */
+
+    shift = 63 - __builtin_clzll(us) - HIST_SUB_BITS;
+    bucket = (shift + 1) * HIST_SUB + (int) (us >> shift) - HIST_SUB;
+
+    return (bucket < HIST_BUCKETS) ? bucket : HIST_BUCKETS - 1;
+} /* end of hist_bucket */
+
+/**
+ * Return the smallest latency counted in a histogram bucket.
+ * @input_param     the bucket
+ * @return          the latency in microseconds
+ */
+static unsigned long long
+hist_value(int bucket) {
+    int shift;
+
+    if (bucket < 2 * HIST_SUB) {
+        return bucket;
+    } /* end if */
+
+    shift = bucket / HIST_SUB - 1;
+    return (unsigned long long) (bucket % HIST_SUB + HIST_SUB) << shift;
+} /* end of hist_value */
+
+/**
+ * Return a percentile of the latency histogram.
+ * @input_param     the statistics
+ * @input_param     the percentile, e.g. 99.9
+ * @return          the latency in microseconds
+ */
+static unsigned long long
+hist_percentile(const stats_t *stats, double percentile) {
+    unsigned long long rank;
+    unsigned long long count = 0;
+    int i;
+
+    if (stats->requests == 0) {
+        return 0;
+    } /* end if */
+
+    rank = (unsigned long long) (stats->requests * percentile / 100.0);
+    if (rank >= stats->requests) {
+        rank = stats->requests - 1;
+    } /* end if */
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        count += stats->hist[i];
+        if (count > rank) {
+            return hist_value(i);
+        } /* end if */
+    } /* end for */
+
+    return stats->max_us;
+} /* end of hist_percentile */
+
+/**
+ * Build the requests of a URL mix and its weighted schedule.
+ * @input_param     the URL entries
+ * @return          -1 in case of error
+ */
+static int
+build_requests(url_entry_t *urls) {
+    char date[64];
+    char extra[REQUEST_SIZE / 2];
+    time_t now = time(NULL);
+    int len;
+    int i;
+    int w;
+
+    strftime(date, sizeof (date), "%a, %d %b %Y %H:%M:%S GMT", gmtime(&now));
+
+    schedule_len = 0;
+    for (i = 0; i < MAX_URLS && urls[i].path != NULL; i++) {
+        extra[0] = '\0';
+        if (urls[i].extra != NULL) {
+            snprintf(extra, sizeof (extra), urls[i].extra, date);
+        } /* end if */
+        len = snprintf(requests[i].text, REQUEST_SIZE,
+                "GET %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: tinyweb-loadgen\r\n%s%s\r\n",
+                urls[i].path, host, extra, keep_alive ? "" : "Connection: close\r\n");
+        if (len < 0 || len >= REQUEST_SIZE) {
+            fprintf(stderr, "ERROR: request for %s too long\n", urls[i].path);
+            return -1;
+        } /* end if */
+        requests[i].len = len;
+        requests[i].status = urls[i].status;
+
+        for (w = 0; w < urls[i].weight && schedule_len < MAX_SCHEDULE; w++) {
+            schedule[schedule_len++] = i;
+        } /* end for */
+    } /* end for */
+
+    if (schedule_len == 0) {
+        fprintf(stderr, "ERROR: empty URL mix\n");
+        return -1;
+    } /* end if */
+
+    return 0;
+} /* end of build_requests */
+
+/**
+ * Start a non-blocking connect.
+ * @input_param     the connection
+ * @input_param     the epoll instance
+ * @input_param     the statistics of the thread
+ * @return          -1 in case of error
+ */
+static int
+conn_open(lg_conn_t *conn, int epfd, stats_t *stats) {
+    struct epoll_event ev;
+    const int on = 1;
+
+    conn->fd = socket(server_addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (conn->fd < 0) {
+        perror("ERROR: socket()");
+        return -1;
+    } /* end if */
+    setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof (on));
+    if (fast_open) {
+        // connect() returns at once, the first write() carries the data
+        setsockopt(conn->fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof (on));
+    } /* end if */
+
+    conn->connect_start = now_ns();
+    conn->state = LG_CONNECTING;
+    conn->inflight = 0;
+    conn->inflight_first = 0;
+    conn->out_len = 0;
+    conn->out_off = 0;
+    conn->in_len = 0;
+    conn->in_body = false;
+    conn->server_closes = false;
+    stats->connects++;
+
+    if (connect(conn->fd, (struct sockaddr *) &server_addr, server_addrlen) < 0 && errno != EINPROGRESS) {
+        perror("ERROR: connect()");
+        close(conn->fd);
+        return -1;
+    } /* end if */
+
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    ev.data.ptr = conn;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, conn->fd, &ev) < 0) {
+        perror("ERROR: epoll_ctl()");
+        close(conn->fd);
+        return -1;
+    } /* end if */
+
+    return 0;
+} /* end of conn_open */
+
+/**
+ * Close a connection and open a new one. Requests still in flight
+ * count as errors.
+ * @input_param     the connection
+ * @input_param     the epoll instance
+ * @input_param     the statistics of the thread
+ * @return          -1 if no new connection could be opened
+ */
+static int
+conn_reopen(lg_conn_t *conn, int epfd, stats_t *stats) {
+    close(conn->fd);
+    conn->fd = -1;
+    if (!running) {
+        return 0;
+    } /* end if */
+    stats->errors += conn->inflight;
+    return conn_open(conn, epfd, stats);
+} /* end of conn_reopen */
+
+/**
+ * Queue requests until the pipeline is full and write the pending
+ * output.
+ * @input_param     the connection
+ * @return          -1 if the connection failed
+ */
+static int
+conn_send(lg_conn_t *conn) {
+    int depth = keep_alive ? pipeline : 1;
+    long long now = now_ns();
+    request_t *req;
+    ssize_t n;
+    int slot;
+    int r;
+
+    while (running && conn->inflight < depth && !conn->server_closes) {
+        if (conn->out_off == conn->out_len) {
+            conn->out_off = conn->out_len = 0;
+        } /* end if */
+        r = schedule[conn->next++ % schedule_len];
+        req = &requests[r];
+        if (conn->out_len + req->len > sizeof (conn->out)) {
+            break;
+        } /* end if */
+        memcpy(conn->out + conn->out_len, req->text, req->len);
+        conn->out_len += req->len;
+
+        slot = (conn->inflight_first + conn->inflight) % MAX_PIPELINE;
+        conn->sent_at[slot] = keep_alive ? now : conn->connect_start;
+        conn->sent_request[slot] = r;
+        conn->inflight++;
+    } /* end while */
+
+    while (conn->out_off < conn->out_len) {
+        n = send(conn->fd, conn->out + conn->out_off, conn->out_len - conn->out_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            } /* end if */
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        } /* end if */
+        conn->out_off += n;
+    } /* end while */
+
+    return 0;
+} /* end of conn_send */
+
+/**
+ * Account a complete response to the oldest request in flight.
+ * @input_param     the connection
+ * @input_param     the statistics of the thread
+ */
+static void
+conn_complete(lg_conn_t *conn, stats_t *stats) {
+    unsigned long long us;
+    int expected;
+
+    if (conn->inflight == 0) {
+        /* a response nobody asked for */
+        stats->errors++;
+        return;
+    } /* end if */
+
+    us = (now_ns() - conn->sent_at[conn->inflight_first]) / 1000;
+    expected = requests[conn->sent_request[conn->inflight_first]].status;
+    conn->inflight_first = (conn->inflight_first + 1) % MAX_PIPELINE;
+    conn->inflight--;
+
+    stats->requests++;
+    stats->bytes += conn->response_bytes;
+    stats->hist[hist_bucket(us)]++;
+    if (us > stats->max_us) {
+        stats->max_us = us;
+    } /* end if */
+    stats->status_class[(conn->status >= 100 && conn->status < 600) ? conn->status / 100 : 0]++;
+    if (expected != 0 ? conn->status != expected : (conn->status < 200 || conn->status >= 400)) {
+        stats->unexpected++;
+    } /* end if */
+
+    conn->in_body = false;
+    if (!keep_alive) {
+        /* wait for the server to close, the TIME_WAIT state stays there */
+        conn->server_closes = true;
+    } /* end if */
+} /* end of conn_complete */
+
+/**
+ * Parse the status line and the header fields of a response needed
+ * to find its end.
+ * @input_param     the connection
+ * @input_param     the header including the empty line
+ * @input_param     the length of the header
+ * @return          -1 if the header is malformed
+ */
+static int
+parse_response_header(lg_conn_t *conn, char *header, size_t len) {
+    char *line;
+    char *end;
+    char *value;
+
+    if (len < 12 || strncmp(header, "HTTP/1.", 7) != 0) {
+        return -1;
+    } /* end if */
+    conn->status = atoi(header + 9);
+    conn->body_left = -1;
+
+    for (line = (char *) memchr(header, '\n', len) + 1; line < header + len; line = end + 1) {
+        end = memchr(line, '\n', header + len - line);
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            conn->body_left = strtoll(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            for (value = line + 11; *value == ' '; value++) {
+            } /* end for */
+            if (strncasecmp(value, "close", 5) == 0) {
+                conn->server_closes = true;
+            } /* end if */
+        } /* end if */
+    } /* end for */
+
+    if (conn->status == 304 || conn->status == 204 || conn->status < 200) {
+        conn->body_left = 0;
+    } /* end if */
+    conn->in_body = true;
+    conn->response_bytes = len;
+
+    return 0;
+} /* end of parse_response_header */
+
+/**
+ * Consume the received data: skip the bodies and account every
+ * complete response.
+ * @input_param     the connection
+ * @input_param     the statistics of the thread
+ * @return          -1 if a response is malformed
+ */
+static int
+conn_consume(lg_conn_t *conn, stats_t *stats) {
+    size_t off = 0;
+    size_t n;
+    char *end;
+
+    while (off < conn->in_len) {
+        if (!conn->in_body) {
+            end = memmem(conn->in + off, conn->in_len - off, "\r\n\r\n", 4);
+            if (end == NULL) {
+                break;
+            } /* end if */
+            n = end + 4 - (conn->in + off);
+            if (parse_response_header(conn, conn->in + off, n) < 0) {
+                return -1;
+            } /* end if */
+            off += n;
+        } else {
+            n = conn->in_len - off;
+            if (conn->body_left >= 0 && (long long) n > conn->body_left) {
+                n = conn->body_left;
+            } /* end if */
+            off += n;
+            conn->response_bytes += n;
+            if (conn->body_left >= 0) {
+                conn->body_left -= n;
+            } /* end if */
+        } /* end if */
+
+        if (conn->in_body && conn->body_left == 0) {
+            conn_complete(conn, stats);
+        } /* end if */
+    } /* end while */
+
+    if (off < conn->in_len) {
+        if (off == 0 && conn->in_len == sizeof (conn->in)) {
+            /* header larger than the buffer */
+            return -1;
+        } /* end if */
+        memmove(conn->in, conn->in + off, conn->in_len - off);
+    } /* end if */
+    conn->in_len -= off;
+
+    return 0;
+} /* end of conn_consume */
+
+/**
+ * Handle the readiness of a connection.
+ * @input_param     the connection
+ * @input_param     the epoll events
+ * @input_param     the epoll instance
+ * @input_param     the statistics of the thread
+ * @return          -1 if no new connection could be opened
+ */
+static int
+conn_event(lg_conn_t *conn, unsigned int events, int epfd, stats_t *stats) {
+    ssize_t n;
+    int err = 0;
+    socklen_t errlen = sizeof (err);
+
+    if (conn->state == LG_CONNECTING) {
+        if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            return 0;
+        } /* end if */
+        getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &errlen);
+        if (err != 0) {
+            stats->errors++;
+            return conn_reopen(conn, epfd, stats);
+        } /* end if */
+        conn->state = LG_ACTIVE;
+    } /* end if */
+
+    for (;;) {
+        n = recv(conn->fd, conn->in + conn->in_len, sizeof (conn->in) - conn->in_len, 0);
+        if (n > 0) {
+            conn->in_len += n;
+            if (conn_consume(conn, stats) < 0) {
+                stats->errors++;
+                return conn_reopen(conn, epfd, stats);
+            } /* end if */
+        } else if (n == 0) {
+            if (conn->in_body && conn->body_left < 0) {
+                /* the body of the response ends with the connection */
+                conn_complete(conn, stats);
+            } /* end if */
+            return conn_reopen(conn, epfd, stats);
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            stats->errors++;
+            return conn_reopen(conn, epfd, stats);
+        } /* end if */
+    } /* end for */
+
+    if (conn_send(conn) < 0) {
+        stats->errors++;
+        return conn_reopen(conn, epfd, stats);
+    } /* end if */
+
+    return 0;
+} /* end of conn_event */
+
+/**
+ * Thread driving a share of the connections.
+ * @input_param     the worker
+ * @return          NULL
+ */
+static void *
+worker_main(void *arg) {
+    worker_t *worker = arg;
+    struct epoll_event events[64];
+    lg_conn_t *conns;
+    int epfd;
+    int n;
+    int i;
+
+    conns = calloc(worker->connections, sizeof (lg_conn_t));
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (conns == NULL || epfd < 0) {
+        perror("ERROR: worker setup");
+        exit(EXIT_FAILURE);
+    } /* end if */
+
+    for (i = 0; i < worker->connections; i++) {
+        // spread the connections over the schedule
+        conns[i].next = i;
+        if (conn_open(&conns[i], epfd, &worker->stats) < 0) {
+            exit(EXIT_FAILURE);
+        } /* end if */
+    } /* end for */
+
+    while (running) {
+        n = epoll_wait(epfd, events, 64, 100);
+        for (i = 0; i < n; i++) {
+            if (conn_event(events[i].data.ptr, events[i].events, epfd, &worker->stats) < 0) {
+                exit(EXIT_FAILURE);
+            } /* end if */
+        } /* end for */
+    } /* end while */
+
+    for (i = 0; i < worker->connections; i++) {
+        if (conns[i].fd >= 0) {
+            close(conns[i].fd);
+        } /* end if */
+    } /* end for */
+    close(epfd);
+    free(conns);
+
+    return NULL;
+} /* end of worker_main */
+
+/**
+ * Stop the run on SIGINT.
+ */
+static void
+stop_handler(int sig) {
+    running = 0;
+} /* end of stop_handler */
+
+/**
+ * Add the statistics of a thread to the total.
+ * @input_param     the total
+ * @input_param     the statistics of the thread
+ */
+static void
+stats_add(stats_t *total, const stats_t *stats) {
+    int i;
+
+    total->requests += stats->requests;
+    total->bytes += stats->bytes;
+    total->errors += stats->errors;
+    total->unexpected += stats->unexpected;
+    total->connects += stats->connects;
+    for (i = 0; i < 6; i++) {
+        total->status_class[i] += stats->status_class[i];
+    } /* end for */
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        total->hist[i] += stats->hist[i];
+    } /* end for */
+    if (stats->max_us > total->max_us) {
+        total->max_us = stats->max_us;
+    } /* end if */
+} /* end of stats_add */
+
+/**
+ * Print the latency histogram with one line per power of two.
+ * @input_param     the statistics
+ */
+static void
+print_histogram(const stats_t *stats) {
+    unsigned long long count;
+    unsigned long long low = 0;
+    unsigned long long high = 1;
+    int bucket = 0;
+    int bar;
+
+    while (bucket < HIST_BUCKETS) {
+        count = 0;
+        while (bucket < HIST_BUCKETS && hist_value(bucket) < high) {
+            count += stats->hist[bucket++];
+        } /* end while */
+        if (count > 0) {
+            bar = (int) (count * 50 / stats->requests);
+            printf("  %8llu - %8llu us %10llu %6.2f%% %.*s\n", low, high - 1, count,
+                    100.0 * count / stats->requests, bar, "##################################################");
+        } /* end if */
+        low = high;
+        high *= 2;
+    } /* end while */
+} /* end of print_histogram */
+
+/**
+ * Print the result of a run.
+ * @input_param     the name of the URL mix
+ * @input_param     the number of connections
+ * @input_param     the statistics
+ * @input_param     the duration in seconds
+ * @input_param     print the latency histogram
+ */
+static void
+print_report(char *mix, int connections, const stats_t *stats, double seconds, bool histogram) {
+    printf("%-8s %s c=%d p=%d %.1fs: %.0f req/s %.2f MB/s"
+            " latency p50 %llu us p99 %llu us p999 %llu us max %llu us\n",
+            mix, keep_alive ? "keep-alive" : "close", connections, keep_alive ? pipeline : 1, seconds,
+            stats->requests / seconds, stats->bytes / seconds / 1e6,
+            hist_percentile(stats, 50.0), hist_percentile(stats, 99.0),
+            hist_percentile(stats, 99.9), stats->max_us);
+    printf("         requests %llu bytes %llu connects %llu errors %llu unexpected status %llu"
+            " (1xx %llu 2xx %llu 3xx %llu 4xx %llu 5xx %llu)\n",
+            stats->requests, stats->bytes, stats->connects, stats->errors, stats->unexpected,
+            stats->status_class[1], stats->status_class[2], stats->status_class[3],
+            stats->status_class[4], stats->status_class[5]);
+    if (histogram) {
+        print_histogram(stats);
+    } /* end if */
+} /* end of print_report */
+
+/**
+ * Print the usage of the load generator.
+ * @input_param     the program name
+ */
+static void
+print_usage(const char *progname) {
+    int i;
+
+    fprintf(stderr, "Usage: %s options\n%s%s%s%s%s%s%s%s%s%s%s", progname,
+            "\t-s\tthe server host (default localhost)\n",
+            "\t-p\tthe server port (default 8080)\n",
+            "\t-c\tthe number of concurrent connections (default 50)\n",
+            "\t-t\tthe number of threads (default 1)\n",
+            "\t-d\tthe duration in seconds (default 5)\n",
+            "\t-k\tuse persistent connections: 'on' (default) or 'off'\n",
+            "\t-P\tthe number of pipelined requests per connection (default 1)\n",
+            "\t-m\tthe URL mix (default small)\n",
+            "\t-u\ta URL path to request instead of a mix, may be repeated\n",
+            "\t-F\tuse TCP Fast Open for new connections\n",
+            "\t-H\tprint the latency histogram\n");
+    fprintf(stderr, "URL mixes:");
+    for (i = 0; mixes[i].name != NULL; i++) {
+        fprintf(stderr, " %s", mixes[i].name);
+    } /* end for */
+    fprintf(stderr, "\n");
+} /* end of print_usage */
+
+int
+main(int argc, char *argv[]) {
+    char *port = DEFAULT_PORT;
+    char *mix = "small";
+    int connections = DEFAULT_CONNECTIONS;
+    int threads = 1;
+    int seconds = DEFAULT_SECONDS;
+    bool histogram = false;
+    url_entry_t custom[MAX_URLS + 1];
+    int custom_count = 0;
+    url_entry_t *urls = NULL;
+    struct addrinfo hints;
+    struct addrinfo *result;
+    struct sigaction sa;
+    struct timespec duration;
+    worker_t *workers;
+    stats_t total;
+    long long begin;
+    double elapsed;
+    int err;
+    int c;
+    int i;
+
+    while ((c = getopt(argc, argv, "s:p:c:t:d:k:P:m:u:FH")) != -1) {
+        switch (c) {
+            case 's':
+                host = optarg;
+                break;
+            case 'p':
+                port = optarg;
+                break;
+            case 'c':
+                connections = atoi(optarg);
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'd':
+                seconds = atoi(optarg);
+                break;
+            case 'k':
+                keep_alive = (strcmp(optarg, "off") != 0);
+                break;
+            case 'P':
+                pipeline = atoi(optarg);
+                break;
+            case 'm':
+                mix = optarg;
+                break;
+            case 'u':
+                if (custom_count < MAX_URLS) {
+                    custom[custom_count].path = optarg;
+                    custom[custom_count].extra = NULL;
+                    custom[custom_count].status = 0;
+                    custom[custom_count].weight = 1;
+                    custom_count++;
+                } /* end if */
+                break;
+            case 'F':
+                fast_open = true;
+                break;
+            case 'H':
+                histogram = true;
+                break;
+            default:
+                print_usage(argv[0]);
+                exit(EXIT_FAILURE);
+        } /* end switch */
+    } /* end while */
+
+    if (custom_count > 0) {
+        custom[custom_count].path = NULL;
+        urls = custom;
+        mix = "custom";
+    } else {
+        for (i = 0; mixes[i].name != NULL; i++) {
+            if (strcmp(mixes[i].name, mix) == 0) {
+                urls = mixes[i].urls;
+            } /* end if */
+        } /* end for */
+    } /* end if */
+
+    if (urls == NULL || connections <= 0 || threads <= 0 || threads > connections || seconds <= 0
+            || pipeline <= 0 || pipeline > MAX_PIPELINE) {
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    } /* end if */
+
+    memset(&hints, 0, sizeof (hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    err = getaddrinfo(host, port, &hints, &result);
+    if (err != 0) {
+        fprintf(stderr, "ERROR: %s:%s: %s\n", host, port, gai_strerror(err));
+        exit(EXIT_FAILURE);
+    } /* end if */
+    memcpy(&server_addr, result->ai_addr, result->ai_addrlen);
+    server_addrlen = result->ai_addrlen;
+    freeaddrinfo(result);
+
+    if (build_requests(urls) < 0) {
+        exit(EXIT_FAILURE);
+    } /* end if */
+
+    memset(&sa, 0, sizeof (sa));
+    sa.sa_handler = stop_handler;
+    sigaction(SIGINT, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    workers = calloc(threads, sizeof (worker_t));
+    if (workers == NULL) {
+        perror("ERROR: calloc()");
+        exit(EXIT_FAILURE);
+    } /* end if */
+
+    begin = now_ns();
+    for (i = 0; i < threads; i++) {
+        workers[i].connections = connections / threads + (i < connections % threads);
+        if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) {
+            perror("ERROR: pthread_create()");
+            exit(EXIT_FAILURE);
+        } /* end if */
+    } /* end for */
+
+    duration.tv_sec = seconds;
+    duration.tv_nsec = 0;
+    while (running && nanosleep(&duration, &duration) < 0 && errno == EINTR) {
+    } /* end while */
+    running = 0;
+    elapsed = (now_ns() - begin) / 1e9;
+
+    memset(&total, 0, sizeof (total));
+    for (i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        stats_add(&total, &workers[i].stats);
+    } /* end for */
+
+    print_report(mix, connections, &total, elapsed, histogram);
+    free(workers);
+
+    exit(total.requests > 0 && total.errors == 0 && total.unexpected == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+} /* end of main */
@@ -0,0 +1,166 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ * Throughput of the access log and the latency a record adds to a
+ * request: the former semaphore protected print_log() against the
+ * access log ring with and without a writer thread. Every variant runs
+ * in its own process.
+ *
+ *===================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "tinyweb.h"
+#include "sem_print.h"
+#include "access_log.h"
+
+#define DEFAULT_RECORDS             200000
+#define DEFAULT_LOGFILE     "/tmp/tinyweb_log_bench.log"
+
+
+typedef enum variant {
+    VARIANT_PRINT_LOG = 0,
+    VARIANT_DIRECT,
+    VARIANT_RING
+} variant_t;
+
+
+static char *variant_names[] = {
+    "print_log (semaphore)",
+    "access log, direct",
+    "access log, ring"
+};
+
+
+/**
+ * Return the current time in nanoseconds.
+ * @return          the time
+ */
+static long long
+now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+} /* end of now_ns */
+
+/**
+ * Compare two latencies for qsort().
+ */
+static int
+compare_latency(const void *a, const void *b) {
+    long long x = *(const long long *) a;
+    long long y = *(const long long *) b;
+
+    return (x > y) - (x < y);
+} /* end of compare_latency */
+
+/**
+ * Log the records with one variant and print the result.
+ * @input_param     the variant
+ * @input_param     the number of records
+ * @input_param     the log file
+ */
+static void
+run_variant(variant_t variant, long records, char *logfile) {
+    prog_options_t server;
+    long long *latency;
+    long long start, begin, total;
+    char record[256];
+    int len;
+    long i;
+
+    memset(&server, 0, sizeof (server));
+    server.log_fd = fopen(logfile, "w");
+    latency = malloc(records * sizeof (long long));
+    if (server.log_fd == NULL || latency == NULL) {
+        perror("log_bench");
+        exit(EXIT_FAILURE);
+    } /* end if */
+    fcntl(fileno(server.log_fd), F_SETFL, O_APPEND);
+
+    if (variant == VARIANT_PRINT_LOG) {
+        init_logging_semaphore(&server);
+    } else {
+        access_log_init(fileno(server.log_fd), (variant == VARIANT_RING) ? LOG_DEFAULT_FLUSH_MS : 0,
+                LOG_OVERFLOW_BLOCK);
+        access_log_start();
+    } /* end if */
+
+    begin = now_ns();
+    for (i = 0; i < records; i++) {
+        start = now_ns();
+        if (variant == VARIANT_PRINT_LOG) {
+            print_log("[%d] %s:%d - - [%s] \"%-7s %s %s\" %d %zu\n", getpid(), "127.0.0.1", 40000 + (int) (i % 1000),
+                    "Sat, 17 Oct 2026 12:00:00 +0200", "GET", "web/index.html", "HTTP/1.1", 200, (size_t) 7776);
+        } else {
+            len = snprintf(record, sizeof (record), "[%d] %s:%d - - [%s] \"%-7s %s %s\" %d %zu\n", access_log_pid(),
+                    "127.0.0.1", 40000 + (int) (i % 1000), "Sat, 17 Oct 2026 12:00:00 +0200",
+                    "GET", "web/index.html", "HTTP/1.1", 200, (size_t) 7776);
+            access_log_write(record, len);
+        } /* end if */
+        latency[i] = now_ns() - start;
+    } /* end for */
+
+    // all records are written when the log is stopped
+    if (variant == VARIANT_PRINT_LOG) {
+        fflush(server.log_fd);
+    } else {
+        access_log_stop();
+    } /* end if */
+    total = now_ns() - begin;
+
+    qsort(latency, records, sizeof (long long), compare_latency);
+    printf("%-22s %12.0f rec/s %8.1f ns avg %8lld ns p99 %8lld ns max\n", variant_names[variant],
+            records / (total / 1e9), (double) total / records,
+            latency[records * 99 / 100], latency[records - 1]);
+
+    fclose(server.log_fd);
+    free(latency);
+} /* end of run_variant */
+
+int
+main(int argc, char *argv[]) {
+    long records = DEFAULT_RECORDS;
+    char *logfile = DEFAULT_LOGFILE;
+    variant_t variant;
+    pid_t pid;
+
+    if (argc > 1) {
+        records = atol(argv[1]);
+    } /* end if */
+    if (argc > 2) {
+        logfile = argv[2];
+    } /* end if */
+    if (records <= 0) {
+        fprintf(stderr, "Usage: %s [records [logfile]]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    } /* end if */
+
+    for (variant = VARIANT_PRINT_LOG; variant <= VARIANT_RING; variant++) {
+        fflush(stdout);
+        pid = fork();
+        if (pid == 0) {
+            run_variant(variant, records, logfile);
+            exit(EXIT_SUCCESS);
+        } else if (pid < 0) {
+            perror("fork");
+            exit(EXIT_FAILURE);
+        } /* end if */
+        waitpid(pid, NULL, 0);
+    } /* end for */
+
+    unlink(logfile);
+    exit(EXIT_SUCCESS);
+} /* end of main */
@@ -0,0 +1,228 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ * Microbenchmark of the request parser: the single-pass parser of
+ * src/http_parser.c against the former regex based parser. The
+ * parser_bench_scalar build uses the parser without SSE2.
+ *
+ *===================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tinyweb.h"
+#include "http.h"
+#include "http_parser.h"
+#include "regex_parser.h"
+
+#define DEFAULT_ITERATIONS          200000
+
+
+typedef struct sample {
+    char *name;
+    char *request;
+} sample_t;
+
+
+static sample_t samples[] = {
+    { "minimal",
+      "GET /index.html HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "\r\n" },
+    { "browser",
+      "GET /images/computerhead1.gif HTTP/1.1\r\n"
+      "Host: localhost:8080\r\n"
+      "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0\r\n"
+      "Accept: image/avif,image/webp,*/*\r\n"
+      "Accept-Language: de,en-US;q=0.7,en;q=0.3\r\n"
+      "Accept-Encoding: gzip, deflate, br\r\n"
+      "Referer: http://localhost:8080/index.html\r\n"
+      "Connection: keep-alive\r\n"
+      "\r\n" },
+    { "conditional",
+      "GET /css/default.css HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "If-Modified-Since: Tue, 12 Jan 2016 10:00:00 GMT\r\n"
+      "\r\n" },
+    { "range",
+      "GET /zeros1.jpg HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Range: bytes=100-2000\r\n"
+      "Connection: close\r\n"
+      "\r\n" },
+    { "chrome",
+      "GET /css/default.css HTTP/1.1\r\n"
+      "Host: www.example.org\r\n"
+      "Connection: keep-alive\r\n"
+      "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+      "sec-ch-ua-mobile: ?0\r\n"
+      "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) "
+      "Chrome/124.0.0.0 Safari/537.36\r\n"
+      "sec-ch-ua-platform: \"Windows\"\r\n"
+      "Accept: text/css,*/*;q=0.1\r\n"
+      "Sec-Fetch-Site: same-origin\r\n"
+      "Sec-Fetch-Mode: no-cors\r\n"
+      "Sec-Fetch-Dest: style\r\n"
+      "Referer: https://www.example.org/index.html\r\n"
+      "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+      "Accept-Language: de-DE,de;q=0.9,en-US;q=0.8,en;q=0.7\r\n"
+      "Cookie: session=4f2a9c1e7b3d5f60a8e2c4b6d8f0a1c3; theme=dark; _ga=GA1.2.1234567890.1700000000\r\n"
+      "If-None-Match: \"1a2b3c-4d5e-17f0e1d2c3b4a596\"\r\n"
+      "If-Modified-Since: Tue, 12 Jan 2016 10:00:00 GMT\r\n"
+      "\r\n" },
+    { "firefox",
+      "GET /images/computerhead1.gif HTTP/1.1\r\n"
+      "Host: www.example.org\r\n"
+      "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:125.0) Gecko/20100101 Firefox/125.0\r\n"
+      "Accept: image/avif,image/webp,image/png,image/svg+xml,image/*;q=0.8,*/*;q=0.5\r\n"
+      "Accept-Language: de,en-US;q=0.7,en;q=0.3\r\n"
+      "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+      "Referer: https://www.example.org/index.html\r\n"
+      "Connection: keep-alive\r\n"
+      "Cookie: session=4f2a9c1e7b3d5f60a8e2c4b6d8f0a1c3; theme=dark; lang=de; "
+      "_ga=GA1.2.1234567890.1700000000; _gid=GA1.2.987654321.1700000000; "
+      "consent=eyJhbmFseXRpY3MiOnRydWUsIm1hcmtldGluZyI6ZmFsc2UsInByZWZlcmVuY2VzIjp0cnVlfQ; "
+      "cart=7c9e6679-7425-40de-944b-e07fc1f90ae7; recently_viewed=1042,2231,877,3310,12,455\r\n"
+      "Sec-Fetch-Dest: image\r\n"
+      "Sec-Fetch-Mode: no-cors\r\n"
+      "Sec-Fetch-Site: same-origin\r\n"
+      "Priority: u=5, i\r\n"
+      "Pragma: no-cache\r\n"
+      "Cache-Control: no-cache\r\n"
+      "X-Requested-With: XMLHttpRequest\r\n"
+      "X-Forwarded-For: 203.0.113.7, 198.51.100.23\r\n"
+      "X-Forwarded-Proto: https\r\n"
+      "DNT: 1\r\n"
+      "Range: bytes=0-1023\r\n"
+      "If-Range: \"1a2b3c-4d5e-17f0e1d2c3b4a596\"\r\n"
+      "\r\n" },
+    { NULL, NULL }
+};
+
+
+/**
+ * Return the time elapsed since a start time.
+ * @input_param     the start time
+ * @return          the elapsed time in seconds
+ */
+static double
+elapsed(struct timespec *start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+} /* end of elapsed */
+
+/**
+ * Print one result line.
+ * @input_param     the sample name
+ * @input_param     the parser name
+ * @input_param     the number of parsed requests
+ * @input_param     the elapsed time in seconds
+ */
+static void
+print_result(char *sample, char *parser, long iterations, double seconds) {
+    printf("%-12s %-12s %12.0f req/s %10.1f ns/req\n", sample, parser,
+            iterations / seconds, seconds * 1e9 / iterations);
+} /* end of print_result */
+
+/**
+ * Parse a sample with the regex parser. The parser modifies its input
+ * with strtok(), so each run works on a fresh copy.
+ * @input_param     the sample
+ * @input_param     the number of iterations
+ * @return          the elapsed time in seconds
+ */
+static double
+bench_regex(sample_t *sample, long iterations) {
+    char buffer[BUFFER_SIZE];
+    size_t len = strlen(sample->request) + 1;
+    regex_parsed_http_header_t parsed_header;
+    struct timespec start;
+    long i;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < iterations; i++) {
+        memcpy(buffer, sample->request, len);
+        parsed_header = regex_parse_http_header(buffer);
+        if (parsed_header.httpState != HTTP_STATUS_OK
+                && parsed_header.httpState != HTTP_STATUS_PARTIAL_CONTENT) {
+            fprintf(stderr, "regex parser rejected sample %s\n", sample->name);
+            exit(EXIT_FAILURE);
+        } /* end if */
+        free(parsed_header.method);
+        free(parsed_header.protocol);
+        if (strcmp(parsed_header.filename, DEFAULT_HTML_PAGE) != 0) {
+            free(parsed_header.filename);
+        } /* end if */
+    } /* end for */
+
+    return elapsed(&start);
+} /* end of bench_regex */
+
+/**
+ * Parse a sample with the single-pass parser, on the same copy of the
+ * input as the regex parser.
+ * @input_param     the sample
+ * @input_param     the number of iterations
+ * @input_param     the number of parts the request is fed in
+ * @return          the elapsed time in seconds
+ */
+static double
+bench_single_pass(sample_t *sample, long iterations, int parts) {
+    char buffer[BUFFER_SIZE];
+    size_t len = strlen(sample->request);
+    parsed_http_header_t parsed_header;
+    http_parse_result_t result = HTTP_PARSE_INCOMPLETE;
+    struct timespec start;
+    long i;
+    int part;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < iterations; i++) {
+        memcpy(buffer, sample->request, len + 1);
+        http_parser_init(&parsed_header);
+        for (part = 1; part <= parts; part++) {
+            result = parse_http_header(&parsed_header, buffer, len * part / parts);
+        } /* end for */
+        if (result != HTTP_PARSE_DONE || (parsed_header.httpState != HTTP_STATUS_OK
+                && parsed_header.httpState != HTTP_STATUS_PARTIAL_CONTENT)) {
+            fprintf(stderr, "single-pass parser rejected sample %s\n", sample->name);
+            exit(EXIT_FAILURE);
+        } /* end if */
+    } /* end for */
+
+    return elapsed(&start);
+} /* end of bench_single_pass */
+
+int
+main(int argc, char *argv[]) {
+    long iterations = DEFAULT_ITERATIONS;
+    sample_t *sample;
+
+    if (argc > 1) {
+        iterations = atol(argv[1]);
+        if (iterations <= 0) {
+            fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        } /* end if */
+    } /* end if */
+
+    setenv("TZ", "GMT", 1);
+    tzset();
+
+    printf("%-12s %-12s %18s %17s\n", "sample", "parser", "throughput", "latency");
+    for (sample = samples; sample->name != NULL; sample++) {
+        print_result(sample->name, "regex", iterations, bench_regex(sample, iterations));
+        print_result(sample->name, "single-pass", iterations, bench_single_pass(sample, iterations, 1));
+        print_result(sample->name, "3 parts", iterations, bench_single_pass(sample, iterations, 3));
+    } /* end for */
+
+    exit(EXIT_SUCCESS);
+} /* end of main */
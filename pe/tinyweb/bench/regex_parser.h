@@ -0,0 +1,28 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _REGEX_PARSER_H
+#define _REGEX_PARSER_H
+
+#include <time.h>
+
+typedef struct regex_parsed_http_header {
+    char* method;
+    char* filename;
+    char* protocol;
+    int httpState;
+    time_t modsince;
+    int byteStart;
+    int byteEnd;
+    int isCGI;
+    int keepAlive;
+} regex_parsed_http_header_t;
+
+extern regex_parsed_http_header_t regex_parse_http_header(char *header);
+#endif
@@ -0,0 +1,46 @@
+#!/bin/bash
+#
+# Start tinyweb on a spare port and run the load generator against it
+# with the standard scenarios. Called by 'make bench' in the tinyweb
+# directory, the variables below may be overridden in the environment:
+#
+#   BENCH_MODES     serving modes to measure (default "prefork fork epoll")
+#   BENCH_SECONDS   duration of every scenario (default 3)
+#   BENCH_CONNS     concurrent connections (default 50)
+#   BENCH_PORT      port of the server (default 8089)
+#
+
+LOADGEN=${1:-build/`uname -s`_`uname -m`/loadgen}
+TINYWEB=../build/`uname -s`_`uname -m`/tinyweb
+MODES=${BENCH_MODES:-prefork fork epoll}
+SECONDS_PER_RUN=${BENCH_SECONDS:-3}
+CONNS=${BENCH_CONNS:-50}
+PORT=${BENCH_PORT:-8089}
+LOG=/tmp/tinyweb_bench_$$.log
+
+# mix, keep-alive, pipeline depth
+SCENARIOS="small:on:1 small:off:1 small:on:8 pdf:on:1 range:on:1 304:on:1 mixed:on:1"
+
+status=0
+for mode in $MODES; do
+    $TINYWEB -p $PORT -d ../web -m $mode -f $LOG &
+    server=$!
+
+    # wait until the server accepts connections
+    for i in `seq 50`; do
+        (echo >/dev/tcp/127.0.0.1/$PORT) 2>/dev/null && break
+        sleep 0.1
+    done
+
+    echo "=== tinyweb -m $mode"
+    for scenario in $SCENARIOS; do
+        IFS=: read mix keepalive depth <<< "$scenario"
+        $LOADGEN -s 127.0.0.1 -p $PORT -c $CONNS -d $SECONDS_PER_RUN -m $mix -k $keepalive -P $depth || status=1
+    done
+
+    kill -INT $server
+    wait $server
+done
+
+rm -f $LOG
+exit $status
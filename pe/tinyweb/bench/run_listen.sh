@@ -0,0 +1,54 @@
+#!/bin/bash
+#
+# Measure the connection rate of short non-persistent requests with
+# different listener settings. Called by 'make listen' in the bench
+# directory, the variables below may be overridden in the environment:
+#
+#   BENCH_MODES     serving modes to measure (default "prefork epoll")
+#   BENCH_SECONDS   duration of every run (default 3)
+#   BENCH_CONNS     concurrent connections (default 200)
+#   BENCH_PORT      port of the server (default 8089)
+#
+# The server side of TCP Fast Open needs bit 2 of net.ipv4.tcp_fastopen,
+# e.g. 'sysctl -w net.ipv4.tcp_fastopen=3', otherwise the last run
+# falls back to a normal handshake.
+#
+
+LOADGEN=${1:-build/`uname -s`_`uname -m`/loadgen}
+TINYWEB=../build/`uname -s`_`uname -m`/tinyweb
+MODES=${BENCH_MODES:-prefork epoll}
+SECONDS_PER_RUN=${BENCH_SECONDS:-3}
+CONNS=${BENCH_CONNS:-200}
+PORT=${BENCH_PORT:-8089}
+LOG=/tmp/tinyweb_listen_$$.log
+
+# server options, the old fixed backlog of 5 first
+LISTENERS=("-b 5" "" "--defer-accept 1" "--fastopen 256")
+
+status=0
+for mode in $MODES; do
+    for listener in "${LISTENERS[@]}"; do
+        $TINYWEB -p $PORT -d ../web -m $mode -f $LOG $listener &
+        server=$!
+
+        # wait until the server accepts connections
+        for i in `seq 50`; do
+            (echo >/dev/tcp/127.0.0.1/$PORT) 2>/dev/null && break
+            sleep 0.1
+        done
+
+        fastopen=
+        case "$listener" in
+            --fastopen*) fastopen=-F ;;
+        esac
+
+        echo "=== tinyweb -m $mode ${listener:-(default listener)}"
+        $LOADGEN -s 127.0.0.1 -p $PORT -c $CONNS -t 2 -d $SECONDS_PER_RUN -m small -k off $fastopen || status=1
+
+        kill -INT $server
+        wait $server
+    done
+done
+
+rm -f $LOG
+exit $status
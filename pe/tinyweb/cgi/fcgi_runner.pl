@@ -0,0 +1,371 @@
+#!/usr/bin/perl
+#
+# FastCGI runner of the tinyweb cgi pool (--cgi-pool)
+#
+# The server starts the runners with the listening socket as standard
+# input and connects to them for each cgi request. A runner answers one
+# request per connection: it reads the environment of the script from
+# the params records, runs the script and sends the output in stdout
+# records. Perl scripts are compiled once and run inside the runner
+# like a subroutine, so a request costs neither a shell nor a new
+# interpreter; other scripts are executed as a child process.
+#
+# The script output is sent unchanged, the script writes its own
+# header fields and the empty line as for a forked cgi script.
+#
+# DHBW Ravensburg - Campus Friedrichshafen
+# Vorlesung Verteilte Systeme
+# Author:  Michael Christa, Florian Hink
+#
+
+use strict;
+use warnings;
+
+use POSIX ();
+
+use constant {
+    FCGI_VERSION_1      => 1,
+    FCGI_BEGIN_REQUEST  => 1,
+    FCGI_ABORT_REQUEST  => 2,
+    FCGI_END_REQUEST    => 3,
+    FCGI_PARAMS         => 4,
+    FCGI_STDIN          => 5,
+    FCGI_STDOUT         => 6,
+    FCGI_STDERR         => 7,
+    FCGI_REQUEST_COMPLETE => 0,
+    OUTPUT_CHUNK        => 8192,    # bytes per stdout record
+};
+
+our $in_script = 0;         # exit() of a script ends the request only
+
+BEGIN {
+    *CORE::GLOBAL::exit = sub {
+        my $status = @_ ? shift : 0;
+        die bless({ status => $status }, 'Tinyweb::Exit') if $in_script;
+        CORE::exit($status);
+    };
+}
+
+my $timeout = $ENV{TINYWEB_CGI_TIMEOUT} || 30;
+my %scripts;                # compiled scripts: path => [ mtime, code ]
+my $child = 0;              # process of a script which is not in Perl
+
+# a script running too long takes the runner with it, the pool starts a new one
+$SIG{ALRM} = sub {
+    kill 'TERM', $child if $child;
+    POSIX::_exit(1);
+};
+$SIG{PIPE} = 'IGNORE';
+
+open(my $listener, '<&', \*STDIN) or die "fcgi_runner: no listening socket: $!\n";
+open(STDIN, '<', '/dev/null') or die "fcgi_runner: /dev/null: $!\n";
+
+while (1) {
+    my $conn;
+    unless (accept($conn, $listener)) {
+        next if $!{EINTR};
+        die "fcgi_runner: accept: $!\n";
+    } # end unless
+    binmode $conn;
+    handle_request($conn);
+    close($conn);
+} # end while
+
+exit 0;
+
+
+#--------------------------------------------------------------------------
+# Read exactly the given number of bytes
+#
+# Parameter(s):
+# (IN) the connection
+# (IN) the number of bytes
+#
+# Return value: the bytes, undef at the end of the connection
+#
+#--------------------------------------------------------------------------
+sub read_exactly {
+    my ($conn, $len) = @_;
+    my $buf = '';
+
+    while (length($buf) < $len) {
+        my $n = sysread($conn, $buf, $len - length($buf), length($buf));
+        next if !defined($n) && $!{EINTR};
+        return undef unless $n;
+    } # end while
+
+    return $buf;
+} # end of read_exactly
+
+
+#--------------------------------------------------------------------------
+# Read a record
+#
+# Parameter(s):
+# (IN) the connection
+#
+# Return value: the type and the content, an empty list at the end
+#
+#--------------------------------------------------------------------------
+sub read_record {
+    my $conn = shift;
+
+    my $header = read_exactly($conn, 8) // return ();
+    my ($version, $type, $id, $len, $padding) = unpack('CCnnC', $header);
+    return () if $version != FCGI_VERSION_1;
+    my $content = read_exactly($conn, $len + $padding) // return ();
+
+    return ($type, substr($content, 0, $len));
+} # end of read_record
+
+
+#--------------------------------------------------------------------------
+# Write a record, content beyond the maximum record length is split
+#
+# Parameter(s):
+# (IN) the connection
+# (IN) the record type
+# (IN) the content
+#
+# Return value: NONE, dies if the server closed the connection
+#
+#--------------------------------------------------------------------------
+sub write_record {
+    my ($conn, $type, $content) = @_;
+    my $offset = 0;
+
+    do {
+        my $len = length($content) - $offset;
+        $len = 65535 if $len > 65535;
+        my $record = pack('CCnnCx', FCGI_VERSION_1, $type, 1, $len, 0) . substr($content, $offset, $len);
+        $offset += $len;
+        while (length $record) {
+            my $n = syswrite($conn, $record);
+            next if !defined($n) && $!{EINTR};
+            die bless({}, 'Tinyweb::Abort') unless defined $n;
+            substr($record, 0, $n) = '';
+        } # end while
+    } while ($offset < length($content));
+} # end of write_record
+
+
+#--------------------------------------------------------------------------
+# Decode the name-value pairs of the params stream
+#
+# Parameter(s):
+# (IN) the params
+#
+# Return value: the hash of the values
+#
+#--------------------------------------------------------------------------
+sub decode_params {
+    my $params = shift;
+    my %values;
+    my $pos = 0;
+
+    while ($pos < length $params) {
+        my @len;
+        for (1 .. 2) {
+            my $len = unpack('C', substr($params, $pos, 1));
+            if ($len & 0x80) {
+                $len = unpack('N', substr($params, $pos, 4)) & 0x7fffffff;
+                $pos += 4;
+            } else {
+                $pos += 1;
+            } # end if
+            push @len, $len;
+        } # end for
+        my $name = substr($params, $pos, $len[0]);
+        $values{$name} = substr($params, $pos + $len[0], $len[1]);
+        $pos += $len[0] + $len[1];
+    } # end while
+
+    return %values;
+} # end of decode_params
+
+
+#--------------------------------------------------------------------------
+# Compile a Perl script into a subroutine, once per modification
+#
+# Parameter(s):
+# (IN) the path of the script
+#
+# Return value: the subroutine, dies if the script does not compile
+#
+#--------------------------------------------------------------------------
+sub compile_script {
+    my $path = shift;
+    my $mtime = (stat $path)[9] // die "cannot access $path: $!\n";
+
+    my $entry = $scripts{$path};
+    return $entry->[1] if $entry && $entry->[0] == $mtime;
+
+    open(my $fh, '<', $path) or die "cannot open $path: $!\n";
+    my $source = do { local $/; <$fh> };
+    close($fh);
+    my $line = ($source =~ s/^#!.*\n//) ? 2 : 1;
+
+    (my $package = $path) =~ s/\W/_/g;
+    # the pragmas of the runner do not apply to the script
+    my $code = eval "package Tinyweb::CGI::$package; no strict; no warnings; sub {\n#line $line \"$path\"\n$source\n}"
+            or die $@;
+    $scripts{$path} = [ $mtime, $code ];
+
+    return $code;
+} # end of compile_script
+
+
+#--------------------------------------------------------------------------
+# Answer a request of the server
+#
+# Parameter(s):
+# (IN) the connection to the server
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub handle_request {
+    my $conn = shift;
+    my $params = '';
+    my $stdin_done = 0;
+    my $params_done = 0;
+
+    # the request ends with an empty params and an empty stdin record
+    while (!$params_done || !$stdin_done) {
+        my ($type, $content) = read_record($conn);
+        return unless defined $type;
+        if ($type == FCGI_PARAMS) {
+            $params .= $content;
+            $params_done = (length($content) == 0);
+        } elsif ($type == FCGI_STDIN) {
+            $stdin_done = (length($content) == 0);
+        } elsif ($type == FCGI_ABORT_REQUEST) {
+            return;
+        } # end if
+    } # end while
+
+    local %ENV = decode_params($params);
+    my $path = $ENV{SCRIPT_FILENAME} // return;
+
+    alarm $timeout;
+    my $ok = eval {
+        if ($path =~ /\.pl\z/) {
+            run_perl_script($conn, $path);
+        } else {
+            run_program($conn, $path);
+        } # end if
+        1;
+    };
+    my $error = $@;
+    alarm 0;
+
+    # the server is gone, there is nobody to answer
+    return if !$ok && ref($error) eq 'Tinyweb::Abort';
+
+    eval {
+        write_record($conn, FCGI_STDERR, "$path: $error") if !$ok;
+        write_record($conn, FCGI_STDOUT, '');
+        write_record($conn, FCGI_END_REQUEST, pack('NCx3', $ok ? 0 : 1, FCGI_REQUEST_COMPLETE));
+    };
+} # end of handle_request
+
+
+#--------------------------------------------------------------------------
+# Run a Perl script inside the runner, its standard output goes into
+# stdout records
+#
+# Parameter(s):
+# (IN) the connection to the server
+# (IN) the path of the script
+#
+# Return value: NONE, dies if the script fails
+#
+#--------------------------------------------------------------------------
+sub run_perl_script {
+    my ($conn, $path) = @_;
+    my $code = compile_script($path);
+
+    local *STDOUT;
+    tie *STDOUT, 'Tinyweb::Output', $conn;
+    my $ok = eval {
+        local $in_script = 1;
+        $code->();
+        1;
+    };
+    my $error = $@;
+    eval { (tied *STDOUT)->flush };
+    my $flush_error = $@;
+    untie *STDOUT;
+
+    die $flush_error if $flush_error;
+    die $error if !$ok && ref($error) ne 'Tinyweb::Exit';
+} # end of run_perl_script
+
+
+#--------------------------------------------------------------------------
+# Run any other script as a child process and send its output
+#
+# Parameter(s):
+# (IN) the connection to the server
+# (IN) the path of the script
+#
+# Return value: NONE, dies if the script cannot be started
+#
+#--------------------------------------------------------------------------
+sub run_program {
+    my ($conn, $path) = @_;
+    my $buf;
+
+    $child = open(my $pipe, '-|', "./$path") or die "cannot run $path: $!\n";
+    while (my $n = sysread($pipe, $buf, OUTPUT_CHUNK)) {
+        eval { write_record($conn, FCGI_STDOUT, $buf) };
+        if ($@) {
+            kill 'TERM', $child;
+            close($pipe);
+            $child = 0;
+            die $@;
+        } # end if
+    } # end while
+    close($pipe);
+    $child = 0;
+} # end of run_program
+
+
+#--------------------------------------------------------------------------
+# Standard output of a Perl script, collected into stdout records
+#--------------------------------------------------------------------------
+package Tinyweb::Output;
+
+sub TIEHANDLE {
+    my ($class, $conn) = @_;
+    return bless { conn => $conn, buf => '' }, $class;
+} # end of TIEHANDLE
+
+sub PRINT {
+    my $self = shift;
+    $self->{buf} .= join(defined $, ? $, : '', @_) . (defined $\ ? $\ : '');
+    $self->flush if length($self->{buf}) >= main::OUTPUT_CHUNK;
+    return 1;
+} # end of PRINT
+
+sub PRINTF {
+    my $self = shift;
+    my $format = shift;
+    return $self->PRINT(sprintf($format, @_));
+} # end of PRINTF
+
+sub WRITE {
+    my ($self, $buf, $len, $offset) = @_;
+    $self->PRINT(substr($buf, $offset // 0, $len));
+    return $len;
+} # end of WRITE
+
+sub BINMODE { return 1 }
+sub FILENO  { return undef }
+sub CLOSE   { my $self = shift; $self->flush; return 1 }
+
+sub flush {
+    my $self = shift;
+    main::write_record($self->{conn}, main::FCGI_STDOUT, $self->{buf}) if length $self->{buf};
+    $self->{buf} = '';
+} # end of flush
@@ -0,0 +1,498 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * alloc_profile.c - per call site statistics of the malloc/free
+ *                   wrappers
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ * Every malloc() is counted at the call site which the return address
+ * of the wrapper identifies, together with a histogram of the sizes.
+ * The live blocks are kept in a second table, so free() can give the
+ * bytes back to the site which allocated them. Both tables use open
+ * addressing and claim their slots with compare-and-swap, no lock is
+ * taken and nothing is allocated.
+ *
+ * A snapshot goes to stderr on PROFILE_SIGNAL and at exit, followed by
+ * the outstanding blocks at exit. A forked child starts with empty
+ * tables, the blocks of its parent are foreign to it. The sites are offsets into the
+ * executable: addr2line -e tinyweb_debug <site>
+ *
+ *===================================================================*/
+
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "alloc_profile.h"
+
+#define BLOCK_REMOVED       ((void *) 1)    // slot of a freed block, probing goes on
+#define OUT_SIZE                    256
+
+
+/*
+ * Counters of one call site, updated with relaxed atomic operations
+ */
+typedef struct profile_site {
+    void               *site;               // return address, NULL while the slot is free
+    unsigned long       allocs;
+    unsigned long       frees;
+    unsigned long long  bytes;              // bytes allocated in total
+    unsigned long long  live_bytes;         // bytes not freed yet
+    unsigned long       hist[PROFILE_BUCKETS];
+} profile_site_t;
+
+
+/*
+ * A live block, NULL if the slot was never used
+ */
+typedef struct profile_block {
+    void               *ptr;
+    size_t              size;
+    int                 site;               // index into the site table
+} profile_block_t;
+
+
+/*
+ * Output without stdio, a snapshot may be written in a signal handler
+ */
+typedef struct out {
+    int                 fd;
+    size_t              len;
+    char                buf[OUT_SIZE];
+} out_t;
+
+
+int _profile_trace = 0;
+
+static profile_site_t sites[PROFILE_SITES];
+static profile_block_t blocks[PROFILE_BLOCKS];
+static int order[PROFILE_SITES];                // sites of a snapshot by bytes
+static unsigned long lost_sites = 0;            // mallocs of sites beyond the table
+static unsigned long untracked_blocks = 0;      // blocks beyond the probe limit
+static unsigned long foreign_frees = 0;         // frees of blocks not allocated here
+static unsigned long process_allocs = 0;        // mallocs of this process since the fork
+static int dumping = 0;
+
+
+/**
+ * Map a pointer to the first slot of a table.
+ * @input_param     the pointer
+ * @input_param     the size of the table minus one
+ * @return          the slot
+ */
+static unsigned int
+hash_ptr(const void *ptr, unsigned int mask)
+{
+    unsigned long long h = (uintptr_t) ptr;
+
+    h = (h >> 4) * 0x9e3779b97f4a7c15ull;
+    return (unsigned int) (h >> 32) & mask;
+} /* end of hash_ptr */
+
+/**
+ * Find or claim the slot of a call site.
+ * @input_param     the return address of the call
+ * @return          the slot, -1 if the table is full
+ */
+static int
+find_site(void *site)
+{
+    unsigned int i = hash_ptr(site, PROFILE_SITES - 1);
+    void *cur;
+    int n;
+
+    for (n = 0; n < PROFILE_SITES; n++) {
+        cur = __atomic_load_n(&sites[i].site, __ATOMIC_ACQUIRE);
+        if (cur == NULL) {
+            if (__atomic_compare_exchange_n(&sites[i].site, &cur, site, false,
+                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                return i;
+            } /* end if */
+        } /* end if */
+        if (cur == site) {
+            return i;
+        } /* end if */
+        i = (i + 1) & (PROFILE_SITES - 1);
+    } /* end for */
+
+    return -1;
+} /* end of find_site */
+
+/**
+ * Get the histogram bucket of a size.
+ * @input_param     the size of the block
+ * @return          the bucket
+ */
+static int
+size_bucket(size_t size)
+{
+    size_t limit = 16;
+    int bucket = 0;
+
+    while (bucket < PROFILE_BUCKETS - 1 && size > limit) {
+        limit <<= 2;
+        bucket++;
+    } /* end while */
+
+    return bucket;
+} /* end of size_bucket */
+
+/*
+ * _profile_malloc - count a block at its call site
+ */
+void
+_profile_malloc(void *ptr, size_t size, void *site)
+{
+    unsigned int i;
+    void *cur;
+    int s, n;
+
+    if (ptr == NULL) {
+        return;
+    } /* end if */
+    __atomic_fetch_add(&process_allocs, 1, __ATOMIC_RELAXED);
+
+    s = find_site(site);
+    if (s < 0) {
+        __atomic_fetch_add(&lost_sites, 1, __ATOMIC_RELAXED);
+        return;
+    } /* end if */
+    __atomic_fetch_add(&sites[s].allocs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&sites[s].bytes, size, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&sites[s].live_bytes, size, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&sites[s].hist[size_bucket(size)], 1, __ATOMIC_RELAXED);
+
+    // a block is removed before it is freed, so its address is in one slot at most
+    i = hash_ptr(ptr, PROFILE_BLOCKS - 1);
+    for (n = 0; n < PROFILE_PROBES; n++) {
+        cur = __atomic_load_n(&blocks[i].ptr, __ATOMIC_ACQUIRE);
+        if ((cur == NULL || cur == BLOCK_REMOVED)
+                && __atomic_compare_exchange_n(&blocks[i].ptr, &cur, ptr, false,
+                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            blocks[i].size = size;
+            blocks[i].site = s;
+            return;
+        } /* end if */
+        i = (i + 1) & (PROFILE_BLOCKS - 1);
+    } /* end for */
+
+    // the free of the block will count as foreign
+    __atomic_fetch_add(&untracked_blocks, 1, __ATOMIC_RELAXED);
+} /* end of _profile_malloc */
+
+/*
+ * _profile_free - give a block back to its call site
+ */
+void
+_profile_free(void *ptr)
+{
+    unsigned int i;
+    void *cur;
+    int n;
+
+    if (ptr == NULL) {
+        return;
+    } /* end if */
+
+    i = hash_ptr(ptr, PROFILE_BLOCKS - 1);
+    for (n = 0; n < PROFILE_PROBES; n++) {
+        cur = __atomic_load_n(&blocks[i].ptr, __ATOMIC_ACQUIRE);
+        if (cur == ptr) {
+            __atomic_fetch_add(&sites[blocks[i].site].frees, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_sub(&sites[blocks[i].site].live_bytes, blocks[i].size, __ATOMIC_RELAXED);
+            __atomic_store_n(&blocks[i].ptr, BLOCK_REMOVED, __ATOMIC_RELEASE);
+            return;
+        } /* end if */
+        if (cur == NULL) {
+            break;
+        } /* end if */
+        i = (i + 1) & (PROFILE_BLOCKS - 1);
+    } /* end for */
+
+    // allocated before the wrapper, by calloc()/realloc() or inside the C library
+    __atomic_fetch_add(&foreign_frees, 1, __ATOMIC_RELAXED);
+} /* end of _profile_free */
+
+/**
+ * Write the buffered output.
+ * @input_param     the output
+ */
+static void
+out_flush(out_t *out)
+{
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < out->len) {
+        n = write(out->fd, out->buf + done, out->len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            break;
+        } /* end if */
+        done += n;
+    } /* end while */
+    out->len = 0;
+} /* end of out_flush */
+
+/**
+ * Append a string to the output.
+ * @input_param     the output
+ * @input_param     the string
+ */
+static void
+out_str(out_t *out, const char *s)
+{
+    while (*s != '\0') {
+        if (out->len == OUT_SIZE) {
+            out_flush(out);
+        } /* end if */
+        out->buf[out->len++] = *s++;
+    } /* end while */
+} /* end of out_str */
+
+/**
+ * Append a string to the output, right-aligned.
+ * @input_param     the output
+ * @input_param     the string
+ * @input_param     the width of the field
+ */
+static void
+out_field(out_t *out, const char *s, int width)
+{
+    int n;
+
+    for (n = strlen(s); n < width; n++) {
+        out_str(out, " ");
+    } /* end for */
+    out_str(out, s);
+} /* end of out_field */
+
+/**
+ * Append a number to the output, right-aligned.
+ * @input_param     the output
+ * @input_param     the number
+ * @input_param     the base, 10 or 16
+ * @input_param     the width of the field
+ */
+static void
+out_num(out_t *out, unsigned long long v, unsigned int base, int width)
+{
+    char digits[32];
+    int n = sizeof (digits) - 1;
+
+    digits[n] = '\0';
+    do {
+        digits[--n] = "0123456789abcdef"[v % base];
+        v /= base;
+    } while (v > 0);
+    if (base == 16) {
+        digits[--n] = 'x';
+        digits[--n] = '0';
+    } /* end if */
+    out_field(out, digits + n, width);
+} /* end of out_num */
+
+/**
+ * Sort the used sites by the bytes they allocated.
+ * @return          the number of sites
+ */
+static int
+sort_sites(void)
+{
+    int count = 0;
+    int i, j;
+
+    for (i = 0; i < PROFILE_SITES; i++) {
+        if (__atomic_load_n(&sites[i].site, __ATOMIC_ACQUIRE) == NULL) {
+            continue;
+        } /* end if */
+        for (j = count; j > 0 && sites[order[j - 1]].bytes < sites[i].bytes; j--) {
+            order[j] = order[j - 1];
+        } /* end for */
+        order[j] = i;
+        count++;
+    } /* end for */
+
+    return count;
+} /* end of sort_sites */
+
+/*
+ * _profile_dump - write a snapshot of the call sites, the counters keep
+ * running meanwhile
+ */
+void
+_profile_dump(int fd)
+{
+    extern char __executable_start[];
+    static const char *bucket_name[PROFILE_BUCKETS] = {
+        "<=16", "<=64", "<=256", "<=1K", "<=4K", "<=16K", "<=64K", ">64K"
+    };
+    out_t out = { .fd = fd, .len = 0 };
+    unsigned long allocs = 0, frees = 0;
+    profile_site_t *site;
+    int count, i, b;
+
+    if (__atomic_exchange_n(&dumping, 1, __ATOMIC_ACQUIRE)) {
+        return;
+    } /* end if */
+
+    count = sort_sites();
+    for (i = 0; i < count; i++) {
+        allocs += sites[order[i]].allocs;
+        frees += sites[order[i]].frees;
+    } /* end for */
+
+    out_str(&out, "[");
+    out_num(&out, getpid(), 10, 0);
+    out_str(&out, "] allocation profile of ");
+    out_str(&out, program_invocation_short_name);
+    out_str(&out, ": ");
+    out_num(&out, allocs, 10, 0);
+    out_str(&out, " mallocs at ");
+    out_num(&out, count, 10, 0);
+    out_str(&out, " sites, ");
+    out_num(&out, frees, 10, 0);
+    out_str(&out, " frees, ");
+    out_num(&out, foreign_frees, 10, 0);
+    out_str(&out, " foreign frees, ");
+    out_num(&out, untracked_blocks + lost_sites, 10, 0);
+    out_str(&out, " untracked blocks\n");
+
+    out_str(&out, "          site    mallocs         bytes      frees  live bytes");
+    for (b = 0; b < PROFILE_BUCKETS; b++) {
+        out_field(&out, bucket_name[b], 8);
+    } /* end for */
+    out_str(&out, "\n");
+
+    for (i = 0; i < count; i++) {
+        site = &sites[order[i]];
+        out_num(&out, (char *) site->site - __executable_start, 16, 14);
+        out_num(&out, site->allocs, 10, 11);
+        out_num(&out, site->bytes, 10, 14);
+        out_num(&out, site->frees, 10, 11);
+        out_num(&out, site->live_bytes, 10, 12);
+        for (b = 0; b < PROFILE_BUCKETS; b++) {
+            out_num(&out, site->hist[b], 10, 8);
+        } /* end for */
+        out_str(&out, "\n");
+    } /* end for */
+    out_flush(&out);
+
+    __atomic_store_n(&dumping, 0, __ATOMIC_RELEASE);
+} /* end of _profile_dump */
+
+/**
+ * List the blocks which are not freed yet.
+ * @input_param     the file descriptor
+ */
+static void
+leak_report(int fd)
+{
+    extern char __executable_start[];
+    out_t out = { .fd = fd, .len = 0 };
+    unsigned long long bytes = 0;
+    unsigned long count = 0;
+    void *ptr;
+    int i;
+
+    for (i = 0; i < PROFILE_BLOCKS; i++) {
+        ptr = __atomic_load_n(&blocks[i].ptr, __ATOMIC_ACQUIRE);
+        if (ptr == NULL || ptr == BLOCK_REMOVED) {
+            continue;
+        } /* end if */
+        if (count < PROFILE_LEAK_LINES) {
+            out_num(&out, (uintptr_t) ptr, 16, 18);
+            out_num(&out, blocks[i].size, 10, 12);
+            out_str(&out, " bytes from ");
+            out_num(&out, (char *) sites[blocks[i].site].site - __executable_start, 16, 0);
+            out_str(&out, "\n");
+        } /* end if */
+        bytes += blocks[i].size;
+        count++;
+    } /* end for */
+
+    if (count > PROFILE_LEAK_LINES) {
+        out_str(&out, "               ...\n");
+    } /* end if */
+    out_str(&out, "[");
+    out_num(&out, getpid(), 10, 0);
+    out_str(&out, "] ");
+    out_num(&out, count, 10, 0);
+    out_str(&out, " outstanding blocks, ");
+    out_num(&out, bytes, 10, 0);
+    out_str(&out, " bytes\n");
+    out_flush(&out);
+} /* end of leak_report */
+
+/**
+ * Dump a snapshot on PROFILE_SIGNAL.
+ * @input_param     the signal
+ */
+static void
+profile_signal(int sig)
+{
+    int saved_errno = errno;
+
+    _profile_dump(STDERR_FILENO);
+    errno = saved_errno;
+} /* end of profile_signal */
+
+/**
+ * Start the profile of a forked child empty, so a prefork worker or a
+ * cgi child does not report the counts of its parent as its own. It
+ * reports at exit only if it allocated itself.
+ */
+static void
+profile_forked(void)
+{
+    memset(sites, 0, sizeof (sites));
+    memset(blocks, 0, sizeof (blocks));
+    lost_sites = 0;
+    untracked_blocks = 0;
+    foreign_frees = 0;
+    process_allocs = 0;
+} /* end of profile_forked */
+
+/**
+ * Select the mode and install the signal handler before main().
+ */
+static void __attribute__((constructor))
+profile_init(void)
+{
+    const char *mode = getenv(PROFILE_ENV);
+    struct sigaction sa;
+
+    _profile_trace = (mode != NULL && strcmp(mode, "trace") == 0);
+    if (_profile_trace) {
+        return;
+    } /* end if */
+
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = profile_signal;
+    sigaction(PROFILE_SIGNAL, &sa, NULL);
+    pthread_atfork(NULL, NULL, profile_forked);
+} /* end of profile_init */
+
+/**
+ * Report the profile and the outstanding blocks at exit.
+ */
+static void __attribute__((destructor))
+profile_exit(void)
+{
+    if (!_profile_trace && process_allocs > 0) {
+        _profile_dump(STDERR_FILENO);
+        leak_report(STDERR_FILENO);
+    } /* end if */
+} /* end of profile_exit */
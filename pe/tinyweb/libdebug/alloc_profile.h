@@ -0,0 +1,38 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * alloc_profile.h - allocation profile of the malloc/free wrappers
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+
+#ifndef _ALLOC_PROFILE_H
+#define _ALLOC_PROFILE_H
+
+#include <stddef.h>
+
+#define PROFILE_SITES            1024   // call sites of malloc, a power of two
+#define PROFILE_BLOCKS          65536   // live blocks tracked, a power of two
+#define PROFILE_PROBES             64   // slots probed before a block goes untracked
+#define PROFILE_BUCKETS             8   // size classes of the histogram, powers of four
+#define PROFILE_LEAK_LINES         50   // outstanding blocks listed in a report
+#define PROFILE_SIGNAL        SIGUSR2   // dumps a snapshot of the profile
+
+/*
+ * The environment variable LIBDEBUG selects the mode, "trace" prints
+ * every call as before, anything else keeps the profile
+ */
+#define PROFILE_ENV         "LIBDEBUG"
+
+
+extern int _profile_trace;
+
+void _profile_malloc(void *ptr, size_t size, void *site);
+void _profile_free(void *ptr);
+void _profile_dump(int fd);
+
+#endif
@@ -0,0 +1,24 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * arena_debug.c - high-water report of the request arenas
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+
+#include <stdio.h>
+#include <unistd.h>
+
+/*
+ * _arena_debug - report a new high-water mark of the arenas
+ */
+void
+_arena_debug(size_t high_water, int chunks)
+{
+    fprintf(stderr, "[%d] arena high-water %zu bytes in %d chunk(s)\n",
+            (int) getpid(), high_water, chunks);
+} /* end of _arena_debug */
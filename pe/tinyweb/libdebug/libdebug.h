@@ -26,5 +26,10 @@
 void *_malloc_debug(size_t size, char *file, int line);
 void _free_debug(void *ptr, char *file, int line);
 
+/*
+ * Report a new high-water mark of the request arenas
+ */
+void _arena_debug(size_t high_water, int chunks);
+
 #endif
 
@@ -24,7 +24,7 @@
 void
 _free_debug(void *ptr, char *file, int line)
 {
-    free(ptr);
     printf("%s:%d: free(%p)\n", file, line, ptr);
+    free(ptr);
 } /* end of _free_debug */
 
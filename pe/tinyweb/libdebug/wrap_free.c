@@ -14,6 +14,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "alloc_profile.h"
+
 /*
  * Link-time interposition of malloc and free using the static linker's (ld)
  * "--wrap symbol" flag.
@@ -22,12 +24,18 @@
 void __real_free(void *ptr);
 
 /*
- * __free_malloc - free wrapper function
+ * __free_malloc - free wrapper function, the block leaves the profile
+ * before another thread can get its address from malloc
  */
 void
 __wrap_free(void *ptr)
 {
-    __real_free(ptr);
-    fprintf(stderr, "free(%p)\n", ptr);
+    if (_profile_trace) {
+        __real_free(ptr);
+        fprintf(stderr, "free(%p)\n", ptr);
+    } else {
+        _profile_free(ptr);
+        __real_free(ptr);
+    } /* end if */
 } /* end of myfree */
 
@@ -14,6 +14,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "alloc_profile.h"
+
 /*
  * Link-time interposition of malloc and free using the static linker's (ld)
  * "--wrap symbol" flag.
@@ -22,14 +24,19 @@
 void *__real_malloc(size_t size);
 
 /*
- * __wrap_malloc - malloc wrapper function
+ * __wrap_malloc - malloc wrapper function, the block is counted at the
+ * caller unless LIBDEBUG=trace prints every call
  */
 void *
 __wrap_malloc(size_t size)
 {
     void *ptr = __real_malloc(size);
 
-    fprintf(stderr, "malloc(%zd)=%p\n", size, ptr);
+    if (_profile_trace) {
+        fprintf(stderr, "malloc(%zd)=%p\n", size, ptr);
+    } else {
+        _profile_malloc(ptr, size, __builtin_return_address(0));
+    } /* end if */
     return ptr;
 } /* end of __wrap_malloc */
 
@@ -8,7 +8,7 @@ DIR=${1:-web}
 # Call tinyweb in the build-path and forward all arguments of this script
 # Do not check whether the root directory exists at this level.
 # Let tinyweb deal with it...
-make && ./build/$BUILD_DIR/tinyweb -p 8080 -d ${DIR}
+make && ./build/$BUILD_DIR/tinyweb -p 8080 -d ${DIR} -s --cgi-pool 2
 
 echo "Exit status: " $?
 
@@ -0,0 +1,327 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "tinyweb.h"
+#include "access_log.h"
+
+/*
+ * Every serving process owns a ring with a single producer, the thread
+ * serving the requests, and a single consumer. The consumer is a
+ * writer thread if one was started, otherwise the producer drains the
+ * ring itself when it is full or on access_log_flush(). head and tail
+ * count the bytes ever written and read, so head - tail is the fill.
+ */
+static int log_fd = -1;
+static bool log_is_file = false;            // batches need no splitting
+static unsigned int log_flush_ms = LOG_DEFAULT_FLUSH_MS;
+static log_overflow_t log_overflow = LOG_OVERFLOW_BLOCK;
+static char *ring = NULL;
+static size_t ring_head = 0;                // written by the producer only
+static size_t ring_tail = 0;                // written by the consumer only
+static char batch[LOG_BATCH_SIZE];          // copy of the records to write
+static unsigned long dropped = 0;
+static pid_t log_pid = 0;
+static pthread_t writer;
+static sem_t writer_wakeup;                 // posted when the ring is half full
+static bool writer_running = false;
+static int writer_stop = 0;
+
+
+/**
+ * Forget the state of the parent in a forked child: there is no
+ * writer thread and the pending records belong to the parent.
+ */
+static void
+reset_after_fork(void) {
+    log_pid = getpid();
+    writer_running = false;
+    writer_stop = 0;
+    ring_tail = ring_head;
+} /* end of reset_after_fork */
+
+/**
+ * Set up the access log of the server, the ring is inherited by all
+ * processes forked later.
+ * @input_param     the log file descriptor
+ * @input_param     the flush interval of the writer thread in ms,
+ *                  0 writes every record directly
+ * @input_param     the policy if the ring is full
+ * @return          -1 in case of error
+ */
+int
+access_log_init(int fd, unsigned int flush_ms, log_overflow_t overflow) {
+    struct stat st;
+
+    log_fd = fd;
+    log_is_file = (fstat(fd, &st) == 0 && S_ISREG(st.st_mode));
+    log_flush_ms = flush_ms;
+    log_overflow = overflow;
+    log_pid = getpid();
+
+    if (flush_ms > 0) {
+        ring = malloc(LOG_RING_SIZE);
+        if (ring == NULL) {
+            err_print("ERROR: cant allocate memory");
+            return -1;
+        } /* end if */
+    } /* end if */
+
+    if (pthread_atfork(NULL, NULL, reset_after_fork) != 0) {
+        err_print("ERROR: pthread_atfork()");
+        return -1;
+    } /* end if */
+
+    return 0;
+} /* end of access_log_init */
+
+/**
+ * Write a buffer completely.
+ * @input_param     the buffer
+ * @input_param     the number of bytes
+ */
+static void
+write_all(const char *buf, size_t len) {
+    ssize_t n;
+
+    while (len > 0) {
+        n = write(log_fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            } /* end if */
+            return;
+        } /* end if */
+        buf += n;
+        len -= n;
+    } /* end while */
+} /* end of write_all */
+
+/**
+ * Write complete records. A regular file is opened with O_APPEND, so
+ * one write() of a batch does not mix with the batches of other
+ * processes. A pipe only guarantees this up to PIPE_BUF bytes, larger
+ * batches are split at record boundaries.
+ * @input_param     the records
+ * @input_param     the number of bytes
+ */
+static void
+write_batch(const char *buf, size_t len) {
+    const char *end;
+    size_t n;
+
+    while (len > 0) {
+        n = len;
+        if (!log_is_file && n > PIPE_BUF) {
+            end = memrchr(buf, '\n', PIPE_BUF);
+            n = (end != NULL) ? (size_t) (end - buf) + 1 : PIPE_BUF;
+        } /* end if */
+        write_all(buf, n);
+        buf += n;
+        len -= n;
+    } /* end while */
+} /* end of write_batch */
+
+/**
+ * Write all records of the ring, as the consumer.
+ */
+static void
+drain(void) {
+    size_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    size_t tail = ring_tail;
+    size_t index;
+    size_t first;
+    size_t n;
+    char *end;
+
+    while (head != tail) {
+        n = head - tail;
+        if (n > LOG_BATCH_SIZE) {
+            n = LOG_BATCH_SIZE;
+        } /* end if */
+
+        index = tail & (LOG_RING_SIZE - 1);
+        first = (n < LOG_RING_SIZE - index) ? n : LOG_RING_SIZE - index;
+        memcpy(batch, ring + index, first);
+        memcpy(batch + first, ring, n - first);
+        if (n < head - tail && (end = memrchr(batch, '\n', n)) != NULL) {
+            /* the rest of the last record goes into the next batch */
+            n = end - batch + 1;
+        } /* end if */
+
+        // the space can be reused while the batch is written
+        tail += n;
+        __atomic_store_n(&ring_tail, tail, __ATOMIC_RELEASE);
+        write_batch(batch, n);
+
+        head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    } /* end while */
+} /* end of drain */
+
+/**
+ * Writer thread, drains the ring once per flush interval or earlier
+ * if the producer reports a half full ring.
+ * @input_param     not used
+ * @return          NULL
+ */
+static void *
+writer_main(void *arg) {
+    struct timespec deadline;
+
+    while (!__atomic_load_n(&writer_stop, __ATOMIC_ACQUIRE)) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += log_flush_ms / 1000;
+        deadline.tv_nsec += (log_flush_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        } /* end if */
+        while (sem_timedwait(&writer_wakeup, &deadline) < 0 && errno == EINTR) {
+        } /* end while */
+        drain();
+    } /* end while */
+    drain();
+
+    return NULL;
+} /* end of writer_main */
+
+/**
+ * Start the writer thread of the calling process. Signals stay with
+ * the thread serving the requests.
+ * @return          -1 in case of error
+ */
+int
+access_log_start(void) {
+    sigset_t all;
+    sigset_t old;
+    int err;
+
+    if (ring == NULL || writer_running) {
+        return 0;
+    } /* end if */
+
+    if (sem_init(&writer_wakeup, 0, 0) < 0) {
+        err_print("ERROR: sem_init()");
+        return -1;
+    } /* end if */
+
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    __atomic_store_n(&writer_stop, 0, __ATOMIC_RELEASE);
+    err = pthread_create(&writer, NULL, writer_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (err != 0) {
+        err_print("ERROR: pthread_create()");
+        return -1;
+    } /* end if */
+
+    writer_running = true;
+    return 0;
+} /* end of access_log_start */
+
+/**
+ * Append a record to the access log. The record is copied, the caller
+ * does not wait for the write unless the ring is full and the overflow
+ * policy is to block.
+ * @input_param     the record including the line feed
+ * @input_param     the length of the record
+ */
+void
+access_log_write(const char *record, size_t len) {
+    struct timespec pause = { 0, 100000L };
+    size_t fill;
+    size_t index;
+    size_t first;
+
+    if (ring == NULL || len > LOG_BATCH_SIZE) {
+        write_batch(record, len);
+        return;
+    } /* end if */
+
+    while (LOG_RING_SIZE - (fill = ring_head - __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE)) < len) {
+        if (!writer_running) {
+            // the caller is the only consumer
+            drain();
+        } else if (log_overflow == LOG_OVERFLOW_DROP) {
+            dropped++;
+            return;
+        } else {
+            sem_post(&writer_wakeup);
+            nanosleep(&pause, NULL);
+        } /* end if */
+    } /* end while */
+
+    index = ring_head & (LOG_RING_SIZE - 1);
+    first = (len < LOG_RING_SIZE - index) ? len : LOG_RING_SIZE - index;
+    memcpy(ring + index, record, first);
+    memcpy(ring, record + first, len - first);
+    __atomic_store_n(&ring_head, ring_head + len, __ATOMIC_RELEASE);
+
+    if (writer_running && fill < LOG_RING_SIZE / 2 && fill + len >= LOG_RING_SIZE / 2) {
+        sem_post(&writer_wakeup);
+    } /* end if */
+} /* end of access_log_write */
+
+/**
+ * Write the pending records now if no writer thread drains the ring,
+ * e.g. before a process waits for its next request.
+ */
+void
+access_log_flush(void) {
+    if (ring != NULL && !writer_running) {
+        drain();
+    } /* end if */
+} /* end of access_log_flush */
+
+/**
+ * Stop the writer thread and write the pending records.
+ */
+void
+access_log_stop(void) {
+    if (writer_running) {
+        __atomic_store_n(&writer_stop, 1, __ATOMIC_RELEASE);
+        sem_post(&writer_wakeup);
+        pthread_join(writer, NULL);
+        sem_destroy(&writer_wakeup);
+        writer_running = false;
+    } /* end if */
+    access_log_flush();
+} /* end of access_log_stop */
+
+/**
+ * Return the number of records dropped because the ring was full.
+ * @return          the number of dropped records
+ */
+unsigned long
+access_log_dropped(void) {
+    return dropped;
+} /* end of access_log_dropped */
+
+/**
+ * Return the process id of the caller without a system call.
+ * @return          the process id
+ */
+pid_t
+access_log_pid(void) {
+    return log_pid;
+} /* end of access_log_pid */
@@ -0,0 +1,35 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _ACCESS_LOG_H
+#define _ACCESS_LOG_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define LOG_RING_SIZE               (1 << 20)   // bytes, a power of two
+#define LOG_BATCH_SIZE                  65536   // maximum size of one write()
+#define LOG_DEFAULT_FLUSH_MS              100
+
+
+typedef enum log_overflow {
+    LOG_OVERFLOW_BLOCK = 0,        // wait for the writer, no record is lost
+    LOG_OVERFLOW_DROP              // drop the record and count it
+} log_overflow_t;
+
+
+extern int access_log_init(int fd, unsigned int flush_ms, log_overflow_t overflow);
+extern int access_log_start(void);
+extern void access_log_write(const char *record, size_t len);
+extern void access_log_flush(void);
+extern void access_log_stop(void);
+extern unsigned long access_log_dropped(void);
+extern pid_t access_log_pid(void);
+
+#endif
@@ -0,0 +1,106 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tinyweb.h"
+#include "arena.h"
+#include "slab.h"
+#ifdef DEBUG
+#include "libdebug.h"
+#endif
+
+/*
+ * The largest request of the serving process, over all its arenas
+ */
+static size_t peak = 0;
+
+
+/**
+ * Initialise an empty arena, it takes no memory before the first
+ * allocation.
+ * @input_param     the arena
+ */
+void
+arena_init(arena_t *arena) {
+    memset(arena, 0, sizeof (*arena));
+} /* end of arena_init */
+
+/**
+ * Allocate a block which is valid until the next arena_reset().
+ * @input_param     the arena
+ * @input_param     the size of the block, at most SLAB_MAX_SIZE
+ * @return          the block, NULL in case of error
+ */
+void *
+arena_alloc(arena_t *arena, size_t size) {
+    size_t chunk_size;
+    char *chunk;
+
+    size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+    if (arena->count > 0 && arena->used + size <= arena->chunk_size[arena->count - 1]) {
+        chunk = arena->chunk[arena->count - 1] + arena->used;
+        arena->used += size;
+        arena->total += size;
+        return chunk;
+    } /* end if */
+
+    if (arena->count == ARENA_CHUNKS || size > SLAB_MAX_SIZE) {
+        err_print("ERROR: arena is full");
+        return NULL;
+    } /* end if */
+    chunk_size = (size > ARENA_CHUNK_SIZE) ? size : ARENA_CHUNK_SIZE;
+    chunk = slab_alloc(&chunk_size);
+    if (chunk == NULL) {
+        return NULL;
+    } /* end if */
+
+    arena->chunk[arena->count] = chunk;
+    arena->chunk_size[arena->count] = chunk_size;
+    arena->count++;
+    arena->used = size;
+    arena->total += size;
+    return chunk;
+} /* end of arena_alloc */
+
+/**
+ * Release all blocks of an arena, the chunks go back to the slab pool.
+ * @input_param     the arena
+ */
+void
+arena_reset(arena_t *arena) {
+    int i;
+
+    if (arena->total > arena->high_water) {
+        arena->high_water = arena->total;
+        if (arena->high_water > peak) {
+            peak = arena->high_water;
+#ifdef DEBUG
+            _arena_debug(peak, arena->count);
+#endif
+        } /* end if */
+    } /* end if */
+
+    for (i = 0; i < arena->count; i++) {
+        slab_free(arena->chunk[i], arena->chunk_size[i]);
+    } /* end for */
+    arena->count = 0;
+    arena->used = 0;
+    arena->total = 0;
+} /* end of arena_reset */
+
+/**
+ * Get the high-water mark of the serving process.
+ * @return          the most bytes a request has taken from an arena
+ */
+size_t
+arena_peak(void) {
+    return peak;
+} /* end of arena_peak */
@@ -0,0 +1,39 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_CHUNKS                8   // slab buffers of one request at most
+#define ARENA_CHUNK_SIZE         4096   // smallest chunk, larger blocks get a chunk of their own
+#define ARENA_ALIGN                16
+
+
+/*
+ * Memory which lives until the response is sent: a bump pointer in
+ * buffers of the slab pool, released all at once by arena_reset()
+ */
+typedef struct arena {
+    char               *chunk[ARENA_CHUNKS];
+    size_t              chunk_size[ARENA_CHUNKS];
+    int                 count;              // chunks in use
+    size_t              used;               // bytes used in the last chunk
+    size_t              total;              // bytes allocated since the reset
+    size_t              high_water;         // most bytes of one request
+} arena_t;
+
+
+extern void arena_init(arena_t *arena);
+extern void *arena_alloc(arena_t *arena, size_t size);
+extern void arena_reset(arena_t *arena);
+extern size_t arena_peak(void);
+
+#endif
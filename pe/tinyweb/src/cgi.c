@@ -0,0 +1,601 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "tinyweb.h"
+#include "connection.h"
+#include "cgi.h"
+#include "http.h"
+#include "header_builder.h"
+#include "response.h"
+#include "metrics.h"
+
+
+/**
+ * Compare the name of a header field.
+ * @input_param     the name
+ * @input_param     the length of the name
+ * @input_param     the field name to compare with
+ * @return          true if equal, ignoring the case
+ */
+static bool
+field_is(const char *name, size_t len, const char *field) {
+    return strlen(field) == len && strncasecmp(name, field, len) == 0;
+} /* end of field_is */
+
+/**
+ * Prepare the connection for the output of a cgi script. The body of
+ * a HEAD request is dropped, the header is the one of a GET request.
+ * @input_param     the connection
+ */
+void
+cgi_output_init(connection_t *conn) {
+    conn->cgi_buf = NULL;
+    conn->cgi_len = 0;
+    conn->cgi_header_done = false;
+    conn->cgi_status = 200;
+    conn->cgi_length = -1;
+    conn->cgi_eof = false;
+    conn->chunked = false;
+    conn->chunk_open = false;
+    conn->chunk_left = 0;
+    conn->body_discard = (conn->parsed_header.methodType == HTTP_METHOD_HEAD);
+    conn->frame_len = 0;
+    conn->frame_sent = 0;
+    conn->header_len = 0;
+    conn->header_sent = 0;
+    conn->response_size = 0;
+    conn->phase_start = metrics_now();
+} /* end of cgi_output_init */
+
+/**
+ * Answer with an error status instead of the output of the script if
+ * nothing is sent yet, otherwise the response is cut off.
+ * @input_param     the connection
+ * @input_param     the error status
+ * @input_param     the program options
+ * @return          CONN_DONE with the error response prepared or CONN_ERROR
+ */
+static conn_result_t
+cgi_fail(connection_t *conn, http_status_t status, prog_options_t *server) {
+    conn->cgi_buf = NULL;
+    if (conn->header_sent > 0 || respond_cgi_error(conn, status, server) < 0) {
+        return CONN_ERROR;
+    } /* end if */
+
+    return CONN_DONE;
+} /* end of cgi_fail */
+
+/**
+ * Build the response header from the header of the script. A Status
+ * field sets the status line, a Location without it redirects with
+ * 302. Without a Content-Length of the script an HTTP/1.1 body is
+ * sent chunked, an HTTP/1.0 body ends with the connection.
+ * @input_param     the connection, the cgi header is in cgi_buf
+ * @return          -1 if the cgi header is invalid
+ */
+static int
+cgi_build_header(connection_t *conn) {
+    parsed_http_header_t *parsed_header = &conn->parsed_header;
+    header_builder_t hb;
+    const char *line, *eol, *colon, *value;
+    const char *end = conn->cgi_buf + conn->cgi_len;
+    const char *reason = "";
+    size_t reason_len = 0;
+    size_t len, name_len;
+    bool location = false;
+    bool status = false;
+    char *number_end;
+    int pass, i, n;
+
+    // the status line comes first, so the fields are scanned twice
+    header_init(&hb, conn->header, sizeof (conn->header));
+    for (pass = 0; pass < 2; pass++) {
+        for (line = conn->cgi_buf; line < end; line = eol + 1) {
+            eol = memchr(line, '\n', end - line);
+            len = eol - line;
+            if (len > 0 && line[len - 1] == '\r') {
+                len--;
+            } /* end if */
+            if (len == 0) {
+                break;
+            } /* end if */
+
+            colon = memchr(line, ':', len);
+            if (colon == NULL) {
+                return -1;
+            } /* end if */
+            name_len = colon - line;
+            for (value = colon + 1; value < line + len && (*value == ' ' || *value == '\t'); value++) {
+            } /* end for */
+
+            if (field_is(line, name_len, "Status")) {
+                if (pass == 0) {
+                    conn->cgi_status = strtol(value, &number_end, 10);
+                    if (number_end != value + 3 || conn->cgi_status < 100 || conn->cgi_status > 599) {
+                        return -1;
+                    } /* end if */
+                    for (reason = number_end; reason < line + len && *reason == ' '; reason++) {
+                    } /* end for */
+                    reason_len = line + len - reason;
+                    status = true;
+                } /* end if */
+                continue;
+            } else if (field_is(line, name_len, "Content-Length")) {
+                if (pass == 0) {
+                    conn->cgi_length = strtoll(value, &number_end, 10);
+                    if (number_end == value || conn->cgi_length < 0) {
+                        return -1;
+                    } /* end if */
+                } /* end if */
+            } else if (field_is(line, name_len, "Location")) {
+                location = true;
+            } else if (field_is(line, name_len, "Connection") || field_is(line, name_len, "Transfer-Encoding")
+                    || field_is(line, name_len, "Keep-Alive") || field_is(line, name_len, "Server")
+                    || field_is(line, name_len, "Date")) {
+                /* the server frames the response */
+                continue;
+            } /* end if */
+
+            if (pass == 1) {
+                header_add_raw(&hb, line, len);
+                header_add_raw(&hb, "\r\n", 2);
+            } /* end if */
+        } /* end for */
+
+        if (pass == 0) {
+            if (location && !status) {
+                conn->cgi_status = 302;
+                reason = "Found";
+                reason_len = 5;
+            } /* end if */
+            for (i = 0, n = -1; i < HTTP_STATUS_COUNT && n < 0; i++) {
+                if (http_status_list[i].code == conn->cgi_status) {
+                    n = i;
+                } /* end if */
+            } /* end for */
+            if (n >= 0) {
+                header_add_status(&hb, n);
+            } else {
+                header_add_status_code(&hb, conn->cgi_status, reason, reason_len);
+            } /* end if */
+        } /* end if */
+    } /* end for */
+
+    if (conn->cgi_status < 200 || conn->cgi_status == 204 || conn->cgi_status == 304) {
+        /* a response without a body */
+        conn->body_discard = true;
+    } else if (conn->cgi_length < 0) {
+        if (parsed_header->protocol.len == 8 && strncmp(parsed_header->protocol.ptr, "HTTP/1.1", 8) == 0) {
+            conn->chunked = true;
+            header_add_field(&hb, HTTP_HEADER_TRANSFER_ENCODING, "chunked");
+        } else {
+            conn->keep_alive = false;
+        } /* end if */
+    } /* end if */
+    header_add_field(&hb, HTTP_HEADER_CONNECTION, conn->keep_alive ? "keep-alive" : "close");
+
+    n = header_finish(&hb);
+    if (n < 0) {
+        return -1;
+    } /* end if */
+    conn->header_len = n;
+    conn->header_sent = 0;
+    return 0;
+} /* end of cgi_build_header */
+
+/**
+ * Collect the header of the script up to the empty line and build the
+ * response header from it. The line ends may be LF or CRLF.
+ * @input_param     the connection
+ * @input_param     the output of the script
+ * @input_param     the number of bytes
+ * @output_param    the number of bytes which belong to the header
+ * @return          1 if the header is complete, 0 if more is
+ *                  required, -1 if the header is invalid or too large
+ */
+static int
+cgi_take_header(connection_t *conn, const char *data, size_t len, size_t *used) {
+    size_t start = conn->cgi_len;
+    size_t n, i;
+    char *p;
+
+    if (conn->cgi_buf == NULL) {
+        conn->cgi_buf = arena_alloc(&conn->arena, CGI_HEADER_SIZE);
+        if (conn->cgi_buf == NULL) {
+            err_print("ERROR: cant allocate memory");
+            return -1;
+        } /* end if */
+    } /* end if */
+
+    n = CGI_HEADER_SIZE - conn->cgi_len;
+    if (n > len) {
+        n = len;
+    } /* end if */
+    memcpy(conn->cgi_buf + conn->cgi_len, data, n);
+    conn->cgi_len += n;
+    *used = n;
+
+    p = conn->cgi_buf;
+    for (i = start; i < conn->cgi_len; i++) {
+        if (p[i] == '\n' && (i == 0 || p[i - 1] == '\n'
+                || (p[i - 1] == '\r' && (i == 1 || p[i - 2] == '\n')))) {
+            /* the empty line, the body follows */
+            *used = i + 1 - start;
+            conn->cgi_len = i + 1;
+            if (cgi_build_header(conn) < 0) {
+                return -1;
+            } /* end if */
+            conn->cgi_header_done = true;
+            conn->cgi_buf = NULL;
+            return 1;
+        } /* end if */
+    } /* end for */
+
+    return (conn->cgi_len == CGI_HEADER_SIZE) ? -1 : 0;
+} /* end of cgi_take_header */
+
+/**
+ * Write the pending part of the response header.
+ * @input_param     the connection
+ * @input_param     MSG_MORE if the body follows at once
+ * @return          CONN_WANT_WRITE if the socket is full,
+ *                  CONN_DONE if the header is sent completely
+ */
+static conn_result_t
+cgi_send_header(connection_t *conn, int flags) {
+    ssize_t n;
+
+    while (conn->header_sent < conn->header_len) {
+        n = send(conn->sd, conn->header + conn->header_sent, conn->header_len - conn->header_sent, flags);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return CONN_WANT_WRITE;
+            } /* end if */
+            return CONN_ERROR;
+        } /* end if */
+        conn->header_sent += n;
+        conn->response_size += n;
+    } /* end while */
+
+    return CONN_DONE;
+} /* end of cgi_send_header */
+
+/**
+ * Write the pending chunk framing.
+ * @input_param     the connection
+ * @input_param     MSG_MORE if chunk data follows at once
+ * @return          CONN_WANT_WRITE if the socket is full,
+ *                  CONN_DONE if the framing is sent completely
+ */
+static conn_result_t
+cgi_send_frame(connection_t *conn, int flags) {
+    ssize_t n;
+
+    while (conn->frame_sent < conn->frame_len) {
+        n = send(conn->sd, conn->frame + conn->frame_sent, conn->frame_len - conn->frame_sent, flags);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return CONN_WANT_WRITE;
+            } /* end if */
+            return CONN_ERROR;
+        } /* end if */
+        conn->frame_sent += n;
+        conn->response_size += n;
+    } /* end while */
+
+    return CONN_DONE;
+} /* end of cgi_send_frame */
+
+/**
+ * Queue the size line of the next chunk, it ends the previous one.
+ * A size of zero queues the last chunk.
+ * @input_param     the connection
+ * @input_param     the number of data bytes of the chunk
+ */
+static void
+cgi_queue_chunk(connection_t *conn, size_t size) {
+    conn->frame_len = snprintf(conn->frame, sizeof (conn->frame), "%s%zx\r\n%s",
+            conn->chunk_open ? "\r\n" : "", size, (size == 0) ? "\r\n" : "");
+    conn->frame_sent = 0;
+    conn->chunk_open = true;
+    conn->chunk_left = size;
+} /* end of cgi_queue_chunk */
+
+/**
+ * Account body bytes against the Content-Length of the script. More
+ * than announced cannot be framed, the connection is closed after it.
+ * @input_param     the connection
+ * @input_param     the number of body bytes
+ */
+static void
+cgi_count_body(connection_t *conn, size_t n) {
+    if (conn->cgi_length < 0) {
+        return;
+    } else if ((off_t) n > conn->cgi_length) {
+        conn->keep_alive = false;
+        conn->cgi_length = 0;
+    } else {
+        conn->cgi_length -= n;
+    } /* end if */
+} /* end of cgi_count_body */
+
+/**
+ * Forward output of the script from memory: the header is taken
+ * first, the body is sent behind the response header, chunked if
+ * required.
+ * @input_param     the connection
+ * @input_param     the output of the script
+ * @input_param     the number of bytes
+ * @output_param    the number of bytes taken, less than all if the
+ *                  socket is full
+ * @input_param     the program options
+ * @return          CONN_WANT_WRITE if the socket is full, CONN_DONE if
+ *                  all bytes are taken or, with another state of the
+ *                  connection, an error response is prepared,
+ *                  CONN_ERROR in case of error
+ */
+conn_result_t
+cgi_output(connection_t *conn, const char *data, size_t len, size_t *used, prog_options_t *server) {
+    conn_result_t result;
+    size_t n;
+    ssize_t sent;
+    int taken;
+
+    *used = 0;
+    if (!conn->cgi_header_done) {
+        taken = cgi_take_header(conn, data, len, used);
+        if (taken < 0) {
+            return cgi_fail(conn, HTTP_STATUS_BAD_GATEWAY, server);
+        } else if (taken == 0) {
+            return CONN_DONE;
+        } /* end if */
+    } /* end if */
+
+    result = cgi_send_header(conn, (*used < len && !conn->body_discard) ? MSG_MORE : 0);
+    if (result != CONN_DONE) {
+        return result;
+    } /* end if */
+    if (conn->body_discard) {
+        *used = len;
+        return CONN_DONE;
+    } /* end if */
+
+    while (*used < len) {
+        if (conn->chunked && conn->chunk_left == 0) {
+            cgi_queue_chunk(conn, len - *used);
+        } /* end if */
+        result = cgi_send_frame(conn, MSG_MORE);
+        if (result != CONN_DONE) {
+            return result;
+        } /* end if */
+
+        n = len - *used;
+        if (conn->chunked && n > conn->chunk_left) {
+            n = conn->chunk_left;
+        } /* end if */
+        sent = send(conn->sd, data + *used, n, 0);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return CONN_WANT_WRITE;
+            } /* end if */
+            return CONN_ERROR;
+        } /* end if */
+        *used += sent;
+        conn->response_size += sent;
+        if (conn->chunked) {
+            conn->chunk_left -= sent;
+        } /* end if */
+        cgi_count_body(conn, sent);
+    } /* end while */
+
+    return CONN_DONE;
+} /* end of cgi_output */
+
+/**
+ * Finish the response at the end of the output of the script: send
+ * the last chunk and log the response.
+ * @input_param     the connection
+ * @input_param     the program options
+ * @return          CONN_WANT_WRITE if the socket is full, CONN_DONE if
+ *                  the response is complete or, with another state of
+ *                  the connection, an error response is prepared,
+ *                  CONN_ERROR in case of error
+ */
+conn_result_t
+cgi_output_end(connection_t *conn, prog_options_t *server) {
+    conn_result_t result;
+
+    if (!conn->cgi_header_done) {
+        /* no complete header */
+        return cgi_fail(conn, HTTP_STATUS_BAD_GATEWAY, server);
+    } /* end if */
+
+    if (!conn->cgi_eof) {
+        conn->cgi_eof = true;
+        if (conn->chunked && !conn->body_discard) {
+            cgi_queue_chunk(conn, 0);
+        } /* end if */
+    } /* end if */
+    result = cgi_send_header(conn, (conn->frame_sent < conn->frame_len) ? MSG_MORE : 0);
+    if (result == CONN_DONE) {
+        result = cgi_send_frame(conn, 0);
+    } /* end if */
+    if (result != CONN_DONE) {
+        return result;
+    } /* end if */
+
+    log_cgi_response(conn, server);
+    if (!conn->body_discard && conn->cgi_length > 0) {
+        /* the script sent less than announced */
+        return CONN_ERROR;
+    } /* end if */
+
+    return CONN_DONE;
+} /* end of cgi_output_end */
+
+/**
+ * Relay the output pipe of a forked cgi script.
+ * @input_param     the connection
+ * @input_param     the non-blocking read end of the output pipe
+ * @input_param     the program options
+ * @return          -1 in case of error, the pipe is closed then
+ */
+int
+cgi_start(connection_t *conn, int fd, prog_options_t *server) {
+    cgi_output_init(conn);
+    conn->cgi_fd = fd;
+    if (conn->pipe_fd[0] < 0 && pipe2(conn->pipe_fd, O_NONBLOCK | O_CLOEXEC) < 0) {
+        err_print("ERROR: pipe2()");
+        cgi_release(conn);
+        return -1;
+    } /* end if */
+    if (conn_watch_fd(conn, fd) < 0) {
+        cgi_release(conn);
+        return -1;
+    } /* end if */
+
+    conn->state = CONN_STATE_CGI;
+    return 0;
+} /* end of cgi_start */
+
+/**
+ * Forward the output of a forked cgi script. After the header the
+ * body moves with splice() from the output pipe into the pipe of the
+ * connection, whose fill level is the size of the next chunk, and on
+ * into the socket without being copied to user space. A slow client
+ * blocks the script when its pipe is full.
+ * @input_param     the connection
+ * @input_param     the program options
+ * @return          CONN_WANT_READ or CONN_WANT_WRITE if the script or
+ *                  the client would block, the descriptor is in wait_fd,
+ *                  CONN_DONE when the response is relayed or an error
+ *                  response is prepared, CONN_ERROR in case of error
+ */
+conn_result_t
+cgi_advance(connection_t *conn, prog_options_t *server) {
+    char buf[CGI_HEADER_SIZE];
+    conn_result_t result;
+    size_t used;
+    ssize_t n;
+    int taken;
+
+    while (!conn->cgi_header_done) {
+        n = read(conn->cgi_fd, buf, sizeof (buf));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn->wait_fd = conn->cgi_fd;
+                return CONN_WANT_READ;
+            } /* end if */
+            n = 0;
+        } /* end if */
+        if (n == 0) {
+            conn_release_fd(conn, &conn->cgi_fd);
+            return cgi_output_end(conn, server);
+        } /* end if */
+
+        taken = cgi_take_header(conn, buf, n, &used);
+        if (taken < 0) {
+            cgi_release(conn);
+            return cgi_fail(conn, HTTP_STATUS_BAD_GATEWAY, server);
+        } else if (taken > 0 && used < (size_t) n && !conn->body_discard) {
+            // the start of the body goes the same way as the rest, the empty pipe takes it
+            if (write(conn->pipe_fd[1], buf + used, n - used) != n - (ssize_t) used) {
+                return CONN_ERROR;
+            } /* end if */
+            conn->pipe_len = n - used;
+            cgi_count_body(conn, conn->pipe_len);
+        } /* end if */
+    } /* end while */
+
+    if (conn->body_discard) {
+        conn_release_fd(conn, &conn->cgi_fd);
+        return cgi_output_end(conn, server);
+    } /* end if */
+
+    while (1) {
+        if (conn->chunked && conn->pipe_len > 0 && conn->chunk_left == 0) {
+            cgi_queue_chunk(conn, conn->pipe_len);
+        } /* end if */
+        result = cgi_send_header(conn, (conn->pipe_len > 0) ? MSG_MORE : 0);
+        if (result == CONN_DONE) {
+            result = cgi_send_frame(conn, MSG_MORE);
+        } /* end if */
+        if (result != CONN_DONE) {
+            return result;
+        } /* end if */
+
+        if (conn->pipe_len > 0) {
+            n = splice(conn->pipe_fd[0], NULL, conn->sd, NULL, conn->pipe_len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return CONN_WANT_WRITE;
+                } /* end if */
+                return CONN_ERROR;
+            } /* end if */
+            conn->pipe_len -= n;
+            conn->response_size += n;
+            if (conn->chunked) {
+                conn->chunk_left -= n;
+            } /* end if */
+            continue;
+        } /* end if */
+
+        if (conn->cgi_fd < 0) {
+            return cgi_output_end(conn, server);
+        } /* end if */
+        n = splice(conn->cgi_fd, NULL, conn->pipe_fd[1], NULL, SPLICE_CHUNK_SIZE, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn->wait_fd = conn->cgi_fd;
+                return CONN_WANT_READ;
+            } /* end if */
+            return CONN_ERROR;
+        } else if (n == 0) {
+            /* the script closed its output */
+            conn_release_fd(conn, &conn->cgi_fd);
+            continue;
+        } /* end if */
+        conn->pipe_len = n;
+        cgi_count_body(conn, n);
+    } /* end while */
+} /* end of cgi_advance */
+
+/**
+ * Release the output pipe of a cgi script, the header buffer goes
+ * with the arena of the response.
+ * @input_param     the connection
+ */
+void
+cgi_release(connection_t *conn) {
+    conn_release_fd(conn, &conn->cgi_fd);
+    conn->cgi_buf = NULL;
+} /* end of cgi_release */
@@ -0,0 +1,29 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _CGI_H
+#define _CGI_H
+
+#include <stddef.h>
+
+#include "tinyweb.h"
+#include "connection.h"
+
+#define CGI_HEADER_SIZE         BUFFER_SIZE     // maximum header of a cgi script
+
+
+extern void cgi_output_init(connection_t *conn);
+extern conn_result_t cgi_output(connection_t *conn, const char *data, size_t len, size_t *used,
+        prog_options_t *server);
+extern conn_result_t cgi_output_end(connection_t *conn, prog_options_t *server);
+extern int cgi_start(connection_t *conn, int fd, prog_options_t *server);
+extern conn_result_t cgi_advance(connection_t *conn, prog_options_t *server);
+extern void cgi_release(connection_t *conn);
+
+#endif
@@ -0,0 +1,231 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "tinyweb.h"
+#include "cgi_pool.h"
+
+
+static struct sockaddr_un pool_addr;        // abstract address of the runners
+static socklen_t pool_addr_len = 0;         // 0 if the pool is not started
+
+
+/**
+ * Signal handler of the manager, a terminated runner interrupts the
+ * poll() to be replaced.
+ */
+static void
+runner_handler(int sig) {
+} /* end of runner_handler */
+
+/**
+ * Start a runner with the listening socket as its standard input, the
+ * FastCGI convention for an application started by the web server.
+ * @input_param     the listening socket descriptor
+ * @input_param     the program options
+ * @return          the process id of the runner, -1 in case of error
+ */
+static pid_t
+start_runner(int lsd, prog_options_t *server) {
+    pid_t pid;
+
+    pid = fork();
+    if (pid == 0) {
+        if (dup2(lsd, STDIN_FILENO) < 0) {
+            _exit(EXIT_FAILURE);
+        } /* end if */
+        execl(server->cgi_runner, server->cgi_runner, (char *) NULL);
+        err_print("ERROR: cgi runner execl()");
+        _exit(EXIT_FAILURE);
+    } else if (pid < 0) {
+        err_print("ERROR: fork() cgi runner");
+    } /* end if */
+
+    return pid;
+} /* end of start_runner */
+
+/**
+ * Keep the runners alive until every server process has exited, the
+ * end of the lifeline pipe tells so. A runner which terminates, e.g.
+ * after a request timed out, is replaced, but not more often than
+ * once per respawn delay.
+ * @input_param     the listening socket descriptor
+ * @input_param     the read end of the lifeline pipe
+ * @input_param     the program options
+ */
+static void
+manager_main(int lsd, int lifeline, prog_options_t *server) {
+    struct sigaction sa;
+    struct pollfd pfd;
+    pid_t runners[CGI_POOL_MAX_RUNNERS];
+    time_t started[CGI_POOL_MAX_RUNNERS];
+    char timeout[16];
+    time_t now;
+    pid_t pid;
+    int i;
+
+    // the server stops the pool, not the terminal; the runners inherit this
+    signal(SIGINT, SIG_IGN);
+    sa.sa_flags = 0;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = runner_handler;
+    sigaction(SIGCHLD, &sa, NULL);
+
+    snprintf(timeout, sizeof (timeout), "%u", server->cgi_timeout);
+    setenv("TINYWEB_CGI_TIMEOUT", timeout, 1);
+    memset(runners, 0, sizeof (runners));
+    memset(started, 0, sizeof (started));
+
+    pfd.fd = lifeline;
+    pfd.events = POLLIN;
+    while (1) {
+        while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+            for (i = 0; i < server->cgi_pool; i++) {
+                if (runners[i] == pid) {
+                    runners[i] = 0;
+                } /* end if */
+            } /* end for */
+        } /* end while */
+
+        now = time(NULL);
+        for (i = 0; i < server->cgi_pool; i++) {
+            if (runners[i] == 0 && now - started[i] >= CGI_POOL_RESPAWN_DELAY) {
+                runners[i] = start_runner(lsd, server);
+                started[i] = now;
+                if (runners[i] < 0) {
+                    runners[i] = 0;
+                } /* end if */
+            } /* end if */
+        } /* end for */
+
+        if (poll(&pfd, 1, CGI_POOL_RESPAWN_DELAY * 1000) > 0) {
+            /* the server is gone */
+            break;
+        } /* end if */
+    } /* end while */
+
+    close(lsd);
+    for (i = 0; i < server->cgi_pool; i++) {
+        if (runners[i] > 0) {
+            kill(runners[i], SIGTERM);
+        } /* end if */
+    } /* end for */
+    while (waitpid(-1, NULL, 0) > 0 || errno == EINTR) {
+    } /* end while */
+    _exit(EXIT_SUCCESS);
+} /* end of manager_main */
+
+/**
+ * Start the persistent cgi runners. They accept the requests on an
+ * abstract Unix socket which the server processes connect to. A
+ * manager process, detached from the server so that the server does
+ * not wait for it, replaces terminated runners and stops all of them
+ * when the last server process has exited.
+ * @input_param     the program options
+ * @return          -1 in case of error
+ */
+int
+cgi_pool_start(prog_options_t *server) {
+    int lsd;
+    int lifeline[2];
+    pid_t pid;
+
+    if (access(server->cgi_runner, X_OK) < 0) {
+        fprintf(stderr, "Cannot execute the cgi runner '%s': %s\n", server->cgi_runner, strerror(errno));
+        return -1;
+    } /* end if */
+
+    memset(&pool_addr, 0, sizeof (pool_addr));
+    pool_addr.sun_family = AF_UNIX;
+    snprintf(pool_addr.sun_path + 1, sizeof (pool_addr.sun_path) - 1, "tinyweb-fcgi-%d", getpid());
+    pool_addr_len = offsetof(struct sockaddr_un, sun_path) + 1 + strlen(pool_addr.sun_path + 1);
+
+    lsd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (lsd < 0) {
+        err_print("ERROR: cgi pool socket()");
+        return -1;
+    } /* end if */
+    if (bind(lsd, (struct sockaddr *) &pool_addr, pool_addr_len) < 0
+            || listen(lsd, SOMAXCONN) < 0) {
+        err_print("ERROR: cgi pool bind()");
+        close(lsd);
+        return -1;
+    } /* end if */
+
+    // every server process holds the write end, the manager sees its end
+    if (pipe2(lifeline, O_CLOEXEC) < 0) {
+        err_print("ERROR: cgi pool pipe2()");
+        close(lsd);
+        return -1;
+    } /* end if */
+
+    fflush(stdout); /* do not duplicate buffered output */
+    pid = fork();
+    if (pid == 0) {
+        close(lifeline[1]);
+        if (fork() == 0) {
+            manager_main(lsd, lifeline[0], server);
+        } /* end if */
+        _exit(EXIT_SUCCESS);
+    } else if (pid < 0) {
+        err_print("ERROR: fork() cgi pool");
+        close(lsd);
+        close(lifeline[0]);
+        close(lifeline[1]);
+        return -1;
+    } /* end if */
+
+    // the manager owns the listener: without runners a connect is refused
+    waitpid(pid, NULL, 0);
+    close(lsd);
+    close(lifeline[0]);
+    return 0;
+} /* end of cgi_pool_start */
+
+/**
+ * Connect to a runner of the pool.
+ * @return          the non-blocking socket descriptor, -1 in case of
+ *                  error: EAGAIN if all runners are busy and the queue
+ *                  is full, ECONNREFUSED if the pool is gone
+ */
+int
+cgi_pool_connect(void) {
+    int sd;
+
+    if (pool_addr_len == 0) {
+        errno = ECONNREFUSED;
+        return -1;
+    } /* end if */
+
+    sd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sd < 0) {
+        return -1;
+    } /* end if */
+    if (connect(sd, (struct sockaddr *) &pool_addr, pool_addr_len) < 0) {
+        close(sd);
+        return -1;
+    } /* end if */
+
+    return sd;
+} /* end of cgi_pool_connect */
@@ -0,0 +1,24 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _CGI_POOL_H
+#define _CGI_POOL_H
+
+#include "tinyweb.h"
+
+#define CGI_POOL_DEFAULT_RUNNER     "cgi/fcgi_runner.pl"
+#define CGI_POOL_DEFAULT_TIMEOUT           30   // seconds
+#define CGI_POOL_MAX_RUNNERS              256
+#define CGI_POOL_RESPAWN_DELAY              1   // seconds between two starts of a runner
+
+
+extern int cgi_pool_start(prog_options_t *server);
+extern int cgi_pool_connect(void);
+
+#endif
@@ -0,0 +1,542 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include <zlib.h>
+#include <brotli/encode.h>
+
+#include "tinyweb.h"
+#include "compress.h"
+#include "path.h"
+
+#define COMPRESS_NICE                      10   // the compressor yields to the server processes
+#define COMPRESS_JOB_SIZE   (PATH_MAX + 1)      // coding and path of a job
+#define COMPRESS_DIR_SIZE                 256
+
+
+/*
+ * A variant written by the compressor, the oldest is removed first
+ */
+typedef struct compress_entry {
+    char                     name[COMPRESS_NAME_SIZE];
+    size_t                   cost;              // size plus COMPRESS_ENTRY_COST
+    struct compress_entry   *next;
+} compress_entry_t;
+
+
+static const struct {
+    const char *name;           // for Content-Encoding and Accept-Encoding
+    const char *ext;            // of a precompressed file and of a cached variant
+} encoding_list[] = {
+    { "identity", ""    },      // CONTENT_ENCODING_IDENTITY
+    { "br",       ".br" },      // CONTENT_ENCODING_BR
+    { "gzip",     ".gz" }       // CONTENT_ENCODING_GZIP
+};
+
+static char cache_dir[COMPRESS_DIR_SIZE];            // the variants built in the background
+static int job_fd = -1;                     // -1 if there is no compressor
+
+
+/**
+ * Get the name of a content coding.
+ * @input_param     the coding
+ * @return          the name for Content-Encoding
+ */
+const char *
+compress_name(content_encoding_t encoding) {
+    return encoding_list[encoding].name;
+} /* end of compress_name */
+
+/**
+ * Parse the value of an Accept-Encoding field (RFC 7231, 5.3.4). A
+ * coding with "q=0" is refused, "*" stands for the codings which are
+ * not listed.
+ * @input_param     the field value
+ * @return          the accepted codings, COMPRESS_ACCEPT() bits
+ */
+unsigned int
+compress_accepted(http_slice_t value) {
+    const char *p = value.ptr;
+    const char *end = value.ptr + value.len;
+    const char *name;
+    size_t len;
+    unsigned int listed = 0;
+    unsigned int accepted = 0;
+    unsigned int bit;
+    bool wildcard = false;
+    bool refused;
+
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+            p++;
+        } /* end while */
+        name = p;
+        while (p < end && *p != ',' && *p != ';' && *p != ' ' && *p != '\t') {
+            p++;
+        } /* end while */
+        len = p - name;
+
+        // the only parameter is the weight, zero in any notation refuses the coding
+        refused = false;
+        while (p < end && *p != ',') {
+            if (*p == ';') {
+                for (p++; p < end && (*p == ' ' || *p == '\t'); p++) {
+                } /* end for */
+                if (end - p >= 2 && (*p == 'q' || *p == 'Q') && p[1] == '=') {
+                    refused = true;
+                    for (p += 2; p < end && *p != ',' && *p != ';'; p++) {
+                        if (*p >= '1' && *p <= '9') {
+                            refused = false;
+                        } /* end if */
+                    } /* end for */
+                    continue;
+                } /* end if */
+            } /* end if */
+            p++;
+        } /* end while */
+
+        if (len == 2 && strncasecmp(name, "br", 2) == 0) {
+            bit = COMPRESS_ACCEPT(CONTENT_ENCODING_BR);
+        } else if ((len == 4 && strncasecmp(name, "gzip", 4) == 0)
+                || (len == 6 && strncasecmp(name, "x-gzip", 6) == 0)) {
+            bit = COMPRESS_ACCEPT(CONTENT_ENCODING_GZIP);
+        } else if (len == 1 && *name == '*') {
+            wildcard = !refused;
+            continue;
+        } else {
+            continue;
+        } /* end if */
+        listed |= bit;
+        if (!refused) {
+            accepted |= bit;
+        } /* end if */
+    } /* end while */
+
+    if (wildcard) {
+        accepted |= (COMPRESS_ACCEPT(CONTENT_ENCODING_BR) | COMPRESS_ACCEPT(CONTENT_ENCODING_GZIP)) & ~listed;
+    } /* end if */
+
+    return accepted;
+} /* end of compress_accepted */
+
+/**
+ * Name the variant of a file in the cache. The name changes with the
+ * file, a variant of an older version is never found again.
+ * @input_param     the request path
+ * @input_param     the file status
+ * @input_param     the coding
+ * @output_param    the name
+ */
+static void
+cache_name(http_slice_t path, const struct stat *fstat, content_encoding_t encoding, char *name) {
+    unsigned long long hash = 14695981039346656037ull;
+    size_t i;
+
+    // FNV-1a, 64 bit
+    for (i = 0; i < path.len; i++) {
+        hash = (hash ^ (unsigned char) path.ptr[i]) * 1099511628211ull;
+    } /* end for */
+
+    snprintf(name, COMPRESS_NAME_SIZE, "%016llx-%llx-%llx-%llx%s", hash,
+            (unsigned long long) fstat->st_mtime, (unsigned long long) fstat->st_size,
+            (unsigned long long) fstat->st_ino, encoding_list[encoding].ext);
+} /* end of cache_name */
+
+/**
+ * Check that an opened variant is a regular file which is not older
+ * than the original, it is closed otherwise.
+ * @input_param     the file descriptor of the variant, -1 if it cannot be opened
+ * @input_param     the file status of the original
+ * @output_param    the file status
+ * @return          the file descriptor, -1 in case of error
+ */
+static int
+check_variant(int fd, const struct stat *orig, struct stat *vstat) {
+    if (fd < 0) {
+        return -1;
+    } /* end if */
+    if (fstat(fd, vstat) < 0 || !S_ISREG(vstat->st_mode) || vstat->st_mtime < orig->st_mtime) {
+        close(fd);
+        errno = ESTALE;
+        return -1;
+    } /* end if */
+
+    return fd;
+} /* end of check_variant */
+
+/**
+ * Open the compressed variant of a file for the accepted codings. A
+ * precompressed sibling "<file>.br" or "<file>.gz" is preferred, else
+ * the variant from the cache. A variant which is missing in the cache
+ * is ordered from the compressor, the response is sent uncompressed
+ * meanwhile. The siblings are opened below the document root like the
+ * original.
+ * @input_param     the request path
+ * @input_param     the file status
+ * @input_param     the accepted codings, see compress_accepted()
+ * @output_param    the coding of the variant
+ * @output_param    the size of the variant
+ * @return          the file descriptor of the variant, -1 if the file
+ *                  is sent uncompressed
+ */
+int
+compress_open(http_slice_t path, const struct stat *fstat, unsigned int accepted, content_encoding_t *encoding, off_t *size) {
+    char variant[PATH_MAX];
+    char job[COMPRESS_JOB_SIZE];
+    char name[COMPRESS_NAME_SIZE];
+    struct stat vstat;
+    content_encoding_t e;
+    int fd;
+
+    *encoding = CONTENT_ENCODING_IDENTITY;
+    for (e = CONTENT_ENCODING_BR; e < CONTENT_ENCODING_COUNT; e++) {
+        if ((accepted & COMPRESS_ACCEPT(e)) != 0) {
+            fd = check_variant(path_open_variant(path, encoding_list[e].ext), fstat, &vstat);
+            if (fd >= 0) {
+                *encoding = e;
+                *size = vstat.st_size;
+                return fd;
+            } /* end if */
+        } /* end if */
+    } /* end for */
+
+    if (job_fd < 0 || fstat->st_size < COMPRESS_MIN_FILE_SIZE || fstat->st_size > COMPRESS_MAX_FILE_SIZE) {
+        return -1;
+    } /* end if */
+
+    for (e = CONTENT_ENCODING_BR; e < CONTENT_ENCODING_COUNT; e++) {
+        if ((accepted & COMPRESS_ACCEPT(e)) == 0) {
+            continue;
+        } /* end if */
+        cache_name(path, fstat, e, name);
+        snprintf(variant, sizeof (variant), "%s/%s", cache_dir, name);
+        fd = check_variant(open(variant, O_RDONLY | O_CLOEXEC), fstat, &vstat);
+        if (fd >= 0 && vstat.st_size > 0) {
+            *encoding = e;
+            *size = vstat.st_size;
+            return fd;
+        } else if (fd >= 0) {
+            /* an empty variant: the coding does not pay off for the file */
+            close(fd);
+        } else if (errno == ENOENT) {
+            if (path.len < sizeof (job) - 1) {
+                // a full queue drops the job, the next request orders it again
+                job[0] = (char) e;
+                memcpy(job + 1, path.ptr, path.len);
+                send(job_fd, job, path.len + 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+            } /* end if */
+        } /* end if */
+    } /* end for */
+
+    return -1;
+} /* end of compress_open */
+
+/**
+ * Read a file into memory.
+ * @input_param     the file descriptor
+ * @input_param     the size of the file
+ * @return          the content, NULL in case of error
+ */
+static unsigned char *
+read_file(int fd, off_t size) {
+    unsigned char *data;
+    off_t done = 0;
+    ssize_t n;
+
+    data = malloc(size);
+    while (data != NULL && done < size) {
+        n = read(fd, data + done, size - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            /* read error or the file shrunk meanwhile */
+            free(data);
+            data = NULL;
+        } else {
+            done += n;
+        } /* end if */
+    } /* end while */
+
+    return data;
+} /* end of read_file */
+
+/**
+ * Compress a buffer with the best ratio of a coding, the time does not
+ * matter as the variant is built once.
+ * @input_param     the coding
+ * @input_param     the data
+ * @input_param     the length of the data
+ * @output_param    the length of the result
+ * @return          the result, NULL in case of error
+ */
+static unsigned char *
+compress_buffer(content_encoding_t encoding, unsigned char *data, size_t len, size_t *out_len) {
+    unsigned char *out = NULL;
+    z_stream zs;
+    size_t size;
+
+    if (encoding == CONTENT_ENCODING_BR) {
+        size = BrotliEncoderMaxCompressedSize(len);
+        out = (size > 0) ? malloc(size) : NULL;
+        if (out != NULL && BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC,
+                len, data, &size, out) != BROTLI_TRUE) {
+            free(out);
+            out = NULL;
+        } /* end if */
+    } else {
+        memset(&zs, 0, sizeof (zs));
+        // a window of 15 bits plus 16 writes the gzip format
+        if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return NULL;
+        } /* end if */
+        size = deflateBound(&zs, len);
+        out = malloc(size);
+        if (out != NULL) {
+            zs.next_in = data;
+            zs.avail_in = len;
+            zs.next_out = out;
+            zs.avail_out = size;
+            if (deflate(&zs, Z_FINISH) == Z_STREAM_END) {
+                size = zs.total_out;
+            } else {
+                free(out);
+                out = NULL;
+            } /* end if */
+        } /* end if */
+        deflateEnd(&zs);
+    } /* end if */
+
+    *out_len = size;
+    return out;
+} /* end of compress_buffer */
+
+/**
+ * Build the variant of a file for the cache. A variant which does not
+ * save anything, or which would not fit into the budget, is written
+ * as an empty file so that it is not ordered again.
+ * @input_param     the request path
+ * @input_param     the coding
+ * @input_param     the budget in bytes
+ * @output_param    the name of the new variant
+ * @return          the size of the variant, -1 if there is none
+ */
+static ssize_t
+build_variant(http_slice_t path, content_encoding_t encoding, size_t budget, char *name) {
+    char variant[PATH_MAX];
+    char tmp[PATH_MAX];
+    struct stat st;
+    unsigned char *data;
+    unsigned char *out = NULL;
+    size_t out_len = 0;
+    size_t done = 0;
+    ssize_t n;
+    int fd;
+
+    // the status and the content of the same file below the document root
+    fd = path_open(path);
+    if (fd < 0) {
+        return -1;
+    } /* end if */
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)
+            || st.st_size < COMPRESS_MIN_FILE_SIZE || st.st_size > COMPRESS_MAX_FILE_SIZE) {
+        close(fd);
+        return -1;
+    } /* end if */
+    cache_name(path, &st, encoding, name);
+    snprintf(variant, sizeof (variant), "%s/%s", cache_dir, name);
+    if (access(variant, F_OK) == 0) {
+        /* ordered by several requests */
+        close(fd);
+        return -1;
+    } /* end if */
+
+    data = read_file(fd, st.st_size);
+    close(fd);
+    if (data == NULL) {
+        return -1;
+    } /* end if */
+    out = compress_buffer(encoding, data, st.st_size, &out_len);
+    free(data);
+    if (out == NULL) {
+        return -1;
+    } /* end if */
+    if (out_len >= (size_t) st.st_size || out_len + COMPRESS_ENTRY_COST > budget) {
+        out_len = 0;
+    } /* end if */
+
+    // the servers see the complete variant or none
+    snprintf(tmp, sizeof (tmp), "%s/.%s", cache_dir, name);
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    while (fd >= 0 && done < out_len) {
+        n = write(fd, out + done, out_len - done);
+        if (n < 0 && errno != EINTR) {
+            break;
+        } else if (n > 0) {
+            done += n;
+        } /* end if */
+    } /* end while */
+    free(out);
+    if (fd < 0 || close(fd) < 0 || done < out_len || rename(tmp, variant) < 0) {
+        err_print("ERROR: cannot write compressed variant");
+        unlink(tmp);
+        return -1;
+    } /* end if */
+
+    return out_len;
+} /* end of build_variant */
+
+/**
+ * Build the ordered variants until every server process has exited,
+ * then remove the cache. The oldest variants are removed when the
+ * budget is exceeded.
+ * @input_param     the socket receiving the jobs
+ * @input_param     the budget in bytes
+ */
+static void
+compressor_main(int sd, size_t budget) {
+    char job[COMPRESS_JOB_SIZE];
+    char variant[PATH_MAX];
+    compress_entry_t *head = NULL;
+    compress_entry_t *tail = NULL;
+    compress_entry_t *entry;
+    http_slice_t path;
+    size_t used = 0;
+    ssize_t n;
+
+    // the server stops the compressor, not the terminal
+    signal(SIGINT, SIG_IGN);
+    setpriority(PRIO_PROCESS, 0, COMPRESS_NICE);
+
+    while (1) {
+        n = recv(sd, job, sizeof (job) - 1, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            /* the server is gone */
+            break;
+        } /* end if */
+        job[n] = '\0';
+        if (n < 2 || job[0] <= CONTENT_ENCODING_IDENTITY || job[0] >= CONTENT_ENCODING_COUNT) {
+            continue;
+        } /* end if */
+
+        entry = malloc(sizeof (compress_entry_t));
+        if (entry == NULL) {
+            continue;
+        } /* end if */
+        path.ptr = job + 1;
+        path.len = n - 1;
+        n = build_variant(path, (content_encoding_t) job[0], budget, entry->name);
+        if (n < 0) {
+            free(entry);
+            continue;
+        } /* end if */
+        entry->cost = n + COMPRESS_ENTRY_COST;
+        entry->next = NULL;
+        if (tail != NULL) {
+            tail->next = entry;
+        } else {
+            head = entry;
+        } /* end if */
+        tail = entry;
+        used += entry->cost;
+
+        while (used > budget && head != NULL) {
+            entry = head;
+            head = entry->next;
+            if (head == NULL) {
+                tail = NULL;
+            } /* end if */
+            used -= entry->cost;
+            snprintf(variant, sizeof (variant), "%s/%s", cache_dir, entry->name);
+            unlink(variant);
+            free(entry);
+        } /* end while */
+    } /* end while */
+
+    for (entry = head; entry != NULL; entry = entry->next) {
+        snprintf(variant, sizeof (variant), "%s/%s", cache_dir, entry->name);
+        unlink(variant);
+    } /* end for */
+    rmdir(cache_dir);
+    _exit(EXIT_SUCCESS);
+} /* end of compressor_main */
+
+/**
+ * Start the compressor which builds the compressed variants in a
+ * temporary directory. The server processes order the variants over a
+ * socket, the compressor, detached from the server so that the server
+ * does not wait for it, removes the directory when the last server
+ * process has exited.
+ * @input_param     the program options
+ * @return          -1 in case of error
+ */
+int
+compress_start(prog_options_t *server) {
+    const char *tmpdir = getenv("TMPDIR");
+    int sv[2];
+    pid_t pid;
+
+    if (server->compress_size == 0) {
+        return 0;
+    } /* end if */
+
+    if ((size_t) snprintf(cache_dir, sizeof (cache_dir), "%s/tinyweb-XXXXXX",
+                (tmpdir != NULL) ? tmpdir : "/tmp") >= sizeof (cache_dir)) {
+        fprintf(stderr, "Path of the compressed cache too long '%s'\n", tmpdir);
+        return -1;
+    } /* end if */
+    if (mkdtemp(cache_dir) == NULL) {
+        fprintf(stderr, "Cannot create the compressed cache '%s': %s\n", cache_dir, strerror(errno));
+        return -1;
+    } /* end if */
+
+    // every server process holds one end, the compressor sees its end
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) {
+        err_print("ERROR: compressor socketpair()");
+        rmdir(cache_dir);
+        return -1;
+    } /* end if */
+
+    fflush(stdout); /* do not duplicate buffered output */
+    pid = fork();
+    if (pid == 0) {
+        close(sv[0]);
+        if (fork() == 0) {
+            compressor_main(sv[1], server->compress_size * 1024);
+        } /* end if */
+        _exit(EXIT_SUCCESS);
+    } else if (pid < 0) {
+        err_print("ERROR: fork() compressor");
+        close(sv[0]);
+        close(sv[1]);
+        rmdir(cache_dir);
+        return -1;
+    } /* end if */
+
+    waitpid(pid, NULL, 0);
+    close(sv[1]);
+    job_fd = sv[0];
+    return 0;
+} /* end of compress_start */
@@ -0,0 +1,45 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _COMPRESS_H
+#define _COMPRESS_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "tinyweb.h"
+#include "http_parser.h"
+
+#define COMPRESS_DEFAULT_SIZE           65536   // disk budget of the compressed variants in kB
+#define COMPRESS_MIN_FILE_SIZE            256   // smaller files do not gain a packet
+#define COMPRESS_MAX_FILE_SIZE   (8 * 1048576)  // larger files are sent uncompressed
+#define COMPRESS_ENTRY_COST               512   // accounted per variant besides its size
+#define COMPRESS_NAME_SIZE                 80
+
+
+/*
+ * The content codings, in the order of preference
+ */
+typedef enum content_encoding {
+    CONTENT_ENCODING_IDENTITY = 0,
+    CONTENT_ENCODING_BR,
+    CONTENT_ENCODING_GZIP,
+    CONTENT_ENCODING_COUNT
+} content_encoding_t;
+
+#define COMPRESS_ACCEPT(encoding)   (1u << (encoding))
+
+
+extern int compress_start(prog_options_t *server);
+extern unsigned int compress_accepted(http_slice_t value);
+extern int compress_open(http_slice_t path, const struct stat *fstat, unsigned int accepted,
+        content_encoding_t *encoding, off_t *size);
+extern const char *compress_name(content_encoding_t encoding);
+
+#endif
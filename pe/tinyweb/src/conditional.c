@@ -0,0 +1,202 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "conditional.h"
+
+
+/*
+ * An entity tag of a field value, the opaque tag without the quotes
+ */
+typedef struct etag_value {
+    const char *ptr;
+    size_t      len;
+    bool        weak;
+} etag_value_t;
+
+
+/**
+ * Format the entity tag of a file from its inode, size and the time of
+ * the last modification in nanoseconds. The tag of a file modified in
+ * the current second is weak, the file may still change within the
+ * resolution of the clock.
+ * @input_param     the file status
+ * @input_param     the content coding of a compressed variant, NULL
+ *                  for the file itself
+ * @output_param    the entity tag
+ * @input_param     the size of the buffer, ETAG_SIZE
+ */
+void
+etag_format(const struct stat *fstat, const char *coding, char *buf, size_t size) {
+    bool weak = (fstat->st_mtime >= time(NULL));
+
+    snprintf(buf, size, "%s\"%llx-%llx-%llx%s%s\"", weak ? "W/" : "",
+            (unsigned long long) fstat->st_ino, (unsigned long long) fstat->st_size,
+            (unsigned long long) fstat->st_mtim.tv_sec * 1000000000ull + fstat->st_mtim.tv_nsec,
+            (coding != NULL) ? "-" : "", (coding != NULL) ? coding : "");
+} /* end of etag_format */
+
+/**
+ * Make a weak entity tag strong once the second of the modification
+ * has passed.
+ * @input_param     the entity tag
+ * @input_param     the file status
+ * @return          true if the tag has changed
+ */
+bool
+etag_refresh(char *etag, const struct stat *fstat) {
+    if (etag[0] != 'W' || fstat->st_mtime >= time(NULL)) {
+        return false;
+    } /* end if */
+    etag_format(fstat, NULL, etag, ETAG_SIZE);
+    return true;
+} /* end of etag_refresh */
+
+/**
+ * Take the next entity tag from a list.
+ * @input_param     the current position, advanced behind the tag
+ * @input_param     the end of the list
+ * @output_param    the tag
+ * @return          false at the end of the list or on a syntax error
+ */
+static bool
+next_etag(const char **p, const char *end, etag_value_t *tag) {
+    const char *q;
+
+    while (*p < end && (**p == ' ' || **p == '\t' || **p == ',')) {
+        (*p)++;
+    } /* end while */
+    tag->weak = (end - *p >= 2 && (*p)[0] == 'W' && (*p)[1] == '/');
+    if (tag->weak) {
+        *p += 2;
+    } /* end if */
+    if (*p == end || **p != '"') {
+        return false;
+    } /* end if */
+    q = memchr(*p + 1, '"', end - *p - 1);
+    if (q == NULL) {
+        return false;
+    } /* end if */
+
+    tag->ptr = *p + 1;
+    tag->len = q - tag->ptr;
+    *p = q + 1;
+    return true;
+} /* end of next_etag */
+
+/**
+ * Check whether a list of entity tags matches the tag of the file,
+ * "*" matches any tag (RFC 7232, 2.3.2).
+ * @input_param     the field value
+ * @input_param     the entity tag of the file
+ * @input_param     true for the strong comparison
+ * @return          true if one tag matches
+ */
+static bool
+etag_match(http_slice_t list, const char *etag, bool strong) {
+    const char *p = list.ptr;
+    const char *end = list.ptr + list.len;
+    const char *rest;
+    etag_value_t own, tag;
+
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    } /* end while */
+    if (p < end && *p == '*') {
+        return true;
+    } /* end if */
+
+    rest = etag;
+    if (!next_etag(&rest, etag + strlen(etag), &own)) {
+        return false;
+    } /* end if */
+
+    while (next_etag(&p, end, &tag)) {
+        if (strong && (tag.weak || own.weak)) {
+            continue;
+        } /* end if */
+        if (tag.len == own.len && memcmp(tag.ptr, own.ptr, own.len) == 0) {
+            return true;
+        } /* end if */
+    } /* end while */
+
+    return false;
+} /* end of etag_match */
+
+/**
+ * Check whether a request has a condition on the validators of the
+ * file.
+ * @input_param     the parsed header
+ * @return          true if the conditions are to be evaluated
+ */
+bool
+conditional_present(const parsed_http_header_t *parsed_header) {
+    return parsed_header->modsince != 0 || parsed_header->ifNoneMatch.ptr != NULL
+            || parsed_header->ifMatch.ptr != NULL
+            || (parsed_header->ifRange.ptr != NULL && parsed_header->range.ptr != NULL);
+} /* end of conditional_present */
+
+/**
+ * Evaluate the preconditions of a request for a file in the order of
+ * RFC 7232, section 6. If-None-Match replaces If-Modified-Since.
+ * @input_param     the parsed header
+ * @input_param     the file status
+ * @input_param     the entity tag of the file
+ * @return          HTTP_STATUS_OK if the request is to be served,
+ *                  HTTP_STATUS_NOT_MODIFIED or
+ *                  HTTP_STATUS_PRECONDITION_FAILED else
+ */
+http_status_t
+conditional_check(const parsed_http_header_t *parsed_header, const struct stat *fstat, const char *etag) {
+    bool safe = (parsed_header->methodType == HTTP_METHOD_GET || parsed_header->methodType == HTTP_METHOD_HEAD);
+
+    if (parsed_header->ifMatch.ptr != NULL && !etag_match(parsed_header->ifMatch, etag, true)) {
+        return HTTP_STATUS_PRECONDITION_FAILED;
+    } /* end if */
+
+    if (parsed_header->ifNoneMatch.ptr != NULL) {
+        if (etag_match(parsed_header->ifNoneMatch, etag, false)) {
+            return safe ? HTTP_STATUS_NOT_MODIFIED : HTTP_STATUS_PRECONDITION_FAILED;
+        } /* end if */
+    } else if (parsed_header->modsince != 0 && safe && fstat->st_mtime <= parsed_header->modsince) {
+        return HTTP_STATUS_NOT_MODIFIED;
+    } /* end if */
+
+    return HTTP_STATUS_OK;
+} /* end of conditional_check */
+
+/**
+ * Evaluate If-Range: the parts are sent only if the client still has
+ * the same version of the file, else the whole file.
+ * @input_param     the parsed header
+ * @input_param     the file status
+ * @input_param     the entity tag of the file
+ * @return          true if the Range field applies
+ */
+bool
+conditional_range(const parsed_http_header_t *parsed_header, const struct stat *fstat, const char *etag) {
+    http_slice_t value = parsed_header->ifRange;
+    time_t date;
+
+    if (value.ptr == NULL) {
+        return true;
+    } /* end if */
+    if (value.len > 0 && (value.ptr[0] == '"' || value.ptr[0] == 'W')) {
+        return etag_match(value, etag, true);
+    } /* end if */
+
+    // a date is a weak validator, it has to be the exact modification time
+    return http_parse_date(value, &date) && date == fstat->st_mtime;
+} /* end of conditional_range */
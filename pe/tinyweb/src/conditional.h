@@ -0,0 +1,32 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _CONDITIONAL_H
+#define _CONDITIONAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "http.h"
+#include "http_parser.h"
+
+#define ETAG_SIZE                          64   // W/"inode-size-mtime-coding"
+
+
+extern void etag_format(const struct stat *fstat, const char *coding, char *buf, size_t size);
+extern bool etag_refresh(char *etag, const struct stat *fstat);
+extern bool conditional_present(const parsed_http_header_t *parsed_header);
+extern http_status_t conditional_check(const parsed_http_header_t *parsed_header, const struct stat *fstat,
+        const char *etag);
+extern bool conditional_range(const parsed_http_header_t *parsed_header, const struct stat *fstat,
+        const char *etag);
+
+#endif
@@ -0,0 +1,675 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+
+#include "tinyweb.h"
+#include "connection.h"
+#include "response.h"
+#include "fastcgi.h"
+#include "cgi.h"
+#include "metrics.h"
+#include "slab.h"
+
+
+/**
+ * Keep the request target in the arena of the connection, it lives as
+ * long as the response.
+ * @input_param     the connection
+ * @input_param     the length of the target
+ * @return          the room for the target, NULL in case of error
+ */
+static char *
+conn_target_alloc(void *ctx, size_t len) {
+    connection_t *conn = ctx;
+
+    return arena_alloc(&conn->arena, len);
+} /* end of conn_target_alloc */
+
+/**
+ * Prepare the parser for the next request of a connection.
+ * @input_param     the connection
+ */
+static void
+conn_parser_init(connection_t *conn) {
+    http_parser_init(&conn->parsed_header);
+    conn->parsed_header.target_alloc = conn_target_alloc;
+    conn->parsed_header.target_ctx = conn;
+} /* end of conn_parser_init */
+
+/**
+ * Initialise the per-connection state.
+ * @input_param     the connection
+ * @input_param     the client socket descriptor
+ * @input_param     the client address
+ * @input_param     the epoll descriptor watching the connection, -1 if none
+ */
+void
+conn_init(connection_t *conn, int sd, const struct sockaddr_storage *client, int epfd) {
+    conn->sd = sd;
+    conn->client = *client;
+    conn->state = CONN_STATE_READ_REQUEST;
+    conn->keep_alive = false;
+    conn->last_active = time(NULL);
+    conn->prev = NULL;
+    conn->next = NULL;
+    conn->request = NULL;
+    conn->request_size = 0;
+    conn->request_len = 0;
+    conn->request_end = 0;
+    conn_parser_init(conn);
+    conn->header[0] = '\0';
+    conn->header_len = 0;
+    conn->header_sent = 0;
+    conn->body_fd = -1;
+    conn->cache_entry = NULL;
+    arena_init(&conn->arena);
+    conn->body_buf = NULL;
+    conn->body_data = NULL;
+    conn->body_offset = 0;
+    conn->body_end = 0;
+    conn->ranges = NULL;
+    conn->pipe_fd[0] = -1;
+    conn->pipe_fd[1] = -1;
+    conn->pipe_len = 0;
+    conn->parse_ns = 0;
+    conn->phase_start = 0;
+    conn->response_size = 0;
+    conn->requests = 0;
+    conn->epfd = epfd;
+    conn->wait_fd = sd;
+    conn->upstream_fd = -1;
+    conn->upstream_buf = NULL;
+    conn->deadline = 0;
+    conn->cgi_fd = -1;
+    conn->cgi_buf = NULL;
+    metrics_connection_opened();
+} /* end of conn_init */
+
+/**
+ * Put a socket into non-blocking mode.
+ * @input_param     the socket descriptor
+ * @return          -1 in case of error
+ */
+int
+conn_set_nonblocking(int sd) {
+    int flags;
+
+    flags = fcntl(sd, F_GETFL, 0);
+    if (flags < 0 || fcntl(sd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        err_print("ERROR: fcntl(O_NONBLOCK)");
+        return -1;
+    } /* end if */
+
+    return 0;
+} /* end of conn_set_nonblocking */
+
+/**
+ * Let the event loop wake the connection for another descriptor, e.g.
+ * the output of a cgi script.
+ * @input_param     the connection
+ * @input_param     the descriptor
+ * @return          -1 in case of error
+ */
+int
+conn_watch_fd(connection_t *conn, int fd) {
+    struct epoll_event ev;
+
+    if (conn->epfd < 0) {
+        /* a blocking handler waits for wait_fd itself */
+        return 0;
+    } /* end if */
+
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = conn;
+    if (epoll_ctl(conn->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        err_print("ERROR: epoll_ctl(ADD)");
+        return -1;
+    } /* end if */
+
+    return 0;
+} /* end of conn_watch_fd */
+
+/**
+ * Stop watching a descriptor of the connection and close it.
+ * @input_param     the connection
+ * @input_param     the descriptor, set to -1
+ */
+void
+conn_release_fd(connection_t *conn, int *fd) {
+    if (*fd < 0) {
+        return;
+    } /* end if */
+
+    if (conn->epfd >= 0) {
+        epoll_ctl(conn->epfd, EPOLL_CTL_DEL, *fd, NULL);
+    } /* end if */
+    close(*fd);
+    *fd = -1;
+} /* end of conn_release_fd */
+
+/**
+ * Provide room for more input in the request buffer. The buffer comes
+ * from the slab pool and is doubled while the header does not fit, the
+ * parsed fields move along with it.
+ * @input_param     the connection
+ * @return          the free bytes, zero if the header exceeds
+ *                  SLAB_MAX_SIZE, -1 in case of error
+ */
+static ssize_t
+conn_request_space(connection_t *conn) {
+    char *buf;
+    size_t size;
+
+    if (conn->request != NULL && conn->request_len + 1 < conn->request_size) {
+        return conn->request_size - conn->request_len - 1;
+    } /* end if */
+
+    size = (conn->request == NULL) ? REQUEST_BUFFER_SIZE : conn->request_size * 2;
+    if (size > SLAB_MAX_SIZE) {
+        return 0;
+    } /* end if */
+    buf = slab_alloc(&size);
+    if (buf == NULL) {
+        return -1;
+    } /* end if */
+
+    if (conn->request != NULL) {
+        memcpy(buf, conn->request, conn->request_len + 1);
+        http_parser_rebase(&conn->parsed_header, conn->request, conn->request_len, buf);
+        slab_free(conn->request, conn->request_size);
+    } else {
+        buf[0] = '\0';
+    } /* end if */
+    conn->request = buf;
+    conn->request_size = size;
+
+    return conn->request_size - conn->request_len - 1;
+} /* end of conn_request_space */
+
+/**
+ * Return the request buffer to the pool, an idle connection holds no
+ * buffer.
+ * @input_param     the connection
+ */
+static void
+conn_release_request(connection_t *conn) {
+    slab_free(conn->request, conn->request_size);
+    conn->request = NULL;
+    conn->request_size = 0;
+    conn->request_len = 0;
+    conn->request_end = 0;
+} /* end of conn_release_request */
+
+/**
+ * Read the request header until the empty line is received. The parser
+ * continues with each new part, so a header is scanned only once.
+ * Pipelined requests may already be waiting in the buffer.
+ * @input_param     the connection
+ * @return          CONN_WANT_READ if more input is required,
+ *                  CONN_DONE if the request is complete or the
+ *                  client closed the connection between two requests
+ */
+static conn_result_t
+conn_read_request(connection_t *conn) {
+    ssize_t n;
+    ssize_t space;
+    long long start;
+    http_parse_result_t result;
+
+    while (1) {
+        start = metrics_now();
+        result = (conn->request != NULL)
+                ? parse_http_header(&conn->parsed_header, conn->request, conn->request_len)
+                : HTTP_PARSE_INCOMPLETE;
+        conn->parse_ns += metrics_now() - start;
+        if (result != HTTP_PARSE_INCOMPLETE) {
+            metrics_phase(METRICS_PHASE_PARSE, conn->parse_ns);
+            conn->parse_ns = 0;
+            /* the framing allows another request unless the request line is broken */
+            conn->request_end = conn->parsed_header.parsed;
+            conn->keep_alive = (result == HTTP_PARSE_DONE);
+            return CONN_DONE;
+        } /* end if */
+
+        space = conn_request_space(conn);
+        if (space < 0) {
+            return CONN_ERROR;
+        } else if (space == 0) {
+            /* header does not fit, the request line alone may be too long */
+            conn->parsed_header.httpState = (conn->parsed_header.lineCount == 0)
+                    ? HTTP_STATUS_URI_TOO_LONG : HTTP_STATUS_HEADER_TOO_LARGE;
+            conn->request_end = conn->request_len;
+            conn->keep_alive = false;
+            return CONN_DONE;
+        } /* end if */
+
+        n = read(conn->sd, conn->request + conn->request_len, space);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (conn->request_len == 0) {
+                    conn_release_request(conn);
+                } /* end if */
+                return CONN_WANT_READ;
+            } /* end if */
+            return CONN_ERROR;
+        } else if (n == 0) {
+            /* peer closed its sending side */
+            if (conn->request_len == 0) {
+                conn->state = CONN_STATE_DONE;
+            } else if (conn->parsed_header.lineCount == 0) {
+                /* the request line is incomplete */
+                conn->parsed_header.httpState = HTTP_STATUS_BAD_REQUEST;
+            } /* end if */
+            conn->request_end = conn->request_len;
+            conn->keep_alive = false;
+            return CONN_DONE;
+        } /* end if */
+
+        conn->request_len += n;
+        conn->request[conn->request_len] = '\0';
+    } /* end while */
+} /* end of conn_read_request */
+
+/**
+ * Write the pending part of the response header. If a file follows,
+ * MSG_MORE lets the kernel put the header into the same segment as
+ * the start of the body.
+ * @input_param     the connection
+ * @return          CONN_WANT_WRITE if the socket is full,
+ *                  CONN_DONE if the header is sent completely
+ */
+static conn_result_t
+conn_send_header(connection_t *conn) {
+    ssize_t n;
+    int flags = (conn->body_fd >= 0 && conn->body_offset < conn->body_end) ? MSG_MORE : 0;
+
+    while (conn->header_sent < conn->header_len) {
+        n = send(conn->sd, conn->header + conn->header_sent,
+                conn->header_len - conn->header_sent, flags);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return CONN_WANT_WRITE;
+            } /* end if */
+            return CONN_ERROR;
+        } /* end if */
+        conn->header_sent += n;
+    } /* end while */
+
+    return CONN_DONE;
+} /* end of conn_send_header */
+
+/**
+ * Write the pending part of the response header together with a body
+ * in memory, e.g. a cached file, a single writev() for the whole
+ * response unless the socket is full.
+ * @input_param     the connection
+ * @return          CONN_WANT_WRITE if the socket is full,
+ *                  CONN_DONE if the response is sent completely
+ */
+static conn_result_t
+conn_send_cached(connection_t *conn) {
+    struct iovec iov[2];
+    size_t header_left;
+    ssize_t n;
+
+    while (conn->header_sent < conn->header_len || conn->body_offset < conn->body_end) {
+        header_left = conn->header_len - conn->header_sent;
+        iov[0].iov_base = conn->header + conn->header_sent;
+        iov[0].iov_len = header_left;
+        iov[1].iov_base = (char *) conn->body_data + conn->body_offset;
+        iov[1].iov_len = conn->body_end - conn->body_offset;
+
+        n = writev(conn->sd, iov, 2);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return CONN_WANT_WRITE;
+            } /* end if */
+            return CONN_ERROR;
+        } /* end if */
+
+        if ((size_t) n < header_left) {
+            conn->header_sent += n;
+        } else {
+            conn->header_sent = conn->header_len;
+            conn->body_offset += n - header_left;
+        } /* end if */
+    } /* end while */
+
+    return CONN_DONE;
+} /* end of conn_send_cached */
+
+/**
+ * Write the pending part of the response body through a pipe with
+ * splice(), for files that sendfile() cannot handle.
+ * @input_param     the connection
+ * @return          CONN_WANT_WRITE if the socket is full,
+ *                  CONN_DONE if the body is sent completely
+ */
+static conn_result_t
+conn_splice_body(connection_t *conn) {
+    ssize_t n;
+    size_t len;
+
+    if (conn->pipe_fd[0] < 0 && pipe2(conn->pipe_fd, O_NONBLOCK | O_CLOEXEC) < 0) {
+        err_print("ERROR: pipe2()");
+        return CONN_ERROR;
+    } /* end if */
+
+    while (conn->pipe_len > 0 || conn->body_offset < conn->body_end) {
+        if (conn->pipe_len == 0) {
+            len = SPLICE_CHUNK_SIZE;
+            if ((off_t) len > conn->body_end - conn->body_offset) {
+                len = conn->body_end - conn->body_offset;
+            } /* end if */
+
+            n = splice(conn->body_fd, &conn->body_offset, conn->pipe_fd[1], NULL,
+                    len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n <= 0) {
+                /* file shrunk or cannot be read */
+                return CONN_ERROR;
+            } /* end if */
+            conn->pipe_len = n;
+        } /* end if */
+
+        n = splice(conn->pipe_fd[0], NULL, conn->sd, NULL, conn->pipe_len,
+                SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return CONN_WANT_WRITE;
+            } /* end if */
+            return CONN_ERROR;
+        } /* end if */
+        conn->pipe_len -= n;
+    } /* end while */
+
+    return CONN_DONE;
+} /* end of conn_splice_body */
+
+/**
+ * Write the pending part of the response body. The file is copied
+ * to the socket inside the kernel with sendfile().
+ * @input_param     the connection
+ * @return          CONN_WANT_WRITE if the socket is full,
+ *                  CONN_DONE if the body is sent completely
+ */
+static conn_result_t
+conn_send_body(connection_t *conn) {
+    ssize_t n;
+
+    if (conn->pipe_len > 0) {
+        /* a previous splice() is not drained yet */
+        return conn_splice_body(conn);
+    } /* end if */
+
+    while (conn->body_offset < conn->body_end) {
+        n = sendfile(conn->sd, conn->body_fd, &conn->body_offset,
+                conn->body_end - conn->body_offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return CONN_WANT_WRITE;
+            } else if (errno == EINVAL || errno == ENOSYS) {
+                /* the file does not support sendfile() */
+                return conn_splice_body(conn);
+            } /* end if */
+            return CONN_ERROR;
+        } else if (n == 0) {
+            /* file shrunk */
+            return CONN_ERROR;
+        } /* end if */
+    } /* end while */
+
+    return CONN_DONE;
+} /* end of conn_send_body */
+
+/**
+ * Write the pending part of a multipart/byteranges body. The
+ * delimiter and fields of each part come from memory, its bytes from
+ * the file with sendfile().
+ * @input_param     the connection
+ * @return          CONN_WANT_WRITE if the socket is full,
+ *                  CONN_DONE if the body is sent completely
+ */
+static conn_result_t
+conn_send_parts(connection_t *conn) {
+    range_set_t *set = conn->ranges;
+    conn_result_t result;
+    ssize_t n;
+
+    while (1) {
+        while (set->part_sent < set->part_len) {
+            n = send(conn->sd, set->part_header + set->part_sent, set->part_len - set->part_sent,
+                    (set->current < set->count) ? MSG_MORE : 0);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return CONN_WANT_WRITE;
+                } /* end if */
+                return CONN_ERROR;
+            } /* end if */
+            set->part_sent += n;
+        } /* end while */
+        if (set->current == set->count) {
+            /* the closing delimiter is sent */
+            return CONN_DONE;
+        } /* end if */
+
+        result = conn_send_body(conn);
+        if (result != CONN_DONE) {
+            return result;
+        } /* end if */
+        range_next_part(set, set->current + 1);
+        if (set->current < set->count) {
+            conn->body_offset = set->part[set->current].first;
+            conn->body_end = set->part[set->current].last + 1;
+        } /* end if */
+    } /* end while */
+} /* end of conn_send_parts */
+
+/**
+ * Prepare the connection for the next request of a persistent
+ * connection and keep the bytes of pipelined requests.
+ * @input_param     the connection
+ */
+static void
+conn_next_request(connection_t *conn) {
+    size_t surplus = conn->request_len - conn->request_end;
+
+    if (surplus == 0) {
+        conn_release_request(conn);
+    } else {
+        memmove(conn->request, conn->request + conn->request_end, surplus);
+        conn->request_len = surplus;
+        conn->request[surplus] = '\0';
+        conn->request_end = 0;
+    } /* end if */
+    conn_parser_init(conn);
+    conn->header_len = 0;
+    conn->header_sent = 0;
+    if (conn->body_fd >= 0) {
+        close(conn->body_fd);
+        conn->body_fd = -1;
+    } /* end if */
+    if (conn->cache_entry != NULL) {
+        file_cache_release(conn->cache_entry);
+        conn->cache_entry = NULL;
+    } /* end if */
+    conn->body_buf = NULL;
+    conn->body_data = NULL;
+    conn->body_offset = 0;
+    conn->body_end = 0;
+    conn->ranges = NULL;
+    fcgi_release(conn);
+    cgi_release(conn);
+    arena_reset(&conn->arena);
+    conn->state = CONN_STATE_READ_REQUEST;
+} /* end of conn_next_request */
+
+/**
+ * Account a response which is sent completely and continue with the
+ * next request of a persistent connection.
+ * @input_param     the connection
+ */
+static void
+conn_response_sent(connection_t *conn) {
+    metrics_phase(METRICS_PHASE_BODY, metrics_now() - conn->phase_start);
+    metrics_bytes_sent(conn->response_size);
+    conn->requests++;
+
+    if (conn->keep_alive) {
+        conn_next_request(conn);
+    } else {
+        conn->state = CONN_STATE_DONE;
+    } /* end if */
+} /* end of conn_response_sent */
+
+/**
+ * Check whether a connection waits for a new request without any
+ * data received so far.
+ * @input_param     the connection
+ * @return          true if the connection is idle
+ */
+bool
+conn_is_idle(connection_t *conn) {
+    return conn->state == CONN_STATE_READ_REQUEST && conn->request_len == 0;
+} /* end of conn_is_idle */
+
+/**
+ * Drive the connection state machine as far as the socket allows.
+ * @input_param     the connection
+ * @input_param     the program options
+ * @return          CONN_WANT_READ or CONN_WANT_WRITE if the socket
+ *                  would block, CONN_DONE when the response is sent,
+ *                  CONN_ERROR in case of error
+ */
+conn_result_t
+conn_advance(connection_t *conn, prog_options_t *server) {
+    conn_result_t result;
+
+    conn->wait_fd = conn->sd;
+    while (1) {
+        switch (conn->state) {
+            case CONN_STATE_READ_REQUEST:
+                result = conn_read_request(conn);
+                if (result != CONN_DONE || conn->state == CONN_STATE_DONE) {
+                    return result;
+                } /* end if */
+                if (process_request(conn, server) < 0) {
+                    return CONN_ERROR;
+                } /* end if */
+                break;
+            case CONN_STATE_SEND_HEADER:
+                if (conn->body_data != NULL) {
+                    result = conn_send_cached(conn);
+                } else {
+                    result = conn_send_header(conn);
+                } /* end if */
+                if (result != CONN_DONE) {
+                    return result;
+                } /* end if */
+                if (conn->body_fd >= 0) {
+                    conn->state = CONN_STATE_SEND_BODY;
+                } else {
+                    conn_response_sent(conn);
+                } /* end if */
+                break;
+            case CONN_STATE_SEND_BODY:
+                if (conn->ranges != NULL) {
+                    result = conn_send_parts(conn);
+                } else {
+                    result = conn_send_body(conn);
+                } /* end if */
+                if (result != CONN_DONE) {
+                    return result;
+                } /* end if */
+                conn_response_sent(conn);
+                break;
+            case CONN_STATE_UPSTREAM:
+                result = fcgi_advance(conn, server);
+                if (result != CONN_DONE) {
+                    return result;
+                } else if (conn->state == CONN_STATE_UPSTREAM) {
+                    conn_response_sent(conn);
+                } /* end if */
+                /* otherwise an error response replaces the one of the runner */
+                break;
+            case CONN_STATE_CGI:
+                result = cgi_advance(conn, server);
+                if (result != CONN_DONE) {
+                    return result;
+                } else if (conn->state == CONN_STATE_CGI) {
+                    conn_response_sent(conn);
+                } /* end if */
+                /* otherwise an error response replaces the output of the script */
+                break;
+            case CONN_STATE_DONE:
+                return CONN_DONE;
+            default:
+                return CONN_ERROR;
+        } /* end switch */
+    } /* end while */
+} /* end of conn_advance */
+
+/**
+ * Release the resources held by a connection.
+ * @input_param     the connection
+ */
+void
+conn_close(connection_t *conn) {
+    if (conn->body_fd >= 0) {
+        close(conn->body_fd);
+        conn->body_fd = -1;
+    } /* end if */
+    if (conn->cache_entry != NULL) {
+        file_cache_release(conn->cache_entry);
+        conn->cache_entry = NULL;
+    } /* end if */
+    conn->body_buf = NULL;
+    conn->body_data = NULL;
+    conn->ranges = NULL;
+    if (conn->pipe_fd[0] >= 0) {
+        close(conn->pipe_fd[0]);
+        close(conn->pipe_fd[1]);
+        conn->pipe_fd[0] = -1;
+        conn->pipe_fd[1] = -1;
+    } /* end if */
+    fcgi_release(conn);
+    cgi_release(conn);
+    arena_reset(&conn->arena);
+    conn_release_request(conn);
+    if (conn->sd >= 0) {
+        close(conn->sd);
+        conn->sd = -1;
+        metrics_connection_closed();
+    } /* end if */
+} /* end of conn_close */
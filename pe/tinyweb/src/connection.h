@@ -0,0 +1,115 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _CONNECTION_H
+#define _CONNECTION_H
+
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "tinyweb.h"
+#include "http_parser.h"
+#include "file_cache.h"
+#include "range.h"
+#include "arena.h"
+
+#define SPLICE_CHUNK_SIZE               65536
+#define REQUEST_BUFFER_SIZE              4096   // first buffer of a request, grown up to SLAB_MAX_SIZE
+
+
+typedef enum conn_state {
+    CONN_STATE_READ_REQUEST = 0,    // waiting for the complete request header
+    CONN_STATE_SEND_HEADER,         // writing the response header
+    CONN_STATE_SEND_BODY,           // writing the response body
+    CONN_STATE_UPSTREAM,            // relaying the response of a cgi runner
+    CONN_STATE_CGI,                 // relaying the output pipe of a cgi script
+    CONN_STATE_DONE                 // last response sent, connection can be closed
+} conn_state_t;
+
+
+typedef enum conn_result {
+    CONN_DONE = 0,                  // connection finished, close it
+    CONN_WANT_READ,                 // socket would block on read
+    CONN_WANT_WRITE,                // socket would block on write
+    CONN_ERROR = -1                 // I/O error, close the connection
+} conn_result_t;
+
+
+typedef struct connection {
+    int                 sd;                         // client socket descriptor
+    struct sockaddr_storage client;                 // client address, IPv4 or IPv6
+    conn_state_t        state;
+    bool                keep_alive;                 // read the next request after the response
+    time_t              last_active;                // for the idle timeout
+    struct connection  *prev;                       // list of open connections
+    struct connection  *next;
+    char               *request;                    // received request header(s), NULL while idle
+    size_t              request_size;               // size of the slab buffer
+    size_t              request_len;
+    size_t              request_end;                // end of the current request header
+    parsed_http_header_t parsed_header;             // fields point into request
+    char                header[BUFFER_SIZE];        // response header
+    size_t              header_len;
+    size_t              header_sent;
+    int                 body_fd;                    // file to send or -1
+    file_cache_entry_t *cache_entry;                // cached file to send or NULL
+    arena_t             arena;                      // memory of the current response
+    char               *body_buf;                   // generated body in the arena or NULL
+    const char         *body_data;                  // body in memory to send or NULL
+    off_t               body_offset;                // next file offset to send
+    off_t               body_end;                   // end of the body (exclusive)
+    range_set_t        *ranges;                     // parts of a multipart/byteranges body in the arena or NULL
+    int                 pipe_fd[2];                 // splice() fallback, -1 if unused
+    size_t              pipe_len;                   // body bytes waiting in the pipe
+    long long           parse_ns;                   // time spent parsing the current request
+    long long           phase_start;                // start of the current request phase
+    size_t              response_size;              // bytes of the current response
+    unsigned int        requests;                   // answered requests
+    int                 epfd;                       // event loop watching the connection, -1 if none
+    int                 wait_fd;                    // descriptor of the last CONN_WANT_READ/WRITE
+    int                 upstream_fd;                // connection to a cgi runner or -1
+    char               *upstream_buf;               // records to and from the runner, in the arena
+    size_t              upstream_len;               // bytes in upstream_buf
+    size_t              upstream_pos;               // next byte to send or to parse
+    bool                upstream_reading;           // request sent, reading the response
+    size_t              out_start;                  // cgi output in upstream_buf to forward
+    size_t              out_end;
+    int                 record_type;                // record being received, 0 between records
+    size_t              record_left;                // content bytes of the record left
+    size_t              record_padding;             // padding bytes after the content
+    time_t              deadline;                   // end of the cgi request, 0 if none
+    int                 cgi_fd;                     // output pipe of a forked cgi script or -1
+    char               *cgi_buf;                    // cgi header received so far in the arena or NULL
+    size_t              cgi_len;
+    bool                cgi_header_done;            // response header built, the body follows
+    int                 cgi_status;                 // status code of the cgi response
+    off_t               cgi_length;                 // Content-Length of the script, -1 if unknown
+    bool                cgi_eof;                    // end of the output, the last chunk is queued
+    bool                chunked;                    // body with Transfer-Encoding: chunked
+    bool                chunk_open;                 // a chunk was sent, the next frame ends it
+    size_t              chunk_left;                 // data bytes of the current chunk left
+    bool                body_discard;               // HEAD: the body of the script is dropped
+    char                frame[32];                  // chunk framing to send
+    size_t              frame_len;
+    size_t              frame_sent;
+} connection_t;
+
+
+extern void conn_init(connection_t *conn, int sd, const struct sockaddr_storage *client, int epfd);
+extern int conn_set_nonblocking(int sd);
+extern bool conn_is_idle(connection_t *conn);
+extern conn_result_t conn_advance(connection_t *conn, prog_options_t *server);
+extern void conn_close(connection_t *conn);
+extern int conn_watch_fd(connection_t *conn, int fd);
+extern void conn_release_fd(connection_t *conn, int *fd);
+
+#endif
@@ -7,42 +7,351 @@
  *
  *===================================================================*/
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
 #include "content.h"
 
+#define CONTENT_DEFAULT_NAME    "text/plain"
 
+
+/*
+ * The built-in types, a mime.types file read at startup adds to them
+ * and overrides them
+ */
 static http_content_type_entry_t http_content_type_list[] = {
-    { ".html",    "text/html"          },
-    { ".css",     "text/css"           },
-    { ".gif",     "image/gif"          },
-    { ".jpg",     "image/jpeg"         },
-    { ".pdf",     "application/pdf"    },
-    { ".tar",     "application/x-tar"  },
-    { ".xml",     "application/xml"    },
-    { NULL,       "text/plain"         }
+    { "html",     "text/html"              },
+    { "htm",      "text/html"              },
+    { "css",      "text/css"               },
+    { "js",       "text/javascript"        },
+    { "mjs",      "text/javascript"        },
+    { "json",     "application/json"       },
+    { "xml",      "application/xml"        },
+    { "txt",      "text/plain"             },
+    { "csv",      "text/csv"               },
+    { "md",       "text/markdown"          },
+    { "svg",      "image/svg+xml"          },
+    { "gif",      "image/gif"              },
+    { "jpg",      "image/jpeg"             },
+    { "jpeg",     "image/jpeg"             },
+    { "png",      "image/png"              },
+    { "webp",     "image/webp"             },
+    { "avif",     "image/avif"             },
+    { "ico",      "image/x-icon"           },
+    { "pdf",      "application/pdf"        },
+    { "tar",      "application/x-tar"      },
+    { "gz",       "application/gzip"       },
+    { "zip",      "application/zip"        },
+    { "wasm",     "application/wasm"       },
+    { "woff",     "font/woff"              },
+    { "woff2",    "font/woff2"             },
+    { "ttf",      "font/ttf"               },
+    { "otf",      "font/otf"               },
+    { "mp3",      "audio/mpeg"             },
+    { "ogg",      "audio/ogg"              },
+    { "mp4",      "video/mp4"              },
+    { "webm",     "video/webm"             },
+    { NULL,       NULL                     }
 };
 
+/*
+ * Types besides text/ and the +xml and +json suffixes which are worth a
+ * content coding
+ */
+static const char *compressible_list[] = {
+    "application/javascript",
+    "application/json",
+    "application/xml",
+    "application/wasm",
+    "application/x-tar",
+    "font/ttf",
+    "font/otf",
+    NULL
+};
 
-http_content_type_t
-get_http_content_type(const char *filename)
+
+typedef struct content_type {
+    char                *name;
+    bool                 compressible;
+} content_type_t;
+
+
+/*
+ * A slot of the extension table, free if ext is empty
+ */
+typedef struct content_ext {
+    char                 ext[CONTENT_EXT_SIZE];     // lower case, without the dot
+    unsigned int         hash;
+    http_content_type_t  type;
+} content_ext_t;
+
+
+static content_type_t *type_list = NULL;    // HTTP_CONTENT_TYPE_DEFAULT first
+static unsigned int type_count = 0;
+static unsigned int type_capacity = 0;
+static content_ext_t *ext_table = NULL;     // open addressing, a power of two slots
+static size_t ext_size = 0;
+static size_t ext_count = 0;
+
+
+/**
+ * Hash an extension with FNV-1a, ignoring case.
+ * @input_param     the extension
+ * @input_param     the length of the extension
+ * @return          the hash value
+ */
+static unsigned int
+hash_ext(const char *ext, size_t len)
 {
-    int i;
+    unsigned int hash = 2166136261u;
+    size_t i;
 
-    i = 0;
-    while (http_content_type_list[i].ext != NULL) {
-        if (strstr(filename, http_content_type_list[i].ext)) {
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char) tolower((unsigned char) ext[i])) * 16777619u;
+    } /* end for */
+
+    return hash;
+} /* end of hash_ext */
+
+
+/**
+ * Find the slot of an extension.
+ * @input_param     the extension
+ * @input_param     the length of the extension
+ * @input_param     the hash of the extension
+ * @return          the slot holding the extension, else the free slot
+ *                  where it belongs
+ */
+static content_ext_t *
+find_slot(const char *ext, size_t len, unsigned int hash)
+{
+    size_t i;
+
+    for (i = hash & (ext_size - 1); ext_table[i].ext[0] != '\0'; i = (i + 1) & (ext_size - 1)) {
+        if (ext_table[i].hash == hash && strncasecmp(ext_table[i].ext, ext, len) == 0
+                && ext_table[i].ext[len] == '\0') {
             break;
         } /* end if */
-        i++;
+    } /* end for */
+
+    return &ext_table[i];
+} /* end of find_slot */
+
+
+/**
+ * Add a type to the list unless it is known.
+ * @input_param     the name of the type
+ * @return          the index of the type, -1 in case of error
+ */
+static int
+add_type(const char *name)
+{
+    content_type_t *list;
+    unsigned int i;
+
+    for (i = 0; i < type_count; i++) {
+        if (strcasecmp(type_list[i].name, name) == 0) {
+            return i;
+        } /* end if */
+    } /* end for */
+
+    if (type_count == type_capacity) {
+        list = realloc(type_list, (type_capacity * 2 + 16) * sizeof (content_type_t));
+        if (list == NULL) {
+            return -1;
+        } /* end if */
+        type_list = list;
+        type_capacity = type_capacity * 2 + 16;
+    } /* end if */
+
+    type_list[type_count].name = strdup(name);
+    if (type_list[type_count].name == NULL) {
+        return -1;
+    } /* end if */
+    type_list[type_count].compressible = (strncasecmp(name, "text/", 5) == 0)
+            || (strlen(name) > 4 && (strcasecmp(name + strlen(name) - 4, "+xml") == 0))
+            || (strlen(name) > 5 && (strcasecmp(name + strlen(name) - 5, "+json") == 0));
+    for (i = 0; compressible_list[i] != NULL; i++) {
+        if (strcasecmp(compressible_list[i], name) == 0) {
+            type_list[type_count].compressible = true;
+        } /* end if */
+    } /* end for */
+
+    return type_count++;
+} /* end of add_type */
+
+
+/**
+ * Map an extension to a type, a later mapping replaces an earlier one.
+ * The table is doubled when it gets half full.
+ * @input_param     the extension
+ * @input_param     the type
+ * @return          -1 in case of error
+ */
+static int
+add_ext(const char *ext, http_content_type_t type)
+{
+    content_ext_t *old = ext_table;
+    size_t old_size = ext_size;
+    content_ext_t *slot;
+    size_t len = strlen(ext);
+    size_t i;
+
+    if (len == 0 || len >= CONTENT_EXT_SIZE) {
+        /* never looked up */
+        return 0;
+    } /* end if */
+
+    if ((ext_count + 1) * 2 > ext_size) {
+        ext_size = (ext_size == 0) ? 64 : ext_size * 2;
+        ext_table = calloc(ext_size, sizeof (content_ext_t));
+        if (ext_table == NULL) {
+            ext_table = old;
+            ext_size = old_size;
+            return -1;
+        } /* end if */
+        for (i = 0; i < old_size; i++) {
+            if (old[i].ext[0] != '\0') {
+                *find_slot(old[i].ext, strlen(old[i].ext), old[i].hash) = old[i];
+            } /* end if */
+        } /* end for */
+        free(old);
+    } /* end if */
+
+    slot = find_slot(ext, len, hash_ext(ext, len));
+    if (slot->ext[0] == '\0') {
+        for (i = 0; i < len; i++) {
+            slot->ext[i] = tolower((unsigned char) ext[i]);
+        } /* end for */
+        slot->hash = hash_ext(ext, len);
+        ext_count++;
+    } /* end if */
+    slot->type = type;
+
+    return 0;
+} /* end of add_ext */
+
+
+/**
+ * Read a file in the mime.types format: a type followed by its
+ * extensions per line, '#' starts a comment.
+ * @input_param     the path of the file
+ * @return          -1 in case of error
+ */
+static int
+read_mime_types(const char *path)
+{
+    char line[CONTENT_LINE_SIZE];
+    char *token, *save, *p;
+    FILE *fp;
+    int type;
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot open mime types '%s': %s\n", path, strerror(errno));
+        return -1;
+    } /* end if */
+
+    while (fgets(line, sizeof (line), fp) != NULL) {
+        p = strchr(line, '#');
+        if (p != NULL) {
+            *p = '\0';
+        } /* end if */
+        token = strtok_r(line, " \t\r\n", &save);
+        if (token == NULL || strchr(token, '/') == NULL) {
+            continue;
+        } /* end if */
+        type = add_type(token);
+        while (type >= 0 && (token = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+            if (add_ext((token[0] == '.') ? token + 1 : token, type) < 0) {
+                type = -1;
+            } /* end if */
+        } /* end while */
+        if (type < 0) {
+            fclose(fp);
+            fprintf(stderr, "Cannot allocate memory for mime types\n");
+            return -1;
+        } /* end if */
     } /* end while */
 
-    return (http_content_type_t)i;
+    fclose(fp);
+    return 0;
+} /* end of read_mime_types */
+
+
+/**
+ * Build the extension table from the built-in types and a mime.types
+ * file.
+ * @input_param     the path of the file, NULL for the built-in types only
+ * @return          -1 in case of error
+ */
+int
+content_type_init(const char *path)
+{
+    int type;
+    int i;
+
+    if (ext_table == NULL) {
+        if (add_type(CONTENT_DEFAULT_NAME) != HTTP_CONTENT_TYPE_DEFAULT) {
+            return -1;
+        } /* end if */
+        for (i = 0; http_content_type_list[i].ext != NULL; i++) {
+            type = add_type(http_content_type_list[i].name);
+            if (type < 0 || add_ext(http_content_type_list[i].ext, type) < 0) {
+                return -1;
+            } /* end if */
+        } /* end for */
+    } /* end if */
+
+    return (path != NULL) ? read_mime_types(path) : 0;
+} /* end of content_type_init */
+
+
+http_content_type_t
+get_http_content_type(const char *filename)
+{
+    const char *ext = NULL;
+    const char *p;
+    content_ext_t *slot;
+    size_t len;
+
+    if (ext_table == NULL && content_type_init(NULL) < 0) {
+        return HTTP_CONTENT_TYPE_DEFAULT;
+    } /* end if */
+
+    // only the suffix behind the last dot of the last segment counts
+    for (p = filename; *p != '\0'; p++) {
+        if (*p == '.') {
+            ext = p + 1;
+        } else if (*p == '/') {
+            ext = NULL;
+        } /* end if */
+    } /* end for */
+    if (ext == NULL) {
+        return HTTP_CONTENT_TYPE_DEFAULT;
+    } /* end if */
+    len = p - ext;
+    if (len == 0 || len >= CONTENT_EXT_SIZE) {
+        return HTTP_CONTENT_TYPE_DEFAULT;
+    } /* end if */
+
+    slot = find_slot(ext, len, hash_ext(ext, len));
+    return (slot->ext[0] != '\0') ? slot->type : HTTP_CONTENT_TYPE_DEFAULT;
 } /* end of get_http_content_type */
 
 
 char *
 get_http_content_type_str(const http_content_type_t type)
 {
-    return http_content_type_list[type].name;
+    return (type < type_count) ? type_list[type].name : CONTENT_DEFAULT_NAME;
 } /* end of get_http_content_type_str */
 
+
+bool
+http_content_type_compressible(const http_content_type_t type)
+{
+    return (type < type_count) ? type_list[type].compressible : true;
+} /* end of http_content_type_compressible */
@@ -10,17 +10,17 @@
 #ifndef _CONTENT_H
 #define _CONTENT_H
 
+#include <stdbool.h>
 
-typedef enum http_content_type {
-    HTTP_CONTENT_TYPE_HTML = 0,
-    HTTP_CONTENT_TYPE_CSS,
-    HTTP_CONTENT_TYPE_GIF,
-    HTTP_CONTENT_TYPE_JPEG,
-    HTTP_CONTENT_TYPE_PDF,
-    HTTP_CONTENT_TYPE_TAR,
-    HTTP_CONTENT_TYPE_XML,
-    HTTP_CONTENT_TYPE_DEFAULT
-} http_content_type_t;
+#define HTTP_CONTENT_TYPE_DEFAULT           0   // files without a known extension
+#define CONTENT_EXT_SIZE                   16   // longer extensions are not looked up
+#define CONTENT_LINE_SIZE                1024
+
+
+/*
+ * Index into the list of content types
+ */
+typedef unsigned int http_content_type_t;
 
 
 typedef struct http_content_type_entry {
@@ -29,11 +29,16 @@ typedef struct http_content_type_entry {
 } http_content_type_entry_t;
 
 
+extern int
+content_type_init(const char *path);
+
 extern http_content_type_t
 get_http_content_type(const char *filename);
 
 extern char *
 get_http_content_type_str(const http_content_type_t type);
 
-#endif
+extern bool
+http_content_type_compressible(const http_content_type_t type);
 
+#endif
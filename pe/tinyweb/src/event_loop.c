@@ -0,0 +1,241 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+
+#include "tinyweb.h"
+#include "connection.h"
+#include "event_loop.h"
+#include "metrics.h"
+
+#define MAX_EVENTS                         64
+#define SWEEP_INTERVAL_MS                1000
+
+static int active_connections = 0;
+static connection_t *connections = NULL;    // list of open connections
+
+
+/**
+ * Remove a connection from the event loop and free it.
+ * @input_param     the epoll descriptor
+ * @input_param     the connection
+ */
+static void
+drop_connection(int epfd, connection_t *conn) {
+    /*
+     * Deregister explicitly: a cgi child may still hold a duplicate of
+     * the socket, so close() alone would not remove it from the epoll set.
+     */
+    epoll_ctl(epfd, EPOLL_CTL_DEL, conn->sd, NULL);
+    conn_close(conn);
+
+    if (conn->prev != NULL) {
+        conn->prev->next = conn->next;
+    } else {
+        connections = conn->next;
+    } /* end if */
+    if (conn->next != NULL) {
+        conn->next->prev = conn->prev;
+    } /* end if */
+    free(conn);
+    active_connections--;
+} /* end of drop_connection */
+
+/**
+ * Close connections that made no progress within the timeout and,
+ * while draining, persistent connections waiting for a new request.
+ * A cgi request past its deadline gets the chance to answer 504.
+ * @input_param     the epoll descriptor
+ * @input_param     the program options
+ * @input_param     true if the server is shutting down
+ */
+static void
+sweep_connections(int epfd, prog_options_t *server, bool draining) {
+    connection_t *conn;
+    connection_t *next;
+    conn_result_t result;
+    time_t now = time(NULL);
+
+    for (conn = connections; conn != NULL; conn = next) {
+        next = conn->next;
+        if (conn->deadline != 0) {
+            if (now >= conn->deadline) {
+                conn->last_active = now;
+                result = conn_advance(conn, server);
+                if (result == CONN_DONE || result == CONN_ERROR) {
+                    drop_connection(epfd, conn);
+                } /* end if */
+            } /* end if */
+        } else if (now - conn->last_active >= server->timeout || (draining && conn_is_idle(conn))) {
+            drop_connection(epfd, conn);
+        } /* end if */
+    } /* end for */
+} /* end of sweep_connections */
+
+/**
+ * Accept all pending clients on the non-blocking listening socket.
+ * @input_param     the epoll descriptor
+ * @input_param     the listening socket descriptor
+ * @return          unequal zero in case of error
+ */
+static int
+accept_connections(int epfd, int sd) {
+    int nsd; /* new socket descriptor */
+    struct sockaddr_storage client; /* the input sockaddr */
+    socklen_t client_len; /* the length of it */
+    struct epoll_event ev;
+    connection_t *conn;
+
+    // the length of the queue when the loop wakes up
+    metrics_accept_queue(sd);
+
+    while (1) {
+        client_len = sizeof (client);
+        nsd = accept4(sd, (struct sockaddr *) &client, &client_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (nsd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            } else if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            } /* end if */
+            err_print("ERROR: server accept()");
+            return -1;
+        } /* end if */
+
+        conn = malloc(sizeof (connection_t));
+        if (conn == NULL) {
+            err_print("ERROR: cant allocate memory");
+            close(nsd);
+            continue;
+        } /* end if */
+        conn_init(conn, nsd, &client, epfd);
+        conn->next = connections;
+        if (connections != NULL) {
+            connections->prev = conn;
+        } /* end if */
+        connections = conn;
+        active_connections++;
+
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = conn;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, nsd, &ev) < 0) {
+            err_print("ERROR: epoll_ctl(ADD)");
+            drop_connection(epfd, conn);
+        } /* end if */
+    } /* end while */
+} /* end of accept_connections */
+
+/**
+ * Serve all clients from a single process with an edge-triggered
+ * epoll loop instead of forking per connection. Connections without
+ * progress for the timeout of the program options are closed. When the
+ * running flag is cleared the listeners are closed and the loop keeps on
+ * serving the open requests for at most this timeout.
+ * @input_param     the non-blocking listening socket descriptors
+ * @input_param     the number of listening sockets
+ * @input_param     the program options
+ * @input_param     the loop runs while this flag is true
+ * @return          unequal zero in case of error
+ */
+int
+run_event_loop(int *sds, int count, prog_options_t *server, volatile sig_atomic_t *running) {
+    int epfd; /* epoll descriptor */
+    int i, j, n;
+    bool listening = true;
+    struct epoll_event ev;
+    struct epoll_event events[MAX_EVENTS];
+    connection_t *conn;
+    conn_result_t result;
+    time_t drain_deadline = 0;
+    time_t last_sweep = time(NULL);
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        err_print("ERROR: epoll_create1()");
+        return -1;
+    } /* end if */
+
+    // the listening sockets are the only entries without a connection
+    for (i = 0; i < count; i++) {
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.ptr = NULL;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, sds[i], &ev) < 0) {
+            err_print("ERROR: epoll_ctl(ADD)");
+            close(epfd);
+            return -1;
+        } /* end if */
+    } /* end for */
+
+    while (1) {
+        if (!*running && listening) {
+            // graceful drain: no new clients, finish the open ones
+            for (i = 0; i < count; i++) {
+                epoll_ctl(epfd, EPOLL_CTL_DEL, sds[i], NULL);
+                close(sds[i]);
+            } /* end for */
+            listening = false;
+            drain_deadline = time(NULL) + server->timeout;
+        } /* end if */
+        if (time(NULL) != last_sweep || !listening) {
+            sweep_connections(epfd, server, !listening);
+            last_sweep = time(NULL);
+        } /* end if */
+        if (!listening && (active_connections == 0 || time(NULL) >= drain_deadline)) {
+            break;
+        } /* end if */
+
+        n = epoll_wait(epfd, events, MAX_EVENTS, SWEEP_INTERVAL_MS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            } /* end if */
+            err_print("ERROR: epoll_wait()");
+            break;
+        } /* end if */
+
+        for (i = 0; i < n; i++) {
+            conn = events[i].data.ptr;
+            if (events[i].events == 0) {
+                /* the connection was dropped for an earlier event */
+                continue;
+            } else if (conn == NULL) {
+                // accept on all listeners, an idle one only returns EAGAIN
+                for (j = 0; j < count && listening; j++) {
+                    if (accept_connections(epfd, sds[j]) < 0) {
+                        *running = false;
+                    } /* end if */
+                } /* end for */
+                continue;
+            } /* end if */
+
+            conn->last_active = time(NULL);
+            result = (events[i].events & EPOLLERR) ? CONN_ERROR : conn_advance(conn, server);
+            if (result == CONN_DONE || result == CONN_ERROR) {
+                // a cgi connection has a second descriptor, it may have an event, too
+                for (j = i + 1; j < n; j++) {
+                    if (events[j].data.ptr == conn) {
+                        events[j].events = 0;
+                    } /* end if */
+                } /* end for */
+                drop_connection(epfd, conn);
+            } /* end if */
+        } /* end for */
+    } /* end while */
+
+    close(epfd);
+    return 0;
+} /* end of run_event_loop */
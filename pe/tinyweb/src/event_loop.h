@@ -0,0 +1,19 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _EVENT_LOOP_H
+#define _EVENT_LOOP_H
+
+#include <signal.h>
+
+#include "tinyweb.h"
+
+extern int run_event_loop(int *sds, int count, prog_options_t *server, volatile sig_atomic_t *running);
+
+#endif
@@ -0,0 +1,309 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "tinyweb.h"
+#include "connection.h"
+#include "fastcgi.h"
+#include "cgi.h"
+#include "response.h"
+
+
+/**
+ * Append a record header to the request buffer.
+ * @input_param     the buffer
+ * @input_param     the record type
+ * @input_param     the length of the content which follows
+ */
+static void
+fcgi_put_header(unsigned char *p, int type, size_t len) {
+    p[0] = FCGI_VERSION_1;
+    p[1] = type;
+    p[2] = FCGI_REQUEST_ID >> 8;
+    p[3] = FCGI_REQUEST_ID & 0xff;
+    p[4] = len >> 8;
+    p[5] = len & 0xff;
+    p[6] = 0; /* no padding */
+    p[7] = 0;
+} /* end of fcgi_put_header */
+
+/**
+ * Append the length of a name or value, values from 128 bytes on
+ * take four bytes.
+ * @input_param     the buffer
+ * @input_param     the length
+ * @return          the number of bytes appended
+ */
+static size_t
+fcgi_put_length(unsigned char *p, size_t len) {
+    if (len < 128) {
+        p[0] = len;
+        return 1;
+    } /* end if */
+
+    p[0] = (len >> 24) | 0x80;
+    p[1] = len >> 16;
+    p[2] = len >> 8;
+    p[3] = len;
+    return 4;
+} /* end of fcgi_put_length */
+
+/**
+ * Encode the request for a runner: the begin record, the environment
+ * in a single params record, and the empty params and stdin records
+ * which end both streams, a request body is not passed.
+ * @input_param     the buffer
+ * @input_param     the size of the buffer
+ * @input_param     the environment, "NAME=value" strings up to NULL
+ * @return          the length of the request, -1 if it does not fit
+ */
+static int
+fcgi_encode_request(unsigned char *buf, size_t size, char **envp) {
+    unsigned char *params = buf + 3 * FCGI_HEADER_LEN;
+    size_t len = 0;
+    size_t name_len, value_len;
+    char *value;
+    int i;
+
+    fcgi_put_header(buf, FCGI_BEGIN_REQUEST, 8);
+    memset(buf + FCGI_HEADER_LEN, 0, 8);
+    buf[FCGI_HEADER_LEN + 1] = FCGI_RESPONDER; /* the runner closes the connection */
+
+    for (i = 0; envp[i] != NULL; i++) {
+        value = strchr(envp[i], '=');
+        if (value == NULL) {
+            continue;
+        } /* end if */
+        name_len = value - envp[i];
+        value_len = strlen(++value);
+        if (len + 8 + name_len + value_len > FCGI_MAX_CONTENT
+                || 3 * FCGI_HEADER_LEN + len + 8 + name_len + value_len + 2 * FCGI_HEADER_LEN > size) {
+            return -1;
+        } /* end if */
+        len += fcgi_put_length(params + len, name_len);
+        len += fcgi_put_length(params + len, value_len);
+        memcpy(params + len, envp[i], name_len);
+        len += name_len;
+        memcpy(params + len, value, value_len);
+        len += value_len;
+    } /* end for */
+
+    fcgi_put_header(buf + 2 * FCGI_HEADER_LEN, FCGI_PARAMS, len);
+    fcgi_put_header(params + len, FCGI_PARAMS, 0);
+    fcgi_put_header(params + len + FCGI_HEADER_LEN, FCGI_STDIN, 0);
+    return 3 * FCGI_HEADER_LEN + len + 2 * FCGI_HEADER_LEN;
+} /* end of fcgi_encode_request */
+
+/**
+ * Hand a cgi request over to a runner of the pool. The output of the
+ * runner is relayed to the client like the one of a forked script.
+ * @input_param     the connection
+ * @input_param     the non-blocking connection to the runner
+ * @input_param     the environment of the script
+ * @input_param     the program options
+ * @return          -1 in case of error, the runner connection is closed then
+ */
+int
+fcgi_start(connection_t *conn, int fd, char **envp, prog_options_t *server) {
+    int len;
+
+    conn->upstream_fd = fd;
+    conn->upstream_buf = arena_alloc(&conn->arena, FCGI_BUFFER_SIZE);
+    if (conn->upstream_buf == NULL) {
+        err_print("ERROR: cant allocate memory");
+        fcgi_release(conn);
+        return -1;
+    } /* end if */
+
+    len = fcgi_encode_request((unsigned char *) conn->upstream_buf, FCGI_BUFFER_SIZE, envp);
+    if (len < 0) {
+        err_print("ERROR: cgi environment too large");
+        fcgi_release(conn);
+        return -1;
+    } /* end if */
+    conn->upstream_len = len;
+    conn->upstream_pos = 0;
+    conn->upstream_reading = false;
+    conn->out_start = 0;
+    conn->out_end = 0;
+    conn->record_type = 0;
+    conn->record_left = 0;
+    conn->record_padding = 0;
+    conn->deadline = time(NULL) + server->cgi_timeout;
+    cgi_output_init(conn);
+
+    if (conn_watch_fd(conn, fd) < 0) {
+        fcgi_release(conn);
+        return -1;
+    } /* end if */
+
+    conn->state = CONN_STATE_UPSTREAM;
+    return 0;
+} /* end of fcgi_start */
+
+/**
+ * Close the connection to the runner, if any.
+ * @input_param     the connection
+ */
+void
+fcgi_release(connection_t *conn) {
+    conn_release_fd(conn, &conn->upstream_fd);
+    conn->upstream_buf = NULL;
+    conn->deadline = 0;
+} /* end of fcgi_release */
+
+/**
+ * Give up a cgi request: answer with an error status if nothing of
+ * the response is sent yet, otherwise the response is cut off.
+ * @input_param     the connection
+ * @input_param     the error status
+ * @input_param     the program options
+ * @return          CONN_DONE with the error response prepared or CONN_ERROR
+ */
+static conn_result_t
+fcgi_fail(connection_t *conn, http_status_t status, prog_options_t *server) {
+    fcgi_release(conn);
+    if (conn->header_sent > 0 || respond_cgi_error(conn, status, server) < 0) {
+        return CONN_ERROR;
+    } /* end if */
+
+    return CONN_DONE;
+} /* end of fcgi_fail */
+
+/**
+ * Send the request to the runner and relay its output to the client.
+ * The records are parsed in place, output is forwarded before the
+ * next part is read, so a slow client slows down the script.
+ * @input_param     the connection
+ * @input_param     the program options
+ * @return          CONN_WANT_READ or CONN_WANT_WRITE if the runner or
+ *                  the client would block, the descriptor is in wait_fd,
+ *                  CONN_DONE when the response is relayed or an error
+ *                  response is prepared, CONN_ERROR in case of error
+ */
+conn_result_t
+fcgi_advance(connection_t *conn, prog_options_t *server) {
+    unsigned char *p;
+    conn_result_t result;
+    size_t avail, n, used;
+    ssize_t len;
+
+    if (time(NULL) >= conn->deadline) {
+        return fcgi_fail(conn, HTTP_STATUS_GATEWAY_TIMEOUT, server);
+    } /* end if */
+
+    while (!conn->upstream_reading) {
+        len = send(conn->upstream_fd, conn->upstream_buf + conn->upstream_pos,
+                conn->upstream_len - conn->upstream_pos, MSG_NOSIGNAL);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn->wait_fd = conn->upstream_fd;
+                return CONN_WANT_WRITE;
+            } /* end if */
+            return fcgi_fail(conn, HTTP_STATUS_BAD_GATEWAY, server);
+        } /* end if */
+        conn->upstream_pos += len;
+        if (conn->upstream_pos == conn->upstream_len) {
+            conn->upstream_reading = true;
+            conn->upstream_len = 0;
+            conn->upstream_pos = 0;
+        } /* end if */
+    } /* end while */
+
+    while (1) {
+        if (conn->out_start < conn->out_end) {
+            result = cgi_output(conn, conn->upstream_buf + conn->out_start,
+                    conn->out_end - conn->out_start, &used, server);
+            conn->out_start += used;
+            if (conn->state != CONN_STATE_UPSTREAM) {
+                /* an error response replaces the output */
+                fcgi_release(conn);
+                return result;
+            } else if (result != CONN_DONE) {
+                return result;
+            } /* end if */
+        } /* end if */
+
+        avail = conn->upstream_len - conn->upstream_pos;
+        p = (unsigned char *) conn->upstream_buf + conn->upstream_pos;
+        if (conn->record_type == 0) {
+            if (avail >= FCGI_HEADER_LEN) {
+                if (p[0] != FCGI_VERSION_1 || p[1] == 0) {
+                    return fcgi_fail(conn, HTTP_STATUS_BAD_GATEWAY, server);
+                } /* end if */
+                conn->record_type = p[1];
+                conn->record_left = (p[4] << 8) | p[5];
+                conn->record_padding = p[6];
+                conn->upstream_pos += FCGI_HEADER_LEN;
+                continue;
+            } /* end if */
+        } else if (conn->record_left > 0) {
+            if (avail > 0) {
+                n = (avail < conn->record_left) ? avail : conn->record_left;
+                if (conn->record_type == FCGI_STDOUT) {
+                    conn->out_start = conn->upstream_pos;
+                    conn->out_end = conn->upstream_pos + n;
+                } else if (conn->record_type == FCGI_STDERR) {
+                    fwrite(p, 1, n, stderr);
+                } /* end if */
+                conn->upstream_pos += n;
+                conn->record_left -= n;
+                continue;
+            } /* end if */
+        } else if (conn->record_padding > 0) {
+            if (avail > 0) {
+                n = (avail < conn->record_padding) ? avail : conn->record_padding;
+                conn->upstream_pos += n;
+                conn->record_padding -= n;
+                continue;
+            } /* end if */
+        } else if (conn->record_type == FCGI_END_REQUEST) {
+            result = cgi_output_end(conn, server);
+            if (result != CONN_WANT_WRITE) {
+                fcgi_release(conn);
+            } /* end if */
+            return result;
+        } else {
+            conn->record_type = 0;
+            continue;
+        } /* end if */
+
+        // all records in the buffer are handled, keep a partial header
+        memmove(conn->upstream_buf, conn->upstream_buf + conn->upstream_pos, avail);
+        conn->upstream_len = avail;
+        conn->upstream_pos = 0;
+
+        len = read(conn->upstream_fd, conn->upstream_buf + conn->upstream_len,
+                FCGI_BUFFER_SIZE - conn->upstream_len);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn->wait_fd = conn->upstream_fd;
+                return CONN_WANT_READ;
+            } /* end if */
+            return fcgi_fail(conn, HTTP_STATUS_BAD_GATEWAY, server);
+        } else if (len == 0) {
+            /* the runner died or gave up the request */
+            return fcgi_fail(conn, HTTP_STATUS_BAD_GATEWAY, server);
+        } /* end if */
+        conn->upstream_len += len;
+    } /* end while */
+} /* end of fcgi_advance */
@@ -0,0 +1,37 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _FASTCGI_H
+#define _FASTCGI_H
+
+#include "tinyweb.h"
+#include "connection.h"
+
+// FastCGI 1.0 record types and roles
+#define FCGI_VERSION_1                      1
+#define FCGI_BEGIN_REQUEST                  1
+#define FCGI_ABORT_REQUEST                  2
+#define FCGI_END_REQUEST                    3
+#define FCGI_PARAMS                         4
+#define FCGI_STDIN                          5
+#define FCGI_STDOUT                         6
+#define FCGI_STDERR                         7
+#define FCGI_RESPONDER                      1
+
+#define FCGI_HEADER_LEN                     8
+#define FCGI_MAX_CONTENT                65535
+#define FCGI_REQUEST_ID                     1   // a single request per runner connection
+#define FCGI_BUFFER_SIZE                65536   // records to and from the runner
+
+
+extern int fcgi_start(connection_t *conn, int fd, char **envp, prog_options_t *server);
+extern conn_result_t fcgi_advance(connection_t *conn, prog_options_t *server);
+extern void fcgi_release(connection_t *conn);
+
+#endif
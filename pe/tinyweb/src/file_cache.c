@@ -0,0 +1,281 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "tinyweb.h"
+#include "http.h"
+#include "content.h"
+#include "file_cache.h"
+#include "conditional.h"
+#include "header_builder.h"
+#include "metrics.h"
+#include "path.h"
+
+/*
+ * The cache belongs to the serving process: the event loop shares it
+ * between all of its connections, a forked client handler between the
+ * requests of its persistent connection.
+ */
+static size_t cache_budget = 0;         // bytes, zero disables the cache
+static size_t cache_used = 0;
+static file_cache_entry_t *buckets[FILE_CACHE_BUCKETS];
+static file_cache_entry_t *lru_head = NULL;
+static file_cache_entry_t *lru_tail = NULL;
+
+
+/**
+ * Set the memory budget of the cache.
+ * @input_param     the budget in bytes, zero disables the cache
+ */
+void
+file_cache_init(size_t budget) {
+    cache_budget = budget;
+} /* end of file_cache_init */
+
+/**
+ * Hash a path with FNV-1a.
+ * @input_param     the path
+ * @return          the hash value
+ */
+static unsigned int
+hash_path(http_slice_t path) {
+    unsigned int hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < path.len; i++) {
+        hash = (hash ^ (unsigned char) path.ptr[i]) * 16777619u;
+    } /* end for */
+
+    return hash;
+} /* end of hash_path */
+
+/**
+ * Free an entry which is no longer referenced.
+ * @input_param     the entry
+ */
+static void
+free_entry(file_cache_entry_t *entry) {
+    free(entry->data);
+    free(entry->path);
+    free(entry);
+} /* end of free_entry */
+
+/**
+ * Remove an entry from the hash table and the LRU list. Connections
+ * still sending the entry keep it until they release it.
+ * @input_param     the entry
+ */
+static void
+unlink_entry(file_cache_entry_t *entry) {
+    file_cache_entry_t **p = &buckets[entry->hash % FILE_CACHE_BUCKETS];
+
+    while (*p != entry) {
+        p = &(*p)->hash_next;
+    } /* end while */
+    *p = entry->hash_next;
+
+    if (entry->lru_prev != NULL) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        lru_head = entry->lru_next;
+    } /* end if */
+    if (entry->lru_next != NULL) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        lru_tail = entry->lru_prev;
+    } /* end if */
+
+    cache_used -= entry->size;
+    entry->cached = 0;
+    if (entry->refcount == 0) {
+        free_entry(entry);
+    } /* end if */
+} /* end of unlink_entry */
+
+/**
+ * Move an entry to the head of the LRU list.
+ * @input_param     the entry
+ */
+static void
+touch_entry(file_cache_entry_t *entry) {
+    if (entry == lru_head) {
+        return;
+    } /* end if */
+
+    // unlink, the entry is not the head, so it has a predecessor
+    entry->lru_prev->lru_next = entry->lru_next;
+    if (entry->lru_next != NULL) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        lru_tail = entry->lru_prev;
+    } /* end if */
+
+    entry->lru_prev = NULL;
+    entry->lru_next = lru_head;
+    lru_head->lru_prev = entry;
+    lru_head = entry;
+} /* end of touch_entry */
+
+/**
+ * Read a file into a new entry and prebuild its entity header fields.
+ * @input_param     the request path
+ * @input_param     the hash of the path
+ * @input_param     the file status
+ * @input_param     the content type of the file
+ * @return          the entry, NULL in case of error
+ */
+static file_cache_entry_t *
+load_entry(http_slice_t path, unsigned int hash, const struct stat *fstat, http_content_type_t type) {
+    file_cache_entry_t *entry;
+    header_builder_t hb;
+    ssize_t n;
+    off_t done = 0;
+    int fd;
+
+    entry = calloc(1, sizeof (file_cache_entry_t));
+    if (entry == NULL) {
+        return NULL;
+    } /* end if */
+    entry->path = strndup(path.ptr, path.len);
+    entry->path_len = path.len;
+    entry->data = malloc(fstat->st_size > 0 ? fstat->st_size : 1);
+    if (entry->path == NULL || entry->data == NULL) {
+        free_entry(entry);
+        return NULL;
+    } /* end if */
+
+    // the same name below the root as the status the caller checked
+    fd = path_open(path);
+    if (fd < 0) {
+        free_entry(entry);
+        return NULL;
+    } /* end if */
+    while (done < fstat->st_size) {
+        n = read(fd, entry->data + done, fstat->st_size - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            /* read error or the file shrunk meanwhile */
+            close(fd);
+            free_entry(entry);
+            return NULL;
+        } /* end if */
+        done += n;
+    } /* end while */
+    close(fd);
+
+    entry->hash = hash;
+    entry->size = fstat->st_size;
+    entry->mtime = fstat->st_mtime;
+    entry->mtime_nsec = fstat->st_mtim.tv_nsec;
+    entry->ino = fstat->st_ino;
+    etag_format(fstat, NULL, entry->etag, sizeof (entry->etag));
+
+    header_init(&hb, entry->header, sizeof (entry->header));
+    header_add_number(&hb, HTTP_HEADER_CONTENT_LENGTH, fstat->st_size);
+    header_add_field(&hb, HTTP_HEADER_CONTENT_TYPE, get_http_content_type_str(type));
+    header_add_time(&hb, HTTP_HEADER_LAST_MODIFIED, fstat->st_mtime);
+    if (hb.overflow) {
+        free_entry(entry);
+        return NULL;
+    } /* end if */
+    entry->header_len = hb.len;
+
+    return entry;
+} /* end of load_entry */
+
+/**
+ * Look up a regular file in the cache and load it on a miss. An entry
+ * is valid as long as modification time, size and inode match the
+ * status of the file. Least recently used entries are evicted when the
+ * memory budget is exceeded.
+ * @input_param     the request path
+ * @input_param     the current status of the file
+ * @input_param     the content type of the file, resolved by the caller
+ * @return          the entry with a reference for the caller, which
+ *                  must be released, NULL if the file is not cached
+ */
+file_cache_entry_t *
+file_cache_lookup(http_slice_t path, const struct stat *fstat, http_content_type_t type) {
+    file_cache_entry_t *entry;
+    unsigned int hash;
+
+    if (cache_budget == 0 || !S_ISREG(fstat->st_mode)
+            || fstat->st_size > FILE_CACHE_MAX_FILE_SIZE || (size_t) fstat->st_size > cache_budget) {
+        return NULL;
+    } /* end if */
+
+    hash = hash_path(path);
+    for (entry = buckets[hash % FILE_CACHE_BUCKETS]; entry != NULL; entry = entry->hash_next) {
+        if (entry->hash == hash && entry->path_len == path.len
+                && memcmp(entry->path, path.ptr, path.len) == 0) {
+            break;
+        } /* end if */
+    } /* end for */
+
+    if (entry != NULL) {
+        if (entry->mtime == fstat->st_mtime && entry->mtime_nsec == fstat->st_mtim.tv_nsec
+                && entry->size == fstat->st_size && entry->ino == fstat->st_ino) {
+            metrics_cache(true);
+            etag_refresh(entry->etag, fstat);
+            touch_entry(entry);
+            entry->refcount++;
+            return entry;
+        } /* end if */
+        /* stale, load the new version */
+        unlink_entry(entry);
+    } /* end if */
+
+    metrics_cache(false);
+    entry = load_entry(path, hash, fstat, type);
+    if (entry == NULL) {
+        return NULL;
+    } /* end if */
+
+    while (lru_tail != NULL && cache_used + entry->size > cache_budget) {
+        unlink_entry(lru_tail);
+    } /* end while */
+
+    entry->cached = 1;
+    entry->hash_next = buckets[hash % FILE_CACHE_BUCKETS];
+    buckets[hash % FILE_CACHE_BUCKETS] = entry;
+    entry->lru_prev = NULL;
+    entry->lru_next = lru_head;
+    if (lru_head != NULL) {
+        lru_head->lru_prev = entry;
+    } else {
+        lru_tail = entry;
+    } /* end if */
+    lru_head = entry;
+    cache_used += entry->size;
+
+    entry->refcount++;
+    return entry;
+} /* end of file_cache_lookup */
+
+/**
+ * Release the reference of a connection to an entry.
+ * @input_param     the entry
+ */
+void
+file_cache_release(file_cache_entry_t *entry) {
+    entry->refcount--;
+    if (entry->refcount == 0 && !entry->cached) {
+        free_entry(entry);
+    } /* end if */
+} /* end of file_cache_release */
@@ -0,0 +1,52 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _FILE_CACHE_H
+#define _FILE_CACHE_H
+
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "http_parser.h"
+#include "content.h"
+#include "conditional.h"
+
+#define FILE_CACHE_DEFAULT_SIZE         16384   // memory budget in kB
+#define FILE_CACHE_MAX_FILE_SIZE       262144   // larger files are sent with sendfile()
+#define FILE_CACHE_BUCKETS               1024
+#define FILE_CACHE_HEADER_SIZE            256
+
+
+typedef struct file_cache_entry {
+    char                    *path;              // request path below the document root, the key
+    size_t                   path_len;
+    unsigned int             hash;
+    char                    *data;              // file content
+    off_t                    size;
+    time_t                   mtime;             // for the revalidation
+    long                     mtime_nsec;
+    ino_t                    ino;
+    char                     header[FILE_CACHE_HEADER_SIZE];  // Content-Length/-Type, Last-Modified
+    size_t                   header_len;
+    char                     etag[ETAG_SIZE];   // weak until the second of the modification has passed
+    int                      refcount;          // connections sending the entry
+    int                      cached;            // still reachable by lookups
+    struct file_cache_entry *hash_next;         // bucket chain
+    struct file_cache_entry *lru_prev;          // most recently used first
+    struct file_cache_entry *lru_next;
+} file_cache_entry_t;
+
+
+extern void file_cache_init(size_t budget);
+extern file_cache_entry_t *file_cache_lookup(http_slice_t path, const struct stat *fstat, http_content_type_t type);
+extern void file_cache_release(file_cache_entry_t *entry);
+
+#endif
@@ -0,0 +1,244 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "tinyweb.h"
+#include "http.h"
+#include "header_builder.h"
+#include "http_date.h"
+
+#define STATUS_LINE_SIZE               80
+#define DATE_LINE_SIZE                 48
+#define NUMBER_SIZE                    24
+
+
+/*
+ * Status line and Server field of every status, built once per process
+ */
+static char status_lines[HTTP_STATUS_COUNT][STATUS_LINE_SIZE];
+static size_t status_lens[HTTP_STATUS_COUNT];
+static bool status_lines_ready = false;
+
+/*
+ * The Date field changes once per second only
+ */
+static char date_line[DATE_LINE_SIZE];
+static size_t date_len = 0;
+static time_t date_time = -1;
+
+
+/**
+ * Start a header in a buffer.
+ * @input_param     the builder
+ * @input_param     the buffer
+ * @input_param     the size of the buffer
+ */
+void
+header_init(header_builder_t *hb, char *buf, size_t size) {
+    hb->buf = buf;
+    hb->size = size;
+    hb->len = 0;
+    hb->overflow = false;
+} /* end of header_init */
+
+/**
+ * Append bytes to the header.
+ * @input_param     the builder
+ * @input_param     the bytes
+ * @input_param     the number of bytes
+ */
+void
+header_add_raw(header_builder_t *hb, const char *s, size_t len) {
+    if (hb->overflow || len > hb->size - hb->len) {
+        hb->overflow = true;
+        return;
+    } /* end if */
+    memcpy(hb->buf + hb->len, s, len);
+    hb->len += len;
+} /* end of header_add_raw */
+
+/**
+ * Build the status lines of http_status_list.
+ */
+static void
+init_status_lines(void) {
+    int i;
+
+    for (i = 0; i < HTTP_STATUS_COUNT; i++) {
+        status_lens[i] = snprintf(status_lines[i], STATUS_LINE_SIZE, "HTTP/1.1 %hu %s\r\n%s%s\r\n",
+                http_status_list[i].code, http_status_list[i].text,
+                http_header_field_list[HTTP_HEADER_SERVER], SERVER_NAME);
+    } /* end for */
+    status_lines_ready = true;
+} /* end of init_status_lines */
+
+/**
+ * Append the Date field.
+ * @input_param     the builder
+ */
+static void
+header_add_date(header_builder_t *hb) {
+    time_t now = time(NULL);
+
+    if (now != date_time) {
+        memcpy(date_line, "Date: ", 6);
+        http_date_format(now, date_line + 6);
+        memcpy(date_line + 6 + HTTP_DATE_LEN, "\r\n", 2);
+        date_len = 6 + HTTP_DATE_LEN + 2;
+        date_time = now;
+    } /* end if */
+    header_add_raw(hb, date_line, date_len);
+} /* end of header_add_date */
+
+/**
+ * Append the status line and the Server and Date fields.
+ * @input_param     the builder
+ * @input_param     the status
+ */
+void
+header_add_status(header_builder_t *hb, http_status_t status) {
+    if (!status_lines_ready) {
+        init_status_lines();
+    } /* end if */
+    header_add_raw(hb, status_lines[status], status_lens[status]);
+    header_add_date(hb);
+} /* end of header_add_status */
+
+/**
+ * Append the status line of a status which is not in http_status_list,
+ * e.g. set by a cgi script, and the Server and Date fields.
+ * @input_param     the builder
+ * @input_param     the status code
+ * @input_param     the reason phrase
+ * @input_param     the length of the reason phrase
+ */
+void
+header_add_status_code(header_builder_t *hb, int code, const char *text, size_t len) {
+    char line[STATUS_LINE_SIZE];
+    int n;
+
+    n = snprintf(line, sizeof (line), "HTTP/1.1 %03d %.*s\r\n%s%s\r\n", code, (int) len, text,
+            http_header_field_list[HTTP_HEADER_SERVER], SERVER_NAME);
+    if (n >= (int) sizeof (line)) {
+        /* cut a very long reason phrase */
+        n = snprintf(line, sizeof (line), "HTTP/1.1 %03d\r\n%s%s\r\n", code,
+                http_header_field_list[HTTP_HEADER_SERVER], SERVER_NAME);
+    } /* end if */
+    header_add_raw(hb, line, n);
+    header_add_date(hb);
+} /* end of header_add_status_code */
+
+/**
+ * Append a header field.
+ * @input_param     the builder
+ * @input_param     the field
+ * @input_param     the value
+ */
+void
+header_add_field(header_builder_t *hb, http_header_field_t field, const char *value) {
+    const char *name = http_header_field_list[field];
+
+    header_add_raw(hb, name, strlen(name));
+    header_add_raw(hb, value, strlen(value));
+    header_add_raw(hb, "\r\n", 2);
+} /* end of header_add_field */
+
+/**
+ * Format a number without the overhead of printf().
+ * @input_param     the number
+ * @output_param    the buffer of NUMBER_SIZE bytes
+ * @return          the first digit in the buffer, terminated by '\0'
+ */
+static char *
+format_number(long long value, char *buf) {
+    char *p = buf + NUMBER_SIZE - 1;
+    unsigned long long v = (value < 0) ? -(unsigned long long) value : (unsigned long long) value;
+
+    *p = '\0';
+    do {
+        *--p = '0' + v % 10;
+        v /= 10;
+    } while (v > 0);
+    if (value < 0) {
+        *--p = '-';
+    } /* end if */
+
+    return p;
+} /* end of format_number */
+
+/**
+ * Append a header field with a numeric value.
+ * @input_param     the builder
+ * @input_param     the field
+ * @input_param     the value
+ */
+void
+header_add_number(header_builder_t *hb, http_header_field_t field, long long value) {
+    char buf[NUMBER_SIZE];
+
+    header_add_field(hb, field, format_number(value, buf));
+} /* end of header_add_number */
+
+/**
+ * Append a header field with a HTTP date.
+ * @input_param     the builder
+ * @input_param     the field
+ * @input_param     the time
+ */
+void
+header_add_time(header_builder_t *hb, http_header_field_t field, time_t t) {
+    char timeString[HTTP_DATE_LEN + 1];
+
+    http_date_format(t, timeString);
+    header_add_field(hb, field, timeString);
+} /* end of header_add_time */
+
+/**
+ * Append a Content-Range field.
+ * @input_param     the builder
+ * @input_param     the first byte of the range, -1 for an unsatisfiable range
+ * @input_param     the last byte of the range
+ * @input_param     the size of the file
+ */
+void
+header_add_range(header_builder_t *hb, off_t first, off_t last, off_t size) {
+    const char *name = http_header_field_list[HTTP_HEADER_CONTENT_RANGE];
+    char buf[NUMBER_SIZE];
+    char *p;
+
+    header_add_raw(hb, name, strlen(name));
+    if (first < 0) {
+        header_add_raw(hb, "bytes */", 8);
+    } else {
+        header_add_raw(hb, "bytes ", 6);
+        p = format_number(first, buf);
+        header_add_raw(hb, p, buf + NUMBER_SIZE - 1 - p);
+        header_add_raw(hb, "-", 1);
+        p = format_number(last, buf);
+        header_add_raw(hb, p, buf + NUMBER_SIZE - 1 - p);
+        header_add_raw(hb, "/", 1);
+    } /* end if */
+    p = format_number(size, buf);
+    header_add_raw(hb, p, buf + NUMBER_SIZE - 1 - p);
+    header_add_raw(hb, "\r\n", 2);
+} /* end of header_add_range */
+
+/**
+ * Terminate the header with an empty line.
+ * @input_param     the builder
+ * @return          the length of the header, -1 if it does not fit
+ */
+int
+header_finish(header_builder_t *hb) {
+    header_add_raw(hb, "\r\n", 2);
+    return hb->overflow ? -1 : (int) hb->len;
+} /* end of header_finish */
@@ -0,0 +1,45 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _HEADER_BUILDER_H
+#define _HEADER_BUILDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "http.h"
+
+#define SERVER_NAME                 "Tinyweb 1.1"
+
+
+/*
+ * Appends header lines to a caller-provided buffer. Nothing is
+ * written beyond the buffer, an overflow is reported at the end.
+ */
+typedef struct header_builder {
+    char    *buf;
+    size_t   size;
+    size_t   len;
+    bool     overflow;
+} header_builder_t;
+
+
+extern void header_init(header_builder_t *hb, char *buf, size_t size);
+extern void header_add_status(header_builder_t *hb, http_status_t status);
+extern void header_add_status_code(header_builder_t *hb, int code, const char *text, size_t len);
+extern void header_add_raw(header_builder_t *hb, const char *s, size_t len);
+extern void header_add_field(header_builder_t *hb, http_header_field_t field, const char *value);
+extern void header_add_number(header_builder_t *hb, http_header_field_t field, long long value);
+extern void header_add_time(header_builder_t *hb, http_header_field_t field, time_t t);
+extern void header_add_range(header_builder_t *hb, off_t first, off_t last, off_t size);
+extern int header_finish(header_builder_t *hb);
+
+#endif
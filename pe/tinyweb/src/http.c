@@ -40,9 +40,15 @@ http_status_entry_t http_status_list[] = {
     { 400, "Bad Request"                     },  // HTTP_STATUS_BAD_REQUEST
     { 403, "Forbidden"                       },  // HTTP_STATUS_FORBIDDEN
     { 404, "Not Found"                       },  // HTTP_STATUS_NOT_FOUND
+    { 412, "Precondition Failed"             },  // HTTP_STATUS_PRECONDITION_FAILED
+    { 414, "URI Too Long"                    },  // HTTP_STATUS_URI_TOO_LONG
     { 416, "Requested Range Not Satisfiable" },  // HTTP_STATUS_RANGE_NOT_SATISFIABLE
+    { 431, "Request Header Fields Too Large" },  // HTTP_STATUS_HEADER_TOO_LARGE
     { 500, "Internal Server Error"           },  // HTTP_STATUS_INTERNAL_SERVER_ERROR
-    { 501, "Not Implemented"                 }   // HTTP_STATUS_NOT_IMPLEMENTED
+    { 501, "Not Implemented"                 },  // HTTP_STATUS_NOT_IMPLEMENTED
+    { 502, "Bad Gateway"                     },  // HTTP_STATUS_BAD_GATEWAY
+    { 503, "Service Unavailable"             },  // HTTP_STATUS_SERVICE_UNAVAILABLE
+    { 504, "Gateway Timeout"                 }   // HTTP_STATUS_GATEWAY_TIMEOUT
 };
 
 char* http_header_field_list[] = {
@@ -54,5 +60,10 @@ char* http_header_field_list[] = {
     "Connection: ",
     "Accept-Ranges: ",
     "Location: ",
-    "Content-Range: "
+    "Content-Range: ",
+    "Retry-After: ",
+    "Transfer-Encoding: ",
+    "Content-Encoding: ",
+    "Vary: ",
+    "ETag: "
 };
\ No newline at end of file
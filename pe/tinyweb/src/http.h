@@ -10,6 +10,9 @@
 #ifndef _HTTP_H
 #define _HTTP_H
 
+#include <time.h>
+#include <sys/types.h>
+
 typedef enum http_method {
     HTTP_METHOD_GET = 0,
     HTTP_METHOD_HEAD,
@@ -28,12 +31,37 @@ typedef enum http_status {
     HTTP_STATUS_BAD_REQUEST,               // 400
     HTTP_STATUS_FORBIDDEN,                 // 401
     HTTP_STATUS_NOT_FOUND,                 // 404
+    HTTP_STATUS_PRECONDITION_FAILED,       // 412
+    HTTP_STATUS_URI_TOO_LONG,              // 414
     HTTP_STATUS_RANGE_NOT_SATISFIABLE,     // 416
+    HTTP_STATUS_HEADER_TOO_LARGE,          // 431
     HTTP_STATUS_INTERNAL_SERVER_ERROR,     // 500
-    HTTP_STATUS_NOT_IMPLEMENTED            // 501
+    HTTP_STATUS_NOT_IMPLEMENTED,           // 501
+    HTTP_STATUS_BAD_GATEWAY,               // 502
+    HTTP_STATUS_SERVICE_UNAVAILABLE,       // 503
+    HTTP_STATUS_GATEWAY_TIMEOUT,           // 504
+    HTTP_STATUS_COUNT                      // number of entries in http_status_list
 } http_status_t;
 
 
+typedef enum http_header_field {
+    HTTP_HEADER_DATE = 0,
+    HTTP_HEADER_SERVER,
+    HTTP_HEADER_LAST_MODIFIED,
+    HTTP_HEADER_CONTENT_LENGTH,
+    HTTP_HEADER_CONTENT_TYPE,
+    HTTP_HEADER_CONNECTION,
+    HTTP_HEADER_ACCEPT_RANGES,
+    HTTP_HEADER_LOCATION,
+    HTTP_HEADER_CONTENT_RANGE,
+    HTTP_HEADER_RETRY_AFTER,
+    HTTP_HEADER_TRANSFER_ENCODING,
+    HTTP_HEADER_CONTENT_ENCODING,
+    HTTP_HEADER_VARY,
+    HTTP_HEADER_ETAG
+} http_header_field_t;
+
+
 typedef struct http_method_entry {
     char          *name;
     http_method_t  method;
@@ -46,17 +74,24 @@ typedef struct http_status_entry {
 } http_status_entry_t;
 
 
+/*
+ * Description of a response header, the header builder writes the
+ * fields which are set
+ */
 typedef struct http_header {
-    http_status_entry_t status;
-    char    *date;
-    char    *server;
-    char    *last_modified;
-    char    *content_length;
-    char    *content_type;
-    char    *connection;
-    char    *accept_ranges;
-    char    *content_location;
-    char    *content_range;
+    http_status_t    status;
+    off_t            content_length;    // -1 if not sent
+    char            *content_type;
+    const char      *content_encoding;  // NULL if not sent
+    const char      *vary;              // NULL if not sent
+    time_t           last_modified;     // 0 if not sent
+    const char      *etag;              // NULL if not sent
+    char            *location;
+    off_t            range_first;       // Content-Range, if range_size >= 0
+    off_t            range_last;
+    off_t            range_size;
+    const char      *cached_fields;     // prebuilt Content-Length, -Type and Last-Modified
+    size_t           cached_len;
 } http_header_t;
 
 
@@ -0,0 +1,333 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "http_date.h"
+
+/*
+ * HTTP-dates (RFC 7231, section 7.1.1.1) in UTC with integer
+ * arithmetic on the proleptic Gregorian calendar, independent of the
+ * locale and of TZ. The conversion between days and dates follows
+ * Howard Hinnant's days_from_civil() and civil_from_days().
+ */
+#define SECONDS_PER_DAY         86400
+#define MIN_TIME                (-62167219200LL)    // 0000-01-01T00:00:00
+#define MAX_TIME                253402300799LL      // 9999-12-31T23:59:59
+
+
+static const char *day_names[7] = {
+    "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+};
+
+static const char *long_day_names[7] = {
+    "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"
+};
+
+static const char *month_names[12] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+
+/*
+ * The fields of a date while it is parsed
+ */
+typedef struct http_date {
+    int     wday;
+    int     day;
+    int     month;      // 1 to 12
+    long    year;
+    int     hour;
+    int     min;
+    int     sec;
+} http_date_t;
+
+
+/**
+ * Count the days from 1970-01-01 to a date.
+ * @input_param     the year
+ * @input_param     the month, 1 to 12
+ * @input_param     the day of the month
+ * @return          the days, negative before 1970
+ */
+static long long
+days_from_civil(long year, int month, int day) {
+    long era, yoe, doy, doe;
+
+    year -= (month <= 2);
+    era = (year >= 0 ? year : year - 399) / 400;
+    yoe = year - era * 400;
+    doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (long long) era * 146097 + doe - 719468;
+} /* end of days_from_civil */
+
+/**
+ * Turn the days since 1970-01-01 into a date.
+ * @input_param     the days
+ * @output_param    the year, month and day of the date
+ */
+static void
+civil_from_days(long long days, http_date_t *date) {
+    long long era, doe, yoe, doy, mp;
+
+    days += 719468;
+    era = (days >= 0 ? days : days - 146096) / 146097;
+    doe = days - era * 146097;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    date->day = doy - (153 * mp + 2) / 5 + 1;
+    date->month = mp < 10 ? mp + 3 : mp - 9;
+    date->year = yoe + era * 400 + (date->month <= 2);
+} /* end of civil_from_days */
+
+/**
+ * Get the number of days of a month.
+ * @input_param     the year
+ * @input_param     the month, 1 to 12
+ * @return          the days
+ */
+static int
+days_in_month(long year, int month) {
+    static const int days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+    if (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)) {
+        return 29;
+    } /* end if */
+    return days[month - 1];
+} /* end of days_in_month */
+
+/**
+ * Write two digits.
+ * @output_param    the buffer
+ * @input_param     the value, 0 to 99
+ */
+static void
+put2(char *p, int value) {
+    p[0] = '0' + value / 10;
+    p[1] = '0' + value % 10;
+} /* end of put2 */
+
+/**
+ * Format a time as IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+ * Times before year 0 or after 9999 are clamped.
+ * @input_param     the time
+ * @output_param    the date, at least HTTP_DATE_LEN + 1 bytes
+ */
+void
+http_date_format(time_t t, char *buf) {
+    long long secs = t;
+    long long days;
+    long long rest;
+    http_date_t date;
+
+    if (secs < MIN_TIME) {
+        secs = MIN_TIME;
+    } else if (secs > MAX_TIME) {
+        secs = MAX_TIME;
+    } /* end if */
+    days = (secs >= 0 ? secs : secs - (SECONDS_PER_DAY - 1)) / SECONDS_PER_DAY;
+    rest = secs - days * SECONDS_PER_DAY;
+    civil_from_days(days, &date);
+
+    // 1970-01-01 was a Thursday
+    memcpy(buf, day_names[((days % 7) + 11) % 7], 3);
+    buf[3] = ',';
+    buf[4] = ' ';
+    put2(buf + 5, date.day);
+    buf[7] = ' ';
+    memcpy(buf + 8, month_names[date.month - 1], 3);
+    buf[11] = ' ';
+    put2(buf + 12, date.year / 100);
+    put2(buf + 14, date.year % 100);
+    buf[16] = ' ';
+    put2(buf + 17, rest / 3600);
+    buf[19] = ':';
+    put2(buf + 20, rest / 60 % 60);
+    buf[22] = ':';
+    put2(buf + 23, rest % 60);
+    memcpy(buf + 25, " GMT", 5);
+} /* end of http_date_format */
+
+/**
+ * Read a fixed number of digits.
+ * @input_param     the current position, advanced behind the digits
+ * @input_param     the end of the input
+ * @input_param     the number of digits
+ * @output_param    the value
+ * @return          zero if there are fewer digits
+ */
+static int
+get_digits(const char **p, const char *end, int count, long *value) {
+    int i;
+
+    if (end - *p < count) {
+        return 0;
+    } /* end if */
+    *value = 0;
+    for (i = 0; i < count; i++) {
+        if ((*p)[i] < '0' || (*p)[i] > '9') {
+            return 0;
+        } /* end if */
+        *value = *value * 10 + ((*p)[i] - '0');
+    } /* end for */
+    *p += count;
+    return 1;
+} /* end of get_digits */
+
+/**
+ * Match a literal.
+ * @input_param     the current position, advanced behind the literal
+ * @input_param     the end of the input
+ * @input_param     the literal
+ * @return          zero if it does not match
+ */
+static int
+get_literal(const char **p, const char *end, const char *literal) {
+    size_t n = strlen(literal);
+
+    if ((size_t) (end - *p) < n || memcmp(*p, literal, n) != 0) {
+        return 0;
+    } /* end if */
+    *p += n;
+    return 1;
+} /* end of get_literal */
+
+/**
+ * Match a name of a list, the names are case-sensitive.
+ * @input_param     the current position, advanced behind the name
+ * @input_param     the end of the input
+ * @input_param     the list
+ * @input_param     the number of names
+ * @return          the index, -1 if no name matches
+ */
+static int
+get_name(const char **p, const char *end, const char **names, int count) {
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (get_literal(p, end, names[i])) {
+            return i;
+        } /* end if */
+    } /* end for */
+
+    return -1;
+} /* end of get_name */
+
+/**
+ * Read the time of day "HH:MM:SS".
+ * @input_param     the current position, advanced behind the time
+ * @input_param     the end of the input
+ * @output_param    the date
+ * @return          zero if malformed
+ */
+static int
+get_time_of_day(const char **p, const char *end, http_date_t *date) {
+    long hour, min, sec;
+
+    if (!get_digits(p, end, 2, &hour) || !get_literal(p, end, ":")
+            || !get_digits(p, end, 2, &min) || !get_literal(p, end, ":")
+            || !get_digits(p, end, 2, &sec)) {
+        return 0;
+    } /* end if */
+    date->hour = hour;
+    date->min = min;
+    date->sec = sec;
+    return 1;
+} /* end of get_time_of_day */
+
+/**
+ * Parse an HTTP-date: the preferred IMF-fixdate and the obsolete
+ * RFC 850 and asctime() formats, all of them in UTC. The fields are
+ * checked, so is the day of the week.
+ * @input_param     the date
+ * @input_param     the length of the date
+ * @output_param    the time, unchanged if the date is malformed
+ * @return          zero if the date is malformed
+ */
+int
+http_date_parse(const char *s, size_t len, time_t *t) {
+    const char *p = s;
+    const char *end = s + len;
+    http_date_t date;
+    long value;
+    long long days;
+
+    // the character behind the day of the week tells the format
+    if (len > 3 && s[3] != ',' && s[3] != ' ') {
+        // RFC 850: "Sunday, 06-Nov-94 08:49:37 GMT"
+        date.wday = get_name(&p, end, long_day_names, 7);
+        if (date.wday < 0 || !get_literal(&p, end, ", ") || !get_digits(&p, end, 2, &value)) {
+            return 0;
+        } /* end if */
+        date.day = value;
+        if (!get_literal(&p, end, "-") || (date.month = get_name(&p, end, month_names, 12) + 1) == 0
+                || !get_literal(&p, end, "-") || !get_digits(&p, end, 2, &value)) {
+            return 0;
+        } /* end if */
+        // a two digit year is taken from 1970 to 2069
+        date.year = value + (value < 70 ? 2000 : 1900);
+        if (!get_literal(&p, end, " ") || !get_time_of_day(&p, end, &date)
+                || !get_literal(&p, end, " GMT")) {
+            return 0;
+        } /* end if */
+    } else {
+        date.wday = get_name(&p, end, day_names, 7);
+        if (date.wday < 0) {
+            return 0;
+        } else if (get_literal(&p, end, ", ")) {
+            // IMF-fixdate: "Sun, 06 Nov 1994 08:49:37 GMT"
+            if (!get_digits(&p, end, 2, &value)) {
+                return 0;
+            } /* end if */
+            date.day = value;
+            if (!get_literal(&p, end, " ") || (date.month = get_name(&p, end, month_names, 12) + 1) == 0
+                    || !get_literal(&p, end, " ") || !get_digits(&p, end, 4, &date.year)
+                    || !get_literal(&p, end, " ") || !get_time_of_day(&p, end, &date)
+                    || !get_literal(&p, end, " GMT")) {
+                return 0;
+            } /* end if */
+        } else {
+            // asctime(): "Sun Nov  6 08:49:37 1994"
+            if (!get_literal(&p, end, " ") || (date.month = get_name(&p, end, month_names, 12) + 1) == 0
+                    || !get_literal(&p, end, " ")) {
+                return 0;
+            } /* end if */
+            if (p < end && *p == ' ') {
+                p++;
+                if (!get_digits(&p, end, 1, &value)) {
+                    return 0;
+                } /* end if */
+            } else if (!get_digits(&p, end, 2, &value)) {
+                return 0;
+            } /* end if */
+            date.day = value;
+            if (!get_literal(&p, end, " ") || !get_time_of_day(&p, end, &date)
+                    || !get_literal(&p, end, " ") || !get_digits(&p, end, 4, &date.year)) {
+                return 0;
+            } /* end if */
+        } /* end if */
+    } /* end if */
+
+    // a leap second is accepted as the first second of the next minute
+    if (p != end || date.day < 1 || date.day > days_in_month(date.year, date.month)
+            || date.hour > 23 || date.min > 59 || date.sec > 60) {
+        return 0;
+    } /* end if */
+    days = days_from_civil(date.year, date.month, date.day);
+    if (((days % 7) + 11) % 7 != date.wday) {
+        return 0;
+    } /* end if */
+
+    *t = days * SECONDS_PER_DAY + date.hour * 3600 + date.min * 60 + date.sec;
+    return 1;
+} /* end of http_date_parse */
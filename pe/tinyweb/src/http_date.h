@@ -0,0 +1,22 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _HTTP_DATE_H
+#define _HTTP_DATE_H
+
+#include <stddef.h>
+#include <time.h>
+
+#define HTTP_DATE_LEN          29   // "Sun, 06 Nov 1994 08:49:37 GMT"
+
+
+extern void http_date_format(time_t t, char *buf);
+extern int http_date_parse(const char *s, size_t len, time_t *t);
+
+#endif
@@ -7,208 +7,612 @@
  *
  *===================================================================*/
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <string.h>
-#include <stdlib.h>
-#include <sys/types.h>
-#include <regex.h>
-#define __USE_XOPEN
-//#define _GNU_SOURCE
-//#define _XOPEN_SOURCE /* Pour GlibC2 */
+#include <strings.h>
 #include <time.h>
 #include <ctype.h>
-#include <math.h>
+#if defined(__SSE2__) && !defined(HTTP_PARSER_SCALAR)
+#include <emmintrin.h>
+#define HTTP_PARSER_SSE2
+#endif
 
 
 #include "http_parser.h"
 #include "safe_print.h"
 #include "tinyweb.h"
 #include "http.h"
+#include "http_date.h"
 
-#define MAX_MATCHES 1
 #define TRUE 1;
 #define FALSE 0;
 
+/*
+ * Characters of a method token (RFC 7230, section 3.2.6)
+ */
+#define IS_TCHAR(c)     (isalnum((unsigned char) (c)) || strchr("!#$%&'*+-.^_`|~", (c)) != NULL)
+#define IS_BLANK(c)     ((c) == ' ' || (c) == '\t')
+
+#define FIELD_SLOTS     16      // a power of two, see field_hash()
+
+
+/*
+ * The header fields the server implements
+ */
+typedef enum http_field {
+    HTTP_FIELD_UNKNOWN = 0,
+    HTTP_FIELD_HOST,
+    HTTP_FIELD_RANGE,
+    HTTP_FIELD_IF_MATCH,
+    HTTP_FIELD_IF_RANGE,
+    HTTP_FIELD_CONNECTION,
+    HTTP_FIELD_IF_NONE_MATCH,
+    HTTP_FIELD_ACCEPT_ENCODING,
+    HTTP_FIELD_IF_MODIFIED_SINCE
+} http_field_t;
+
+
+typedef struct http_field_entry {
+    const char     *name;       // lower case
+    size_t          len;        // length of the name
+    http_field_t    field;
+} http_field_entry_t;
+
+
+/*
+ * The known names by field_hash(), which has no collisions for them.
+ * Any other name hashes to a slot holding a different name or none.
+ */
+static const http_field_entry_t field_table[FIELD_SLOTS] = {
+    [0]  = { "host",               4, HTTP_FIELD_HOST              },
+    [6]  = { "if-range",           8, HTTP_FIELD_IF_RANGE          },
+    [7]  = { "accept-encoding",   15, HTTP_FIELD_ACCEPT_ENCODING   },
+    [9]  = { "if-match",           8, HTTP_FIELD_IF_MATCH          },
+    [11] = { "connection",        10, HTTP_FIELD_CONNECTION        },
+    [12] = { "range",              5, HTTP_FIELD_RANGE             },
+    [14] = { "if-none-match",     13, HTTP_FIELD_IF_NONE_MATCH     },
+    [15] = { "if-modified-since", 17, HTTP_FIELD_IF_MODIFIED_SINCE },
+};
+
+
+/**
+ * Check whether a slice equals a string.
+ * @input_param     the slice
+ * @input_param     the string
+ * @return          unequal zero if equal
+ */
+static int
+slice_equals(http_slice_t slice, const char *s) {
+    return strlen(s) == slice.len && memcmp(slice.ptr, s, slice.len) == 0;
+} /* end of slice_equals */
+
 /**
- * parse the http header
- * @param 	the header as char pointer
- * @return 	the parsed header defined in http_parser.h
+ * Classify the request method with the method list of http.c.
+ * @input_param     the method token
+ * @return          the method, HTTP_METHOD_UNKNOWN if not listed
  */
-parsed_http_header_t
-parse_http_header(char *header) {
+static http_method_t
+classify_method(http_slice_t method) {
+    int i;
 
-    parsed_http_header_t parsed_header;
+    for (i = 0; http_method_list[i].name != NULL; i++) {
+        if (slice_equals(method, http_method_list[i].name)) {
+            return http_method_list[i].method;
+        } /* end if */
+    } /* end for */
 
-    //Initialize State with ERROR and modsince with 0
-    parsed_header.httpState = HTTP_STATUS_INTERNAL_SERVER_ERROR;
-    parsed_header.modsince = 0;
-    parsed_header.isCGI = FALSE;
-    parsed_header.byteStart = -2;
-    parsed_header.byteEnd = -2;
-
-    char *pointer; /* Helds actual processing string */
-
-    /*
-     *  Create and compile regex to validate a correct status line
-     */
-    regex_t exp;
-    int rv = regcomp(&exp, "^\\(GET\\|HEAD\\|POST\\|PUT\\|DELETE\\|TRACE\\|CONNECT\\|OPTIONS\\|DUMMY\\)"
-            "[[:blank:]]"
-            "/\\([[:alnum:]]\\|/\\|-\\)\\{0,\\}\\([[:punct:]][[:alnum:]]\\{1,\\}\\)\\{0,1\\}"
-            "[[:blank:]]"
-            "HTTP/[[:digit:]][[:punct:]][[:digit:]]\r$", REG_NEWLINE);
-    if (rv != 0) {
-        err_print("ERROR: parser regex statusline compile");
-        parsed_header.httpState = HTTP_STATUS_INTERNAL_SERVER_ERROR;
-        return parsed_header;
-    }
-    regmatch_t matches[MAX_MATCHES];
-    if (regexec(&exp, header, MAX_MATCHES, matches, 0) == 0) {
-        if (matches[0].rm_so == 0) { /* Match begins von first char */
-            regfree(&exp);
-            char delimiter[] = " ";
-            pointer = strtok(header, delimiter); /* pointer points to http method */
-            parsed_header.method = malloc(strlen(pointer) + 1);
-            if (parsed_header.method == NULL) {
-                err_print("ERROR: cant allocate memory");
-                parsed_header.httpState = HTTP_STATUS_INTERNAL_SERVER_ERROR;
-                return parsed_header;
-            }
-            strcpy(parsed_header.method, pointer);
-            pointer = strtok(NULL, delimiter); /* pointer points to requested file */
-            if (strlen(pointer) == 1) { /* If no file is requested */
-                parsed_header.filename = DEFAULT_HTML_PAGE;
-            } else {
-                parsed_header.filename = malloc(strlen(pointer) + 1);
-                if (parsed_header.filename == NULL) {
-                    err_print("ERROR: cant allocate memory");
-                    parsed_header.httpState = HTTP_STATUS_INTERNAL_SERVER_ERROR;
-                    return parsed_header;
-                }
-                strcpy(parsed_header.filename, pointer);
-                regex_t cgiReg;
-                int rv = regcomp(&cgiReg, "^/cgi-bin", REG_ICASE);
-                if (rv != 0) {
-                    err_print("ERROR: parser regex cgi compile");
-                    parsed_header.httpState = HTTP_STATUS_INTERNAL_SERVER_ERROR;
-                    return parsed_header;
-                }
-                if (regexec(&cgiReg, parsed_header.filename, MAX_MATCHES, matches, 0) == 0) {
-                    parsed_header.isCGI = TRUE;
-                }
-            }
-            pointer = strtok(NULL, "\r"); /* \r is char before end */
-            parsed_header.protocol = malloc(strlen(pointer) + 1);
-            if (parsed_header.protocol == NULL) {
-                    err_print("ERROR: cant allocate memory");
-                    parsed_header.httpState = HTTP_STATUS_INTERNAL_SERVER_ERROR;
-                    return parsed_header;
-                }
-            strcpy(parsed_header.protocol, pointer);
-
-            if (strcmp(parsed_header.protocol, "HTTP/1.1") != 0) { //the only allowed Header
-                parsed_header.httpState = HTTP_STATUS_BAD_REQUEST;
-                return parsed_header;
-            } else if (!((strcmp(parsed_header.method, "GET") == 0) || (strcmp(parsed_header.method, "HEAD") == 0))) {
-                parsed_header.httpState = HTTP_STATUS_NOT_IMPLEMENTED;
-                return parsed_header;
-            } else {
-                //Status line is correct
-                parsed_header.httpState = HTTP_STATUS_OK;
-            }
-            //End of parsing status line
-
-            //Start of parsing further header lines
-            /*
-             * Create and compile regex to parse range line
-             */
-            regex_t rangeRegex;
-            int rv = regcomp(&rangeRegex, "^Range"
-                    "[[:blank:]]\\{0,\\}"
-                    ":[[:blank:]]\\{0,\\}"
-                    "bytes="
-                    "\\("
-                    "\\([[:digit:]]\\{1,\\}-[[:digit:]]\\{0,\\}\\)"
-                    "\\|"
-                    "\\(-[[:digit:]]\\{1,\\}\\)"
-                    "\\)", REG_ICASE);
-
-            if (rv != 0) {
-                err_print("ERROR: parser regex range compile");
-                parsed_header.httpState = HTTP_STATUS_INTERNAL_SERVER_ERROR;
-                return parsed_header;
-            }
-
-            /*
-             * Check for further Header lines
-             * If-Modified-Since and Range is implemented
-             */
-            pointer = strtok(NULL, "\n");
-            while (pointer != NULL) {
-                struct tm tm;
-                char *ret = strptime(pointer, "If-Modified-Since: %a, %d %b %Y %H:%M:%S", &tm);
-                if (ret != NULL) {
-                    time_t t = mktime(&tm);
-                    parsed_header.modsince = t;
-                }
-
-                if (regexec(&rangeRegex, pointer, MAX_MATCHES, matches, 0) == 0) {
-                    int matchEnd = matches[0].rm_eo; /* Get Index of last matching char */
-                    int i = 0;
-                    int pos = 1; /* Parameter to set chars to right position */
-                    int startValue = -1; /* -1 is not set */
-                    int endValue = -1; /* -1 is not set */
-
-                    int c = (int) (pointer[matchEnd - i - 1] - '0'); /* get last char */
-
-                    if (c >= 0 && c <= 9) { /* If second value is set, change value to zero */
-                        endValue = 0;
-                    }
-                    //last char is either a "-" or a digit
-                    while (c >= 0 && c <= 9) { /* while Digit */
-                        int temp = c;
-                        endValue = endValue + temp * pos;
-                        i++;
-                        pos = pos * 10;
-                        c = (int) (pointer[matchEnd - i - 1] - '0');
-                    }
-                    //Increase Index, because of -
-                    i++;
-                    pos = 1; /* Reset positon parameter for first value */
-                    c = (int) (pointer[matchEnd - i - 1] - '0');
-                    if (c >= 0 && c <= 9) {
-                        startValue = 0;
-                    }
-                    while (c >= 0 && c <= 9) { /* Get first value */
-                        int temp = c;
-                        startValue = startValue + temp * pos;
-                        i++;
-                        pos = pos * 10;
-                        c = (int) (pointer[matchEnd - i - 1] - '0');
-                    }
-
-                    /* Write data for return*/
-                    parsed_header.httpState = HTTP_STATUS_RANGE_NOT_SATISFIABLE;
-                    parsed_header.byteStart = startValue;
-                    parsed_header.byteEnd = endValue;
-
-                    //Check Status
-                    if (startValue == -1 && endValue > 0) {
-                        parsed_header.httpState = HTTP_STATUS_PARTIAL_CONTENT;
-                    } else if (startValue >= 0 && endValue == -1) {
-                        parsed_header.httpState = HTTP_STATUS_PARTIAL_CONTENT;
-                    } else if (startValue >= 0 && endValue > 0 && startValue < endValue) {
-                        parsed_header.httpState = HTTP_STATUS_PARTIAL_CONTENT;
-                    }
-                } //end of parsing range
-                pointer = strtok(NULL, "\n");
-            }
+    return HTTP_METHOD_UNKNOWN;
+} /* end of classify_method */
+
+/**
+ * Get the value of a hex digit.
+ * @input_param     the character
+ * @return          the value, -1 if it is no hex digit
+ */
+static int
+hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    } /* end if */
+    return -1;
+} /* end of hex_value */
+
+/**
+ * Check whether a path is left as it is by normalize_path(): it has no
+ * escape, no duplicate slash and no segment starting with a dot.
+ * @input_param     the path, starting with a slash
+ * @input_param     the length of the path
+ * @return          zero if the path may be rewritten
+ */
+static int
+path_is_normal(const char *path, size_t len) {
+    size_t i;
 
+    for (i = 0; i < len; i++) {
+        if (path[i] == '%' || (path[i] == '/' && i + 1 < len && (path[i + 1] == '/' || path[i + 1] == '.'))) {
+            return FALSE;
+        } /* end if */
+    } /* end for */
+
+    return TRUE;
+} /* end of path_is_normal */
+
+/**
+ * Normalize a request path in place: decode the percent escapes,
+ * collapse duplicate slashes and remove the dot segments (RFC 3986,
+ * section 5.2.4). The result is never longer than the path, so it
+ * fits into the receive buffer. A path ending in a directory keeps
+ * its trailing slash.
+ * @input_param     the path, starting with a slash
+ * @input_param     the length of the path
+ * @output_param    the length of the normalized path
+ * @return          zero if the path has a malformed escape, a control
+ *                  character or a ".." leaving the document root
+ */
+static int
+normalize_path(char *path, size_t *len) {
+    char *end = path + *len;
+    char *src;
+    char *seg;
+    char *w = path;
+    size_t seglen;
+    int dir = FALSE;
+    int hi, lo;
+    char c;
+
+    // decode and collapse the slashes
+    for (src = path; src < end; src++) {
+        c = *src;
+        if (c == '%') {
+            if (end - src < 3 || (hi = hex_value(src[1])) < 0 || (lo = hex_value(src[2])) < 0) {
+                return FALSE;
+            } /* end if */
+            c = (char) (hi * 16 + lo);
+            src += 2;
+        } /* end if */
+        if ((unsigned char) c < ' ' || c == 0x7f) {
+            return FALSE;
+        } /* end if */
+        if (c == '/' && w > path && w[-1] == '/') {
+            continue;
+        } /* end if */
+        *w++ = c;
+    } /* end for */
+
+    // remove the dot segments, the writer never passes the reader
+    end = w;
+    w = path;
+    src = path;
+    while (src < end) {
+        seg = ++src;
+        while (src < end && *src != '/') {
+            src++;
+        } /* end while */
+        seglen = src - seg;
+        if (seglen == 0 || (seglen == 1 && seg[0] == '.')) {
+            dir = TRUE;
+        } else if (seglen == 2 && seg[0] == '.' && seg[1] == '.') {
+            if (w == path) {
+                return FALSE;
+            } /* end if */
+            while (*--w != '/') {
+            } /* end while */
+            dir = TRUE;
         } else {
-            parsed_header.httpState = HTTP_STATUS_BAD_REQUEST;
-        }
-    } else {
-        parsed_header.httpState = HTTP_STATUS_BAD_REQUEST;
-    }
-    return parsed_header;
+            *w++ = '/';
+            memmove(w, seg, seglen);
+            w += seglen;
+            dir = FALSE;
+        } /* end if */
+    } /* end while */
+    if (w == path || dir) {
+        *w++ = '/';
+    } /* end if */
+
+    *len = w - path;
+    return TRUE;
+} /* end of normalize_path */
+
+/**
+ * Parse the request line "METHOD SP /path SP HTTP/x.y CR".
+ * @input_param     the parsed header to fill in
+ * @input_param     the line without the line feed
+ * @input_param     the length of the line
+ * @return          zero if the line is malformed
+ */
+static int
+parse_request_line(parsed_http_header_t *parsed_header, char *line, size_t len) {
+    char *p = line;
+    char *end;
+    char *target;
+    char *query;
+    char *copy;
+    size_t target_len;
+
+    if (len == 0 || line[len - 1] != '\r') {
+        return FALSE;
+    } /* end if */
+    end = line + len - 1;
+
+    // method
+    while (p < end && IS_TCHAR(*p)) {
+        p++;
+    } /* end while */
+    if (p == line || p == end || !IS_BLANK(*p)) {
+        return FALSE;
+    } /* end if */
+    parsed_header->method.ptr = line;
+    parsed_header->method.len = p - line;
+    p++;
+
+    // request target, an absolute path with an optional query
+    if (p == end || *p != '/') {
+        return FALSE;
+    } /* end if */
+    target = p;
+    query = NULL;
+    while (p < end && *p > ' ' && *p < 0x7f) {
+        if (*p == '?' && query == NULL) {
+            query = p;
+        } /* end if */
+        p++;
+    } /* end while */
+    if (p == end || !IS_BLANK(*p)) {
+        return FALSE;
+    } /* end if */
+    parsed_header->target.ptr = target;
+    parsed_header->target.len = p - target;
+    target_len = (query != NULL ? query : p) - target;
+    if (query != NULL) {
+        parsed_header->query.ptr = query + 1;
+        parsed_header->query.len = p - query - 1;
+    } /* end if */
+    p++;
+
+    // protocol
+    if (end - p != 8 || memcmp(p, "HTTP/", 5) != 0
+            || !isdigit((unsigned char) p[5]) || !ispunct((unsigned char) p[6])
+            || !isdigit((unsigned char) p[7])) {
+        return FALSE;
+    } /* end if */
+    parsed_header->protocol.ptr = p;
+    parsed_header->protocol.len = 8;
+
+    // the path is confined to the document root before anything looks at it, the target is kept
+    if (!path_is_normal(target, target_len)) {
+        copy = (parsed_header->target_alloc != NULL)
+                ? parsed_header->target_alloc(parsed_header->target_ctx, parsed_header->target.len) : NULL;
+        if (copy != NULL) {
+            memcpy(copy, target, parsed_header->target.len);
+        } /* end if */
+        parsed_header->target.ptr = copy;
+    } /* end if */
+    if (!normalize_path(target, &target_len)) {
+        return FALSE;
+    } /* end if */
+    parsed_header->filename.ptr = target;
+    parsed_header->filename.len = target_len;
+    if (parsed_header->target.ptr == NULL) {
+        parsed_header->target = parsed_header->filename;
+    } /* end if */
+
+    return TRUE;
+} /* end of parse_request_line */
+
+/**
+ * Check the status line fields of a well-formed request line.
+ * @input_param     the parsed header
+ */
+static void
+check_request_line(parsed_http_header_t *parsed_header) {
+    parsed_header->methodType = classify_method(parsed_header->method);
+
+    if (!slice_equals(parsed_header->protocol, "HTTP/1.1")) { //the only allowed Header
+        parsed_header->httpState = HTTP_STATUS_BAD_REQUEST;
+        return;
+    } else if (parsed_header->methodType != HTTP_METHOD_GET && parsed_header->methodType != HTTP_METHOD_HEAD) {
+        parsed_header->httpState = HTTP_STATUS_NOT_IMPLEMENTED;
+        return;
+    } /* end if */
+
+    //Status line is correct
+    parsed_header->httpState = HTTP_STATUS_OK;
+    //HTTP/1.1 connections are persistent by default
+    parsed_header->keepAlive = TRUE;
+
+    if (parsed_header->filename.len == 1) { /* If no file is requested */
+        parsed_header->filename.ptr = DEFAULT_HTML_PAGE;
+        parsed_header->filename.len = strlen(DEFAULT_HTML_PAGE);
+    } else if (parsed_header->filename.len >= 8
+            && strncasecmp(parsed_header->filename.ptr, "/cgi-bin", 8) == 0
+            && (parsed_header->filename.len == 8 || parsed_header->filename.ptr[8] == '/')) {
+        parsed_header->isCGI = TRUE;
+    } /* end if */
+} /* end of check_request_line */
+
+/**
+ * Hash a field name by its length and its first and last character,
+ * ignoring case.
+ * @input_param     the name
+ * @input_param     the length of the name, at least one
+ * @return          the slot in field_table
+ */
+static unsigned int
+field_hash(const char *name, size_t len) {
+    return (len + tolower((unsigned char) name[0]) + tolower((unsigned char) name[len - 1]))
+            & (FIELD_SLOTS - 1);
+} /* end of field_hash */
+
+/**
+ * Identify a field name with a single probe of the perfect hash.
+ * @input_param     the name
+ * @input_param     the length of the name
+ * @return          the field, HTTP_FIELD_UNKNOWN if not implemented
+ */
+static http_field_t
+lookup_field(const char *name, size_t len) {
+    const http_field_entry_t *entry;
+
+    if (len == 0) {
+        return HTTP_FIELD_UNKNOWN;
+    } /* end if */
+    entry = &field_table[field_hash(name, len)];
+    if (entry->name == NULL || entry->len != len || strncasecmp(entry->name, name, len) != 0) {
+        return HTTP_FIELD_UNKNOWN;
+    } /* end if */
+
+    return entry->field;
+} /* end of lookup_field */
+
+/**
+ * Find the end of a line and the first colon on it in one pass, 16
+ * bytes at a time where SSE2 is available.
+ * @input_param     the start of the line
+ * @input_param     the end of the received data
+ * @output_param    the first colon before the line feed, NULL if none
+ * @return          the line feed, NULL if the line is incomplete
+ */
+static char *
+scan_line(char *p, const char *end, char **colon) {
+#ifdef HTTP_PARSER_SSE2
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i sep = _mm_set1_epi8(':');
+    __m128i block;
+    unsigned int lf_mask, sep_mask;
+#endif
+
+    *colon = NULL;
+#ifdef HTTP_PARSER_SSE2
+    while (end - p >= 16) {
+        block = _mm_loadu_si128((const __m128i *) p);
+        lf_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, lf));
+        sep_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, sep));
+        if (lf_mask != 0) {
+            // only a colon in front of the line feed counts
+            sep_mask &= (lf_mask & -lf_mask) - 1;
+        } /* end if */
+        if (*colon == NULL && sep_mask != 0) {
+            *colon = p + __builtin_ctz(sep_mask);
+        } /* end if */
+        if (lf_mask != 0) {
+            return p + __builtin_ctz(lf_mask);
+        } /* end if */
+        p += 16;
+    } /* end while */
+#endif
+
+    for (; p < end; p++) {
+        if (*p == '\n') {
+            return p;
+        } else if (*p == ':' && *colon == NULL) {
+            *colon = p;
+        } /* end if */
+    } /* end for */
+
+    return NULL;
+} /* end of scan_line */
+
+/**
+ * Check whether a field value contains a token, ignoring case.
+ * @input_param     the field value
+ * @input_param     the token
+ * @return          unequal zero if the token is found
+ */
+static int
+value_contains(http_slice_t value, const char *token) {
+    size_t n = strlen(token);
+    size_t i;
+
+    for (i = 0; i + n <= value.len; i++) {
+        if (strncasecmp(value.ptr + i, token, n) == 0) {
+            return TRUE;
+        } /* end if */
+    } /* end for */
+
+    return FALSE;
+} /* end of value_contains */
+
+/**
+ * Parse an HTTP-date in any of the formats of RFC 7231, 7.1.1.1,
+ * e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+ * @input_param     the field value
+ * @output_param    the time, unchanged if the value is no date
+ * @return          zero if the value is no date
+ */
+int
+http_parse_date(http_slice_t value, time_t *t) {
+    return http_date_parse(value.ptr, value.len, t);
+} /* end of http_parse_date */
+
+/**
+ * Parse a header line, the conditional fields, Range, Accept-Encoding,
+ * Connection and Host are implemented.
+ * @input_param     the parsed header
+ * @input_param     the line without the line feed
+ * @input_param     the length of the line
+ * @input_param     the colon behind the field name, NULL if none
+ */
+static void
+parse_header_line(parsed_http_header_t *parsed_header, const char *line, size_t len, const char *colon) {
+    const char *name_end = colon;
+    const char *end = line + len;
+    http_slice_t value;
+
+    if (colon == NULL) {
+        return;
+    } /* end if */
+    while (name_end > line && IS_BLANK(name_end[-1])) {
+        name_end--;
+    } /* end while */
+
+    value.ptr = colon + 1;
+    while (value.ptr < end && IS_BLANK(*value.ptr)) {
+        value.ptr++;
+    } /* end while */
+    while (end > value.ptr && (end[-1] == '\r' || IS_BLANK(end[-1]))) {
+        end--;
+    } /* end while */
+    value.len = end - value.ptr;
+
+    switch (lookup_field(line, name_end - line)) {
+        case HTTP_FIELD_IF_MODIFIED_SINCE:
+            http_parse_date(value, &parsed_header->modsince);
+            break;
+        case HTTP_FIELD_IF_NONE_MATCH:
+            parsed_header->ifNoneMatch = value;
+            break;
+        case HTTP_FIELD_IF_MATCH:
+            parsed_header->ifMatch = value;
+            break;
+        case HTTP_FIELD_IF_RANGE:
+            /* an entity tag or a date, told apart with the validators of the file */
+            parsed_header->ifRange = value;
+            break;
+        case HTTP_FIELD_RANGE:
+            /* resolved against the size of the file */
+            parsed_header->range = value;
+            break;
+        case HTTP_FIELD_ACCEPT_ENCODING:
+            /* negotiated against the variants of the file */
+            parsed_header->acceptEncoding = value;
+            break;
+        case HTTP_FIELD_CONNECTION:
+            if (value_contains(value, "close")) {
+                parsed_header->keepAlive = FALSE;
+            } /* end if */
+            break;
+        case HTTP_FIELD_HOST:
+            parsed_header->host = value;
+            break;
+        default:
+            break;
+    } /* end switch */
+} /* end of parse_header_line */
+
+/**
+ * Reset the parser for a new request.
+ * @input_param     the parsed header
+ */
+void
+http_parser_init(parsed_http_header_t *parsed_header) {
+    //Initialize State with ERROR and modsince with 0
+    memset(parsed_header, 0, sizeof (*parsed_header));
+    parsed_header->methodType = HTTP_METHOD_UNKNOWN;
+    parsed_header->httpState = HTTP_STATUS_INTERNAL_SERVER_ERROR;
+    parsed_header->modsince = 0;
+    parsed_header->isCGI = FALSE;
+    parsed_header->keepAlive = FALSE;
+} /* end of http_parser_init */
+
+/**
+ * Move a slice along with the buffer it points into.
+ * @input_param     the slice
+ * @input_param     the old buffer
+ * @input_param     the number of bytes in the buffer
+ * @input_param     the new buffer
+ */
+static void
+rebase_slice(http_slice_t *slice, const char *from, size_t length, const char *to) {
+    if (slice->ptr != NULL && slice->ptr >= from && slice->ptr < from + length) {
+        slice->ptr = to + (slice->ptr - from);
+    } /* end if */
+} /* end of rebase_slice */
+
+/**
+ * Let the fields of a partly parsed header point into a new buffer
+ * after the received data was copied there, e.g. into a larger one.
+ * Fields pointing elsewhere, like the default page, are kept.
+ * @input_param     the parsed header
+ * @input_param     the old buffer
+ * @input_param     the number of bytes in the buffer
+ * @input_param     the new buffer
+ */
+void
+http_parser_rebase(parsed_http_header_t *parsed_header, const char *from, size_t length, const char *to) {
+    rebase_slice(&parsed_header->method, from, length, to);
+    rebase_slice(&parsed_header->target, from, length, to);
+    rebase_slice(&parsed_header->filename, from, length, to);
+    rebase_slice(&parsed_header->query, from, length, to);
+    rebase_slice(&parsed_header->protocol, from, length, to);
+    rebase_slice(&parsed_header->ifNoneMatch, from, length, to);
+    rebase_slice(&parsed_header->ifMatch, from, length, to);
+    rebase_slice(&parsed_header->ifRange, from, length, to);
+    rebase_slice(&parsed_header->range, from, length, to);
+    rebase_slice(&parsed_header->acceptEncoding, from, length, to);
+    rebase_slice(&parsed_header->host, from, length, to);
+} /* end of http_parser_rebase */
+
+/**
+ * Parse the http header in a single pass without copying. The fields
+ * of the parsed header point into the buffer, the request path is
+ * normalized in place. The buffer may hold a
+ * part of the header only, the next call with more data continues
+ * behind the last complete line.
+ * @input_param     the parsed header, initialised with http_parser_init()
+ * @input_param     the received data
+ * @input_param     the number of bytes received so far
+ * @return          HTTP_PARSE_DONE at the end of the header,
+ *                  HTTP_PARSE_ERROR for a malformed request line or
+ *                  more than HTTP_MAX_LINES lines,
+ *                  HTTP_PARSE_INCOMPLETE otherwise
+ */
+http_parse_result_t
+parse_http_header(parsed_http_header_t *parsed_header, char *buffer, size_t length) {
+    char *line;
+    char *eol;
+    char *colon;
+    size_t len;
+
+    while (parsed_header->parsed < length) {
+        line = buffer + parsed_header->parsed;
+        eol = scan_line(line, buffer + length, &colon);
+        if (eol == NULL) {
+            return HTTP_PARSE_INCOMPLETE;
+        } /* end if */
+        len = eol - line;
+        parsed_header->parsed += len + 1;
+
+        if (parsed_header->lineCount++ == 0) {
+            if (!parse_request_line(parsed_header, line, len)) {
+                parsed_header->httpState = HTTP_STATUS_BAD_REQUEST;
+                return HTTP_PARSE_ERROR;
+            } /* end if */
+            check_request_line(parsed_header);
+        } else if (len == 0 || (len == 1 && line[0] == '\r')) {
+            return HTTP_PARSE_DONE;
+        } else if (parsed_header->lineCount > HTTP_MAX_LINES) {
+            parsed_header->httpState = HTTP_STATUS_HEADER_TOO_LARGE;
+            return HTTP_PARSE_ERROR;
+        } else if (parsed_header->httpState != HTTP_STATUS_BAD_REQUEST
+                && parsed_header->httpState != HTTP_STATUS_NOT_IMPLEMENTED) {
+            parse_header_line(parsed_header, line, len, colon);
+        } /* end if */
+    } /* end while */
+
+    return HTTP_PARSE_INCOMPLETE;
 } /* end of parse_http_header */
@@ -10,17 +10,58 @@
 #ifndef _HTTP_PARSER_H
 #define _HTTP_PARSER_H
 
+#include <stddef.h>
+#include <time.h>
+
+#include "http.h"
+
+/*
+ * A part of the receive buffer, not terminated by '\0'
+ */
+typedef struct http_slice {
+    const char *ptr;
+    size_t len;
+} http_slice_t;
+
+#define HTTP_MAX_LINES    100   // request line and header fields
+
+/*
+ * Room for a copy of the request target before its path is rewritten,
+ * NULL if there is none
+ */
+typedef char *(*http_target_alloc_t)(void *ctx, size_t len);
+
+typedef enum http_parse_result {
+    HTTP_PARSE_INCOMPLETE = 0,  // more input is required
+    HTTP_PARSE_DONE,            // header complete, httpState is valid
+    HTTP_PARSE_ERROR            // malformed request line or too many lines, framing is lost
+} http_parse_result_t;
+
 typedef struct parsed_http_header {
-    char* method;
-    char* filename;
-    char* protocol;
+    http_slice_t method;
+    http_slice_t target;    /* the request target as received, for REQUEST_URI */
+    http_slice_t filename;
+    http_slice_t query;
+    http_slice_t protocol;
+    http_method_t methodType;
     int httpState;
     time_t modsince;
-    int byteStart;
-    int byteEnd;
+    http_slice_t ifNoneMatch;   /* conditional fields, ptr NULL if none */
+    http_slice_t ifMatch;
+    http_slice_t ifRange;
+    http_slice_t range;     /* value of a Range field, ptr NULL if none */
+    http_slice_t acceptEncoding;    /* value of an Accept-Encoding field, ptr NULL if none */
+    http_slice_t host;      /* value of the Host field, ptr NULL if none */
     int isCGI;
+    int keepAlive;
+    size_t parsed;      /* bytes of complete lines consumed so far */
+    int lineCount;      /* lines consumed so far */
+    http_target_alloc_t target_alloc;   /* keeps the target, NULL to keep the rewritten path instead */
+    void *target_ctx;
 } parsed_http_header_t;
 
-extern parsed_http_header_t parse_http_header(char *header);
-void parseHeaderField(char *);
-#endif
\ No newline at end of file
+extern int http_parse_date(http_slice_t value, time_t *t);
+extern void http_parser_init(parsed_http_header_t *parsed_header);
+extern void http_parser_rebase(parsed_http_header_t *parsed_header, const char *from, size_t length, const char *to);
+extern http_parse_result_t parse_http_header(parsed_http_header_t *parsed_header, char *buffer, size_t length);
+#endif
@@ -0,0 +1,526 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "tinyweb.h"
+#include "http.h"
+#include "metrics.h"
+#include "header_builder.h"
+
+/*
+ * The slots live in an anonymous shared mapping created before the
+ * first fork, so every process of the server can sum them up. The last
+ * slot is shared by the processes which found no free slot, only these
+ * count with atomic additions.
+ */
+typedef struct metrics_shared {
+    time_t          started;
+    metrics_slot_t  slots[METRICS_SLOTS + 1];
+} metrics_shared_t;
+
+
+static metrics_shared_t *shared = NULL;
+static metrics_slot_t *slot = NULL;         // the slot of the calling process
+static bool slot_shared = false;
+
+static char *phase_names[] = {
+    "parse",
+    "stat",
+    "header",
+    "body"
+};
+
+
+/**
+ * Create the shared counters and take a slot for the calling process.
+ * @return          -1 in case of error
+ */
+int
+metrics_init(void) {
+    shared = mmap(NULL, sizeof (metrics_shared_t), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        shared = NULL;
+        err_print("ERROR: mmap() metrics");
+        return -1;
+    } /* end if */
+
+    shared->started = time(NULL);
+    metrics_attach();
+    return 0;
+} /* end of metrics_init */
+
+/**
+ * Take a free slot for the calling process, which must be called by
+ * every forked process serving clients before it counts anything.
+ */
+void
+metrics_attach(void) {
+    pid_t pid = getpid();
+    pid_t expected;
+    int i;
+
+    if (shared == NULL) {
+        return;
+    } /* end if */
+
+    for (i = 0; i < METRICS_SLOTS; i++) {
+        expected = 0;
+        if (__atomic_load_n(&shared->slots[i].owner, __ATOMIC_RELAXED) == 0
+                && __atomic_compare_exchange_n(&shared->slots[i].owner, &expected, pid, false,
+                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            slot = &shared->slots[i];
+            slot_shared = false;
+            return;
+        } /* end if */
+    } /* end for */
+
+    slot = &shared->slots[METRICS_SLOTS];
+    slot_shared = true;
+} /* end of metrics_attach */
+
+/**
+ * Release the slot of a slot owner.
+ * @input_param     the slot
+ * @input_param     the process id of the owner
+ */
+static void
+release_slot(metrics_slot_t *s, pid_t pid) {
+    pid_t expected = pid;
+
+    __atomic_store_n(&s->active, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->accept_queue, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->accept_queue_max, 0, __ATOMIC_RELAXED);
+    __atomic_compare_exchange_n(&s->owner, &expected, 0, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+} /* end of release_slot */
+
+/**
+ * Release the slot of the calling process before it exits.
+ */
+void
+metrics_detach(void) {
+    if (slot != NULL && !slot_shared) {
+        release_slot(slot, getpid());
+    } /* end if */
+    slot = NULL;
+} /* end of metrics_detach */
+
+/**
+ * Release the slot of a terminated child, which may have died without
+ * detaching. Async-signal-safe, called when the child is reaped.
+ * @input_param     the process id of the child
+ */
+void
+metrics_reap(pid_t pid) {
+    int i;
+
+    if (shared == NULL) {
+        return;
+    } /* end if */
+
+    for (i = 0; i < METRICS_SLOTS; i++) {
+        if (__atomic_load_n(&shared->slots[i].owner, __ATOMIC_RELAXED) == pid) {
+            release_slot(&shared->slots[i], pid);
+        } /* end if */
+    } /* end for */
+} /* end of metrics_reap */
+
+/**
+ * Add to a counter of the own slot.
+ * @input_param     the counter
+ * @input_param     the value to add
+ */
+static inline void
+count(unsigned long long *counter, unsigned long long n) {
+    if (slot_shared) {
+        __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+    } else {
+        /* single writer, readers only need to see a whole value */
+        __atomic_store_n(counter, *counter + n, __ATOMIC_RELAXED);
+    } /* end if */
+} /* end of count */
+
+/**
+ * Add to a gauge of the own slot.
+ * @input_param     the gauge
+ * @input_param     the value to add, may be negative
+ */
+static inline void
+adjust(long long *gauge, long long n) {
+    if (slot_shared) {
+        __atomic_fetch_add(gauge, n, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(gauge, *gauge + n, __ATOMIC_RELAXED);
+    } /* end if */
+} /* end of adjust */
+
+/**
+ * Return a monotonic time stamp for the phase durations.
+ * @return          the time in nanoseconds
+ */
+long long
+metrics_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+} /* end of metrics_now */
+
+/**
+ * Count an accepted connection.
+ */
+void
+metrics_connection_opened(void) {
+    if (slot != NULL) {
+        count(&slot->accepted, 1);
+        adjust(&slot->active, 1);
+    } /* end if */
+} /* end of metrics_connection_opened */
+
+/**
+ * Count a closed connection.
+ */
+void
+metrics_connection_closed(void) {
+    if (slot != NULL) {
+        adjust(&slot->active, -1);
+    } /* end if */
+} /* end of metrics_connection_closed */
+
+/**
+ * Record the length of the accept queues and the length at which
+ * connections are no longer queued.
+ * @input_param     the number of waiting connections
+ * @input_param     the limit
+ */
+void
+metrics_queue(long long length, long long limit) {
+    if (slot == NULL || slot_shared) {
+        return;
+    } /* end if */
+
+    __atomic_store_n(&slot->accept_queue, length, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->accept_queue_max, limit, __ATOMIC_RELAXED);
+} /* end of metrics_queue */
+
+/**
+ * Sample the length of the accept queue of a listening socket.
+ * @input_param     the listening socket descriptor
+ */
+void
+metrics_accept_queue(int sd) {
+    struct tcp_info info;
+    socklen_t len = sizeof (info);
+
+    if (slot == NULL || slot_shared) {
+        return;
+    } /* end if */
+
+    /* for a listening socket the kernel reports the queue in these fields */
+    if (getsockopt(sd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0) {
+        metrics_queue(info.tcpi_unacked, info.tcpi_sacked);
+    } /* end if */
+} /* end of metrics_accept_queue */
+
+/**
+ * Count a response.
+ * @input_param     the status of the response
+ */
+void
+metrics_response(http_status_t status) {
+    if (slot != NULL && status < HTTP_STATUS_COUNT) {
+        count(&slot->status[status], 1);
+    } /* end if */
+} /* end of metrics_response */
+
+/**
+ * Count the bytes of a response sent completely.
+ * @input_param     the number of bytes
+ */
+void
+metrics_bytes_sent(size_t bytes) {
+    if (slot != NULL) {
+        count(&slot->bytes_sent, bytes);
+    } /* end if */
+} /* end of metrics_bytes_sent */
+
+/**
+ * Count a lookup in the file cache.
+ * @input_param     true for a hit
+ */
+void
+metrics_cache(bool hit) {
+    if (slot != NULL) {
+        count(hit ? &slot->cache_hits : &slot->cache_misses, 1);
+    } /* end if */
+} /* end of metrics_cache */
+
+/**
+ * Count the duration of a request phase.
+ * @input_param     the phase
+ * @input_param     the duration in nanoseconds
+ */
+void
+metrics_phase(metrics_phase_t phase, long long ns) {
+    unsigned long long us;
+    int bucket = 0;
+
+    if (slot == NULL || ns < 0) {
+        return;
+    } /* end if */
+
+    // the bucket b counts durations up to 2^b microseconds
+    us = (ns + 999) / 1000;
+    if (us > 1) {
+        bucket = 64 - __builtin_clzll(us - 1);
+    } /* end if */
+    if (bucket >= METRICS_HIST_BUCKETS) {
+        bucket = METRICS_HIST_BUCKETS - 1;
+    } /* end if */
+
+    count(&slot->phase_count[phase], 1);
+    count(&slot->phase_ns[phase], ns);
+    count(&slot->phase_hist[phase][bucket], 1);
+} /* end of metrics_phase */
+
+/**
+ * Sum up the slots of all processes.
+ * @output_param    the sum, the owner field holds the number of processes
+ */
+static void
+sum_slots(metrics_slot_t *sum) {
+    metrics_slot_t *s;
+    int i, j, k;
+
+    memset(sum, 0, sizeof (metrics_slot_t));
+    for (i = 0; i <= METRICS_SLOTS; i++) {
+        s = &shared->slots[i];
+        if (__atomic_load_n(&s->owner, __ATOMIC_RELAXED) != 0) {
+            sum->owner++;
+        } /* end if */
+        sum->accepted += __atomic_load_n(&s->accepted, __ATOMIC_RELAXED);
+        sum->active += __atomic_load_n(&s->active, __ATOMIC_RELAXED);
+        sum->accept_queue += __atomic_load_n(&s->accept_queue, __ATOMIC_RELAXED);
+        sum->accept_queue_max += __atomic_load_n(&s->accept_queue_max, __ATOMIC_RELAXED);
+        sum->bytes_sent += __atomic_load_n(&s->bytes_sent, __ATOMIC_RELAXED);
+        sum->cache_hits += __atomic_load_n(&s->cache_hits, __ATOMIC_RELAXED);
+        sum->cache_misses += __atomic_load_n(&s->cache_misses, __ATOMIC_RELAXED);
+        for (j = 0; j < HTTP_STATUS_COUNT; j++) {
+            sum->status[j] += __atomic_load_n(&s->status[j], __ATOMIC_RELAXED);
+        } /* end for */
+        for (j = 0; j < METRICS_PHASE_COUNT; j++) {
+            sum->phase_count[j] += __atomic_load_n(&s->phase_count[j], __ATOMIC_RELAXED);
+            sum->phase_ns[j] += __atomic_load_n(&s->phase_ns[j], __ATOMIC_RELAXED);
+            for (k = 0; k < METRICS_HIST_BUCKETS; k++) {
+                sum->phase_hist[j][k] += __atomic_load_n(&s->phase_hist[j][k], __ATOMIC_RELAXED);
+            } /* end for */
+        } /* end for */
+    } /* end for */
+} /* end of sum_slots */
+
+/**
+ * Append formatted text to a buffer, an overflow is remembered.
+ * @input_param     the buffer
+ * @input_param     the size of the buffer
+ * @input_param     the length so far, the size after an overflow
+ * @input_param     the format
+ */
+static void
+append(char *buf, size_t size, size_t *len, const char *fmt, ...) {
+    va_list ap;
+    int n;
+
+    if (*len >= size) {
+        return;
+    } /* end if */
+
+    va_start(ap, fmt);
+    n = vsnprintf(buf + *len, size - *len, fmt, ap);
+    va_end(ap);
+    *len = (n < 0 || (size_t) n >= size - *len) ? size : *len + n;
+} /* end of append */
+
+/**
+ * Return the upper bound of the histogram bucket holding a percentile.
+ * @input_param     the buckets
+ * @input_param     the number of counted durations
+ * @input_param     the percentile, e.g. 99.0
+ * @return          the bound in microseconds
+ */
+static unsigned long long
+hist_percentile(const unsigned long long *hist, unsigned long long total, double percentile) {
+    unsigned long long rank = (unsigned long long) (total * percentile / 100.0);
+    unsigned long long seen = 0;
+    int i;
+
+    for (i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen > rank) {
+            break;
+        } /* end if */
+    } /* end for */
+
+    return 1ULL << (i < METRICS_HIST_BUCKETS ? i : METRICS_HIST_BUCKETS - 1);
+} /* end of hist_percentile */
+
+/**
+ * Write the counters as Prometheus text exposition format.
+ * @input_param     the sum of all slots
+ * @input_param     the buffer
+ * @input_param     the size of the buffer
+ * @input_param     the length so far
+ */
+static void
+format_prometheus(const metrics_slot_t *sum, char *buf, size_t size, size_t *len) {
+    unsigned long long cumulative;
+    int i, j;
+
+    append(buf, size, len, "# HELP tinyweb_uptime_seconds Time since the server was started.\n"
+            "# TYPE tinyweb_uptime_seconds gauge\ntinyweb_uptime_seconds %ld\n",
+            (long) (time(NULL) - shared->started));
+    append(buf, size, len, "# HELP tinyweb_processes Processes serving clients.\n"
+            "# TYPE tinyweb_processes gauge\ntinyweb_processes %d\n", (int) sum->owner);
+    append(buf, size, len, "# HELP tinyweb_connections_accepted_total Accepted connections.\n"
+            "# TYPE tinyweb_connections_accepted_total counter\n"
+            "tinyweb_connections_accepted_total %llu\n", sum->accepted);
+    append(buf, size, len, "# HELP tinyweb_connections_active Open connections.\n"
+            "# TYPE tinyweb_connections_active gauge\ntinyweb_connections_active %lld\n", sum->active);
+    append(buf, size, len, "# HELP tinyweb_accept_queue_length Connections waiting to be accepted.\n"
+            "# TYPE tinyweb_accept_queue_length gauge\ntinyweb_accept_queue_length %lld\n",
+            sum->accept_queue);
+    append(buf, size, len, "# HELP tinyweb_accept_queue_limit Length of the accept queues at which connections are refused.\n"
+            "# TYPE tinyweb_accept_queue_limit gauge\ntinyweb_accept_queue_limit %lld\n",
+            sum->accept_queue_max);
+
+    append(buf, size, len, "# HELP tinyweb_responses_total Responses by status code.\n"
+            "# TYPE tinyweb_responses_total counter\n");
+    for (i = 0; i < HTTP_STATUS_COUNT; i++) {
+        append(buf, size, len, "tinyweb_responses_total{code=\"%d\"} %llu\n",
+                http_status_list[i].code, sum->status[i]);
+    } /* end for */
+
+    append(buf, size, len, "# HELP tinyweb_sent_bytes_total Bytes of completely sent responses.\n"
+            "# TYPE tinyweb_sent_bytes_total counter\ntinyweb_sent_bytes_total %llu\n", sum->bytes_sent);
+    append(buf, size, len, "# HELP tinyweb_cache_lookups_total File cache lookups by result.\n"
+            "# TYPE tinyweb_cache_lookups_total counter\n"
+            "tinyweb_cache_lookups_total{result=\"hit\"} %llu\n"
+            "tinyweb_cache_lookups_total{result=\"miss\"} %llu\n", sum->cache_hits, sum->cache_misses);
+
+    append(buf, size, len, "# HELP tinyweb_phase_duration_seconds Duration of the request phases.\n"
+            "# TYPE tinyweb_phase_duration_seconds histogram\n");
+    for (i = 0; i < METRICS_PHASE_COUNT; i++) {
+        cumulative = 0;
+        for (j = 0; j < METRICS_HIST_BUCKETS - 1; j++) {
+            cumulative += sum->phase_hist[i][j];
+            append(buf, size, len, "tinyweb_phase_duration_seconds_bucket{phase=\"%s\",le=\"%g\"} %llu\n",
+                    phase_names[i], (double) (1ULL << j) / 1e6, cumulative);
+        } /* end for */
+        append(buf, size, len, "tinyweb_phase_duration_seconds_bucket{phase=\"%s\",le=\"+Inf\"} %llu\n"
+                "tinyweb_phase_duration_seconds_sum{phase=\"%s\"} %.9f\n"
+                "tinyweb_phase_duration_seconds_count{phase=\"%s\"} %llu\n",
+                phase_names[i], sum->phase_count[i], phase_names[i], sum->phase_ns[i] / 1e9,
+                phase_names[i], sum->phase_count[i]);
+    } /* end for */
+} /* end of format_prometheus */
+
+/**
+ * Write the counters as a page for humans, with one line per process.
+ * @input_param     the sum of all slots
+ * @input_param     the buffer
+ * @input_param     the size of the buffer
+ * @input_param     the length so far
+ */
+static void
+format_text(const metrics_slot_t *sum, char *buf, size_t size, size_t *len) {
+    unsigned long long requests = 0;
+    unsigned long long lookups = sum->cache_hits + sum->cache_misses;
+    metrics_slot_t *s;
+    int i, j;
+
+    for (i = 0; i < HTTP_STATUS_COUNT; i++) {
+        requests += sum->status[i];
+    } /* end for */
+
+    append(buf, size, len, "%s server status\n\n", SERVER_NAME);
+    append(buf, size, len, "Uptime:               %ld s\n", (long) (time(NULL) - shared->started));
+    append(buf, size, len, "Processes:            %d\n", (int) sum->owner);
+    append(buf, size, len, "Connections active:   %lld\n", sum->active);
+    append(buf, size, len, "Connections accepted: %llu\n", sum->accepted);
+    append(buf, size, len, "Accept queue:         %lld of %lld\n", sum->accept_queue, sum->accept_queue_max);
+    append(buf, size, len, "Requests:             %llu\n", requests);
+    append(buf, size, len, "Bytes sent:           %llu\n", sum->bytes_sent);
+    append(buf, size, len, "Cache hits/misses:    %llu/%llu (%.1f %%)\n\n", sum->cache_hits, sum->cache_misses,
+            lookups > 0 ? 100.0 * sum->cache_hits / lookups : 0.0);
+
+    append(buf, size, len, "Status  Responses\n");
+    for (i = 0; i < HTTP_STATUS_COUNT; i++) {
+        append(buf, size, len, "%d     %10llu\n", http_status_list[i].code, sum->status[i]);
+    } /* end for */
+
+    append(buf, size, len, "\nPhase       Count    Avg us  p50 <= us  p99 <= us\n");
+    for (i = 0; i < METRICS_PHASE_COUNT; i++) {
+        append(buf, size, len, "%-6s %10llu %9.1f %10llu %10llu\n", phase_names[i], sum->phase_count[i],
+                sum->phase_count[i] > 0 ? sum->phase_ns[i] / 1e3 / sum->phase_count[i] : 0.0,
+                hist_percentile(sum->phase_hist[i], sum->phase_count[i], 50.0),
+                hist_percentile(sum->phase_hist[i], sum->phase_count[i], 99.0));
+    } /* end for */
+
+    // the counters belong to the slot, the owner is the current process
+    append(buf, size, len, "\nSlot  Owner    Accepted  Active  Responses\n");
+    for (i = 0; i < METRICS_SLOTS; i++) {
+        s = &shared->slots[i];
+        if (__atomic_load_n(&s->owner, __ATOMIC_RELAXED) == 0) {
+            continue;
+        } /* end if */
+        requests = 0;
+        for (j = 0; j < HTTP_STATUS_COUNT; j++) {
+            requests += __atomic_load_n(&s->status[j], __ATOMIC_RELAXED);
+        } /* end for */
+        append(buf, size, len, "%4d  %-8d %8llu %7lld %10llu\n", i, (int) __atomic_load_n(&s->owner, __ATOMIC_RELAXED),
+                __atomic_load_n(&s->accepted, __ATOMIC_RELAXED),
+                __atomic_load_n(&s->active, __ATOMIC_RELAXED), requests);
+    } /* end for */
+} /* end of format_text */
+
+/**
+ * Write the current counters of all processes into a buffer.
+ * @output_param    the buffer
+ * @input_param     the size of the buffer
+ * @input_param     true for the Prometheus text format
+ * @return          the length of the text, -1 if it does not fit
+ */
+int
+metrics_format(char *buf, size_t size, bool prometheus) {
+    metrics_slot_t sum;
+    size_t len = 0;
+
+    if (shared == NULL) {
+        return -1;
+    } /* end if */
+
+    sum_slots(&sum);
+    if (prometheus) {
+        format_prometheus(&sum, buf, size, &len);
+    } else {
+        format_text(&sum, buf, size, &len);
+    } /* end if */
+
+    return (len < size) ? (int) len : -1;
+} /* end of metrics_format */
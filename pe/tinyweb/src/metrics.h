@@ -0,0 +1,72 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "http.h"
+
+#define METRICS_SLOTS                     256   // processes counting at the same time
+#define METRICS_HIST_BUCKETS               24   // powers of two of microseconds
+#define METRICS_BUFFER_SIZE             32768   // size of a status page
+#define METRICS_STATUS_PATH   "/server-status"
+
+
+typedef enum metrics_phase {
+    METRICS_PHASE_PARSE = 0,        // scanning the request header
+    METRICS_PHASE_STAT,             // looking up the file
+    METRICS_PHASE_HEADER,           // building the response header
+    METRICS_PHASE_BODY,             // writing the response to the socket
+    METRICS_PHASE_COUNT
+} metrics_phase_t;
+
+
+/*
+ * Counters of one serving process. Only the owner writes them, so the
+ * request path needs neither locks nor atomic read-modify-write
+ * instructions. The counters of a slot survive its owner, a slot is
+ * reused by the next process.
+ */
+typedef struct metrics_slot {
+    pid_t               owner;                      // 0 if the slot is free
+    unsigned long long  accepted;                   // connections
+    long long           active;                     // open connections
+    long long           accept_queue;               // last sampled length of the listen queue
+    long long           accept_queue_max;           // backlog, or the queue limit of a prefork pool
+    unsigned long long  status[HTTP_STATUS_COUNT];  // responses per status
+    unsigned long long  bytes_sent;
+    unsigned long long  cache_hits;
+    unsigned long long  cache_misses;
+    unsigned long long  phase_count[METRICS_PHASE_COUNT];
+    unsigned long long  phase_ns[METRICS_PHASE_COUNT];
+    unsigned long long  phase_hist[METRICS_PHASE_COUNT][METRICS_HIST_BUCKETS];
+} __attribute__((aligned(64))) metrics_slot_t;
+
+
+extern int metrics_init(void);
+extern void metrics_attach(void);
+extern void metrics_detach(void);
+extern void metrics_reap(pid_t pid);
+extern long long metrics_now(void);
+extern void metrics_connection_opened(void);
+extern void metrics_connection_closed(void);
+extern void metrics_queue(long long length, long long limit);
+extern void metrics_accept_queue(int sd);
+extern void metrics_response(http_status_t status);
+extern void metrics_bytes_sent(size_t bytes);
+extern void metrics_cache(bool hit);
+extern void metrics_phase(metrics_phase_t phase, long long ns);
+extern int metrics_format(char *buf, size_t size, bool prometheus);
+
+#endif
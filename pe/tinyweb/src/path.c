@@ -0,0 +1,253 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/openat2.h>
+
+#include "tinyweb.h"
+#include "path.h"
+
+/*
+ * The files are looked up relative to a descriptor of the document
+ * root, so a path can only name a file below it: the parser has
+ * removed the dot segments and the leading slash is dropped here. A
+ * symbolic link must not lead out of the root either, names are
+ * resolved with RESOLVE_BENEATH and the file status is taken from the
+ * opened descriptor.
+ *
+ * Regular files are checked on every request, their status is needed
+ * for the validators anyway. The results which end the request early,
+ * the missing files and the directories, are kept for a few seconds
+ * in a small table per serving process.
+ */
+typedef struct path_cache_slot {
+    char                path[PATH_CACHE_KEY_SIZE];
+    size_t              len;                // zero if the slot is free
+    unsigned int        hash;
+    path_result_t       result;
+    time_t              expires;            // monotonic seconds
+} path_cache_slot_t;
+
+
+static int root_fd = -1;
+static bool no_openat2 = false;             // kernel before 5.6
+static path_cache_slot_t path_cache[PATH_CACHE_SLOTS];
+
+
+/**
+ * Open the document root for the lookups.
+ * @input_param     the document root
+ * @return          -1 in case of error
+ */
+int
+path_init(const char *root_dir) {
+    root_fd = open(root_dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd < 0) {
+        err_print("ERROR: Cannot open root dir");
+        return -1;
+    } /* end if */
+    return 0;
+} /* end of path_init */
+
+/**
+ * Hash a path with FNV-1a.
+ * @input_param     the path
+ * @return          the hash value
+ */
+static unsigned int
+hash_path(http_slice_t path) {
+    unsigned int hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < path.len; i++) {
+        hash = (hash ^ (unsigned char) path.ptr[i]) * 16777619u;
+    } /* end for */
+
+    return hash;
+} /* end of hash_path */
+
+/**
+ * Get the coarse monotonic time, good enough for the expiry.
+ * @return          the time in seconds
+ */
+static time_t
+now_seconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return ts.tv_sec;
+} /* end of now_seconds */
+
+/**
+ * Turn a request path into a name relative to the document root.
+ * @input_param     the normalized path, starting with a slash
+ * @output_param    the relative name
+ * @input_param     the size of the buffer
+ * @return          -1 if the name is too long
+ */
+static int
+relative_name(http_slice_t path, char *name, size_t size) {
+    if (path.len <= 1) {
+        snprintf(name, size, ".");
+        return 0;
+    } /* end if */
+    if (path.len > size) {
+        errno = ENAMETOOLONG;
+        return -1;
+    } /* end if */
+    memcpy(name, path.ptr + 1, path.len - 1);
+    name[path.len - 1] = '\0';
+    return 0;
+} /* end of relative_name */
+
+/**
+ * Open a name below the document root without following a link out of
+ * it. Without openat2() the components are opened one by one and no
+ * symbolic link is followed at all.
+ * @input_param     the name relative to the root
+ * @input_param     the flags of open()
+ * @return          the file descriptor, -1 in case of error
+ */
+static int
+open_beneath(const char *name, int flags) {
+    struct open_how how;
+    char buf[PATH_MAX];
+    char *component, *next, *save;
+    int dir, fd;
+
+    if (!no_openat2) {
+        memset(&how, 0, sizeof (how));
+        how.flags = flags | O_CLOEXEC;
+        how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+        fd = syscall(SYS_openat2, root_fd, name, &how, sizeof (how));
+        if (fd >= 0 || errno != ENOSYS) {
+            return fd;
+        } /* end if */
+        no_openat2 = true;
+    } /* end if */
+
+    snprintf(buf, sizeof (buf), "%s", name);
+    dir = root_fd;
+    fd = -1;
+    for (component = strtok_r(buf, "/", &save); component != NULL; component = next) {
+        next = strtok_r(NULL, "/", &save);
+        if (next != NULL) {
+            fd = openat(dir, component, O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        } else {
+            fd = openat(dir, component, flags | O_NOFOLLOW | O_CLOEXEC);
+        } /* end if */
+        if (dir != root_fd) {
+            close(dir);
+        } /* end if */
+        if (fd < 0) {
+            return -1;
+        } /* end if */
+        dir = fd;
+    } /* end for */
+
+    return fd;
+} /* end of open_beneath */
+
+/**
+ * Look up a request path below the document root.
+ * @input_param     the normalized path
+ * @output_param    the status of the file, valid for PATH_FILE
+ * @return          what the path names
+ */
+path_result_t
+path_lookup(http_slice_t path, struct stat *st) {
+    char name[PATH_MAX];
+    path_cache_slot_t *slot = NULL;
+    path_result_t result;
+    unsigned int hash = 0;
+    time_t now = 0;
+    int fd;
+
+    if (path.len < PATH_CACHE_KEY_SIZE) {
+        hash = hash_path(path);
+        slot = &path_cache[hash & (PATH_CACHE_SLOTS - 1)];
+        now = now_seconds();
+        if (slot->len == path.len && slot->hash == hash && slot->expires > now
+                && memcmp(slot->path, path.ptr, path.len) == 0) {
+            return slot->result;
+        } /* end if */
+    } /* end if */
+
+    fd = -1;
+    if (relative_name(path, name, sizeof (name)) < 0 || (fd = open_beneath(name, O_PATH)) < 0
+            || fstat(fd, st) < 0) {
+        result = (errno == EACCES) ? PATH_FORBIDDEN : PATH_NOT_FOUND;
+    } else if (S_ISREG(st->st_mode) && faccessat(root_fd, name, R_OK, 0) < 0) {
+        result = (errno == EACCES) ? PATH_FORBIDDEN : PATH_NOT_FOUND;
+    } else if (S_ISREG(st->st_mode)) {
+        close(fd);
+        return PATH_FILE;
+    } else if (S_ISDIR(st->st_mode)) {
+        result = PATH_DIRECTORY;
+    } else {
+        result = PATH_NOT_FOUND;
+    } /* end if */
+    if (fd >= 0) {
+        close(fd);
+    } /* end if */
+
+    if (slot != NULL) {
+        memcpy(slot->path, path.ptr, path.len);
+        slot->len = path.len;
+        slot->hash = hash;
+        slot->result = result;
+        slot->expires = now + PATH_CACHE_TTL;
+    } /* end if */
+    return result;
+} /* end of path_lookup */
+
+/**
+ * Open a file below the document root for reading.
+ * @input_param     the normalized path
+ * @return          the file descriptor, -1 in case of error
+ */
+int
+path_open(http_slice_t path) {
+    return path_open_variant(path, "");
+} /* end of path_open */
+
+/**
+ * Open a sibling of a file below the document root, e.g. its
+ * precompressed variant.
+ * @input_param     the normalized path
+ * @input_param     the suffix appended to the name
+ * @return          the file descriptor, -1 in case of error
+ */
+int
+path_open_variant(http_slice_t path, const char *suffix) {
+    char name[PATH_MAX];
+    size_t len;
+
+    if (relative_name(path, name, sizeof (name)) < 0) {
+        return -1;
+    } /* end if */
+    len = strlen(name);
+    if (len + strlen(suffix) >= sizeof (name)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    } /* end if */
+    strcpy(name + len, suffix);
+    return open_beneath(name, O_RDONLY);
+} /* end of path_open_variant */
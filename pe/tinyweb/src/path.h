@@ -0,0 +1,36 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _PATH_H
+#define _PATH_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "http_parser.h"
+
+#define PATH_CACHE_SLOTS          256   // direct mapped, a power of two
+#define PATH_CACHE_KEY_SIZE       128   // longer paths are not cached
+#define PATH_CACHE_TTL              2   // seconds a result is trusted
+
+
+typedef enum path_result {
+    PATH_NOT_FOUND = 0,         // missing, outside the root or no regular file
+    PATH_FILE,                  // a readable regular file, the status is valid
+    PATH_DIRECTORY,             // a directory, the status may be stale
+    PATH_FORBIDDEN              // the file or a directory on the way may not be read
+} path_result_t;
+
+
+extern int path_init(const char *root_dir);
+extern path_result_t path_lookup(http_slice_t path, struct stat *st);
+extern int path_open(http_slice_t path);
+extern int path_open_variant(http_slice_t path, const char *suffix);
+
+#endif
@@ -0,0 +1,372 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "tinyweb.h"
+#include "prefork.h"
+#include "response.h"
+#include "metrics.h"
+
+
+typedef enum worker_state {
+    WORKER_EMPTY = 0,               // slot unused
+    WORKER_STARTING,                // forked, not accepting yet
+    WORKER_IDLE,                    // waiting for a connection
+    WORKER_BUSY                     // serving a connection
+} worker_state_t;
+
+/*
+ * Scoreboard entry of a worker in shared memory. The state is written
+ * by the worker, pid and quit by the master.
+ */
+typedef struct worker_slot {
+    pid_t           pid;
+    int             state;
+    int             quit;           // asked to exit, no longer counted as spare
+} worker_slot_t;
+
+
+static worker_slot_t *scoreboard = NULL;
+static volatile sig_atomic_t *worker_running = NULL;
+
+
+/**
+ * Signal handler of a worker, the master asks it to exit. The worker
+ * stops accepting, its connection is drained like on shutdown.
+ */
+static void
+quit_handler(int sig) {
+    *worker_running = false;
+} /* end of quit_handler */
+
+/**
+ * Signal handler of the master, a terminated worker interrupts the
+ * pause of the maintenance loop to be replaced at once.
+ */
+static void
+child_handler(int sig) {
+} /* end of child_handler */
+
+/**
+ * Accept connections in a worker until it is asked to exit or has
+ * answered the maximum number of requests. All idle workers wait on
+ * the shared listeners, EPOLLEXCLUSIVE wakes only one of them for a
+ * new connection.
+ * @input_param     the scoreboard entry of the worker
+ * @input_param     the listening socket descriptors
+ * @input_param     the number of listening sockets
+ * @input_param     the program options
+ * @input_param     the worker runs while this flag is true
+ * @input_param     the connection handler
+ */
+static void
+worker_main(worker_slot_t *self, int *sds, int count, prog_options_t *server, volatile sig_atomic_t *running,
+        prefork_handler_t handler) {
+    struct sigaction sa;
+    struct epoll_event ev;
+    struct sockaddr_storage client;
+    socklen_t client_len;
+    unsigned long served = 0;
+    int epfd;
+    int nsd;
+    int n;
+    int i;
+
+    // interrupt epoll_wait(), the connection being served retries on EINTR
+    worker_running = running;
+    sa.sa_flags = 0;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = quit_handler;
+    sigaction(SIGUSR1, &sa, NULL);
+    metrics_attach();
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        err_print("ERROR: worker epoll_create1()");
+        exit(EXIT_FAILURE);
+    } /* end if */
+    for (i = 0; i < count; i++) {
+        ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+        ev.data.fd = sds[i];
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, sds[i], &ev) < 0) {
+            err_print("ERROR: worker epoll_ctl()");
+            exit(EXIT_FAILURE);
+        } /* end if */
+    } /* end for */
+
+    while (*running && (server->max_requests == 0 || served < server->max_requests)) {
+        __atomic_store_n(&self->state, WORKER_IDLE, __ATOMIC_RELAXED);
+
+        n = epoll_wait(epfd, &ev, 1, -1);
+        if (n <= 0) {
+            if (n < 0 && errno != EINTR) {
+                err_print("ERROR: worker epoll_wait()");
+                break;
+            } /* end if */
+            continue;
+        } /* end if */
+
+        client_len = sizeof (client);
+        nsd = accept4(ev.data.fd, (struct sockaddr *) &client, &client_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (nsd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ECONNABORTED) {
+                /* another worker was faster */
+                continue;
+            } /* end if */
+            err_print("ERROR: worker accept()");
+            break;
+        } /* end if */
+
+        __atomic_store_n(&self->state, WORKER_BUSY, __ATOMIC_RELAXED);
+        n = handler(nsd, server, &client);
+        if (n > 0) {
+            served += n;
+        } /* end if */
+    } /* end while */
+
+    close(epfd);
+    metrics_detach();
+    exit(EXIT_SUCCESS);
+} /* end of worker_main */
+
+/**
+ * Start a worker in a free scoreboard entry.
+ * @input_param     the scoreboard entry
+ * @input_param     the listening socket descriptors
+ * @input_param     the number of listening sockets
+ * @input_param     the program options
+ * @input_param     the worker runs while this flag is true
+ * @input_param     the connection handler
+ * @input_param     the SIGCHLD action of the worker, which reaps its cgi children
+ * @return          -1 in case of error
+ */
+static int
+start_worker(worker_slot_t *slot, int *sds, int count, prog_options_t *server, volatile sig_atomic_t *running,
+        prefork_handler_t handler, struct sigaction *reap_action) {
+    pid_t pid;
+
+    // before the fork, the worker sets its state when it is ready
+    slot->quit = 0;
+    __atomic_store_n(&slot->state, WORKER_STARTING, __ATOMIC_RELAXED);
+
+    fflush(stdout); /* do not duplicate buffered output in the worker */
+    pid = fork();
+    if (pid == 0) {
+        sigaction(SIGCHLD, reap_action, NULL);
+        worker_main(slot, sds, count, server, running, handler);
+    } else if (pid < 0) {
+        err_print("ERROR: fork() worker");
+        __atomic_store_n(&slot->state, WORKER_EMPTY, __ATOMIC_RELAXED);
+        return -1;
+    } /* end if */
+
+    slot->pid = pid;
+    return 0;
+} /* end of start_worker */
+
+/**
+ * Release the scoreboard entries of terminated workers.
+ * @input_param     the maximum number of workers
+ */
+static void
+reap_workers(int max_workers) {
+    pid_t pid;
+    int i;
+
+    while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+        metrics_reap(pid);
+        for (i = 0; i < max_workers; i++) {
+            if (scoreboard[i].pid == pid) {
+                scoreboard[i].pid = 0;
+                __atomic_store_n(&scoreboard[i].state, WORKER_EMPTY, __ATOMIC_RELAXED);
+                break;
+            } /* end if */
+        } /* end for */
+    } /* end while */
+} /* end of reap_workers */
+
+/**
+ * Return the number of connections waiting in the accept queue.
+ * @input_param     the listening socket descriptor
+ * @return          the queue length
+ */
+static int
+accept_queue_length(int sd) {
+    struct tcp_info info;
+    socklen_t len = sizeof (info);
+
+    if (getsockopt(sd, IPPROTO_TCP, TCP_INFO, &info, &len) < 0) {
+        return 0;
+    } /* end if */
+
+    return info.tcpi_unacked;
+} /* end of accept_queue_length */
+
+/**
+ * Admission control of a saturated pool: answer the connections
+ * waiting beyond the queue limit with 503 instead of letting them
+ * wait for a free worker.
+ * @input_param     the listening socket descriptor
+ * @input_param     the program options
+ */
+static void
+shed_connections(int sd, prog_options_t *server) {
+    struct sockaddr_storage client;
+    socklen_t client_len;
+    int nsd;
+
+    while (accept_queue_length(sd) > (int) server->max_queue) {
+        client_len = sizeof (client);
+        nsd = accept4(sd, (struct sockaddr *) &client, &client_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (nsd < 0) {
+            /* a worker was faster */
+            return;
+        } /* end if */
+        respond_unavailable(nsd, &client, server);
+    } /* end while */
+    access_log_flush();
+} /* end of shed_connections */
+
+/**
+ * Serve clients with a pool of preforked workers like the Apache
+ * prefork MPM. The master keeps between the minimum and the maximum
+ * number of spare workers waiting for a connection, never more than
+ * the maximum number of workers at all. A worker exits after the
+ * maximum number of requests and is replaced by a new one.
+ * @input_param     the non-blocking listening socket descriptors
+ * @input_param     the number of listening sockets
+ * @input_param     the program options
+ * @input_param     the pool runs while this flag is true
+ * @input_param     the connection handler of the workers
+ * @return          unequal zero in case of error
+ */
+int
+run_prefork_pool(int *sds, int count, prog_options_t *server, volatile sig_atomic_t *running,
+        prefork_handler_t handler) {
+    struct sigaction reap_action;
+    struct sigaction sa;
+    struct timespec interval;
+    int spawn_rate = 1;
+    int total, spare, spawned;
+    long long queued;
+    bool saturated = false;
+    int i;
+
+    scoreboard = mmap(NULL, server->max_workers * sizeof (worker_slot_t), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (scoreboard == MAP_FAILED) {
+        err_print("ERROR: mmap() scoreboard");
+        return -1;
+    } /* end if */
+
+    // the master reaps its workers itself to free their entries
+    sa.sa_flags = 0;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = child_handler;
+    sigaction(SIGCHLD, &sa, &reap_action);
+
+    while (*running) {
+        reap_workers(server->max_workers);
+
+        total = 0;
+        spare = 0;
+        for (i = 0; i < server->max_workers; i++) {
+            switch (__atomic_load_n(&scoreboard[i].state, __ATOMIC_RELAXED)) {
+                case WORKER_EMPTY:
+                    continue;
+                case WORKER_STARTING:
+                case WORKER_IDLE:
+                    spare += !scoreboard[i].quit;
+                    break;
+                default:
+                    break;
+            } /* end switch */
+            total++;
+        } /* end for */
+
+        if (spare < (int) server->min_spare && total < server->max_workers) {
+            // start more workers each time the pool is still short of spare ones
+            spawned = 0;
+            for (i = 0; i < server->max_workers && spawned < spawn_rate
+                    && spare + spawned < (int) server->min_spare; i++) {
+                if (__atomic_load_n(&scoreboard[i].state, __ATOMIC_RELAXED) == WORKER_EMPTY
+                        && scoreboard[i].pid == 0) {
+                    if (start_worker(&scoreboard[i], sds, count, server, running, handler, &reap_action) < 0) {
+                        break;
+                    } /* end if */
+                    spawned++;
+                } /* end if */
+            } /* end for */
+            if (spawn_rate < PREFORK_MAX_SPAWN_RATE) {
+                spawn_rate *= 2;
+            } /* end if */
+        } else {
+            spawn_rate = 1;
+        } /* end if */
+
+        if (spare > (int) server->max_spare) {
+            // retire one idle worker per maintenance
+            for (i = 0; i < server->max_workers; i++) {
+                if (__atomic_load_n(&scoreboard[i].state, __ATOMIC_RELAXED) == WORKER_IDLE && !scoreboard[i].quit) {
+                    scoreboard[i].quit = 1;
+                    kill(scoreboard[i].pid, SIGUSR1);
+                    break;
+                } /* end if */
+            } /* end for */
+        } /* end if */
+
+        // the status page shows the queues against the limit of the admission control
+        queued = 0;
+        for (i = 0; i < count; i++) {
+            queued += accept_queue_length(sds[i]);
+        } /* end for */
+        metrics_queue(queued, (long long) server->max_queue * count);
+
+        saturated = (spare == 0 && total >= server->max_workers);
+        for (i = 0; saturated && i < count; i++) {
+            shed_connections(sds[i], server);
+        } /* end for */
+
+        interval.tv_sec = 0;
+        interval.tv_nsec = (saturated ? PREFORK_SATURATED_MS : PREFORK_MAINTENANCE_MS) * 1000000L;
+        nanosleep(&interval, NULL);
+    } /* end while */
+
+    // graceful drain: the workers stop accepting and finish their connections
+    for (i = 0; i < count; i++) {
+        close(sds[i]);
+    } /* end for */
+    for (i = 0; i < server->max_workers; i++) {
+        if (scoreboard[i].pid > 0) {
+            kill(scoreboard[i].pid, SIGUSR1);
+        } /* end if */
+    } /* end for */
+    while (waitpid(-1, NULL, 0) > 0 || errno == EINTR) {
+    } /* end while */
+
+    sigaction(SIGCHLD, &reap_action, NULL);
+    munmap(scoreboard, server->max_workers * sizeof (worker_slot_t));
+    scoreboard = NULL;
+    return 0;
+} /* end of run_prefork_pool */
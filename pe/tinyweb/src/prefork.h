@@ -0,0 +1,39 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _PREFORK_H
+#define _PREFORK_H
+
+#include <signal.h>
+#include <sys/socket.h>
+
+#include "tinyweb.h"
+
+#define PREFORK_DEFAULT_MIN_SPARE           5
+#define PREFORK_DEFAULT_MAX_SPARE          10
+#define PREFORK_DEFAULT_MAX_WORKERS       150
+#define PREFORK_DEFAULT_MAX_REQUESTS    10000   // 0 never recycles a worker
+#define PREFORK_DEFAULT_MAX_QUEUE          32
+#define PREFORK_MAX_WORKERS              4096
+#define PREFORK_MAX_SPAWN_RATE             32   // workers started per maintenance
+#define PREFORK_MAINTENANCE_MS            100
+#define PREFORK_SATURATED_MS               10   // check interval for the admission control
+
+
+/*
+ * Serves one non-blocking connection and closes it.
+ * @return          the number of answered requests, -1 in case of error
+ */
+typedef int (*prefork_handler_t)(int sd, prog_options_t *server, const struct sockaddr_storage *client);
+
+
+extern int run_prefork_pool(int *sds, int count, prog_options_t *server, volatile sig_atomic_t *running,
+        prefork_handler_t handler);
+
+#endif
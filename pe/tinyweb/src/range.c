@@ -0,0 +1,234 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "range.h"
+
+#define RANGE_OFFSET_MAX        (((off_t) 1 << 62) - 1)     // larger offsets are cut, no file is that large
+
+
+/**
+ * Parse a decimal byte offset.
+ * @input_param     the current position, advanced behind the digits
+ * @input_param     the end of the input
+ * @return          the offset, -1 if there is no digit
+ */
+static off_t
+parse_offset(const char **p, const char *end) {
+    off_t value = -1;
+
+    while (*p < end && isdigit((unsigned char) **p)) {
+        value = (value < 0 ? 0 : value) * 10 + (**p - '0');
+        if (value > RANGE_OFFSET_MAX / 10) {
+            value = RANGE_OFFSET_MAX / 10;
+        } /* end if */
+        (*p)++;
+    } /* end while */
+
+    return value;
+} /* end of parse_offset */
+
+/**
+ * Add a range to the sorted set. Ranges which overlap, or which are
+ * separated by a gap smaller than the overhead of another part, are
+ * coalesced regardless of the order of the request.
+ * @input_param     the set
+ * @input_param     the first byte
+ * @input_param     the last byte
+ * @return          -1 if the set is full
+ */
+static int
+range_add(range_set_t *set, off_t first, off_t last) {
+    byte_range_t *part = set->part;
+    int i, j;
+
+    for (i = 0; i < set->count && part[i].last + RANGE_COALESCE_GAP < first; i++) {
+    } /* end for */
+    for (j = i; j < set->count && part[j].first <= last + RANGE_COALESCE_GAP; j++) {
+        if (part[j].first < first) {
+            first = part[j].first;
+        } /* end if */
+        if (part[j].last > last) {
+            last = part[j].last;
+        } /* end if */
+    } /* end for */
+
+    if (i == j) {
+        if (set->count == RANGE_MAX_PARTS) {
+            return -1;
+        } /* end if */
+        memmove(&part[i + 1], &part[i], (set->count - i) * sizeof (byte_range_t));
+        set->count++;
+    } else {
+        /* parts i to j - 1 become one */
+        memmove(&part[i + 1], &part[j], (set->count - j) * sizeof (byte_range_t));
+        set->count -= j - i - 1;
+    } /* end if */
+    part[i].first = first;
+    part[i].last = last;
+    return 0;
+} /* end of range_add */
+
+/**
+ * Parse the value of a Range field against the size of the file
+ * (RFC 7233): "bytes=" followed by a list of "first-[last]" and
+ * "-suffix" ranges. A list with a syntax error is ignored as a whole,
+ * ranges which begin behind the end of the file are skipped.
+ * @input_param     the field value
+ * @input_param     the size of the file
+ * @output_param    the sorted and coalesced parts
+ * @return          RANGE_NONE if the field is to be ignored,
+ *                  RANGE_NOT_SATISFIABLE if no range is left
+ */
+range_result_t
+range_parse(http_slice_t value, off_t size, range_set_t *set) {
+    const char *p = value.ptr;
+    const char *end = value.ptr + value.len;
+    off_t first, last;
+    bool found = false;
+
+    set->count = 0;
+    set->size = size;
+    if (value.len < 5 || strncasecmp(p, "bytes", 5) != 0) {
+        return RANGE_NONE;
+    } /* end if */
+    for (p += 5; p < end && (*p == ' ' || *p == '\t'); p++) {
+    } /* end for */
+    if (p == end || *p != '=') {
+        return RANGE_NONE;
+    } /* end if */
+    p++;
+
+    while (1) {
+        // the list may contain empty elements
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+            p++;
+        } /* end while */
+        if (p == end) {
+            break;
+        } /* end if */
+
+        first = parse_offset(&p, end);
+        if (p == end || *p != '-') {
+            return RANGE_NONE;
+        } /* end if */
+        p++;
+        last = parse_offset(&p, end);
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            p++;
+        } /* end while */
+        if ((p < end && *p != ',') || (first < 0 && last < 0) || (first >= 0 && last >= 0 && last < first)) {
+            return RANGE_NONE;
+        } /* end if */
+        found = true;
+
+        if (first < 0) {
+            /* the last bytes of the file */
+            if (last == 0 || size == 0) {
+                continue;
+            } /* end if */
+            first = (last < size) ? size - last : 0;
+            last = size - 1;
+        } else if (first >= size) {
+            continue;
+        } else if (last < 0 || last >= size) {
+            last = size - 1;
+        } /* end if */
+
+        if (range_add(set, first, last) < 0) {
+            /* too many parts to be worth it, send the whole file */
+            return RANGE_NONE;
+        } /* end if */
+    } /* end while */
+
+    if (!found) {
+        return RANGE_NONE;
+    } /* end if */
+
+    return (set->count > 0) ? RANGE_SATISFIABLE : RANGE_NOT_SATISFIABLE;
+} /* end of range_parse */
+
+/**
+ * Format the delimiter and the fields in front of a part, or the
+ * closing delimiter behind the last part.
+ * @input_param     the set
+ * @input_param     the part, count for the closing delimiter
+ * @output_param    the buffer
+ * @input_param     the size of the buffer
+ * @return          the length
+ */
+static size_t
+range_format_part(range_set_t *set, int i, char *buf, size_t size) {
+    int n;
+
+    if (i == set->count) {
+        n = snprintf(buf, size, "\r\n--%s--\r\n", set->boundary);
+    } else {
+        // the line break in front of a delimiter belongs to it, the body starts with the first one
+        n = snprintf(buf, size, "%s--%s\r\nContent-Type: %s\r\nContent-Range: bytes %lld-%lld/%lld\r\n\r\n",
+                (i == 0) ? "" : "\r\n", set->boundary, set->content_type,
+                (long long) set->part[i].first, (long long) set->part[i].last, (long long) set->size);
+    } /* end if */
+
+    return ((size_t) n < size) ? (size_t) n : size - 1;
+} /* end of range_format_part */
+
+/**
+ * Prepare a set of several parts for a multipart/byteranges body with
+ * a new boundary and the first part.
+ * @input_param     the set
+ * @input_param     the content type of the file
+ */
+void
+range_multipart_init(range_set_t *set, const char *content_type) {
+    static unsigned int counter = 0;
+
+    set->content_type = (content_type != NULL) ? content_type : "application/octet-stream";
+    snprintf(set->boundary, sizeof (set->boundary), "%08lx%08x",
+            (unsigned long) time(NULL), ((unsigned int) getpid() << 16) ^ ++counter);
+    range_next_part(set, 0);
+} /* end of range_multipart_init */
+
+/**
+ * Compute the length of the multipart/byteranges body.
+ * @input_param     the set, prepared with range_multipart_init()
+ * @return          the length for Content-Length
+ */
+off_t
+range_multipart_length(range_set_t *set) {
+    char buf[RANGE_PART_HEADER_SIZE];
+    off_t len = 0;
+    int i;
+
+    for (i = 0; i < set->count; i++) {
+        len += range_format_part(set, i, buf, sizeof (buf));
+        len += set->part[i].last - set->part[i].first + 1;
+    } /* end for */
+
+    return len + range_format_part(set, set->count, buf, sizeof (buf));
+} /* end of range_multipart_length */
+
+/**
+ * Continue with the next part of a multipart/byteranges body.
+ * @input_param     the set
+ * @input_param     the part, count for the closing delimiter
+ */
+void
+range_next_part(range_set_t *set, int i) {
+    set->current = i;
+    set->part_len = range_format_part(set, i, set->part_header, sizeof (set->part_header));
+    set->part_sent = 0;
+} /* end of range_next_part */
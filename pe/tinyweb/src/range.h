@@ -0,0 +1,60 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _RANGE_H
+#define _RANGE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "http_parser.h"
+
+#define RANGE_MAX_PARTS                    32   // more parts after coalescing serve the whole file
+#define RANGE_COALESCE_GAP                 80   // a smaller gap costs less than another part header
+#define RANGE_BOUNDARY_SIZE                32
+#define RANGE_PART_HEADER_SIZE            256
+
+
+typedef enum range_result {
+    RANGE_NONE = 0,                 // no valid Range field, send the whole file
+    RANGE_SATISFIABLE,              // 206 with the parts of the set
+    RANGE_NOT_SATISFIABLE           // 416, no range overlaps the file
+} range_result_t;
+
+
+typedef struct byte_range {
+    off_t       first;
+    off_t       last;               // inclusive
+} byte_range_t;
+
+
+/*
+ * The parts of a 206 response, sorted and coalesced. A multipart body
+ * is sent part by part, the delimiter and fields of the current part
+ * are in part_header.
+ */
+typedef struct range_set {
+    byte_range_t part[RANGE_MAX_PARTS];
+    int         count;
+    off_t       size;               // size of the file
+    const char *content_type;       // of the file, repeated in each part
+    char        boundary[RANGE_BOUNDARY_SIZE];
+    int         current;            // part being sent, count for the closing delimiter
+    char        part_header[RANGE_PART_HEADER_SIZE];
+    size_t      part_len;
+    size_t      part_sent;
+} range_set_t;
+
+
+extern range_result_t range_parse(http_slice_t value, off_t size, range_set_t *set);
+extern void range_multipart_init(range_set_t *set, const char *content_type);
+extern off_t range_multipart_length(range_set_t *set);
+extern void range_next_part(range_set_t *set, int i);
+
+#endif
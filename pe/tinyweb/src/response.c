@@ -0,0 +1,813 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "tinyweb.h"
+#include "connection.h"
+#include "response.h"
+
+#include "safe_print.h"
+#include "sem_print.h"
+
+#include "http_parser.h"
+#include "content.h"
+#include "http.h"
+#include "socket_io.h"
+#include "file_cache.h"
+#include "header_builder.h"
+#include "metrics.h"
+#include "cgi_pool.h"
+#include "cgi.h"
+#include "fastcgi.h"
+#include "range.h"
+#include "compress.h"
+#include "conditional.h"
+#include "path.h"
+#include "http_date.h"
+
+#define CGI_ENV_SIZE        (3 * BUFFER_SIZE)   // strings of the cgi environment
+#define CGI_ENV_MAX                        32   // variables of the cgi environment
+
+
+/*
+ * Environment of a cgi script, the variables point into buf.
+ */
+typedef struct cgi_env {
+    char                buf[CGI_ENV_SIZE];
+    size_t              len;
+    char               *vars[CGI_ENV_MAX + 1];  // terminated by NULL
+    int                 count;
+} cgi_env_t;
+
+
+/**
+ * write log to stdout or log file
+ * @input_param     the http status of the response
+ * @input_param     the parsed http header
+ * @input_param     the client info
+ * @input_param     the path to requested file
+ * @input_param     the number of bytes of the response
+ * @input_param     the program options
+ * @return          unequal zero in case of error
+ */
+static int
+write_log(http_status_entry_t httpStatus, parsed_http_header_t parsed_header, const struct sockaddr_storage *client, char* filepath, size_t size, prog_options_t *server) {
+    /*
+     * write log, the time string changes once per second only
+     */
+    static time_t log_time = -1;
+    static char date [HTTP_DATE_LEN + 1];
+    char record [BUFFER_SIZE + 256];
+    int len;
+    time_t rawtime = time(NULL);
+    if (rawtime != log_time) {
+        http_date_format(rawtime, date);
+        log_time = rawtime;
+    }
+    // IP Address and port, an IPv6 address in brackets
+    char str[INET6_ADDRSTRLEN + 2];
+    int portNumber;
+    if (client->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *client6 = (const struct sockaddr_in6 *) client;
+        str[0] = '[';
+        inet_ntop(AF_INET6, &client6->sin6_addr, str + 1, INET6_ADDRSTRLEN);
+        strcat(str, "]");
+        portNumber = ntohs(client6->sin6_port);
+    } else {
+        const struct sockaddr_in *client4 = (const struct sockaddr_in *) client;
+        inet_ntop(AF_INET, &client4->sin_addr, str, INET_ADDRSTRLEN);
+        portNumber = ntohs(client4->sin_port);
+    }
+    // Request line, not available for malformed requests
+    http_slice_t method = (parsed_header.method.ptr != NULL) ? parsed_header.method : (http_slice_t) { "-", 1 };
+    http_slice_t protocol = (parsed_header.protocol.ptr != NULL) ? parsed_header.protocol : (http_slice_t) { "-", 1 };
+
+    len = snprintf(record, sizeof (record), "[%d] %s:%d - - [%s] \"%-7.*s %s %.*s\" %d %zu\n", access_log_pid(), str, portNumber, date,
+            (int) method.len, method.ptr, filepath, (int) protocol.len, protocol.ptr, httpStatus.code, size);
+    if (len >= (int) sizeof (record)) { /* cut a very long path */
+        len = sizeof (record) - 1;
+        record[len - 1] = '\n';
+    }
+    access_log_write(record, len);
+    return 0;
+} /*end of write_log */
+
+/**
+ * build the response header from its description
+ * @input_param     the response header data
+ * @input_param     true if the connection stays open
+ * @output_param    the header buffer
+ * @input_param     the size of the header buffer
+ * @return          the length of the header, -1 if it does not fit
+ */
+static int
+build_response_header(http_header_t *response_header_data, bool keep_alive, char *buf, size_t size) {
+    header_builder_t hb;
+
+    header_init(&hb, buf, size);
+    header_add_status(&hb, response_header_data->status);
+    if (response_header_data->cached_fields != NULL) {
+        header_add_raw(&hb, response_header_data->cached_fields, response_header_data->cached_len);
+    } else if (response_header_data->content_length >= 0) {
+        header_add_number(&hb, HTTP_HEADER_CONTENT_LENGTH, response_header_data->content_length);
+    } else if (response_header_data->status != HTTP_STATUS_NOT_MODIFIED) {
+        /* a persistent connection needs the end of the (empty) body */
+        header_add_number(&hb, HTTP_HEADER_CONTENT_LENGTH, 0);
+    } /* end if */
+    if (response_header_data->content_type != NULL) {
+        header_add_field(&hb, HTTP_HEADER_CONTENT_TYPE, response_header_data->content_type);
+    } /* end if */
+    if (response_header_data->content_encoding != NULL) {
+        header_add_field(&hb, HTTP_HEADER_CONTENT_ENCODING, response_header_data->content_encoding);
+    } /* end if */
+    if (response_header_data->vary != NULL) {
+        header_add_field(&hb, HTTP_HEADER_VARY, response_header_data->vary);
+    } /* end if */
+    if (response_header_data->last_modified != 0) {
+        header_add_time(&hb, HTTP_HEADER_LAST_MODIFIED, response_header_data->last_modified);
+    } /* end if */
+    if (response_header_data->etag != NULL) {
+        header_add_field(&hb, HTTP_HEADER_ETAG, response_header_data->etag);
+    } /* end if */
+    if (response_header_data->location != NULL) {
+        header_add_field(&hb, HTTP_HEADER_LOCATION, response_header_data->location);
+    } /* end if */
+    if (response_header_data->range_size >= 0) {
+        header_add_range(&hb, response_header_data->range_first,
+                response_header_data->range_last, response_header_data->range_size);
+    } /* end if */
+    header_add_field(&hb, HTTP_HEADER_CONNECTION, keep_alive ? "keep-alive" : "close");
+
+    return header_finish(&hb);
+} /* end of build_response_header */
+
+/**
+ * prepare a response which consists of the header only
+ * @input_param     the connection
+ * @input_param     the response header data
+ * @input_param     the parsed http header
+ * @input_param     the path to requested file
+ * @input_param     the program options
+ * @return          unequal zero in case of error
+ */
+static int
+respond_header(connection_t *conn, http_header_t *response_header_data, parsed_http_header_t parsed_header, char *filepath, prog_options_t *server) {
+    int len;
+    long long start = metrics_now();
+    len = build_response_header(response_header_data, conn->keep_alive, conn->header, sizeof (conn->header));
+    if (len < 0) {
+        /* e.g. a very long location, answer without the optional fields */
+        http_header_t error_header = {
+            .status = HTTP_STATUS_INTERNAL_SERVER_ERROR,
+            .content_length = -1,
+            .range_size = -1
+        };
+        conn->keep_alive = false;
+        conn->body_offset = conn->body_end = 0;
+        conn->ranges = NULL;
+        *response_header_data = error_header;
+        len = build_response_header(response_header_data, false, conn->header, sizeof (conn->header));
+    } /* end if */
+    conn->header_len = len;
+    conn->header_sent = 0;
+    conn->state = CONN_STATE_SEND_HEADER;
+    if (conn->ranges != NULL) {
+        conn->response_size = conn->header_len + response_header_data->content_length;
+    } else {
+        conn->response_size = conn->header_len + (conn->body_end - conn->body_offset);
+    } /* end if */
+    write_log(http_status_list[response_header_data->status], parsed_header, &conn->client, filepath,
+            conn->response_size, server);
+    metrics_response(response_header_data->status);
+
+    // sending starts now
+    conn->phase_start = metrics_now();
+    metrics_phase(METRICS_PHASE_HEADER, conn->phase_start - start);
+    return 0;
+} /* end of respond_header */
+
+/**
+ * prepare a response which consists of the header and a file
+ * @input_param     the connection
+ * @input_param     the response header data
+ * @input_param     the parsed http header
+ * @input_param     the path to requested file
+ * @input_param     the first byte of the file to send
+ * @input_param     the end of the bytes to send (exclusive)
+ * @input_param     the program options
+ * @return          unequal zero in case of error
+ */
+static int
+respond_file(connection_t *conn, http_header_t *response_header_data, parsed_http_header_t parsed_header, char *filepath, off_t start, off_t end, prog_options_t *server) {
+    conn->body_fd = path_open(parsed_header.filename);
+    if (conn->body_fd < 0) {
+        err_print("ERROR: open()");
+        response_header_data->status = HTTP_STATUS_INTERNAL_SERVER_ERROR;
+        response_header_data->content_length = -1;
+        response_header_data->content_type = NULL;
+        response_header_data->last_modified = 0;
+        response_header_data->range_size = -1;
+        // the 500 has no body, nothing of the parts is left to frame
+        conn->ranges = NULL;
+        conn->body_offset = 0;
+        conn->body_end = 0;
+        return respond_header(conn, response_header_data, parsed_header, filepath, server);
+    } /* end if */
+    conn->body_offset = start;
+    conn->body_end = end;
+
+    return respond_header(conn, response_header_data, parsed_header, filepath, server);
+} /* end of respond_file */
+
+/**
+ * prepare a response for a file from the cache, header and body are
+ * sent with a single writev()
+ * @input_param     the connection
+ * @input_param     the response header data
+ * @input_param     the parsed http header
+ * @input_param     the path to requested file
+ * @input_param     the cache entry, referenced by the connection from now on
+ * @input_param     the program options
+ * @return          unequal zero in case of error
+ */
+static int
+respond_cached(connection_t *conn, http_header_t *response_header_data, parsed_http_header_t parsed_header, char *filepath, file_cache_entry_t *entry, prog_options_t *server) {
+    conn->cache_entry = entry;
+    conn->body_data = entry->data;
+    conn->body_offset = 0;
+    conn->body_end = (parsed_header.methodType == HTTP_METHOD_GET) ? entry->size : 0;
+    response_header_data->cached_fields = entry->header;
+    response_header_data->cached_len = entry->header_len;
+
+    return respond_header(conn, response_header_data, parsed_header, filepath, server);
+} /* end of respond_cached */
+
+/**
+ * prepare a response with a compressed variant of a file, the fields
+ * of the entity besides its length describe the original file
+ * @input_param     the connection
+ * @input_param     the response header data
+ * @input_param     the parsed http header
+ * @input_param     the path to requested file
+ * @input_param     the file descriptor of the variant
+ * @input_param     the size of the variant
+ * @input_param     the coding of the variant
+ * @input_param     the program options
+ * @return          unequal zero in case of error
+ */
+static int
+respond_encoded(connection_t *conn, http_header_t *response_header_data, parsed_http_header_t parsed_header, char *filepath, int fd, off_t size, content_encoding_t encoding, prog_options_t *server) {
+    response_header_data->content_length = size;
+    response_header_data->content_encoding = compress_name(encoding);
+    if (parsed_header.methodType == HTTP_METHOD_GET) {
+        conn->body_fd = fd;
+        conn->body_offset = 0;
+        conn->body_end = size;
+    } else {
+        close(fd);
+    } /* end if */
+
+    return respond_header(conn, response_header_data, parsed_header, filepath, server);
+} /* end of respond_encoded */
+
+/**
+ * prepare a 206 response with the requested parts of a file. A single
+ * part is described by Content-Range, several parts are sent as a
+ * multipart/byteranges body, the bytes of each part with sendfile().
+ * @input_param     the connection
+ * @input_param     the response header data with the content type
+ * @input_param     the parsed http header
+ * @input_param     the path to requested file
+ * @input_param     the file status
+ * @input_param     the parts, sorted and coalesced
+ * @input_param     the program options
+ * @return          unequal zero in case of error
+ */
+static int
+respond_ranges(connection_t *conn, http_header_t *response_header_data, parsed_http_header_t parsed_header, char *filepath, struct stat *fstat, range_set_t *ranges, prog_options_t *server) {
+    char content_type[RANGE_BOUNDARY_SIZE + 64];
+    byte_range_t *part = &ranges->part[0];
+
+    response_header_data->status = HTTP_STATUS_PARTIAL_CONTENT;
+    response_header_data->last_modified = fstat->st_mtime;
+    if (ranges->count == 1) {
+        response_header_data->content_length = part->last - part->first + 1;
+        response_header_data->range_first = part->first;
+        response_header_data->range_last = part->last;
+        response_header_data->range_size = fstat->st_size;
+        return respond_file(conn, response_header_data, parsed_header, filepath, part->first, part->last + 1, server);
+    } /* end if */
+
+    conn->ranges = arena_alloc(&conn->arena, sizeof (range_set_t));
+    if (conn->ranges == NULL) {
+        return -1;
+    } /* end if */
+    *conn->ranges = *ranges;
+    range_multipart_init(conn->ranges, response_header_data->content_type);
+    snprintf(content_type, sizeof (content_type), "multipart/byteranges; boundary=%s", conn->ranges->boundary);
+    response_header_data->content_type = content_type;
+    response_header_data->content_length = range_multipart_length(conn->ranges);
+    return respond_file(conn, response_header_data, parsed_header, filepath, part->first, part->last + 1, server);
+} /* end of respond_ranges */
+
+/**
+ * prepare a response with the counters of all server processes, as
+ * text or, for the query "format=prometheus", in the Prometheus text
+ * exposition format
+ * @input_param     the connection
+ * @input_param     the response header data
+ * @input_param     the parsed http header
+ * @input_param     the program options
+ * @return          unequal zero in case of error
+ */
+static int
+respond_status(connection_t *conn, http_header_t *response_header_data, parsed_http_header_t parsed_header, prog_options_t *server) {
+    bool prometheus = (parsed_header.query.len == 17 && strncmp(parsed_header.query.ptr, "format=prometheus", 17) == 0);
+    int len = -1;
+
+    conn->body_buf = arena_alloc(&conn->arena, METRICS_BUFFER_SIZE);
+    if (conn->body_buf != NULL) {
+        len = metrics_format(conn->body_buf, METRICS_BUFFER_SIZE, prometheus);
+    } /* end if */
+    if (len < 0) {
+        err_print("ERROR: status page");
+        response_header_data->status = HTTP_STATUS_INTERNAL_SERVER_ERROR;
+        return respond_header(conn, response_header_data, parsed_header, METRICS_STATUS_PATH, server);
+    } /* end if */
+
+    conn->body_data = conn->body_buf;
+    conn->body_offset = 0;
+    conn->body_end = (parsed_header.methodType == HTTP_METHOD_GET) ? len : 0;
+    response_header_data->status = HTTP_STATUS_OK;
+    response_header_data->content_length = len;
+    response_header_data->content_type = prometheus ? "text/plain; version=0.0.4" : "text/plain";
+
+    return respond_header(conn, response_header_data, parsed_header, METRICS_STATUS_PATH, server);
+} /* end of respond_status */
+
+/**
+ * Format the numeric host part of a socket address.
+ * @input_param     the address
+ * @output_param    the host string
+ * @input_param     the size of the host string
+ * @return          the port of the address
+ */
+static int
+format_address(const struct sockaddr_storage *addr, char *host, size_t size) {
+    if (addr->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *addr6 = (const struct sockaddr_in6 *) addr;
+        inet_ntop(AF_INET6, &addr6->sin6_addr, host, size);
+        return ntohs(addr6->sin6_port);
+    } /* end if */
+
+    const struct sockaddr_in *addr4 = (const struct sockaddr_in *) addr;
+    inet_ntop(AF_INET, &addr4->sin_addr, host, size);
+    return ntohs(addr4->sin_port);
+} /* end of format_address */
+
+/**
+ * Add a variable to the cgi environment, a variable which does not
+ * fit anymore is left out.
+ * @input_param     the environment
+ * @input_param     the name of the variable
+ * @input_param     the value
+ * @input_param     the length of the value
+ */
+static void
+cgi_setenv(cgi_env_t *env, const char *name, const char *value, size_t len) {
+    size_t space = sizeof (env->buf) - env->len;
+    int n;
+
+    if (env->count >= CGI_ENV_MAX || value == NULL) {
+        return;
+    } /* end if */
+    n = snprintf(env->buf + env->len, space, "%s=%.*s", name, (int) len, value);
+    if (n < 0 || (size_t) n >= space) {
+        return;
+    } /* end if */
+    env->vars[env->count++] = env->buf + env->len;
+    env->vars[env->count] = NULL;
+    env->len += n + 1;
+} /* end of cgi_setenv */
+
+/**
+ * Build the CGI/1.1 meta-variables of a request.
+ * @input_param     the environment
+ * @input_param     the connection
+ * @input_param     the path to the script
+ * @input_param     the program options
+ */
+static void
+cgi_environment(cgi_env_t *env, connection_t *conn, char *filepath, prog_options_t *server) {
+    parsed_http_header_t *parsed_header = &conn->parsed_header;
+    struct sockaddr_storage local;
+    socklen_t local_len = sizeof (local);
+    char host[INET6_ADDRSTRLEN];
+    char number[16];
+    const char *path = getenv("PATH");
+
+    env->len = 0;
+    env->count = 0;
+    env->vars[0] = NULL;
+
+    cgi_setenv(env, "GATEWAY_INTERFACE", "CGI/1.1", 7);
+    cgi_setenv(env, "SERVER_SOFTWARE", SERVER_NAME, strlen(SERVER_NAME));
+    cgi_setenv(env, "SERVER_PROTOCOL", parsed_header->protocol.ptr, parsed_header->protocol.len);
+    if (getsockname(conn->sd, (struct sockaddr *) &local, &local_len) == 0) {
+        snprintf(number, sizeof (number), "%d", format_address(&local, host, sizeof (host)));
+        cgi_setenv(env, "SERVER_NAME", host, strlen(host));
+        cgi_setenv(env, "SERVER_ADDR", host, strlen(host));
+        cgi_setenv(env, "SERVER_PORT", number, strlen(number));
+    } /* end if */
+    cgi_setenv(env, "REQUEST_METHOD", parsed_header->method.ptr, parsed_header->method.len);
+    cgi_setenv(env, "REQUEST_URI", parsed_header->target.ptr, parsed_header->target.len);
+    cgi_setenv(env, "SCRIPT_NAME", parsed_header->filename.ptr, parsed_header->filename.len);
+    cgi_setenv(env, "SCRIPT_FILENAME", filepath, strlen(filepath));
+    cgi_setenv(env, "QUERY_STRING", parsed_header->query.ptr ? parsed_header->query.ptr : "", parsed_header->query.len);
+    cgi_setenv(env, "DOCUMENT_ROOT", server->root_dir, strlen(server->root_dir));
+    snprintf(number, sizeof (number), "%d", format_address(&conn->client, host, sizeof (host)));
+    cgi_setenv(env, "REMOTE_ADDR", host, strlen(host));
+    cgi_setenv(env, "REMOTE_PORT", number, strlen(number));
+    if (parsed_header->host.ptr != NULL) {
+        cgi_setenv(env, "HTTP_HOST", parsed_header->host.ptr, parsed_header->host.len);
+    } /* end if */
+    if (path != NULL) {
+        cgi_setenv(env, "PATH", path, strlen(path));
+    } /* end if */
+} /* end of cgi_environment */
+
+/**
+ * rebuild the path of the requested file for the log
+ * @input_param     the connection
+ * @output_param    the path
+ * @input_param     the size of the path buffer
+ * @input_param     the program options
+ */
+static void
+request_filepath(connection_t *conn, char *filepath, size_t size, prog_options_t *server) {
+    snprintf(filepath, size, "%s%.*s", server->root_dir,
+            (int) conn->parsed_header.filename.len, conn->parsed_header.filename.ptr);
+} /* end of request_filepath */
+
+/**
+ * run a cgi script. With the cgi pool a persistent runner executes
+ * it, otherwise a forked child writes into a pipe. The server relays
+ * the output in both cases and builds the response header from the
+ * header of the script.
+ * @input_param     the connection
+ * @input_param     the path to the script
+ * @input_param     the program options
+ * @return          unequal zero in case of error
+ */
+static int
+start_cgi(connection_t *conn, char *filepath, prog_options_t *server) {
+    char *argv[] = { filepath, NULL };
+    pid_t pid; /* process id */
+    int script;
+    int fd;
+    int fds[2];
+    cgi_env_t env;
+
+    cgi_environment(&env, conn, filepath, server);
+
+    if (server->cgi_pool > 0) {
+        fd = cgi_pool_connect();
+        if (fd < 0) {
+            /* the queue of the runners is full or the pool is gone */
+            return respond_cgi_error(conn, (errno == EAGAIN) ? HTTP_STATUS_SERVICE_UNAVAILABLE
+                    : HTTP_STATUS_BAD_GATEWAY, server);
+        } /* end if */
+        if (fcgi_start(conn, fd, env.vars, server) < 0) {
+            return respond_cgi_error(conn, HTTP_STATUS_INTERNAL_SERVER_ERROR, server);
+        } /* end if */
+        return 0;
+    } /* end if */
+
+    // the script checked by the caller, below the document root and without a shell
+    script = path_open(conn->parsed_header.filename);
+    if (script < 0) {
+        err_print("ERROR: cannot open cgi script");
+        return respond_cgi_error(conn, HTTP_STATUS_INTERNAL_SERVER_ERROR, server);
+    } /* end if */
+
+    // only the server side does not block, the script expects a blocking stdout
+    if (pipe2(fds, O_CLOEXEC) < 0 || conn_set_nonblocking(fds[0]) < 0) {
+        err_print("ERROR: pipe2() in cgi");
+        close(script);
+        return -1;
+    } /* end if */
+
+    pid = fork();
+    if (pid == 0) {
+        /*
+         * child process, a script writing to a closed response ends
+         * with SIGPIPE which the server ignores
+         */
+        signal(SIGPIPE, SIG_DFL);
+        dup2(fds[1], STDOUT_FILENO);
+        // the interpreter of a script reads it through /dev/fd
+        fcntl(script, F_SETFD, 0);
+        fexecve(script, argv, env.vars);
+        _exit(EXIT_FAILURE);
+    } else if (pid < 0) {
+        /*
+         * error while forking
+         */
+        err_print("ERROR: fork() in cgi");
+        close(script);
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    } /* end if */
+
+    /*
+     * parent process, the end of the pipe is the end of the output
+     */
+    close(script);
+    close(fds[1]);
+    if (cgi_start(conn, fds[0], server) < 0) {
+        return respond_cgi_error(conn, HTTP_STATUS_INTERNAL_SERVER_ERROR, server);
+    } /* end if */
+    return 0;
+} /* end of start_cgi */
+
+/**
+ * Process a complete request and prepare the response.
+ * @input_param     the connection holding the request
+ * @input_param     the program options
+ * @return          on error -1 is returned
+ */
+int
+process_request(connection_t *conn, prog_options_t *server) {
+    parsed_http_header_t parsed_header = conn->parsed_header;
+    http_header_t response_header_data = {
+        .status = HTTP_STATUS_INTERNAL_SERVER_ERROR,
+        .content_length = -1,
+        .content_type = NULL,
+        .last_modified = 0,
+        .etag = NULL,
+        .content_encoding = NULL,
+        .vary = NULL,
+        .location = NULL,
+        .range_size = -1,
+        .cached_fields = NULL
+    };
+    path_result_t result; /* what the path names */
+    char filepath[BUFFER_SIZE]; /* path to requested file */
+    char location[BUFFER_SIZE]; /* redirection of a directory */
+    struct stat fstat; /* file status */
+    file_cache_entry_t *entry; /* cached file */
+    range_set_t ranges; /* requested parts of the file */
+    content_encoding_t encoding; /* coding of a compressed variant */
+    off_t size; /* size of a compressed variant */
+    int fd; /* compressed variant */
+    char etag[ETAG_SIZE]; /* entity tag of the file or its variant */
+    http_content_type_t type; /* content type of the file */
+
+    filepath[0] = '\0';
+
+    /*
+     * The request was parsed while it was read, pipelined requests stay in the buffer
+     */
+    conn->keep_alive = conn->keep_alive && parsed_header.keepAlive;
+
+    // check on parsed http status
+    switch (parsed_header.httpState) {
+        case HTTP_STATUS_INTERNAL_SERVER_ERROR:
+        case HTTP_STATUS_BAD_REQUEST:
+        case HTTP_STATUS_URI_TOO_LONG:
+        case HTTP_STATUS_HEADER_TOO_LARGE:
+        case HTTP_STATUS_NOT_IMPLEMENTED:
+            /* a request body, if any, is not read, so the framing is lost */
+            conn->keep_alive = false;
+            response_header_data.status = parsed_header.httpState;
+            return respond_header(conn, &response_header_data, parsed_header, filepath, server);
+        default:
+            break;
+    }
+
+    if (server->status_page && parsed_header.filename.len == strlen(METRICS_STATUS_PATH)
+            && strncmp(parsed_header.filename.ptr, METRICS_STATUS_PATH, parsed_header.filename.len) == 0) {
+        return respond_status(conn, &response_header_data, parsed_header, server);
+    } /* end if */
+
+    snprintf(filepath, sizeof (filepath), "%s%.*s", server->root_dir,
+            (int) parsed_header.filename.len, parsed_header.filename.ptr);
+    conn->phase_start = metrics_now();
+    result = path_lookup(parsed_header.filename, &fstat);
+    metrics_phase(METRICS_PHASE_STAT, metrics_now() - conn->phase_start);
+
+    // check for 404, 403, 301
+    if (result == PATH_NOT_FOUND) { /* 404 */
+        response_header_data.status = HTTP_STATUS_NOT_FOUND;
+        return respond_header(conn, &response_header_data, parsed_header, filepath, server);
+    } else if (result == PATH_FORBIDDEN) { /* 403 - no permission */
+        response_header_data.status = HTTP_STATUS_FORBIDDEN;
+        return respond_header(conn, &response_header_data, parsed_header, filepath, server);
+    } else if (result == PATH_DIRECTORY
+            && parsed_header.filename.ptr[parsed_header.filename.len - 1] == '/') { /* 403 - no listing */
+        response_header_data.status = HTTP_STATUS_FORBIDDEN;
+        return respond_header(conn, &response_header_data, parsed_header, filepath, server);
+    } else if (result == PATH_DIRECTORY) { /* 301 */
+        response_header_data.status = HTTP_STATUS_MOVED_PERMANENTLY;
+        snprintf(location, sizeof (location), "%.*s/",
+                (int) parsed_header.filename.len, parsed_header.filename.ptr);
+        response_header_data.location = location;
+        return respond_header(conn, &response_header_data, parsed_header, filepath, server);
+    }
+
+    // already checked for 404
+    if (parsed_header.isCGI) {
+        /*
+         * Check executable, only on success go on
+         */
+        if (fstat.st_mode & S_IEXEC) {
+            return start_cgi(conn, filepath, server);
+        } else { /* 403 - Not executable*/
+            response_header_data.status = HTTP_STATUS_FORBIDDEN;
+            return respond_header(conn, &response_header_data, parsed_header, filepath, server);
+        }
+    }
+
+    // text is sent compressed if the client accepts it
+    type = get_http_content_type(filepath);
+    if (http_content_type_compressible(type)) {
+        response_header_data.vary = "Accept-Encoding";
+    } /* end if */
+
+    // the parts of a range refer to the original, a compressed variant has an entity tag of its own
+    fd = -1;
+    etag[0] = '\0';
+    if (response_header_data.vary != NULL && parsed_header.acceptEncoding.ptr != NULL
+            && parsed_header.range.ptr == NULL) {
+        fd = compress_open(parsed_header.filename, &fstat, compress_accepted(parsed_header.acceptEncoding), &encoding, &size);
+        if (fd >= 0) {
+            etag_format(&fstat, compress_name(encoding), etag, sizeof (etag));
+            response_header_data.etag = etag;
+        } /* end if */
+    } /* end if */
+
+    // check for 304, 412 against the tag of the representation to be sent
+    if (conditional_present(&parsed_header)) {
+        if (etag[0] == '\0') {
+            etag_format(&fstat, NULL, etag, sizeof (etag));
+            response_header_data.etag = etag;
+        } /* end if */
+        response_header_data.status = conditional_check(&parsed_header, &fstat, etag);
+        if (response_header_data.status != HTTP_STATUS_OK) {
+            if (fd >= 0) {
+                close(fd);
+            } /* end if */
+            return respond_header(conn, &response_header_data, parsed_header, filepath, server);
+        } /* end if */
+    } /* end if */
+
+    if (fd >= 0) {
+        response_header_data.status = HTTP_STATUS_OK;
+        response_header_data.content_type = get_http_content_type_str(type);
+        response_header_data.last_modified = fstat.st_mtime;
+        return respond_encoded(conn, &response_header_data, parsed_header, filepath, fd, size, encoding, server);
+    } /* end if */
+
+    // a Range of a GET request, other methods ignore it, and so does If-Range for another version
+    if (parsed_header.range.ptr != NULL && parsed_header.methodType == HTTP_METHOD_GET
+            && conditional_range(&parsed_header, &fstat, etag)) {
+        if (etag[0] == '\0') {
+            etag_format(&fstat, NULL, etag, sizeof (etag));
+            response_header_data.etag = etag;
+        } /* end if */
+        switch (range_parse(parsed_header.range, fstat.st_size, &ranges)) {
+            case RANGE_SATISFIABLE:
+                response_header_data.content_type = get_http_content_type_str(type);
+                return respond_ranges(conn, &response_header_data, parsed_header, filepath, &fstat, &ranges, server);
+            case RANGE_NOT_SATISFIABLE:
+                response_header_data.status = HTTP_STATUS_RANGE_NOT_SATISFIABLE;
+                response_header_data.range_first = -1;
+                response_header_data.range_size = fstat.st_size;
+                return respond_header(conn, &response_header_data, parsed_header, filepath, server);
+            default:
+                break;
+        } /* end switch */
+    } /* end if */
+
+    // check on parsed http method
+    response_header_data.status = HTTP_STATUS_OK;
+    entry = file_cache_lookup(parsed_header.filename, &fstat, type);
+    if (entry != NULL) {
+        response_header_data.etag = entry->etag;
+        return respond_cached(conn, &response_header_data, parsed_header, filepath, entry, server);
+    } /* end if */
+    if (etag[0] == '\0') {
+        etag_format(&fstat, NULL, etag, sizeof (etag));
+        response_header_data.etag = etag;
+    } /* end if */
+    response_header_data.content_length = fstat.st_size;
+    response_header_data.content_type = get_http_content_type_str(type);
+    response_header_data.last_modified = fstat.st_mtime;
+    if (parsed_header.methodType == HTTP_METHOD_GET) { /* GET method */
+        return respond_file(conn, &response_header_data, parsed_header, filepath, 0, fstat.st_size, server);
+    } else { /* HEAD method */
+        return respond_header(conn, &response_header_data, parsed_header, filepath, server);
+    }
+} /* end of process_request */
+
+/**
+ * Answer a connection with 503 if the server is overloaded and close
+ * it without waiting for the client, the request is not read.
+ * @input_param     the socket descriptor of the connection
+ * @input_param     the client address
+ * @input_param     the program options
+ */
+void
+respond_unavailable(int sd, const struct sockaddr_storage *client, prog_options_t *server) {
+    parsed_http_header_t parsed_header;
+    header_builder_t hb;
+    char buf[BUFFER_SIZE];
+    int len;
+
+    // discard a request which is already there, the close must not reset the connection
+    while (recv(sd, buf, sizeof (buf), MSG_DONTWAIT) > 0) {
+    } /* end while */
+
+    header_init(&hb, buf, sizeof (buf));
+    header_add_status(&hb, HTTP_STATUS_SERVICE_UNAVAILABLE);
+    header_add_number(&hb, HTTP_HEADER_RETRY_AFTER, 1);
+    header_add_number(&hb, HTTP_HEADER_CONTENT_LENGTH, 0);
+    header_add_field(&hb, HTTP_HEADER_CONNECTION, "close");
+    len = header_finish(&hb);
+    if (len > 0) {
+        send(sd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    } /* end if */
+
+    memset(&parsed_header, 0, sizeof (parsed_header));
+    write_log(http_status_list[HTTP_STATUS_SERVICE_UNAVAILABLE], parsed_header, client, "-", 0, server);
+    metrics_response(HTTP_STATUS_SERVICE_UNAVAILABLE);
+    close(sd);
+} /* end of respond_unavailable */
+
+/**
+ * Answer a cgi request with an error status instead of the output of
+ * the script and close the connection afterwards.
+ * @input_param     the connection
+ * @input_param     the error status
+ * @input_param     the program options
+ * @return          unequal zero in case of error
+ */
+int
+respond_cgi_error(connection_t *conn, http_status_t status, prog_options_t *server) {
+    char filepath[BUFFER_SIZE];
+    http_header_t response_header_data = {
+        .status = status,
+        .content_length = -1,
+        .content_type = NULL,
+        .last_modified = 0,
+        .location = NULL,
+        .range_size = -1,
+        .cached_fields = NULL
+    };
+
+    conn->keep_alive = false;
+    request_filepath(conn, filepath, sizeof (filepath), server);
+    return respond_header(conn, &response_header_data, conn->parsed_header, filepath, server);
+} /* end of respond_cgi_error */
+
+/**
+ * Log a cgi response relayed by the server, once it is sent, with
+ * the status set by the script.
+ * @input_param     the connection
+ * @input_param     the program options
+ */
+void
+log_cgi_response(connection_t *conn, prog_options_t *server) {
+    char filepath[BUFFER_SIZE];
+    http_status_entry_t entry = { conn->cgi_status, "" };
+    int i;
+
+    request_filepath(conn, filepath, sizeof (filepath), server);
+    for (i = 0; i < HTTP_STATUS_COUNT; i++) {
+        if (http_status_list[i].code == conn->cgi_status) {
+            entry = http_status_list[i];
+            metrics_response(i);
+        } /* end if */
+    } /* end for */
+    write_log(entry, conn->parsed_header, &conn->client, filepath, conn->response_size, server);
+} /* end of log_cgi_response */
@@ -0,0 +1,21 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _RESPONSE_H
+#define _RESPONSE_H
+
+#include "tinyweb.h"
+#include "connection.h"
+
+extern int process_request(connection_t *conn, prog_options_t *server);
+extern void respond_unavailable(int sd, const struct sockaddr_storage *client, prog_options_t *server);
+extern int respond_cgi_error(connection_t *conn, http_status_t status, prog_options_t *server);
+extern void log_cgi_response(connection_t *conn, prog_options_t *server);
+
+#endif
@@ -0,0 +1,104 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tinyweb.h"
+#include "slab.h"
+
+/*
+ * Buffers of a few power of two sizes for the connections. A slab of
+ * SLAB_MAX_SIZE bytes is cut into buffers of one size, a released
+ * buffer goes onto the free list of its size and is handed out again
+ * before a new slab is allocated. The slabs are never returned, the
+ * pool keeps the size of the busiest moment of the serving process.
+ */
+typedef struct slab_buffer {
+    struct slab_buffer *next;
+} slab_buffer_t;
+
+
+static slab_buffer_t *free_list[SLAB_CLASSES];
+
+
+/**
+ * Find the size class of a buffer.
+ * @input_param     the minimum size
+ * @return          the class, -1 if the size exceeds SLAB_MAX_SIZE
+ */
+static int
+size_class(size_t size) {
+    size_t class_size = SLAB_MIN_SIZE;
+    int i;
+
+    for (i = 0; i < SLAB_CLASSES; i++, class_size *= 2) {
+        if (size <= class_size) {
+            return i;
+        } /* end if */
+    } /* end for */
+
+    return -1;
+} /* end of size_class */
+
+/**
+ * Take a buffer from the pool.
+ * @input_param     the minimum size, rounded up to the size of the
+ *                  buffer
+ * @return          the buffer, NULL in case of error
+ */
+char *
+slab_alloc(size_t *size) {
+    int class = size_class(*size);
+    size_t class_size;
+    slab_buffer_t *buf;
+    char *slab;
+    size_t i;
+
+    if (class < 0) {
+        return NULL;
+    } /* end if */
+    class_size = (size_t) SLAB_MIN_SIZE << class;
+
+    if (free_list[class] == NULL) {
+        slab = malloc(SLAB_MAX_SIZE);
+        if (slab == NULL) {
+            err_print("ERROR: Cannot allocate slab");
+            return NULL;
+        } /* end if */
+        for (i = 0; i < SLAB_MAX_SIZE; i += class_size) {
+            buf = (slab_buffer_t *) (slab + i);
+            buf->next = free_list[class];
+            free_list[class] = buf;
+        } /* end for */
+    } /* end if */
+
+    buf = free_list[class];
+    free_list[class] = buf->next;
+    *size = class_size;
+    return (char *) buf;
+} /* end of slab_alloc */
+
+/**
+ * Return a buffer to the pool.
+ * @input_param     the buffer, NULL is ignored
+ * @input_param     the size returned by slab_alloc()
+ */
+void
+slab_free(char *buf, size_t size) {
+    slab_buffer_t *entry = (slab_buffer_t *) buf;
+    int class = size_class(size);
+
+    if (buf == NULL || class < 0) {
+        return;
+    } /* end if */
+
+    entry->next = free_list[class];
+    free_list[class] = entry;
+} /* end of slab_free */
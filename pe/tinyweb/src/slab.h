@@ -0,0 +1,23 @@
+/*===================================================================
+ * DHBW Ravensburg - Campus Friedrichshafen
+ *
+ * Vorlesung Verteilte Systeme
+ *
+ * Author:  Michael Christa, Florian Hink
+ *
+ *===================================================================*/
+
+#ifndef _SLAB_H
+#define _SLAB_H
+
+#include <stddef.h>
+
+#define SLAB_MIN_SIZE            4096   // smallest buffer, a power of two
+#define SLAB_MAX_SIZE           65536   // largest buffer and size of a slab
+#define SLAB_CLASSES                5   // buffer sizes from SLAB_MIN_SIZE to SLAB_MAX_SIZE
+
+
+extern char *slab_alloc(size_t *size);
+extern void slab_free(char *buf, size_t size);
+
+#endif
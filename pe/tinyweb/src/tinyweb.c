@@ -12,6 +12,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <arpa/inet.h>
 #include <syslog.h>
 #include <netdb.h>
@@ -24,6 +26,8 @@
 #include <signal.h>
 #include <getopt.h>
 #include <fcntl.h>
+#include <sched.h>
+#include <limits.h>
 
 #include "tinyweb.h"
 #include "connect_tcp.h"
@@ -35,6 +39,15 @@
 #include "content.h"
 #include "http.h"
 #include "socket_io.h"
+#include "connection.h"
+#include "event_loop.h"
+#include "file_cache.h"
+#include "metrics.h"
+#include "prefork.h"
+#include "response.h"
+#include "cgi_pool.h"
+#include "compress.h"
+#include "path.h"
 
 
 // Must be true for the server accepting clients,
@@ -43,12 +56,49 @@ static volatile sig_atomic_t server_running = false;
 
 #define IS_ROOT_DIR(mode)   (S_ISDIR(mode) && ((S_IROTH || S_IXOTH) & (mode)))
 
+// long options without a short form
+enum {
+    OPT_MIN_SPARE = 256,
+    OPT_MAX_SPARE,
+    OPT_MAX_WORKERS,
+    OPT_MAX_REQUESTS,
+    OPT_MAX_QUEUE,
+    OPT_DEFER_ACCEPT,
+    OPT_FASTOPEN,
+    OPT_CGI_POOL,
+    OPT_CGI_RUNNER,
+    OPT_CGI_TIMEOUT,
+    OPT_COMPRESS_CACHE,
+    OPT_MIME_TYPES
+};
+
 static void
 print_usage(const char *progname) {
-    fprintf(stderr, "Usage: %s options\n%s%s%s%s", progname,
+    fprintf(stderr, "Usage: %s options\n%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s", progname,
             "\t-d\tthe directory of web files\n",
             "\t-f\tthe logfile (if '-' or option not set; logging will be redirected to stdout\n",
             "\t-p\tthe port logging is redirected to stdout.for the server\n",
+            "\t-a\tthe host name or address to listen on (default all IPv4 and IPv6 addresses)\n",
+            "\t-m\tthe serving mode: 'prefork' (default, pool of processes), 'fork' (one process per client) or 'epoll'\n",
+            "\t-w\tthe number of worker processes, each with its own listener, pinned to a CPU in epoll mode (default 0)\n",
+            "\t-t\tthe timeout in seconds for idle and stalled connections (default 120)\n",
+            "\t-c\tthe memory budget of the file cache in kB, 0 disables it (default 16384)\n",
+            "\t-l\tthe flush interval of the access log in ms, 0 writes every record directly (default 100)\n",
+            "\t-o\tif the access log buffer is full: 'block' (default) or 'drop' records\n",
+            "\t-s\tserve the server counters on /server-status (?format=prometheus)\n",
+            "\t-b\tthe length of the accept queue (default 511)\n",
+            "\t--defer-accept\tthe seconds to wait for the request before a client is accepted, 0 off (default 0)\n",
+            "\t--fastopen\tthe number of pending TCP Fast Open requests, 0 off (default 0)\n",
+            "\t--min-spare\tthe minimum number of idle prefork workers (default 5)\n",
+            "\t--max-spare\tthe maximum number of idle prefork workers (default 10)\n",
+            "\t--max-workers\tthe maximum number of prefork workers, shared by the -w workers (default 150)\n",
+            "\t--max-requests\tthe requests until a prefork worker is replaced, 0 never (default 10000)\n",
+            "\t--max-queue\tthe waiting clients answered with 503 if all prefork workers are busy (default 32)\n",
+            "\t--cgi-pool\tthe number of persistent FastCGI runners for /cgi-bin, 0 forks per request (default 0)\n",
+            "\t--cgi-runner\tthe FastCGI runner program (default " CGI_POOL_DEFAULT_RUNNER ")\n",
+            "\t--cgi-timeout\tthe seconds a request to a runner may take (default 30)\n",
+            "\t--compress-cache\tthe disk budget of the gzip/brotli variants built in the background in kB, 0 off (default 65536)\n",
+            "\t--mime-types\ta file in the mime.types format adding to the built-in content types\n",
             "TIT12 Gruppe 7: Michael Christa, Florian Hink\n");
 } /* end of print_usage */
 
@@ -56,8 +106,10 @@ static int
 get_options(int argc, char *argv[], prog_options_t *opt) {
     int c;
     int err;
+    long value;
     int success = 1;
     char *p;
+    char *port = NULL;
     struct addrinfo hints;
 
     p = strrchr(argv[0], '/');
@@ -77,9 +129,29 @@ get_options(int argc, char *argv[], prog_options_t *opt) {
 
     opt->log_filename = NULL;
     opt->root_dir = NULL;
+    opt->listen_address = NULL;
     opt->server_addr = NULL;
     opt->verbose = 0;
     opt->timeout = 120;
+    opt->mode = SERVER_MODE_PREFORK;
+    opt->workers = 0;
+    opt->cache_size = FILE_CACHE_DEFAULT_SIZE;
+    opt->log_flush = LOG_DEFAULT_FLUSH_MS;
+    opt->log_overflow = LOG_OVERFLOW_BLOCK;
+    opt->status_page = false;
+    opt->min_spare = PREFORK_DEFAULT_MIN_SPARE;
+    opt->max_spare = PREFORK_DEFAULT_MAX_SPARE;
+    opt->max_workers = PREFORK_DEFAULT_MAX_WORKERS;
+    opt->max_requests = PREFORK_DEFAULT_MAX_REQUESTS;
+    opt->max_queue = PREFORK_DEFAULT_MAX_QUEUE;
+    opt->backlog = DEFAULT_BACKLOG;
+    opt->defer_accept = 0;
+    opt->fastopen = 0;
+    opt->cgi_pool = 0;
+    opt->cgi_runner = CGI_POOL_DEFAULT_RUNNER;
+    opt->cgi_timeout = CGI_POOL_DEFAULT_TIMEOUT;
+    opt->compress_size = COMPRESS_DEFAULT_SIZE;
+    opt->mime_types = NULL;
 
     memset(&hints, 0, sizeof (struct addrinfo));
     hints.ai_socktype = SOCK_STREAM;
@@ -89,15 +161,36 @@ get_options(int argc, char *argv[], prog_options_t *opt) {
     while (success) {
         int option_index = 0;
         static struct option long_options[] = {
-            { "file", required_argument, 0, 0},
-            { "port", required_argument, 0, 0},
-            { "dir", required_argument, 0, 0},
-            { "verbose", no_argument, 0, 0},
+            { "file", required_argument, 0, 'f'},
+            { "port", required_argument, 0, 'p'},
+            { "address", required_argument, 0, 'a'},
+            { "dir", required_argument, 0, 'd'},
+            { "mode", required_argument, 0, 'm'},
+            { "workers", required_argument, 0, 'w'},
+            { "timeout", required_argument, 0, 't'},
+            { "cache", required_argument, 0, 'c'},
+            { "log-flush", required_argument, 0, 'l'},
+            { "log-overflow", required_argument, 0, 'o'},
+            { "status", no_argument, 0, 's'},
+            { "backlog", required_argument, 0, 'b'},
+            { "defer-accept", required_argument, 0, OPT_DEFER_ACCEPT},
+            { "fastopen", required_argument, 0, OPT_FASTOPEN},
+            { "min-spare", required_argument, 0, OPT_MIN_SPARE},
+            { "max-spare", required_argument, 0, OPT_MAX_SPARE},
+            { "max-workers", required_argument, 0, OPT_MAX_WORKERS},
+            { "max-requests", required_argument, 0, OPT_MAX_REQUESTS},
+            { "max-queue", required_argument, 0, OPT_MAX_QUEUE},
+            { "cgi-pool", required_argument, 0, OPT_CGI_POOL},
+            { "cgi-runner", required_argument, 0, OPT_CGI_RUNNER},
+            { "cgi-timeout", required_argument, 0, OPT_CGI_TIMEOUT},
+            { "compress-cache", required_argument, 0, OPT_COMPRESS_CACHE},
+            { "mime-types", required_argument, 0, OPT_MIME_TYPES},
+            { "verbose", no_argument, 0, 'v'},
             { "debug", no_argument, 0, 0},
             { NULL, 0, 0, 0}
         };
 
-        c = getopt_long(argc, argv, "f:p:d:hv", long_options, &option_index);
+        c = getopt_long(argc, argv, "f:p:a:d:m:w:t:c:l:o:sb:hv", long_options, &option_index);
         if (c == -1) break;
 
         switch (c) {
@@ -112,12 +205,18 @@ get_options(int argc, char *argv[], prog_options_t *opt) {
                 } /* end if */
                 break;
             case 'p':
-                // 'optarg' contains port number
-                if ((err = getaddrinfo(NULL, optarg, &hints, &opt->server_addr)) != 0) {
-                    fprintf(stderr, "Cannot resolve service '%s': %s\n", optarg, gai_strerror(err));
+                // 'optarg' contains port number, resolved with the address below
+                port = optarg;
+                break;
+            case 'a':
+                // 'optarg' contains the host to listen on
+                opt->listen_address = (char *) malloc(strlen(optarg) + 1);
+                if (opt->listen_address != NULL) {
+                    strcpy(opt->listen_address, optarg);
+                } else {
+                    err_print("cannot allocate memory");
                     return EXIT_FAILURE;
                 } /* end if */
-                opt->server_port = (int) ntohs(((struct sockaddr_in*) opt->server_addr->ai_addr)->sin_port);
                 break;
             case 'd':
                 // 'optarg contains root directory */
@@ -129,6 +228,180 @@ get_options(int argc, char *argv[], prog_options_t *opt) {
                     return EXIT_FAILURE;
                 } /* end if */
                 break;
+            case 'm':
+                // 'optarg' contains the serving mode
+                if (strcmp(optarg, "prefork") == 0) {
+                    opt->mode = SERVER_MODE_PREFORK;
+                } else if (strcmp(optarg, "fork") == 0) {
+                    opt->mode = SERVER_MODE_FORK;
+                } else if (strcmp(optarg, "epoll") == 0) {
+                    opt->mode = SERVER_MODE_EPOLL;
+                } else {
+                    fprintf(stderr, "Unknown mode '%s'\n", optarg);
+                    success = 0;
+                } /* end if */
+                break;
+            case 'w':
+                // 'optarg' contains the number of worker processes
+                opt->workers = atoi(optarg);
+                if (opt->workers < 0 || opt->workers > MAX_WORKERS) {
+                    fprintf(stderr, "Number of workers must be between 0 and %d\n", MAX_WORKERS);
+                    success = 0;
+                } /* end if */
+                break;
+            case 't':
+                // 'optarg' contains the timeout in seconds
+                value = atol(optarg);
+                if (value <= 0 || value > USHRT_MAX) {
+                    fprintf(stderr, "Invalid timeout '%s'\n", optarg);
+                    success = 0;
+                } else {
+                    opt->timeout = value;
+                } /* end if */
+                break;
+            case 'c':
+                // 'optarg' contains the cache size in kB
+                value = atol(optarg);
+                if (value < 0 || (optarg[0] != '0' && value == 0)) {
+                    fprintf(stderr, "Invalid cache size '%s'\n", optarg);
+                    success = 0;
+                } else {
+                    opt->cache_size = value;
+                } /* end if */
+                break;
+            case 'l':
+                // 'optarg' contains the flush interval in ms
+                value = atol(optarg);
+                if (value < 0 || value > 60000 || (optarg[0] != '0' && value == 0)) {
+                    fprintf(stderr, "Invalid flush interval '%s'\n", optarg);
+                    success = 0;
+                } else {
+                    opt->log_flush = value;
+                } /* end if */
+                break;
+            case 'o':
+                // 'optarg' contains the overflow policy of the access log
+                if (strcmp(optarg, "block") == 0) {
+                    opt->log_overflow = LOG_OVERFLOW_BLOCK;
+                } else if (strcmp(optarg, "drop") == 0) {
+                    opt->log_overflow = LOG_OVERFLOW_DROP;
+                } else {
+                    fprintf(stderr, "Unknown overflow policy '%s'\n", optarg);
+                    success = 0;
+                } /* end if */
+                break;
+            case 's':
+                opt->status_page = true;
+                break;
+            case 'b':
+                // 'optarg' contains the length of the accept queue
+                value = atol(optarg);
+                if (value <= 0 || value > INT_MAX) {
+                    fprintf(stderr, "Invalid backlog '%s'\n", optarg);
+                    success = 0;
+                } else {
+                    opt->backlog = value;
+                } /* end if */
+                break;
+            case OPT_DEFER_ACCEPT:
+                // 'optarg' contains the timeout in seconds
+                value = atol(optarg);
+                if (value < 0 || value > USHRT_MAX || (optarg[0] != '0' && value == 0)) {
+                    fprintf(stderr, "Invalid defer timeout '%s'\n", optarg);
+                    success = 0;
+                } else {
+                    opt->defer_accept = value;
+                } /* end if */
+                break;
+            case OPT_FASTOPEN:
+                // 'optarg' contains the length of the Fast Open queue
+                value = atol(optarg);
+                if (value < 0 || value > INT_MAX || (optarg[0] != '0' && value == 0)) {
+                    fprintf(stderr, "Invalid Fast Open queue length '%s'\n", optarg);
+                    success = 0;
+                } else {
+                    opt->fastopen = value;
+                } /* end if */
+                break;
+            case OPT_MIN_SPARE:
+            case OPT_MAX_SPARE:
+                // 'optarg' contains the number of idle workers
+                value = atol(optarg);
+                if (value < 0 || value > PREFORK_MAX_WORKERS || (optarg[0] != '0' && value == 0)) {
+                    fprintf(stderr, "Invalid number of spare workers '%s'\n", optarg);
+                    success = 0;
+                } else if (c == OPT_MIN_SPARE) {
+                    opt->min_spare = value;
+                } else {
+                    opt->max_spare = value;
+                } /* end if */
+                break;
+            case OPT_MAX_WORKERS:
+                // 'optarg' contains the size of the pool
+                value = atol(optarg);
+                if (value <= 0 || value > PREFORK_MAX_WORKERS) {
+                    fprintf(stderr, "Number of workers must be between 1 and %d\n", PREFORK_MAX_WORKERS);
+                    success = 0;
+                } else {
+                    opt->max_workers = value;
+                } /* end if */
+                break;
+            case OPT_MAX_REQUESTS:
+                // 'optarg' contains the requests per worker
+                value = atol(optarg);
+                if (value < 0 || (optarg[0] != '0' && value == 0)) {
+                    fprintf(stderr, "Invalid number of requests '%s'\n", optarg);
+                    success = 0;
+                } else {
+                    opt->max_requests = value;
+                } /* end if */
+                break;
+            case OPT_MAX_QUEUE:
+                // 'optarg' contains the length of the accept queue
+                value = atol(optarg);
+                if (value < 0 || value > INT_MAX || (optarg[0] != '0' && value == 0)) {
+                    fprintf(stderr, "Invalid queue length '%s'\n", optarg);
+                    success = 0;
+                } else {
+                    opt->max_queue = value;
+                } /* end if */
+                break;
+            case OPT_CGI_POOL:
+                // 'optarg' contains the number of runners
+                value = atol(optarg);
+                if (value < 0 || value > CGI_POOL_MAX_RUNNERS || (optarg[0] != '0' && value == 0)) {
+                    fprintf(stderr, "Number of cgi runners must be between 0 and %d\n", CGI_POOL_MAX_RUNNERS);
+                    success = 0;
+                } else {
+                    opt->cgi_pool = value;
+                } /* end if */
+                break;
+            case OPT_CGI_RUNNER:
+                opt->cgi_runner = optarg;
+                break;
+            case OPT_CGI_TIMEOUT:
+                // 'optarg' contains the timeout in seconds
+                value = atol(optarg);
+                if (value <= 0 || value > USHRT_MAX) {
+                    fprintf(stderr, "Invalid cgi timeout '%s'\n", optarg);
+                    success = 0;
+                } else {
+                    opt->cgi_timeout = value;
+                } /* end if */
+                break;
+            case OPT_COMPRESS_CACHE:
+                // 'optarg' contains the budget in kB
+                value = atol(optarg);
+                if (value < 0 || (optarg[0] != '0' && value == 0)) {
+                    fprintf(stderr, "Invalid compressed cache size '%s'\n", optarg);
+                    success = 0;
+                } else {
+                    opt->compress_size = value;
+                } /* end if */
+                break;
+            case OPT_MIME_TYPES:
+                opt->mime_types = optarg;
+                break;
             case 'h':
                 break;
             case 'v':
@@ -139,6 +412,24 @@ get_options(int argc, char *argv[], prog_options_t *opt) {
         } /* end switch */
     } /* end while */
 
+    if (opt->max_spare < opt->min_spare) {
+        // keep the pool from starting and retiring workers in turn
+        opt->max_spare = opt->min_spare;
+    } /* end if */
+
+    if (success && port != NULL) {
+        // listen on every address of the host, all local addresses without one
+        if ((err = getaddrinfo(opt->listen_address, port, &hints, &opt->server_addr)) != 0) {
+            fprintf(stderr, "Cannot resolve '%s' port '%s': %s\n",
+                    opt->listen_address ? opt->listen_address : "*", port, gai_strerror(err));
+            opt->server_addr = NULL;
+        } else if (opt->server_addr->ai_family == AF_INET6) {
+            opt->server_port = (int) ntohs(((struct sockaddr_in6 *) opt->server_addr->ai_addr)->sin6_port);
+        } else {
+            opt->server_port = (int) ntohs(((struct sockaddr_in *) opt->server_addr->ai_addr)->sin_port);
+        } /* end if */
+    } /* end if */
+
     // check presence of required program parameters
     success = success && opt->server_addr && opt->root_dir;
 
@@ -157,6 +448,8 @@ open_logfile(prog_options_t *opt) {
             err_print("ERROR: Cannot open logfile");
             exit(EXIT_FAILURE);
         } /* end if */
+        // the processes append their batches without a lock
+        fcntl(fileno(opt->log_fd), F_SETFL, O_APPEND);
     } else {
         printf("Note: logging is redirected to stdout.\n");
         opt->log_fd = stdout;
@@ -181,6 +474,7 @@ check_root_dir(prog_options_t *opt) {
 static void
 sig_handler(int sig) {
     int status;
+    pid_t pid;
     switch (sig) {
         case SIGINT:
             // use our own thread-safe implemention of printf
@@ -188,7 +482,8 @@ sig_handler(int sig) {
             server_running = false;
             break;
         case SIGCHLD:
-            while (waitpid(-1, &status, WNOHANG) > 0) {
+            while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+                metrics_reap(pid);
             }
             break;
         case SIGSEGV:
@@ -204,6 +499,25 @@ sig_handler(int sig) {
     } /* end switch */
 } /* end of sig_handler */
 
+/**
+ * Install or reset the SIGCHLD handler.
+ * @input_param     true to reap children in the handler, false to
+ *                  leave them to an explicit waitpid()
+ */
+static void
+install_sigchld_handler(bool reap) {
+    struct sigaction sa;
+
+    // reap cgi children of the event loop, restart interrupted calls
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = reap ? sig_handler : SIG_DFL;
+    if (sigaction(SIGCHLD, &sa, NULL) < 0) {
+        err_print("sigaction(SIGCHLD)");
+        exit(EXIT_FAILURE);
+    } /* end if */
+} /* end of install_sigchld_handler */
+
 static void
 install_signal_handlers(void) {
     struct sigaction sa;
@@ -216,24 +530,36 @@ install_signal_handlers(void) {
         err_print("sigaction(SIGINT)");
         exit(EXIT_FAILURE);
     } /* end if */
+
+    install_sigchld_handler(true);
+
+    // a client closing its connection early must not kill the server
+    sa.sa_flags = 0;
+    sa.sa_handler = SIG_IGN;
+    if (sigaction(SIGPIPE, &sa, NULL) < 0) {
+        err_print("sigaction(SIGPIPE)");
+        exit(EXIT_FAILURE);
+    } /* end if */
 } /* end of install_signal_handlers */
 
 /**
- * Creates a server socket.
+ * Creates a non-blocking server socket.
  * @param   the program options
+ * @param   the address to listen on
+ * @param   true if an IPv6 socket must not accept IPv4 clients
  * @return  the socket descriptor
  */
-int
-create_server_socket(prog_options_t *server) {
+static int
+create_server_socket(prog_options_t *server, struct addrinfo *addr, bool v6only) {
     int sfd; /* socket file descriptor */
     int retcode; /* return code from bind */
     const int on = 1; /* used to set socket option */
-    const int qlen = 5; /* socket descriptor */
+    const int v6 = v6only;
 
     /*
      * Create a socket
      */
-    sfd = socket(PF_INET, SOCK_STREAM, server->server_addr->ai_protocol);
+    sfd = socket(addr->ai_family, addr->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, addr->ai_protocol);
     if (sfd < 0) {
         err_print("ERROR: server socket()");
         return -1;
@@ -243,22 +569,52 @@ create_server_socket(prog_options_t *server) {
      * Set socket options.
      */
     setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof (on));
+    if (addr->ai_family == AF_INET6) {
+        /* the IPv4 address has its own listener, or '::' serves both */
+        if (setsockopt(sfd, IPPROTO_IPV6, IPV6_V6ONLY, &v6, sizeof (v6)) < 0) {
+            err_print("ERROR: setsockopt(IPV6_V6ONLY)");
+            close(sfd);
+            return -1;
+        } /* end if */
+    } /* end if */
+    if (server->workers > 0) {
+        /* every worker binds its own listener, the kernel balances between them */
+        if (setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof (on)) < 0) {
+            err_print("ERROR: setsockopt(SO_REUSEPORT)");
+            close(sfd);
+            return -1;
+        } /* end if */
+    } /* end if */
+    if (server->defer_accept > 0) {
+        /* wake the server when the request arrives, not after the handshake */
+        if (setsockopt(sfd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &server->defer_accept, sizeof (int)) < 0) {
+            err_print("WARNING: setsockopt(TCP_DEFER_ACCEPT)");
+        } /* end if */
+    } /* end if */
+    if (server->fastopen > 0) {
+        /* the request in the SYN saves a round trip, see net.ipv4.tcp_fastopen */
+        if (setsockopt(sfd, IPPROTO_TCP, TCP_FASTOPEN, &server->fastopen, sizeof (int)) < 0) {
+            err_print("WARNING: setsockopt(TCP_FASTOPEN)");
+        } /* end if */
+    } /* end if */
 
     /*
      * Bind the socket to the provided port.
      */
-    retcode = bind(sfd, server->server_addr->ai_addr, server->server_addr->ai_addrlen);
+    retcode = bind(sfd, addr->ai_addr, addr->ai_addrlen);
     if (retcode < 0) {
         err_print("ERROR: server bind()");
+        close(sfd);
         return -1;
     } /* end if */
 
     /*
      * Place the socket in passive mode.
      */
-    retcode = listen(sfd, qlen);
+    retcode = listen(sfd, server->backlog);
     if (retcode < 0) {
         err_print("ERROR: server listen()");
+        close(sfd);
         return -1;
     } /* end if */
 
@@ -266,456 +622,144 @@ create_server_socket(prog_options_t *server) {
 } /* end of create_server_socket */
 
 /**
- * write response header to the client
- * @input_param     the socket descriptor
- * @input_param     the response header string
- * @input_param     the program options
- * @return          unequal zero in case of error
- */
-static int
-write_response_header(int sd, char *response_header_string, prog_options_t *server) {
-    int retcode;
-
-    /*
-     * write header
-     */
-    retcode = write_to_socket(sd, response_header_string, strlen(response_header_string), server->timeout);
-    if (retcode < 0) {
-        err_print("ERROR: write()");
-        return -1;
-    } /* end if */
-
-
-    // TODO: return something different than 0
-    return 0;
-} /* end of write_response_header */
-
-/*
- * write the response body to client
- * @input_param     the socket descriptor
- * @input_param     the path to the requested file
- * @input_param     the program options
- * @input_param     the start of partial content
- * @input_param     the end of partial content
- * @return          unequal zero in case of error
+ * Creates a server socket for every address of the program options.
+ * @param   the program options
+ * @param   the socket descriptors, MAX_LISTENERS entries
+ * @return  the number of sockets, -1 in case of error
  */
 static int
-write_response_body(int sd, char *filepath, prog_options_t *server, int start, int end) {
-    int retcode;
-    int file; /* file descriptor of requested file */
-    int chunkSize = 256; /* chunk size for write of message body */
+create_server_sockets(prog_options_t *server, int *sds) {
+    struct addrinfo *addr;
+    bool has_ipv4 = false;
+    int count = 0;
+
+    for (addr = server->server_addr; addr != NULL; addr = addr->ai_next) {
+        has_ipv4 = has_ipv4 || addr->ai_family == AF_INET;
+    } /* end for */
+
+    for (addr = server->server_addr; addr != NULL && count < MAX_LISTENERS; addr = addr->ai_next) {
+        if (addr->ai_family != AF_INET && addr->ai_family != AF_INET6) {
+            continue;
+        } /* end if */
+        sds[count] = create_server_socket(server, addr, has_ipv4);
+        if (sds[count] < 0) {
+            while (count > 0) {
+                close(sds[--count]);
+            } /* end while */
+            return -1;
+        } /* end if */
+        count++;
+    } /* end for */
 
-    file = open(filepath, O_RDONLY);
-    if (file < 0) {
-        err_print("ERROR: open()");
+    if (count == 0) {
+        err_print("ERROR: no address to listen on");
         return -1;
     } /* end if */
-
-    char chunk[chunkSize];
-    struct stat fstat; /* file status */
-    retcode = stat(filepath, &fstat);
-    size_t bytesWritten = 0;
-    size_t bytesToWrite = fstat.st_size;
-
-    if ((start != -2) && (end != -2)) { /* for partial content */
-        bytesWritten = start;
-        if (end == -1) {
-            bytesToWrite = fstat.st_size;
-        } else {
-            bytesToWrite = end;
-        }
-
-        if (lseek(file, bytesWritten, SEEK_SET) < 0) {
-            return -1;
-        }
-    }
-
-    while (bytesWritten < bytesToWrite) {
-        size_t writtenThisTime;
-        size_t readThisTime;
-
-        readThisTime = read(file, chunk, chunkSize);
-
-        if (readThisTime < 0) {
-            return -1;
-        }
-
-        writtenThisTime = write(sd, chunk, readThisTime);
-        if (writtenThisTime == -1) {
-            return -1;
-        }
-
-        bytesWritten += writtenThisTime;
-    }
-
-    return retcode;
-} /* end of write_response_body */
-
-static int
-create_response_header(char *filepath, http_header_t *response_header_data, struct stat fstat, int start, int end) {
-
-    // content-type
-    char *content_type_str;
-    http_content_type_t content_type;
-    content_type = get_http_content_type(filepath);
-    content_type_str = get_http_content_type_str(content_type);
-    int size = strlen(http_header_field_list[4]) + strlen(content_type_str) + strlen("\r\n") + 1;
-    response_header_data->content_type = malloc(size);
-    snprintf(response_header_data->content_type, size, "%s%s\r\n", http_header_field_list[4], content_type_str);
-
-
-    struct tm * timeinfo;
-    char timeString[80];
-    timeinfo = localtime(&fstat.st_mtime);
-    strftime(timeString, 80, "%a, %d %b %Y %H:%M:%S GMT", timeinfo);
-    size = strlen(http_header_field_list[2]) + strlen(timeString) + strlen("\r\n") + 1;
-    response_header_data->last_modified = malloc(size);
-    snprintf(response_header_data->last_modified, size, "%s%s\r\n", http_header_field_list[2], timeString);
-
-    // content-range
-    if ((start != -2) && (end != -2)) { /* for partial content */
-        size = strlen(http_header_field_list[8]) + sizeof (int)*3 + strlen("bytes -/\r\n") + 1;
-        response_header_data->content_range = malloc(size);
-        int endOfRange = fstat.st_size - 1;
-        snprintf(response_header_data->content_range, size, "%sbytes %d-%d/%d\r\n", http_header_field_list[8], start, endOfRange, (int) fstat.st_size);
-
-        int size = strlen(http_header_field_list[3]) + sizeof (int) +strlen("\r\n") + 1;
-        int range_length = fstat.st_size - start;
-        response_header_data->content_length = malloc(size);
-        snprintf(response_header_data->content_length, size, "%s%d\r\n", http_header_field_list[3], range_length);
-    } else {
-        // content-length, content type, und last modified
-        size = strlen(http_header_field_list[3]) + sizeof (long long) +strlen("\r\n") + 1;
-        response_header_data->content_length = malloc(size);
-        snprintf(response_header_data->content_length, size, "%s%lld\r\n", http_header_field_list[3], (long long) fstat.st_size);
-    }
-
-    // TODO: return retcode instead of 0
-    return 0;
-} /* end of create_response_header */
+    return count;
+} /* end of create_server_sockets */
 
 /**
- * create the response header string
- * @input_param     the response header data
- * @output_param    the response header string
- * @return          unequal zero in case of error
+ * Close the listening sockets.
+ * @param   the socket descriptors
+ * @param   the number of sockets
  */
-static int
-create_response_header_string(http_header_t response_header_data, char* response_header_string) {
-    // status
-    snprintf(response_header_string, 50, "%s %hu %s\r\n", "HTTP/1.1", response_header_data.status.code, response_header_data.status.text);
-
-    // server
-    char server[30];
-    snprintf(server, 30, "%s%s\r\n", http_header_field_list[1], "Tinyweb 1.1");
-    strcat(response_header_string, server);
-
-    // date
-    char timeString [80];
-    char date [50];
-    time_t rawtime;
-    struct tm * timeinfo;
-    time(&rawtime);
-    timeinfo = localtime(&rawtime);
-    strftime(timeString, 80, "%a, %d %b %Y %H:%M:%S", timeinfo);
-    snprintf(date, 50, "%s%s\r\n", http_header_field_list[0], timeString);
-    strcat(response_header_string, date);
-
-    if (response_header_data.content_length != NULL) {
-        //content length
-        strcat(response_header_string, response_header_data.content_length);
-    }
-    if (response_header_data.content_type != NULL) {
-        //content type
-        strcat(response_header_string, response_header_data.content_type);
-    }
-    if (response_header_data.last_modified != NULL) {
-        //last modified
-        strcat(response_header_string, response_header_data.last_modified);
-    }
-    if (response_header_data.content_location != NULL) {
-        strcat(response_header_string, response_header_data.content_location);
-    }
-    if (response_header_data.content_range != NULL) {
-        strcat(response_header_string, response_header_data.content_range);
-    }
-    // end header
-    strcat(response_header_string, "\r\n");
-    return 0;
-} /* end of create_response_header_string */
+static void
+close_server_sockets(int *sds, int count) {
+    int i;
 
-/**
- * write log to stdout or log file
- * @input_param     the parsed http header
- * @input_param     the client info
- * @input_param     the path to requested file
- * @input_param     the response header string
- * @input_param     the file status
- * @input_param     the start of partial content
- * @input_param     the end of partial content
- * @input_param     the program options
- * @return          unequal zero in case of error
- */
-static int
-write_log(http_status_entry_t httpStatus, parsed_http_header_t parsed_header, struct sockaddr_in client, char* filepath, char* response_header_string, struct stat fstat, int start, int end, prog_options_t *server) {
-    /*
-     * write log
-     */
-    // time
-    char timeString [80];
-    char date [50];
-    time_t rawtime;
-    struct tm * timeinfo;
-    time(&rawtime);
-    timeinfo = localtime(&rawtime);
-    strftime(timeString, 80, "%a, %d %b %Y %H:%M:%S", timeinfo);
-    snprintf(date, 50, "%s +0200", timeString);
-    // IP Address
-    char str[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &(client.sin_addr), str, INET_ADDRSTRLEN);
-    // Port
-    int portNumber = ntohs(client.sin_port);
-    int size = strlen(response_header_string);
-    if (server->log_filename != NULL && strcmp(server->log_filename, "-") != 0) { /* write to logfile*/
-        if ((start != -2) && (end != -2)) { /* for partial requests only */
-            size += fstat.st_size - start;
-            print_log("[%d] %s:%d - - [%s] \"%-7s %s %s\" %d %d\n", getpid(), str, portNumber, date, parsed_header.method, filepath, parsed_header.protocol, httpStatus.code , size);
-        } else { /* every other request */
-            size += fstat.st_size;
-            print_log("[%d] %s:%d - - [%s] \"%-7s %s %s\" %d %d\n", getpid(), str, portNumber, date, parsed_header.method, filepath, parsed_header.protocol, httpStatus.code , size);
-        }
-    } else { /* write to stdout*/
-        if ((start != -2) && (end != -2)) { /* for partial requests only */
-            size += fstat.st_size - start;
-            safe_printf("[%d] %s:%d - - [%s] \"%-7s %s %s\" %d %d\n", getpid(), str, portNumber, date, parsed_header.method, filepath, parsed_header.protocol, httpStatus.code , size);
-        } else { /* every other request */
-            size += fstat.st_size;
-            safe_printf("[%d] %s:%d - - [%s] \"%-7s %s %s\" %d %d\n", getpid(), str, portNumber, date, parsed_header.method, filepath, parsed_header.protocol, httpStatus.code , size);
-        }
-    }
-    return 0;
-} /*end of write_log */
+    for (i = 0; i < count; i++) {
+        close(sds[i]);
+    } /* end for */
+} /* end of close_server_sockets */
 
 /**
  * Handle clients.
  * @input_param     the socket descriptor to read on
  * @input_param     the program options
- * @return          on error -1 is returned
+ * @input_param     the client address
+ * @return          the number of answered requests, on error -1 is returned
  */
 static int
-handle_client(int sd, prog_options_t *server, struct sockaddr_in client) {
-    int BUFSIZE = 1000;
-    char client_header[BUFSIZE];
-    char server_header[BUFSIZE];
-    parsed_http_header_t parsed_header;
-    http_header_t response_header_data = {
-        .status = http_status_list[8],
-        .date = NULL,
-        .server = NULL,
-        .last_modified = NULL,
-        .content_length = NULL,
-        .content_type = NULL,
-        .connection = NULL,
-        .accept_ranges = NULL,
-        .content_location = NULL,
-        .content_range = NULL
-    };
-    int retcode = 0;
-    char filepath[BUFSIZE]; /* path to requested file */
-    struct stat fstat; /* file status */
-
-    read_from_socket(sd, client_header, BUFSIZE, server->timeout);
-    parsed_header = parse_http_header(client_header);
-
-    // check on parsed http status
-    switch (parsed_header.httpState) {
-        case HTTP_STATUS_INTERNAL_SERVER_ERROR:
-            response_header_data.status = http_status_list[8];
-            create_response_header_string(response_header_data, server_header);
-            write_log(http_status_list[8], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-            return write_response_header(sd, server_header, server);
-        case HTTP_STATUS_BAD_REQUEST:
-            response_header_data.status = http_status_list[4];
-            create_response_header_string(response_header_data, server_header);
-            write_log(http_status_list[4], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-            return write_response_header(sd, server_header, server);
-        case HTTP_STATUS_NOT_IMPLEMENTED:
-            response_header_data.status = http_status_list[9];
-            create_response_header_string(response_header_data, server_header);
-            write_log(http_status_list[9], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-            return write_response_header(sd, server_header, server);
-        default:
-            break;
-    }
-
-    strcpy(filepath, server->root_dir);
-    strcat(filepath, parsed_header.filename);
-    retcode = stat(filepath, &fstat);
+handle_client(int sd, prog_options_t *server, const struct sockaddr_storage *client) {
+    connection_t conn;
+    conn_result_t result;
+    time_t drain_deadline = 0;
+    int retcode;
+    int timeout;
 
-    if (retcode) {
-        response_header_data.status = http_status_list[6];
-        create_response_header_string(response_header_data, server_header);
-        write_log(http_status_list[6], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-        return write_response_header(sd, server_header, server);
-    }
+    /*
+     * Run the same state machine as the event loop, but simply wait
+     * on the socket whenever it would block. A persistent connection
+     * is served until the client closes it or stays idle too long.
+     * The socket is non-blocking from accept4().
+     */
+    conn_init(&conn, sd, client, -1);
 
-    switch (parsed_header.httpState) {
-        case HTTP_STATUS_RANGE_NOT_SATISFIABLE:
-            response_header_data.status = http_status_list[7];
-            create_response_header_string(response_header_data, server_header);
-            write_log(http_status_list[7], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-            return write_response_header(sd, server_header, server);
-        case HTTP_STATUS_PARTIAL_CONTENT:
-            if (parsed_header.byteStart >= fstat.st_size) { /* throw 416 */
-                response_header_data.status = http_status_list[7];
-                create_response_header_string(response_header_data, server_header);
-                write_log(http_status_list[7], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-                return write_response_header(sd, server_header, server);
-            }
-            response_header_data.status = http_status_list[1];
-            create_response_header(filepath, &response_header_data, fstat, parsed_header.byteStart, parsed_header.byteEnd);
-            create_response_header_string(response_header_data, server_header);
-            write_response_header(sd, server_header, server);
-            write_log(http_status_list[1], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-            return write_response_body(sd, filepath, server, parsed_header.byteStart, parsed_header.byteEnd);
-        default:
+    while ((result = conn_advance(&conn, server)) == CONN_WANT_READ || result == CONN_WANT_WRITE) {
+        if (conn_is_idle(&conn)) {
+            /* write the records of the answered requests before waiting */
+            access_log_flush();
+        } /* end if */
+        do {
+            if (!server_running && drain_deadline == 0) {
+                // graceful drain: the response in progress gets the timeout once more
+                drain_deadline = time(NULL) + server->timeout;
+            } /* end if */
+            if (!server_running && (conn_is_idle(&conn) || time(NULL) >= drain_deadline)) {
+                /* close an idle persistent connection, cut off a stalled one */
+                retcode = 0;
+                break;
+            } /* end if */
+            // a cgi runner has its own deadline
+            timeout = server->timeout;
+            if (conn.deadline != 0) {
+                timeout = (conn.deadline > time(NULL)) ? conn.deadline - time(NULL) : 0;
+            } /* end if */
+            if (drain_deadline != 0 && drain_deadline - time(NULL) < timeout) {
+                timeout = drain_deadline - time(NULL);
+            } /* end if */
+            retcode = select_socket_fd(conn.wait_fd, timeout, result == CONN_WANT_WRITE);
+        } while (retcode == -1 && errno == EINTR);
+        if (retcode == 0 && conn.deadline != 0 && (drain_deadline == 0 || time(NULL) < drain_deadline)) {
+            /* answer 504 if nothing is sent yet */
+            continue;
+        } else if (retcode <= 0) { /* timeout, shutdown or error */
+            result = conn_is_idle(&conn) ? CONN_DONE : CONN_ERROR;
             break;
-    }
-
-    // check for 404, 304, 301
-    if (!(S_ISREG(fstat.st_mode)) && !(S_ISDIR(fstat.st_mode))) { /* 404 */
-        response_header_data.status = http_status_list[6];
-        create_response_header_string(response_header_data, server_header);
-        write_log(http_status_list[6], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-        return write_response_header(sd, server_header, server);
-    } else if (S_ISDIR(fstat.st_mode)) { /* 301 */
-        response_header_data.status = http_status_list[2];
-        int size = strlen(http_header_field_list[7]) + strlen(filepath) + strlen("/\r\n") + 1;
-        response_header_data.content_location = malloc(size);
-        snprintf(response_header_data.content_location, BUFSIZE, "%s%s%s\r\n", http_header_field_list[7], filepath, "/");
-        create_response_header_string(response_header_data, server_header);
-        write_log(http_status_list[2], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-        return write_response_header(sd, server_header, server);
-    } else if (parsed_header.modsince != 0) { /* 304 */
-        int seconds;
-        seconds = difftime(parsed_header.modsince, fstat.st_mtime);
-        if (seconds >= 0) {
-            response_header_data.status = http_status_list[3];
-            create_response_header_string(response_header_data, server_header);
-            write_log(http_status_list[3], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-            return write_response_header(sd, server_header, server);
-        }
-    }
-
-    // already checked for 404
-    if (parsed_header.isCGI) {
-        pid_t pid; /* process id */
-        //int link[2];
-        //char buffer[4096];
-        /*
-         * Check executable, only on success go on
-         */
-        if (fstat.st_mode & S_IEXEC) {
-            char* execPath = malloc(strlen(filepath) + 3);
-            if (execPath == NULL) {
-                err_print("ERROR: cant allocate memory");
-            }
-            strcpy(execPath, "./");
-            strcat(execPath, filepath);
-
-            pid = fork();
-            if (pid == 0) {
-                /* 
-                 * child process 
-                 */
-                dup2(sd, STDOUT_FILENO);
-                close(sd);
-
-                response_header_data.status = http_status_list[0];
-                create_response_header_string(response_header_data, server_header);
-
-                int headerLength = strlen(server_header);
-                server_header[headerLength - 2] = '\0'; /* cut off one \r\n */
-
-                fprintf(stdout, "%s", server_header); /* print header */
-                execle("/bin/sh", "sh", "-c", execPath, NULL, NULL);
-                exit(EXIT_SUCCESS);
-
-                //exit(EXIT_SUCCESS);
-            } else if (pid > 0) {
-
-                /* 
-                 * parent process 
-                 */
-
-                int status;
-                wait(&status);
-                if (WIFEXITED(status) != 1) {
-                    err_print("ERROR: Execute cgi failed");
-                    return -1;
-                }
-                close(sd);
-                exit(EXIT_SUCCESS);
-            } else {
-                /* 
-                 * error while forking 
-                 */
-                err_print("ERROR: fork() in cgi");
-                return 1;
-            }
-        } else { /* 403 - Not executable*/
-            response_header_data.status = http_status_list[5];
-            create_response_header_string(response_header_data, server_header);
-            write_log(http_status_list[5], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-            return write_response_header(sd, server_header, server);
-        }
-    }
-
-    // check on parsed http method
-    if (strcmp(parsed_header.method, "GET") == 0) { /* GET method */
-        response_header_data.status = http_status_list[0];
-        create_response_header(filepath, &response_header_data, fstat, parsed_header.byteStart, parsed_header.byteEnd);
-        create_response_header_string(response_header_data, server_header);
-        write_response_header(sd, server_header, server);
-        write_log(http_status_list[0], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-        return write_response_body(sd, filepath, server, parsed_header.byteStart, parsed_header.byteEnd);
-    } else { /* HEAD method */
-        response_header_data.status = http_status_list[0];
-        create_response_header(filepath, &response_header_data, fstat, parsed_header.byteStart, parsed_header.byteEnd);
-        create_response_header_string(response_header_data, server_header);
-        write_log(http_status_list[0], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-        return write_response_header(sd, server_header, server);
-    }
-
-    response_header_data.status = http_status_list[8];
-    create_response_header_string(response_header_data, server_header);
-    write_log(http_status_list[8], parsed_header, client, filepath, server_header, fstat, parsed_header.byteStart, parsed_header.byteEnd, server);
-    return write_response_header(sd, server_header, server);
+        } /* end if */
+    } /* end while */
 
+    conn_close(&conn);
+    access_log_stop();
+    return (result == CONN_DONE) ? (int) conn.requests : -1;
 } /* end of handle_client */
 
 /**
- * Accept clients on the socket.
+ * Accept a client on one of the listening sockets.
  * @input_param     the socket descriptor
+ * @input_param     all listening socket descriptors
+ * @input_param     the number of listening sockets
  * @input_param     the program options
  * @return          unequal zero in case of error
  */
 static int
-accept_client(int sd, prog_options_t *server) {
-
-    signal(SIGCHLD, sig_handler);
-
+accept_client(int sd, int *sds, int count, prog_options_t *server) {
     int nsd; /* new socket descriptor */
     pid_t pid; /* process id */
     int retcode; /* return code */
-    struct sockaddr_in client; /* the input sockaddr */
+    struct sockaddr_storage client; /* the input sockaddr */
     socklen_t client_len = sizeof (client); /* the length of it */
 
     /*
      * accept clients on the socket
      */
-    nsd = accept(sd, (struct sockaddr *) &client, &client_len);
+    metrics_accept_queue(sd);
+    nsd = accept4(sd, (struct sockaddr *) &client, &client_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (nsd < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ECONNABORTED) {
+            /* the caller checks whether to keep on running */
+            return 0;
+        } /* end if */
         err_print("ERROR: server accept()");
         return -1;
     }
@@ -725,11 +769,10 @@ accept_client(int sd, prog_options_t *server) {
         /* 
          * child process 
          */
-        retcode = close(sd);
-        if (retcode < 0) {
-            err_print("ERROR: child close()");
-        } /* end if */
-        retcode = handle_client(nsd, server, client);
+        close_server_sockets(sds, count);
+        metrics_attach();
+        retcode = handle_client(nsd, server, &client);
+        metrics_detach();
         if (retcode < 0) {
             err_print("ERROR: child handle_client()");
             exit(EXIT_FAILURE);
@@ -753,6 +796,217 @@ accept_client(int sd, prog_options_t *server) {
     return nsd;
 } /* end of accept_client */
 
+/**
+ * Serve clients on the sockets with the configured mode until
+ * the server is stopped, then let the running requests finish.
+ * @input_param     the listening socket descriptors
+ * @input_param     the number of listening sockets
+ * @input_param     the program options
+ * @return          unequal zero in case of error
+ */
+static int
+serve_clients(int *sds, int count, prog_options_t *server) {
+    struct pollfd fds[MAX_LISTENERS];
+    int retcode = 0;
+    int i;
+
+    if (server->mode == SERVER_MODE_EPOLL) {
+        if (access_log_start() < 0) {
+            return -1;
+        } /* end if */
+        retcode = run_event_loop(sds, count, server, &server_running);
+        access_log_stop();
+        if (access_log_dropped() > 0) {
+            safe_printf("[%d] %lu access log records dropped\n", getpid(), access_log_dropped());
+        } /* end if */
+        return retcode;
+    } else if (server->mode == SERVER_MODE_PREFORK) {
+        return run_prefork_pool(sds, count, server, &server_running, handle_client);
+    } /* end if */
+
+    for (i = 0; i < count; i++) {
+        fds[i].fd = sds[i];
+        fds[i].events = POLLIN;
+    } /* end for */
+
+    while (server_running && retcode >= 0) {
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            } /* end if */
+            err_print("ERROR: poll()");
+            retcode = -1;
+            break;
+        } /* end if */
+        for (i = 0; i < count && retcode >= 0; i++) {
+            if (fds[i].revents & POLLIN) {
+                retcode = accept_client(sds[i], sds, count, server);
+            } /* end if */
+        } /* end for */
+        if (retcode < 0) {
+            err_print("ERROR: accepting clients()");
+        } /* end if */
+    } /* end while */
+
+    // drain: stop accepting and wait for the client handlers
+    close_server_sockets(sds, count);
+    while (waitpid(-1, NULL, 0) > 0 || errno == EINTR) {
+    } /* end while */
+
+    return (retcode < 0) ? retcode : 0;
+} /* end of serve_clients */
+
+/**
+ * Pin the calling worker process to one CPU.
+ * @input_param     the worker number
+ */
+static void
+pin_worker(int id) {
+    cpu_set_t cpus;
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (ncpus <= 0) {
+        return;
+    } /* end if */
+
+    CPU_ZERO(&cpus);
+    CPU_SET(id % ncpus, &cpus);
+    if (sched_setaffinity(0, sizeof (cpus), &cpus) < 0) {
+        err_print("WARNING: sched_setaffinity()");
+    } /* end if */
+} /* end of pin_worker */
+
+/**
+ * Give a worker its share of a prefork pool limit, the first workers
+ * take the remainder.
+ * @input_param     the limit of all workers
+ * @input_param     the worker number
+ * @input_param     the number of workers
+ * @return          the share of the worker, at least 1
+ */
+static unsigned int
+pool_share(unsigned int limit, int id, int workers) {
+    unsigned int share = limit / workers + ((unsigned int) id < limit % workers);
+
+    return (share > 0) ? share : 1;
+} /* end of pool_share */
+
+/**
+ * Start a worker process with its own SO_REUSEPORT listeners.
+ * @input_param     the worker number
+ * @input_param     the program options
+ * @return          the process id of the worker, -1 in case of error
+ */
+static pid_t
+start_worker(int id, prog_options_t *server) {
+    int sds[MAX_LISTENERS];
+    int count;
+    pid_t pid;
+
+    fflush(stdout); /* do not duplicate buffered output in the worker */
+    pid = fork();
+    if (pid != 0) {
+        if (pid < 0) {
+            err_print("ERROR: fork() worker");
+        } /* end if */
+        return pid;
+    } /* end if */
+
+    /*
+     * worker process
+     */
+    install_sigchld_handler(true);
+    if (server->mode == SERVER_MODE_EPOLL) {
+        // one event loop per CPU, a pool or forked clients use all of them
+        pin_worker(id);
+    } else if (server->mode == SERVER_MODE_PREFORK) {
+        // the pools of all workers together stay within the limits
+        server->max_workers = pool_share(server->max_workers, id, server->workers);
+        server->min_spare = pool_share(server->min_spare, id, server->workers);
+        server->max_spare = pool_share(server->max_spare, id, server->workers);
+        if (server->max_spare < server->min_spare) {
+            server->max_spare = server->min_spare;
+        } /* end if */
+    } /* end if */
+    metrics_attach();
+
+    count = create_server_sockets(server, sds);
+    if (count < 0) {
+        err_print("ERROR: creating socket()");
+        exit(EXIT_FAILURE);
+    } /* end if */
+
+    safe_printf("[%d] Worker %d accepting clients\n", getpid(), id);
+    exit(serve_clients(sds, count, server) < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+} /* end of start_worker */
+
+/**
+ * Run the configured number of worker processes, restart workers
+ * that terminate unexpectedly and drain all of them on shutdown.
+ * @input_param     the program options
+ * @return          unequal zero in case of error
+ */
+static int
+run_workers(prog_options_t *server) {
+    pid_t workers[MAX_WORKERS];
+    pid_t pid;
+    int i;
+    int status;
+    int retcode = 0;
+
+    // the master waits for its workers explicitly
+    install_sigchld_handler(false);
+
+    for (i = 0; i < server->workers; i++) {
+        workers[i] = -1;
+    } /* end for */
+    for (i = 0; i < server->workers && server_running; i++) {
+        workers[i] = start_worker(i, server);
+        if (workers[i] < 0) {
+            retcode = -1;
+            server_running = false;
+        } /* end if */
+    } /* end for */
+
+    while (server_running) {
+        pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            } /* end if */
+            break;
+        } /* end if */
+        metrics_reap(pid);
+
+        for (i = 0; i < server->workers && server_running; i++) {
+            if (workers[i] != pid) {
+                continue;
+            } /* end if */
+            workers[i] = -1;
+            if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_FAILURE) {
+                // e.g. the listener cannot be bound, a restart would fail again
+                err_print("ERROR: worker failed");
+                retcode = -1;
+                server_running = false;
+            } else {
+                safe_printf("[%d] Restarting worker %d\n", getpid(), i);
+                workers[i] = start_worker(i, server);
+            } /* end if */
+        } /* end for */
+    } /* end while */
+
+    // graceful drain: the workers finish their running requests
+    for (i = 0; i < server->workers; i++) {
+        if (workers[i] > 0) {
+            kill(workers[i], SIGINT);
+        } /* end if */
+    } /* end for */
+    while (waitpid(-1, NULL, 0) > 0 || errno == EINTR) {
+    } /* end while */
+
+    return retcode;
+} /* end of run_workers */
+
 /**
  * Main function
  * @input_param     the argument counter
@@ -763,7 +1017,8 @@ int
 main(int argc, char *argv[]) {
     int retcode = EXIT_SUCCESS;
     prog_options_t my_opt;
-    int socketDescriptor;
+    int socketDescriptors[MAX_LISTENERS];
+    int count;
 
     // read program options
     if (get_options(argc, argv, &my_opt) == 0) {
@@ -771,37 +1026,45 @@ main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     } /* end if */
 
-    // set the time zone (TZ) to GMT in order to
-    // ignore any other local time zone that would
-    // interfere with correct time string parsing
-    setenv("TZ", "GMT", 1);
-    tzset();
-
     // do some checks and initialisations...
     open_logfile(&my_opt);
     check_root_dir(&my_opt);
+    if (path_init(my_opt.root_dir) < 0) {
+        exit(EXIT_FAILURE);
+    } /* end if */
     install_signal_handlers();
-    init_logging_semaphore(&my_opt);
-
-    // create the server socket
-    socketDescriptor = create_server_socket(&my_opt);
-    if (retcode < 0) {
-        err_print("ERROR: creating socket()");
-        exit(retcode);
+    if (access_log_init(fileno(my_opt.log_fd), my_opt.log_flush, my_opt.log_overflow) < 0) {
+        exit(EXIT_FAILURE);
+    } /* end if */
+    if (content_type_init(my_opt.mime_types) < 0) {
+        exit(EXIT_FAILURE);
+    } /* end if */
+    file_cache_init(my_opt.cache_size * 1024);
+    if (metrics_init() < 0) {
+        exit(EXIT_FAILURE);
+    } /* end if */
+    if (compress_start(&my_opt) < 0) {
+        exit(EXIT_FAILURE);
+    } /* end if */
+    if (my_opt.cgi_pool > 0 && cgi_pool_start(&my_opt) < 0) {
+        exit(EXIT_FAILURE);
     } /* end if */
 
     // here, as an example, show how to interact with the
     // condition set by the signal handler above
     safe_printf("[%d] Starting server '%s'...\n", getpid(), my_opt.progname);
     server_running = true;
-    while (server_running) {
-        // TODO: add error handling to accept_client
-        retcode = accept_client(socketDescriptor, &my_opt);
-        if (retcode < 0) {
-            err_print("ERROR: accepting clients()");
-            exit(retcode);
+    if (my_opt.workers > 0) {
+        retcode = run_workers(&my_opt);
+    } else {
+        // create a server socket per address
+        count = create_server_sockets(&my_opt, socketDescriptors);
+        if (count < 0) {
+            err_print("ERROR: creating socket()");
+            exit(EXIT_FAILURE);
         } /* end if */
-    } /* end while */
+        retcode = serve_clients(socketDescriptors, count, &my_opt);
+    } /* end if */
 
     safe_printf("[%d] Good Bye...", getpid());
     return retcode;
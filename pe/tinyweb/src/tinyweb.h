@@ -16,10 +16,22 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#include "access_log.h"
+
 #define err_print(s)              fprintf(stderr, "ERROR: %s, %s:%d\n", (s), __FILE__, __LINE__)
 
 #define BUFFER_SIZE                      8192
 #define DEFAULT_HTML_PAGE      "/default.html"
+#define MAX_WORKERS                       256
+#define DEFAULT_BACKLOG                   511   // the kernel caps it at net.core.somaxconn
+#define MAX_LISTENERS                      16   // addresses the server listens on
+
+
+typedef enum server_mode {
+    SERVER_MODE_PREFORK = 0,       // bounded pool of preforked processes
+    SERVER_MODE_FORK,              // fork a process per connection
+    SERVER_MODE_EPOLL              // single process, event-driven
+} server_mode_t;
 
 
 typedef struct prog_options {
@@ -29,8 +41,28 @@ typedef struct prog_options {
     FILE               *log_fd;
     bool                verbose;
     unsigned short      timeout;
-    struct addrinfo    *server_addr;
+    char               *listen_address;     // host to listen on, NULL for all addresses
+    struct addrinfo    *server_addr;        // list of addresses to listen on
     int                 server_port;
+    server_mode_t       mode;
+    int                 workers;
+    size_t              cache_size;         // memory budget of the file cache in kB
+    unsigned int        log_flush;          // flush interval of the access log in ms
+    log_overflow_t      log_overflow;
+    bool                status_page;        // serve the counters on /server-status
+    unsigned int        min_spare;          // idle workers of the prefork pool
+    unsigned int        max_spare;
+    int                 max_workers;        // size of the prefork pool
+    unsigned long       max_requests;       // requests until a worker is replaced, 0 never
+    unsigned int        max_queue;          // waiting connections before 503 if the pool is busy
+    int                 backlog;            // length of the accept queue
+    int                 defer_accept;       // seconds to wait for the request before accept, 0 off
+    int                 fastopen;           // pending TCP Fast Open requests, 0 off
+    int                 cgi_pool;           // persistent cgi runners, 0 forks per request
+    char               *cgi_runner;         // program of the runners
+    unsigned int        cgi_timeout;        // seconds a cgi request may take
+    size_t              compress_size;      // disk budget of the compressed variants in kB
+    char               *mime_types;         // file in the mime.types format, NULL for the built-in types
 } prog_options_t;
 
 #endif
@@ -0,0 +1,135 @@
+#!/usr/bin/perl
+
+use strict;
+use warnings;
+
+use Test::More;
+use IO::Socket::IP;
+use File::stat;
+
+
+my $root_dir    = "web";
+my $remote_host = "localhost";
+my $remote_port = "8080";
+
+
+#--------------------------------------------------------------------------
+# Test Cases
+#--------------------------------------------------------------------------
+my @tests = (
+    # Two requests on one persistent connection, sent one after the other
+    [ { pipelined => 0, requests => [ [ 'GET',  "/index.html",      200 ],
+                                      [ 'GET',  "/css/default.css", 200 ] ] } ],
+    # Pipelined requests sent in one go, answered in order
+    [ { pipelined => 1, requests => [ [ 'GET',  "/index.html",      200 ],
+                                      [ 'HEAD', "/index.html",      200 ],
+                                      [ 'GET',  "/blablabla.html",  404 ],
+                                      [ 'GET',  "/zeros2.jpg",      200 ] ] } ],
+    # The last request asks to close the connection
+    [ { pipelined => 1, requests => [ [ 'GET',  "/zeros1.jpg",      200 ],
+                                      [ 'GET',  "/zeros3.jpg",      200, 'close' ] ] } ],
+);
+
+# Set the number of test cases (excluding subtests)
+plan tests => scalar @tests;
+
+connect_to_server(@$_) for @tests;
+
+exit 0;
+
+
+#--------------------------------------------------------------------------
+# Read one response from the socket
+#
+# Parameter(s):
+# (IN) the socket
+# (IN) the request method
+#
+# Return value: status code, reference to the header hash, body
+#
+#--------------------------------------------------------------------------
+sub read_response {
+    my $socket = shift;
+    my $method = shift;
+
+    my $status_line = <$socket>;
+    return (undef, {}, undef) unless defined $status_line;
+    my @fields = split " ", $status_line;
+
+    my %header = ();
+    while (my $line = <$socket>) {
+        $line =~ s/\R\z//;
+        last if $line eq "";
+        my ($name, $value) = split /:\s*/, $line, 2;
+        $header{lc $name} = $value;
+    } # end while
+
+    my $body = "";
+    my $length = ($method eq 'HEAD') ? 0 : ($header{'content-length'} // 0);
+    while (length($body) < $length) {
+        my $n = read($socket, $body, $length - length($body), length($body));
+        last unless $n;
+    } # end while
+
+    return ($fields[1], \%header, $body);
+} # end of read_response
+
+
+#--------------------------------------------------------------------------
+# Send several requests on one connection and check the responses
+#
+# Parameter(s):
+# (IN) Reference to a hash containing test data
+#      'pipelined' -> send all requests before reading the responses
+#      'requests'  -> list of [ method, url, expected status, connection ]
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub connect_to_server {
+    my $ref = shift;
+
+    my $socket = IO::Socket::IP->new(
+                PeerAddr => $remote_host,
+                PeerPort => $remote_port,
+                Type     => SOCK_STREAM
+    ) or die "ERROR: socket() - $@";
+
+    my @requests = @{$ref->{requests}};
+    my $close = 0;
+
+    subtest "keep-alive, pipelined=$ref->{pipelined}" => sub {
+        my @pending = ();
+        for my $req (@requests) {
+            my ($method, $url, $status, $connection) = @$req;
+            my $request = "$method $url HTTP/1.1\r\nHost: $remote_host\r\n";
+            $request .= "Connection: $connection\r\n" if defined $connection;
+            print $socket "$request\r\n";
+            push @pending, $req;
+            next if $ref->{pipelined} && $req != $requests[-1];
+
+            while (my $p = shift @pending) {
+                my ($method, $url, $status, $connection) = @$p;
+                my ($code, $header, $body) = read_response($socket, $method);
+                is($code, $status, "$method $url: Status $status");
+                if (defined $connection) {
+                    is($header->{'connection'}, $connection, "$method $url: Connection");
+                    $close = 1;
+                } else {
+                    is($header->{'connection'}, 'keep-alive', "$method $url: Connection");
+                } # end if
+                if ($status == 200 && $method eq 'GET') {
+                    my $st = stat("$root_dir$url") or die "ERROR: cannot access $url: $!";
+                    is(length($body), $st->size, "$method $url: Body length");
+                } # end if
+            } # end while
+        } # end for
+
+        if ($close) {
+            my $rest = <$socket>;
+            ok(!defined $rest, "Connection closed by server");
+        } # end if
+    };
+
+    close($socket);
+} # end of connect_to_server
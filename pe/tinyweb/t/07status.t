@@ -0,0 +1,122 @@
+#!/usr/bin/perl
+
+use strict;
+use warnings;
+
+use Test::More;
+use IO::Socket::IP;
+
+
+my $remote_host = "localhost";
+my $remote_port = "8080";
+
+
+#--------------------------------------------------------------------------
+# Test Cases
+#--------------------------------------------------------------------------
+my @tests = (
+    # Text page for humans
+    [ { method => 'GET',  url => "/server-status",
+        type => 'text/plain', match => qr/^Requests:\s+\d+$/m } ],
+    # Prometheus text exposition format
+    [ { method => 'GET',  url => "/server-status?format=prometheus",
+        type => 'text/plain; version=0.0.4', match => qr/^tinyweb_responses_total\{code="200"\} \d+$/m } ],
+    [ { method => 'GET',  url => "/server-status?format=prometheus",
+        type => 'text/plain; version=0.0.4', match => qr/^tinyweb_phase_duration_seconds_count\{phase="parse"\} \d+$/m } ],
+    # No body for HEAD, but the length of the page
+    [ { method => 'HEAD', url => "/server-status",
+        type => 'text/plain', match => qr/^$/ } ],
+);
+
+# Set the number of test cases (excluding subtests)
+plan tests => scalar @tests + 1;
+
+connect_to_server(@$_) for @tests;
+check_counting();
+
+exit 0;
+
+
+#--------------------------------------------------------------------------
+# Send one request and read the response
+#
+# Parameter(s):
+# (IN) the request method
+# (IN) the url
+#
+# Return value: status code, reference to the header hash, body
+#
+#--------------------------------------------------------------------------
+sub request {
+    my $method = shift;
+    my $url    = shift;
+
+    my $socket = IO::Socket::IP->new(
+                PeerAddr => $remote_host,
+                PeerPort => $remote_port,
+                Type     => SOCK_STREAM
+    ) or die "ERROR: socket() - $@";
+
+    print $socket "$method $url HTTP/1.1\r\nHost: $remote_host\r\nConnection: close\r\n\r\n";
+
+    my $status_line = <$socket> // "";
+    my @fields = split " ", $status_line;
+
+    my %header = ();
+    while (my $line = <$socket>) {
+        $line =~ s/\R\z//;
+        last if $line eq "";
+        my ($name, $value) = split /:\s*/, $line, 2;
+        $header{lc $name} = $value;
+    } # end while
+
+    local $/;
+    my $body = <$socket> // "";
+    close($socket);
+
+    return ($fields[1], \%header, $body);
+} # end of request
+
+
+#--------------------------------------------------------------------------
+# Request the status page and check the response
+#
+# Parameter(s):
+# (IN) Reference to a hash containing test data
+#      'method' -> the request method
+#      'url'    -> the url of the status page
+#      'type'   -> the expected Content-Type
+#      'match'  -> a pattern the body must match
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub connect_to_server {
+    my $ref = shift;
+
+    subtest "$ref->{method} $ref->{url}" => sub {
+        my ($code, $header, $body) = request($ref->{method}, $ref->{url});
+        is($code, 200, "Status 200");
+        is($header->{'content-type'}, $ref->{type}, "Content-Type");
+        ok($header->{'content-length'} > 0, "Content-Length");
+        like($body, $ref->{match}, "Body");
+    };
+} # end of connect_to_server
+
+
+#--------------------------------------------------------------------------
+# Check that a 404 response is counted
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub check_counting {
+    my $pattern = qr/^tinyweb_responses_total\{code="404"\} (\d+)$/m;
+    my (undef, undef, $before) = request('GET', "/server-status?format=prometheus");
+    request('GET', "/blablabla.html");
+    my (undef, undef, $after) = request('GET', "/server-status?format=prometheus");
+
+    my ($n) = $before =~ $pattern;
+    my ($m) = $after =~ $pattern;
+    ok(defined $n && defined $m && $m == $n + 1, "404 response counted");
+} # end of check_counting
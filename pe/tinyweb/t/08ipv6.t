@@ -0,0 +1,81 @@
+#!/usr/bin/perl
+
+use strict;
+use warnings;
+
+use Test::More;
+use IO::Socket::IP;
+use File::stat;
+
+
+my $root_dir    = "web";
+my $remote_port = "8080";
+
+
+#--------------------------------------------------------------------------
+# Test Cases
+#--------------------------------------------------------------------------
+my @tests = (
+    # The server listens on every address family by default
+    [ { address => "127.0.0.1", method => 'GET',  url => "/index.html",     status => 200 } ],
+    [ { address => "::1",       method => 'GET',  url => "/index.html",     status => 200 } ],
+    [ { address => "::1",       method => 'HEAD', url => "/index.html",     status => 200 } ],
+    [ { address => "::1",       method => 'GET',  url => "/blablabla.html", status => 404 } ],
+);
+
+# Set the number of test cases (excluding subtests)
+plan tests => scalar @tests;
+
+connect_to_server(@$_) for @tests;
+
+exit 0;
+
+
+#--------------------------------------------------------------------------
+# Send one request to an address of the server and check the response
+#
+# Parameter(s):
+# (IN) Reference to a hash containing test data
+#      'address' -> the numeric address of the server
+#      'method'  -> the request method
+#      'url'     -> the requested url
+#      'status'  -> the expected status
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub connect_to_server {
+    my $ref = shift;
+    my ($address, $method, $url, $status) = @{$ref}{qw(address method url status)};
+
+    subtest "$method [$address]:$remote_port$url" => sub {
+        my $socket = IO::Socket::IP->new(
+                    PeerHost => $address,
+                    PeerPort => $remote_port,
+                    Type     => SOCK_STREAM
+        );
+        SKIP: {
+            skip "no connection to $address: $@", 2 unless $socket;
+
+            print $socket "$method $url HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+            my $status_line = <$socket> // "";
+            my %header = ();
+            while (my $line = <$socket>) {
+                $line =~ s/\R\z//;
+                last if $line eq "";
+                my ($name, $value) = split /:\s*/, $line, 2;
+                $header{lc $name} = $value;
+            } # end while
+            my $body = do { local $/; <$socket> } // "";
+            close($socket);
+
+            is((split " ", $status_line)[1], $status, "Status $status");
+            if ($status == 200 && $method eq 'GET') {
+                my $st = stat("$root_dir$url") or die "ERROR: cannot access $url: $!";
+                is(length($body), $st->size, "Body length");
+            } else {
+                is(length($body), ($method eq 'HEAD') ? 0 : $header{'content-length'}, "Body length");
+            } # end if
+        }
+    };
+} # end of connect_to_server
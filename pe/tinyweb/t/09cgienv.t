@@ -0,0 +1,84 @@
+#!/usr/bin/perl
+
+use strict;
+use warnings;
+
+use Test::More;
+use IO::Socket::IP;
+
+
+my $remote_host = "127.0.0.1";
+my $remote_port = "8080";
+
+
+#--------------------------------------------------------------------------
+# Test Cases
+#--------------------------------------------------------------------------
+my @tests = (
+    # CGI/1.1 meta-variables, passed to forked scripts and to the cgi pool
+    [ { url => "/cgi-bin/envinfo.pl", env => {
+            GATEWAY_INTERFACE => "CGI/1.1",
+            REQUEST_METHOD    => "GET",
+            SCRIPT_NAME       => "/cgi-bin/envinfo.pl",
+            SERVER_PORT       => $remote_port,
+            REMOTE_ADDR       => $remote_host } } ],
+    [ { url => "/cgi-bin/envinfo.pl?name=value&x=1", env => {
+            QUERY_STRING      => "name=value&x=1",
+            SERVER_PROTOCOL   => "HTTP/1.1",
+            SCRIPT_NAME       => "/cgi-bin/envinfo.pl" } } ],
+    # SCRIPT_NAME carries the normalized path, REQUEST_URI the target as it was sent
+    [ { url => "/cgi-bin/./../cgi-bin//envinfo.pl?x=1", env => {
+            QUERY_STRING      => "x=1",
+            REQUEST_URI       => "/cgi-bin/./../cgi-bin//envinfo.pl?x=1",
+            HTTP_HOST         => "localhost",
+            SCRIPT_NAME       => "/cgi-bin/envinfo.pl" } } ],
+    [ { url => "/cgi-bin/%65nvinfo.pl?x=%41", env => {
+            QUERY_STRING      => "x=%41",
+            REQUEST_URI       => "/cgi-bin/%65nvinfo.pl?x=%41",
+            SCRIPT_NAME       => "/cgi-bin/envinfo.pl" } } ],
+    [ { url => "/cgi-bin/envinfo.pl", env => {
+            REQUEST_URI       => "/cgi-bin/envinfo.pl" } } ],
+);
+
+# Set the number of test cases (excluding subtests)
+plan tests => scalar @tests;
+
+connect_to_server(@$_) for @tests;
+
+exit 0;
+
+
+#--------------------------------------------------------------------------
+# Request a cgi script which prints its environment and check the values
+#
+# Parameter(s):
+# (IN) Reference to a hash containing test data
+#      'url' -> the requested url
+#      'env' -> the expected variables and their values
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub connect_to_server {
+    my $ref = shift;
+    my ($url, $env) = @{$ref}{qw(url env)};
+
+    subtest "GET $url" => sub {
+        my $socket = IO::Socket::IP->new(
+                    PeerHost => $remote_host,
+                    PeerPort => $remote_port,
+                    Type     => SOCK_STREAM
+        ) or die "ERROR: cannot connect to server: $@";
+
+        print $socket "GET $url HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+        my $response = do { local $/; <$socket> } // "";
+        close($socket);
+
+        like($response, qr{^HTTP/1.1 200 }, "Status 200");
+        # <TR><TD><B>NAME</B></TD><TD>description</TD><TD>value</TD></TR>
+        my %values = $response =~ m{<TR><TD><B>(\w+)</B></TD><TD>[^<]*</TD><TD>(.*?)</TD></TR>}g;
+        for my $name (sort keys %$env) {
+            is($values{$name}, $env->{$name}, $name);
+        } # end for
+    };
+} # end of connect_to_server
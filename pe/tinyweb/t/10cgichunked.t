@@ -0,0 +1,130 @@
+#!/usr/bin/perl
+
+use strict;
+use warnings;
+
+use Test::More;
+use IO::Socket::IP;
+
+
+my $remote_host = "localhost";
+my $remote_port = "8080";
+
+
+#--------------------------------------------------------------------------
+# Test Cases
+#--------------------------------------------------------------------------
+my @tests = (
+    # The output of a script without Content-Length is sent chunked, the
+    # connection stays open for the next request
+    [ { requests => [ [ 'GET',  "/cgi-bin/hello.pl",   qr{<H1>Hello, world!</H1>} ],
+                      [ 'HEAD', "/cgi-bin/hello.pl",   undef ],
+                      [ 'GET',  "/cgi-bin/envinfo.pl", qr{GATEWAY_INTERFACE} ],
+                      [ 'GET',  "/index.html",         qr{</html>}i, 'close' ] ] } ],
+    # The last response of a connection is chunked as well
+    [ { requests => [ [ 'GET',  "/cgi-bin/hello.pl",   qr{</HTML>}, 'close' ] ] } ],
+);
+
+# Set the number of test cases (excluding subtests)
+plan tests => scalar @tests;
+
+connect_to_server(@$_) for @tests;
+
+exit 0;
+
+
+#--------------------------------------------------------------------------
+# Read one response from the socket, a chunked body is decoded
+#
+# Parameter(s):
+# (IN) the socket
+# (IN) the request method
+#
+# Return value: status code, reference to the header hash, body
+#
+#--------------------------------------------------------------------------
+sub read_response {
+    my $socket = shift;
+    my $method = shift;
+
+    my $status_line = <$socket>;
+    return (undef, {}, undef) unless defined $status_line;
+    my @fields = split " ", $status_line;
+
+    my %header = ();
+    while (my $line = <$socket>) {
+        $line =~ s/\R\z//;
+        last if $line eq "";
+        my ($name, $value) = split /:\s*/, $line, 2;
+        $header{lc $name} = $value;
+    } # end while
+
+    my $body = "";
+    if ($method eq 'HEAD') {
+        return ($fields[1], \%header, $body);
+    } elsif (($header{'transfer-encoding'} // '') eq 'chunked') {
+        while (defined(my $line = <$socket>)) {
+            my $size = hex($line =~ s/\R\z//r);
+            my $chunk = "";
+            read($socket, $chunk, $size + 2) if $size > 0;
+            <$socket> if $size == 0;    # the empty line after the last chunk
+            last if $size == 0;
+            $body .= substr($chunk, 0, $size);
+        } # end while
+    } else {
+        my $length = $header{'content-length'} // 0;
+        while (length($body) < $length) {
+            my $n = read($socket, $body, $length - length($body), length($body));
+            last unless $n;
+        } # end while
+    } # end if
+
+    return ($fields[1], \%header, $body);
+} # end of read_response
+
+
+#--------------------------------------------------------------------------
+# Send the requests one after the other on one connection and check
+# the framing of the responses
+#
+# Parameter(s):
+# (IN) Reference to a hash containing test data
+#      'requests'  -> list of [ method, url, expected body, connection ]
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub connect_to_server {
+    my $ref = shift;
+
+    my $socket = IO::Socket::IP->new(
+                PeerAddr => $remote_host,
+                PeerPort => $remote_port,
+                Type     => SOCK_STREAM
+    ) or die "ERROR: socket() - $@";
+
+    subtest "cgi output, chunked" => sub {
+        for my $req (@{$ref->{requests}}) {
+            my ($method, $url, $content, $connection) = @$req;
+            my $request = "$method $url HTTP/1.1\r\nHost: $remote_host\r\n";
+            $request .= "Connection: $connection\r\n" if defined $connection;
+            print $socket "$request\r\n";
+
+            my ($code, $header, $body) = read_response($socket, $method);
+            is($code, 200, "$method $url: Status 200");
+            is($header->{'connection'}, $connection // 'keep-alive', "$method $url: Connection");
+            if ($url =~ m{^/cgi-bin/}) {
+                is($header->{'transfer-encoding'}, 'chunked', "$method $url: Transfer-Encoding");
+                ok(!exists $header->{'content-length'}, "$method $url: no Content-Length");
+            } # end if
+            if (defined $content) {
+                like($body, $content, "$method $url: Body");
+            } # end if
+        } # end for
+
+        my $rest = <$socket>;
+        ok(!defined $rest, "Connection closed by server");
+    };
+
+    close($socket);
+} # end of connect_to_server
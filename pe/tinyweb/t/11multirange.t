@@ -0,0 +1,144 @@
+#!/usr/bin/perl
+
+use strict;
+use warnings;
+
+use Test::More;
+use IO::Socket::IP;
+use File::stat;
+
+
+my $root_dir    = "web";
+my $remote_host = "localhost";
+my $remote_port = "8080";
+
+
+#--------------------------------------------------------------------------
+# Test Cases
+#--------------------------------------------------------------------------
+my @tests = (
+    # A single range, also as a suffix or coalesced from several
+    [ { url => "/index.html", range => "bytes=0-9",             status => 206, parts => [ [ 0, 9 ] ] } ],
+    [ { url => "/index.html", range => "bytes=-5",              status => 206, parts => [ [ -5, -1 ] ] } ],
+    [ { url => "/index.html", range => "bytes=0-4, 50-60,2-8",  status => 206, parts => [ [ 0, 60 ] ] } ],
+    [ { url => "/index.html", range => "bytes=-100000",         status => 206, parts => [ [ 0, -1 ] ] } ],
+    # Several parts as multipart/byteranges, sorted by offset
+    [ { url => "/index.html", range => "bytes=200-204,0-4",     status => 206, parts => [ [ 0, 4 ], [ 200, 204 ] ] } ],
+    [ { url => "/index.html", range => "bytes=0-0,1000-1999,-3", status => 206,
+        parts => [ [ 0, 0 ], [ 1000, 1999 ], [ -3, -1 ] ] } ],
+    # Ranges behind the end of the file
+    [ { url => "/index.html", range => "bytes=100000-",         status => 416 } ],
+    [ { url => "/index.html", range => "bytes=100000-,-0",      status => 416 } ],
+    # An invalid list is ignored
+    [ { url => "/index.html", range => "bytes=5-3",             status => 200 } ],
+    [ { url => "/index.html", range => "bytes=1-2 3-4",         status => 200 } ],
+    [ { url => "/index.html", range => "items=0-1",             status => 200 } ],
+    # Only GET requests are served partially
+    [ { url => "/index.html", range => "bytes=0-9",             status => 200, method => 'HEAD' } ],
+);
+
+# Set the number of test cases (excluding subtests)
+plan tests => scalar @tests;
+
+connect_to_server(@$_) for @tests;
+
+exit 0;
+
+
+#--------------------------------------------------------------------------
+# Read the content of a file
+#
+# Parameter(s):
+# (IN) the url
+#
+# Return value: the content
+#
+#--------------------------------------------------------------------------
+sub file_content {
+    my $url = shift;
+
+    open(my $fh, '<', "$root_dir$url") or die "ERROR: cannot open $url: $!";
+    binmode $fh;
+    my $content = do { local $/; <$fh> };
+    close($fh);
+
+    return $content;
+} # end of file_content
+
+
+#--------------------------------------------------------------------------
+# Request a file with a Range field and check the parts of the response.
+# The request is followed by a second one on the same connection, which
+# fails unless Content-Length is exact.
+#
+# Parameter(s):
+# (IN) Reference to a hash containing test data
+#      'url'    -> the requested url
+#      'range'  -> the value of the Range field
+#      'status' -> the expected status
+#      'parts'  -> the expected [ first, last ], negative from the end
+#      'method' -> the request method, GET if not set
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub connect_to_server {
+    my $ref = shift;
+    my $method = $ref->{method} // 'GET';
+    my $content = file_content($ref->{url});
+    my $size = length($content);
+
+    subtest "$method $ref->{url}, $ref->{range}" => sub {
+        my $socket = IO::Socket::IP->new(
+                    PeerAddr => $remote_host,
+                    PeerPort => $remote_port,
+                    Type     => SOCK_STREAM
+        ) or die "ERROR: socket() - $@";
+        print $socket "$method $ref->{url} HTTP/1.1\r\nHost: $remote_host\r\nRange: $ref->{range}\r\n\r\n";
+        print $socket "HEAD $ref->{url} HTTP/1.1\r\nHost: $remote_host\r\nConnection: close\r\n\r\n";
+
+        my $status_line = <$socket> // "";
+        my %header = ();
+        while (my $line = <$socket>) {
+            $line =~ s/\R\z//;
+            last if $line eq "";
+            my ($name, $value) = split /:\s*/, $line, 2;
+            $header{lc $name} = $value;
+        } # end while
+        my $body = "";
+        my $length = ($method eq 'HEAD') ? 0 : $header{'content-length'} // 0;
+        read($socket, $body, $length) if $length > 0;
+
+        like($status_line, qr{^HTTP/1.1 $ref->{status} }, "Status $ref->{status}");
+        if ($ref->{status} == 416) {
+            is($header{'content-range'}, "bytes */$size", "Content-Range");
+        } elsif ($ref->{status} == 200 && $method eq 'GET') {
+            ok($body eq $content, "Whole file");
+        } elsif ($ref->{status} == 206) {
+            my @parts = map { [ $_->[0] < 0 ? $size + $_->[0] : $_->[0],
+                                $_->[1] < 0 ? $size + $_->[1] : $_->[1] ] } @{$ref->{parts}};
+            if (@parts == 1) {
+                my ($first, $last) = @{$parts[0]};
+                is($header{'content-range'}, "bytes $first-$last/$size", "Content-Range");
+                ok($body eq substr($content, $first, $last - $first + 1), "Body");
+            } else {
+                my ($boundary) = ($header{'content-type'} // "") =~ m{^multipart/byteranges; boundary=(\S+)$};
+                ok(defined $boundary, "multipart/byteranges");
+                my $expected = "";
+                for my $part (@parts) {
+                    my ($first, $last) = @$part;
+                    $expected .= "\r\n" if length $expected;
+                    $expected .= "--$boundary\r\nContent-Type: text/html\r\n"
+                            . "Content-Range: bytes $first-$last/$size\r\n\r\n"
+                            . substr($content, $first, $last - $first + 1);
+                } # end for
+                $expected .= "\r\n--$boundary--\r\n";
+                ok($body eq $expected, "Parts");
+            } # end if
+        } # end if
+
+        my $next = <$socket> // "";
+        like($next, qr{^HTTP/1.1 200 }, "Next response on the connection");
+        close($socket);
+    };
+} # end of connect_to_server
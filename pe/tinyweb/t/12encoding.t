@@ -0,0 +1,182 @@
+#!/usr/bin/perl
+
+use strict;
+use warnings;
+
+use Test::More;
+use IO::Socket::IP;
+use IO::Uncompress::Gunzip qw(gunzip $GunzipError);
+
+
+my $root_dir    = "web";
+my $remote_host = "localhost";
+my $remote_port = "8080";
+
+
+#--------------------------------------------------------------------------
+# Test Cases
+#--------------------------------------------------------------------------
+my @tests = (
+    # A precompressed sibling is sent as it is
+    [ { url => "/encoding.html", encoding => "gzip",               expect => "gzip", sibling => 1 } ],
+    [ { url => "/encoding.html", encoding => "gzip", method => 'HEAD', expect => "gzip", sibling => 1 } ],
+    # The sibling is older than the file and ignored
+    [ { url => "/encoding.html", encoding => "gzip",               expect => undef, sibling => 1, stale => 1 } ],
+    # The variant from the cache is built in the background
+    [ { url => "/index.html",    encoding => "gzip",               expect => "gzip", retry => 1 } ],
+    [ { url => "/index.html",    encoding => "br;q=0, gzip;q=0.5", expect => "gzip", retry => 1 } ],
+    [ { url => "/index.html",    encoding => "*, gzip;q=0, br;q=0", expect => undef } ],
+    [ { url => "/index.html",    encoding => "gzip;q=0.000",       expect => undef } ],
+    [ { url => "/index.html",    encoding => undef,                expect => undef } ],
+    # The parts of a range refer to the uncompressed file
+    [ { url => "/index.html",    encoding => "gzip", range => "bytes=0-9", expect => undef } ],
+    # Images are not compressed
+    [ { url => "/images/computerhead1.gif", encoding => "gzip",             expect => undef, vary => 0 } ],
+);
+
+# Set the number of test cases (excluding subtests)
+plan tests => scalar @tests;
+
+connect_to_server(@$_) for @tests;
+
+unlink("$root_dir/encoding.html", "$root_dir/encoding.html.gz");
+
+exit 0;
+
+
+#--------------------------------------------------------------------------
+# Read the content of a file
+#
+# Parameter(s):
+# (IN) the path
+#
+# Return value: the content
+#
+#--------------------------------------------------------------------------
+sub file_content {
+    my $path = shift;
+
+    open(my $fh, '<', $path) or die "ERROR: cannot open $path: $!";
+    binmode $fh;
+    my $content = do { local $/; <$fh> };
+    close($fh);
+
+    return $content;
+} # end of file_content
+
+
+#--------------------------------------------------------------------------
+# Write a html file and its gzip sibling
+#
+# Parameter(s):
+# (IN) true if the sibling is to be older than the file
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub write_sibling {
+    my $stale = shift;
+    my $path = "$root_dir/encoding.html";
+
+    open(my $fh, '>', $path) or die "ERROR: cannot write $path: $!";
+    print $fh "<html><body>\n", map({ "<p>line $_</p>\n" } 1 .. 500), "</body></html>\n";
+    close($fh);
+    system("gzip", "-kf", $path) == 0 or die "ERROR: gzip failed";
+    utime(time() - 100, time() - 100, "$path.gz") if $stale;
+} # end of write_sibling
+
+
+#--------------------------------------------------------------------------
+# Send a request and read the response
+#
+# Parameter(s):
+# (IN) Reference to a hash containing test data
+#
+# Return value: status line, reference to the header hash, body
+#
+#--------------------------------------------------------------------------
+sub request {
+    my $ref = shift;
+    my $method = $ref->{method} // 'GET';
+
+    my $socket = IO::Socket::IP->new(
+                PeerAddr => $remote_host,
+                PeerPort => $remote_port,
+                Type     => SOCK_STREAM
+    ) or die "ERROR: socket() - $@";
+    my $request = "$method $ref->{url} HTTP/1.1\r\nHost: $remote_host\r\nConnection: close\r\n";
+    $request .= "Accept-Encoding: $ref->{encoding}\r\n" if defined $ref->{encoding};
+    $request .= "Range: $ref->{range}\r\n" if defined $ref->{range};
+    print $socket "$request\r\n";
+
+    my $status_line = <$socket> // "";
+    my %header = ();
+    while (my $line = <$socket>) {
+        $line =~ s/\R\z//;
+        last if $line eq "";
+        my ($name, $value) = split /:\s*/, $line, 2;
+        $header{lc $name} = $value;
+    } # end while
+    my $body = do { local $/; <$socket> } // "";
+    close($socket);
+
+    return ($status_line, \%header, $body);
+} # end of request
+
+
+#--------------------------------------------------------------------------
+# Request a file with an Accept-Encoding field and check the coding of
+# the response
+#
+# Parameter(s):
+# (IN) Reference to a hash containing test data
+#      'url'      -> the requested url
+#      'encoding' -> the value of the Accept-Encoding field, none if undef
+#      'expect'   -> the expected Content-Encoding, none if undef
+#      'method'   -> the request method, GET if not set
+#      'range'    -> the value of a Range field
+#      'sibling'  -> write the file and a precompressed sibling first
+#      'stale'    -> the sibling is older than the file
+#      'retry'    -> repeat the request until the variant is built
+#      'vary'     -> whether Vary is expected, 1 if not set
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub connect_to_server {
+    my $ref = shift;
+    my $method = $ref->{method} // 'GET';
+    my $title = "$method $ref->{url}, " . ($ref->{encoding} // "no Accept-Encoding");
+
+    write_sibling($ref->{stale}) if $ref->{sibling};
+    my $content = file_content("$root_dir$ref->{url}");
+
+    subtest $title => sub {
+        my ($status_line, $header, $body) = request($ref);
+        for (my $i = 0; $ref->{retry} && !defined $header->{'content-encoding'} && $i < 50; $i++) {
+            select(undef, undef, undef, 0.1);
+            ($status_line, $header, $body) = request($ref);
+        } # end for
+
+        like($status_line, qr{^HTTP/1.1 20[06] }, "Status");
+        is($header->{'content-encoding'}, $ref->{expect}, "Content-Encoding");
+        if ($ref->{vary} // 1) {
+            is($header->{'vary'}, "Accept-Encoding", "Vary");
+        } else {
+            ok(!exists $header->{'vary'}, "no Vary");
+        } # end if
+
+        if ($method eq 'HEAD') {
+            my $length = -s "$root_dir$ref->{url}.gz";
+            is($header->{'content-length'}, $length, "Content-Length of the variant");
+            is($body, "", "no body");
+        } elsif (defined $ref->{expect}) {
+            is($header->{'content-length'}, length($body), "Content-Length");
+            my $plain;
+            gunzip(\$body => \$plain) or die "ERROR: gunzip failed: $GunzipError";
+            ok($plain eq $content, "Body decoded");
+        } elsif (!defined $ref->{range}) {
+            ok($body eq $content, "Body");
+        } # end if
+    };
+} # end of connect_to_server
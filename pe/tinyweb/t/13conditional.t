@@ -0,0 +1,167 @@
+#!/usr/bin/perl
+
+use strict;
+use warnings;
+
+use Test::More;
+use IO::Socket::IP;
+use POSIX qw(strftime);
+use File::stat;
+
+
+my $root_dir    = "web";
+my $remote_host = "localhost";
+my $remote_port = "8080";
+my $url         = "/index.html";
+
+
+#--------------------------------------------------------------------------
+# Test Cases, '$etag' and '$date' are replaced with the validators of
+# the file, '$gzip' with the entity tag of its gzip variant
+#--------------------------------------------------------------------------
+my @tests = (
+    # If-None-Match
+    [ { fields => { 'If-None-Match' => '$etag' },                    status => 304 } ],
+    [ { fields => { 'If-None-Match' => 'W/$etag' },                  status => 304 } ],
+    [ { fields => { 'If-None-Match' => '"other", $etag' },           status => 304 } ],
+    [ { fields => { 'If-None-Match' => '*' },                        status => 304 } ],
+    [ { fields => { 'If-None-Match' => '"other"' },                  status => 200 } ],
+    [ { fields => { 'If-None-Match' => '$etag' }, method => 'HEAD',  status => 304 } ],
+    # If-None-Match replaces If-Modified-Since
+    [ { fields => { 'If-None-Match' => '"other"', 'If-Modified-Since' => '$date' }, status => 200 } ],
+    [ { fields => { 'If-Modified-Since' => '$date' },                status => 304 } ],
+    # If-Match
+    [ { fields => { 'If-Match' => '$etag' },                         status => 200 } ],
+    [ { fields => { 'If-Match' => '*' },                             status => 200 } ],
+    [ { fields => { 'If-Match' => '"other"' },                       status => 412 } ],
+    [ { fields => { 'If-Match' => 'W/$etag' },                       status => 412 } ],
+    # A compressed variant is compared by its own entity tag
+    [ { fields => { 'If-None-Match' => '$gzip' }, encoding => 'gzip', status => 304 } ],
+    [ { fields => { 'If-None-Match' => '$etag' }, encoding => 'gzip', status => 200 } ],
+    [ { fields => { 'If-None-Match' => '$gzip' },                    status => 200 } ],
+    [ { fields => { 'If-Match' => '$gzip' },      encoding => 'gzip', status => 200 } ],
+    [ { fields => { 'If-Match' => '$etag' },      encoding => 'gzip', status => 412 } ],
+    # If-Range
+    [ { fields => { 'Range' => 'bytes=0-9', 'If-Range' => '$etag' },   status => 206 } ],
+    [ { fields => { 'Range' => 'bytes=0-9', 'If-Range' => '"other"' }, status => 200 } ],
+    [ { fields => { 'Range' => 'bytes=0-9', 'If-Range' => 'W/$etag' }, status => 200 } ],
+    [ { fields => { 'Range' => 'bytes=0-9', 'If-Range' => '$date' },   status => 206 } ],
+    [ { fields => { 'Range' => 'bytes=0-9', 'If-Range' => 'Sun, 06 Nov 1994 08:49:37 GMT' }, status => 200 } ],
+);
+
+# Set the number of test cases (excluding subtests)
+plan tests => scalar @tests;
+
+my $st = stat($root_dir . $url) or die "ERROR: cannot access $url: $!";
+my $date = strftime("%a, %d %b %Y %H:%M:%S GMT", gmtime($st->mtime));
+my $etag = get_etag({});
+my $gzip = get_etag({ 'Accept-Encoding' => 'gzip' });
+
+connect_to_server(@$_) for @tests;
+
+exit 0;
+
+
+#--------------------------------------------------------------------------
+# Send a request and read the response header
+#
+# Parameter(s):
+# (IN) the request method
+# (IN) Reference to a hash with the additional fields
+#
+# Return value: status code, reference to the header hash, length of the body
+#
+#--------------------------------------------------------------------------
+sub request {
+    my $method = shift;
+    my $fields = shift;
+
+    my $socket = IO::Socket::IP->new(
+                PeerAddr => $remote_host,
+                PeerPort => $remote_port,
+                Type     => SOCK_STREAM
+    ) or die "ERROR: socket() - $@";
+    my $request = "$method $url HTTP/1.1\r\nHost: $remote_host\r\nConnection: close\r\n";
+    $request .= "$_: $fields->{$_}\r\n" for sort keys %$fields;
+    print $socket "$request\r\n";
+
+    my @status = split " ", <$socket> // "";
+    my %header = ();
+    while (my $line = <$socket>) {
+        $line =~ s/\R\z//;
+        last if $line eq "";
+        my ($name, $value) = split /:\s*/, $line, 2;
+        $header{lc $name} = $value;
+    } # end while
+    my $body = do { local $/; <$socket> } // "";
+    close($socket);
+
+    return ($status[1], \%header, length($body));
+} # end of request
+
+
+#--------------------------------------------------------------------------
+# Get the entity tag of the file or of a compressed variant, it is weak
+# while the file has just been modified, and the variant from the cache
+# is built in the background
+#
+# Parameter(s):
+# (IN) Reference to a hash with the additional fields
+#
+# Return value: the strong entity tag
+#
+#--------------------------------------------------------------------------
+sub get_etag {
+    my $fields = shift;
+
+    for (my $i = 0; $i < 30; $i++) {
+        my ($code, $header) = request('HEAD', $fields);
+        my $tag = $header->{'etag'} // "";
+        return $tag if $tag =~ m{^"[^"]+"$}
+                && (!exists $fields->{'Accept-Encoding'} || exists $header->{'content-encoding'});
+        select(undef, undef, undef, 0.1);
+    } # end for
+
+    die "ERROR: no strong entity tag for $url";
+} # end of get_etag
+
+
+#--------------------------------------------------------------------------
+# Send a conditional request and check the status of the response
+#
+# Parameter(s):
+# (IN) Reference to a hash containing test data
+#      'fields' -> the conditional fields
+#      'status' -> the expected status
+#      'method' -> the request method, GET if not set
+#      'encoding' -> the accepted content coding, none if not set
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub connect_to_server {
+    my $ref = shift;
+    my $method = $ref->{method} // 'GET';
+    my %fields = map { my $v = $ref->{fields}{$_}; $v =~ s/\$etag/$etag/; $v =~ s/\$gzip/$gzip/; $v =~ s/\$date/$date/; ($_ => $v) }
+            keys %{$ref->{fields}};
+    my $tag = defined $ref->{encoding} ? $gzip : $etag;
+
+    $fields{'Accept-Encoding'} = $ref->{encoding} if defined $ref->{encoding};
+
+    subtest "$method " . join(", ", map { "$_: " . ($ref->{fields}{$_} // $fields{$_}) } sort keys %fields) => sub {
+        my ($code, $header, $length) = request($method, \%fields);
+
+        is($code, $ref->{status}, "Status $ref->{status}");
+        if ($ref->{status} == 304) {
+            is($header->{'etag'}, $tag, "ETag");
+            ok(!exists $header->{'content-length'}, "no Content-Length");
+            is($length, 0, "no body");
+        } elsif ($ref->{status} == 206) {
+            is($header->{'etag'}, $tag, "ETag");
+            is($length, 10, "Part");
+        } elsif ($ref->{status} == 200 && $method eq 'GET') {
+            is($header->{'etag'}, $tag, "ETag");
+            is($length, $st->size, "Whole file") if !defined $ref->{encoding};
+        } # end if
+    };
+} # end of connect_to_server
@@ -0,0 +1,86 @@
+#!/usr/bin/perl
+
+use strict;
+use warnings;
+
+use Test::More;
+use IO::Socket::IP;
+
+
+my $root_dir    = "web";
+my $remote_host = "localhost";
+my $remote_port = "8080";
+
+
+#--------------------------------------------------------------------------
+# Test Cases, the files are created for the test
+#--------------------------------------------------------------------------
+my @tests = (
+    [ { file => "mime.js",       type => "text/javascript"  } ],
+    [ { file => "mime.json",     type => "application/json" } ],
+    [ { file => "mime.svg",      type => "image/svg+xml"    } ],
+    [ { file => "mime.png",      type => "image/png"        } ],
+    [ { file => "mime.woff2",    type => "font/woff2"       } ],
+    [ { file => "mime.mp4",      type => "video/mp4"        } ],
+    # The extension is looked up regardless of its case
+    [ { file => "mime.HTML",     type => "text/html"        } ],
+    # Only the last extension counts
+    [ { file => "mime.html.bak", type => "text/plain"       } ],
+    [ { file => "mime.tar.gz",   type => "application/gzip" } ],
+    # Files without a known extension
+    [ { file => "mime",          type => "text/plain"       } ],
+    [ { file => "mime.",         type => "text/plain"       } ],
+    [ { file => "mime.unknown",  type => "text/plain"       } ],
+);
+
+# Set the number of test cases (excluding subtests)
+plan tests => scalar @tests;
+
+connect_to_server(@$_) for @tests;
+
+exit 0;
+
+
+#--------------------------------------------------------------------------
+# Create a file and check the content type of the response
+#
+# Parameter(s):
+# (IN) Reference to a hash containing test data
+#      'file' -> the file name in the web root
+#      'type' -> the expected content type
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub connect_to_server {
+    my $ref = shift;
+    my $path = "$root_dir/$ref->{file}";
+
+    open(my $fh, '>', $path) or die "ERROR: cannot write $path: $!";
+    print $fh "content\n";
+    close($fh);
+
+    subtest "/$ref->{file}" => sub {
+        my $socket = IO::Socket::IP->new(
+                    PeerAddr => $remote_host,
+                    PeerPort => $remote_port,
+                    Type     => SOCK_STREAM
+        ) or die "ERROR: socket() - $@";
+        print $socket "HEAD /$ref->{file} HTTP/1.1\r\nHost: $remote_host\r\nConnection: close\r\n\r\n";
+
+        my $status_line = <$socket> // "";
+        my %header = ();
+        while (my $line = <$socket>) {
+            $line =~ s/\R\z//;
+            last if $line eq "";
+            my ($name, $value) = split /:\s*/, $line, 2;
+            $header{lc $name} = $value;
+        } # end while
+        close($socket);
+
+        like($status_line, qr{^HTTP/1.1 200 }, "Status 200");
+        is($header{'content-type'}, $ref->{type}, "Content-Type");
+    };
+
+    unlink($path);
+} # end of connect_to_server
@@ -0,0 +1,109 @@
+#!/usr/bin/perl
+
+use strict;
+use warnings;
+
+use Test::More;
+use IO::Socket::IP;
+
+
+my $root_dir    = "web";
+my $remote_host = "localhost";
+my $remote_port = "8080";
+
+
+#--------------------------------------------------------------------------
+# Test Cases, the paths are sent as they are
+#--------------------------------------------------------------------------
+my @tests = (
+    # Paths naming a file below the root
+    [ { url => "//index.html",               status => 200 } ],
+    [ { url => "/./index.html",              status => 200 } ],
+    [ { url => "/css/../index.html",         status => 200 } ],
+    [ { url => "/css/.././/index.html",      status => 200 } ],
+    [ { url => "/%69ndex.html",              status => 200 } ],
+    [ { url => "/.",                         status => 200 } ],
+    # Paths leaving the root or with a malformed escape
+    [ { url => "/..",                        status => 400 } ],
+    [ { url => "/../web/index.html",         status => 400 } ],
+    [ { url => "/css/../../web/index.html",  status => 400 } ],
+    [ { url => "/%2e%2e/web/index.html",     status => 400 } ],
+    [ { url => "/%2E%2E%2fweb/index.html",   status => 400 } ],
+    [ { url => "/index.html%00.txt",         status => 400 } ],
+    [ { url => "/index%zz.html",             status => 400 } ],
+    [ { url => "/index.html%",               status => 400 } ],
+    # A missing file is found missing again from the cache
+    [ { url => "/missing.html",              status => 404 } ],
+    [ { url => "/missing.html",              status => 404 } ],
+    [ { url => "/index.html/",               status => 404 } ],
+    # Directories
+    [ { url => "/css",                       status => 301, location => "/css/" } ],
+    [ { url => "/css",                       status => 301, location => "/css/" } ],
+    [ { url => "//css",                      status => 301, location => "/css/" } ],
+    [ { url => "/source/../css",             status => 301, location => "/css/" } ],
+    [ { url => "/css/",                      status => 403 } ],
+    [ { url => "/css/.",                     status => 403 } ],
+    # Only the directory /cgi-bin holds scripts
+    [ { url => "/cgi-bin.html",              status => 200 } ],
+    [ { url => "/cgi-bin",                   status => 301, location => "/cgi-bin/" } ],
+    # Symbolic links must not lead out of the root
+    [ { url => "/outside/etc/passwd",        status => 404 } ],
+    [ { url => "/css/outside/etc/passwd",    status => 404 } ],
+);
+
+# Set the number of test cases (excluding subtests)
+plan tests => scalar @tests;
+
+unlink("$root_dir/outside", "$root_dir/css/outside");
+open(my $fh, '>', "$root_dir/cgi-bin.html") or die "ERROR: cannot create $root_dir/cgi-bin.html: $!";
+print $fh "<html></html>\n";
+close($fh);
+symlink("/", "$root_dir/outside") or die "ERROR: cannot create $root_dir/outside: $!";
+symlink("../../../../../../../..", "$root_dir/css/outside") or die "ERROR: cannot create $root_dir/css/outside: $!";
+
+connect_to_server(@$_) for @tests;
+
+unlink("$root_dir/outside", "$root_dir/css/outside", "$root_dir/cgi-bin.html");
+
+exit 0;
+
+
+#--------------------------------------------------------------------------
+# Send a request for a path and check the status of the response
+#
+# Parameter(s):
+# (IN) Reference to a hash containing test data
+#      'url'      -> the path of the request
+#      'status'   -> the expected status
+#      'location' -> the expected location of a redirection
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub connect_to_server {
+    my $ref = shift;
+
+    subtest "GET '$ref->{url}'" => sub {
+        my $socket = IO::Socket::IP->new(
+                    PeerAddr => $remote_host,
+                    PeerPort => $remote_port,
+                    Type     => SOCK_STREAM
+        ) or die "ERROR: socket() - $@";
+        print $socket "GET $ref->{url} HTTP/1.1\r\nHost: $remote_host\r\nConnection: close\r\n\r\n";
+
+        my @status = split " ", <$socket> // "";
+        my %header = ();
+        while (my $line = <$socket>) {
+            $line =~ s/\R\z//;
+            last if $line eq "";
+            my ($name, $value) = split /:\s*/, $line, 2;
+            $header{lc $name} = $value;
+        } # end while
+        close($socket);
+
+        is($status[1], $ref->{status}, "Status $ref->{status}");
+        if (defined $ref->{location}) {
+            like($header{'location'} // "", qr{\Q$ref->{location}\E$}, "Location");
+        } # end if
+    };
+} # end of connect_to_server
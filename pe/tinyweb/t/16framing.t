@@ -0,0 +1,92 @@
+#!/usr/bin/perl
+
+use strict;
+use warnings;
+
+use Test::More;
+use IO::Socket::IP;
+use Time::HiRes qw(usleep);
+
+
+my $remote_host = "localhost";
+my $remote_port = "8080";
+my $request     = "GET /index.html HTTP/1.1\r\nHost: $remote_host\r\n";
+
+
+#--------------------------------------------------------------------------
+# Test Cases, each part is written separately
+#--------------------------------------------------------------------------
+my @tests = (
+    # A slow client sending the header in small segments
+    [ { name => "segments", parts => [ "${request}Connection: close\r\n\r\n" =~ /(.{1,5})/gs ],
+        status => [ 200 ] } ],
+    [ { name => "empty line apart", parts => [ "${request}Connection: close\r\n", "\r", "\n" ],
+        status => [ 200 ] } ],
+    # Headers larger than the first buffer grow it
+    [ { name => "20 kB header", parts => [ $request . ("X-Filler: " . ("x" x 400) . "\r\n") x 50 . "Connection: close\r\n\r\n" ],
+        status => [ 200 ] } ],
+    [ { name => "100 lines", parts => [ $request . ("X-Filler: x\r\n") x 97 . "Connection: close\r\n\r\n" ],
+        status => [ 200 ] } ],
+    # Pipelined requests stay in the buffer
+    [ { name => "pipelined", parts => [ "$request\r\n" . $request . ("X-Filler: " . ("x" x 400) . "\r\n") x 20
+                . "\r\n${request}Connection: close\r\n\r\n" ],
+        status => [ 200, 200, 200 ] } ],
+    # Limits
+    [ { name => "101 lines", parts => [ $request . ("X-Filler: x\r\n") x 98 . "Connection: close\r\n\r\n" ],
+        status => [ 431 ] } ],
+    [ { name => "70 kB header", parts => [ $request . ("X-Filler: " . ("x" x 1000) . "\r\n") x 70 . "\r\n" ],
+        status => [ 431 ] } ],
+    [ { name => "70 kB request line", parts => [ "GET /" . ("x" x 70000) . " HTTP/1.1\r\n\r\n" ],
+        status => [ 414 ] } ],
+);
+
+# Set the number of test cases (excluding subtests)
+plan tests => scalar @tests;
+
+connect_to_server(@$_) for @tests;
+
+exit 0;
+
+
+#--------------------------------------------------------------------------
+# Send the parts of a request and check the status of each response
+#
+# Parameter(s):
+# (IN) Reference to a hash containing test data
+#      'name'   -> the name of the test
+#      'parts'  -> the parts of the request, written with a pause
+#      'status' -> the expected status of each response
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub connect_to_server {
+    my $ref = shift;
+
+    subtest $ref->{name} => sub {
+        my $socket = IO::Socket::IP->new(
+                    PeerAddr => $remote_host,
+                    PeerPort => $remote_port,
+                    Type     => SOCK_STREAM
+        ) or die "ERROR: socket() - $@";
+        $socket->autoflush(1);
+        for my $part (@{$ref->{parts}}) {
+            print $socket $part;
+            usleep(20000);
+        } # end for
+        shutdown($socket, 1);
+
+        for my $status (@{$ref->{status}}) {
+            my @status = split " ", <$socket> // "";
+            my $length = 0;
+            while (my $line = <$socket>) {
+                $line =~ s/\R\z//;
+                last if $line eq "";
+                $length = $1 if $line =~ /^Content-Length:\s*(\d+)/i;
+            } # end while
+            read($socket, my $body, $length) if $length > 0;
+            is($status[1], $status, "Status $status");
+        } # end for
+        close($socket);
+    };
+} # end of connect_to_server
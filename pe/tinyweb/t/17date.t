@@ -0,0 +1,105 @@
+#!/usr/bin/perl
+
+use strict;
+use warnings;
+
+use Test::More;
+use IO::Socket::IP;
+use POSIX qw(strftime);
+use File::stat;
+
+
+my $root_dir    = "web";
+my $remote_host = "localhost";
+my $remote_port = "8080";
+my $url         = "/index.html";
+
+
+my $st = stat($root_dir . $url) or die "ERROR: cannot access $url: $!";
+my $mtime = $st->mtime;
+
+#--------------------------------------------------------------------------
+# Test Cases, the dates of If-Modified-Since in the three formats
+#--------------------------------------------------------------------------
+my @tests = (
+    [ { date => strftime("%a, %d %b %Y %H:%M:%S GMT", gmtime($mtime)),        status => 304 } ],
+    [ { date => strftime("%A, %d-%b-%y %H:%M:%S GMT", gmtime($mtime)),        status => 304 } ],
+    [ { date => strftime("%a %b %e %H:%M:%S %Y", gmtime($mtime)),             status => 304 } ],
+    [ { date => strftime("%a, %d %b %Y %H:%M:%S GMT", gmtime($mtime - 1)),    status => 200 } ],
+    [ { date => strftime("%a, %d %b %Y %H:%M:%S GMT", gmtime($mtime + 86400)), status => 304 } ],
+    # Malformed dates are ignored
+    [ { date => strftime("%a, %d %b %Y %H:%M:%S UTC", gmtime($mtime)),        status => 200 } ],
+    [ { date => strftime("%a, %d %b %Y %H:%M:%S GMT", gmtime($mtime + 86400 * 3)) =~ s/^.../Xyz/r, status => 200 } ],
+    [ { date => "Tue, 29 Feb 2100 00:00:00 GMT",                              status => 200 } ],
+    [ { date => "yesterday",                                                  status => 200 } ],
+);
+
+# Set the number of test cases (excluding subtests)
+plan tests => scalar @tests + 1;
+
+connect_to_server(@$_) for @tests;
+
+subtest "Date and Last-Modified" => sub {
+    my ($code, $header) = request({});
+    like($header->{'date'}, qr{^(Mon|Tue|Wed|Thu|Fri|Sat|Sun), \d\d (Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|Sep|Oct|Nov|Dec) \d{4} \d\d:\d\d:\d\d GMT$},
+            "Date");
+    is($header->{'last-modified'}, strftime("%a, %d %b %Y %H:%M:%S GMT", gmtime($mtime)), "Last-Modified");
+};
+
+exit 0;
+
+
+#--------------------------------------------------------------------------
+# Send a HEAD request and read the response header
+#
+# Parameter(s):
+# (IN) Reference to a hash with the additional fields
+#
+# Return value: status code, reference to the header hash
+#
+#--------------------------------------------------------------------------
+sub request {
+    my $fields = shift;
+
+    my $socket = IO::Socket::IP->new(
+                PeerAddr => $remote_host,
+                PeerPort => $remote_port,
+                Type     => SOCK_STREAM
+    ) or die "ERROR: socket() - $@";
+    my $request = "HEAD $url HTTP/1.1\r\nHost: $remote_host\r\nConnection: close\r\n";
+    $request .= "$_: $fields->{$_}\r\n" for sort keys %$fields;
+    print $socket "$request\r\n";
+
+    my @status = split " ", <$socket> // "";
+    my %header = ();
+    while (my $line = <$socket>) {
+        $line =~ s/\R\z//;
+        last if $line eq "";
+        my ($name, $value) = split /:\s*/, $line, 2;
+        $header{lc $name} = $value;
+    } # end while
+    close($socket);
+
+    return ($status[1], \%header);
+} # end of request
+
+
+#--------------------------------------------------------------------------
+# Send a request with If-Modified-Since and check the status
+#
+# Parameter(s):
+# (IN) Reference to a hash containing test data
+#      'date'   -> the value of If-Modified-Since
+#      'status' -> the expected status
+#
+# Return value: NONE
+#
+#--------------------------------------------------------------------------
+sub connect_to_server {
+    my $ref = shift;
+
+    subtest "If-Modified-Since: $ref->{date}" => sub {
+        my ($code) = request({ 'If-Modified-Since' => $ref->{date} });
+        is($code, $ref->{status}, "Status $ref->{status}");
+    };
+} # end of connect_to_server